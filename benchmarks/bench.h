@@ -0,0 +1,55 @@
+#ifndef NETLYZER_BENCH_H
+#define NETLYZER_BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+
+// Minimal timing harness: runs `body` in growing batches until a batch takes
+// long enough to time reliably, then reports the best of a few batches.
+namespace bench {
+
+template<typename T>
+inline void do_not_optimize(const T& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+template<typename Body>
+double ns_per_call(Body&& body, double min_batch_ms = 50, int repeats = 5)
+{
+    using clock = std::chrono::steady_clock;
+    uint64_t iterations = 1;
+    for (;;) {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+            body(i);
+        double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+        if (ms >= min_batch_ms)
+            break;
+        iterations *= 2;
+    }
+
+    double best = 1e300;
+    for (int r = 0; r < repeats; ++r) {
+        auto start = clock::now();
+        for (uint64_t i = 0; i < iterations; ++i)
+            body(i);
+        double ns = std::chrono::duration<double, std::nano>(clock::now() - start).count();
+        if (ns / iterations < best)
+            best = ns / iterations;
+    }
+    return best;
+}
+
+inline void report(const char* name, double ns, double baseline_ns = 0)
+{
+    if (baseline_ns > 0)
+        std::printf("  %-36s %9.1f ns  (%.1fx)\n", name, ns, baseline_ns / ns);
+    else
+        std::printf("  %-36s %9.1f ns\n", name, ns);
+}
+
+} // namespace bench
+
+#endif // NETLYZER_BENCH_H
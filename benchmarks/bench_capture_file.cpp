@@ -0,0 +1,147 @@
+// Opening a capture file: how long until the first screen of frames is
+// indexed, decoded and stored, and the rate of the pass over the rest, with
+// the packet bytes left in the mapping. Writes a pcap of synthetic TCP
+// frames to the temporary directory; run with a packet count to try other
+// sizes. A second run reads it from the page cache, as reopening a file
+// would; drop caches between runs to time a cold disk. Then dissection of
+// the indexed frames on a ParallelDissector at 1, 4, 16 and 32 threads;
+// more threads than cores only measure the overhead.
+#include "bench.h"
+#include "netlyzer/core/parallel_dissector.h"
+#include "netlyzer/network/capture_file.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> tcp_frame(uint32_t flow, size_t size)
+{
+    std::vector<uint8_t> frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                                  0x45, 0, 0, 40, 0, 1, 0x40, 0, 64, 6, 0, 0,
+                                  10, 0, static_cast<uint8_t>(flow >> 8), static_cast<uint8_t>(flow),
+                                  192, 168, 0, 1, 0x04, 0x00, 0x01, 0xbb,
+                                  0, 0, 0, 1, 0, 0, 0, 0, 0x50, 0x10, 0xff, 0xff, 0, 0, 0, 0};
+    frame.resize(size, 0x5a);
+    return frame;
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t value)
+{
+    const size_t at = out.size();
+    out.resize(at + 4);
+    std::memcpy(&out[at], &value, 4);
+}
+
+// Mostly small frames with a full-sized one in every eight, like web traffic.
+bool write_pcap(const std::string& path, size_t packets)
+{
+    FILE* file = std::fopen(path.c_str(), "wb");
+    if (!file)
+        return false;
+    std::vector<uint8_t> out;
+    for (uint32_t value : {0xa1b23c4du, 0x00040002u, 0u, 0u, 262144u, 1u})
+        put32(out, value);
+    for (size_t i = 0; i < packets; ++i) {
+        const std::vector<uint8_t> frame = tcp_frame(static_cast<uint32_t>(i % 4096), i % 8 == 0 ? 1514 : 66);
+        put32(out, static_cast<uint32_t>(1700000000 + i / 100000));
+        put32(out, static_cast<uint32_t>(i % 100000 * 10000));
+        put32(out, static_cast<uint32_t>(frame.size()));
+        put32(out, static_cast<uint32_t>(frame.size()));
+        out.insert(out.end(), frame.begin(), frame.end());
+        if (out.size() > (8u << 20)) {
+            std::fwrite(out.data(), 1, out.size(), file);
+            out.clear();
+        }
+    }
+    std::fwrite(out.data(), 1, out.size(), file);
+    return std::fclose(file) == 0;
+}
+
+double ms_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t packets = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 4000000;
+    const char* directory = std::getenv("TMPDIR");
+    const std::string path = std::string(directory ? directory : "/tmp") + "/netlyzer-bench.pcap";
+    if (!write_pcap(path, packets)) {
+        std::perror(path.c_str());
+        return 1;
+    }
+
+    for (int run = 0; run < 2; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        CaptureFile file;
+        if (!file.open(path)) {
+            std::fprintf(stderr, "%s\n", file.last_error().c_str());
+            return 1;
+        }
+        PacketStore::Config config;
+        config.mapped_file = file.mapping();
+        PacketStore store(config);
+
+        std::vector<CaptureFile::Frame> frames(4096);
+        double first_ms = 0;
+        double index_ms = 0;
+        while (size_t count = file.read(frames.data(), frames.size())) {
+            const auto batch = std::chrono::steady_clock::now();
+            for (size_t i = 0; i < count; ++i) {
+                const CaptureFile::Frame& frame = frames[i];
+                DecodedPacket decoded;
+                PacketDecoder::decode(file.data(frame), frame.captured_length, frame.length, decoded);
+                store.append_mapped(frame.timestamp_ns, frame.length, 0, frame.offset, frame.captured_length,
+                                    decoded);
+            }
+            if (first_ms == 0)
+                first_ms = ms_since(start);
+            index_ms -= ms_since(batch);
+        }
+        const double total_ms = ms_since(start);
+        index_ms += total_ms;
+
+        std::printf("%s: %zu packets, %.0f MB (%s)\n", path.c_str(), store.size(), file.size() / 1e6,
+                    run == 0 ? "just written" : "again");
+        std::printf("  first %zu frames stored after %8.2f ms\n", frames.size(), first_ms);
+        std::printf("  whole file stored in            %8.2f ms  (%.2f GB/s, %.0f ns per packet)\n", total_ms,
+                    file.size() / total_ms / 1e6, total_ms * 1e6 / store.size());
+        std::printf("  of which header pass            %8.2f ms  (%.0f ns per packet)\n", index_ms,
+                    index_ms * 1e6 / store.size());
+        std::printf("  packet bytes copied             %8zu bytes\n", store.contents().data_bytes());
+    }
+
+    CaptureFile file;
+    if (!file.open(path))
+        return 1;
+    std::vector<CaptureFile::Frame> frames(packets);
+    frames.resize(file.read(frames.data(), frames.size()));
+    std::printf("dissecting %zu indexed frames, %u cores\n", frames.size(), std::thread::hardware_concurrency());
+    double single = 0;
+    for (unsigned threads : {1u, 4u, 16u, 32u}) {
+        PacketStore::Config config;
+        config.mapped_file = file.mapping();
+        PacketStore store(config);
+        ParallelDissector dissector(threads);
+        const size_t batch = 1u << 18;
+        const auto start = std::chrono::steady_clock::now();
+        for (size_t first = 0; first < frames.size(); first += batch)
+            dissector.append(store, file, &frames[first], std::min(batch, frames.size() - first));
+        const double rate = store.size() / ms_since(start) * 1e3;
+        if (threads == 1)
+            single = rate;
+        std::printf("  %2u threads %12.0f packets/s  (%.1fx)\n", threads, rate, rate / single);
+    }
+    unlink(path.c_str());
+    return 0;
+}
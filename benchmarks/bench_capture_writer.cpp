@@ -0,0 +1,75 @@
+// Recording to disk: what write() costs the capture thread, the longest it
+// was held up, and what reached the file, for each backend. A capture
+// thread replays synthetic web-like traffic at a fixed packet rate (3
+// million packets a second, about 6 Gb/s, by default; pass packets per
+// second and seconds to try others), so a disk that cannot keep up shows as
+// drops rather than as a slower loop. With fewer cores than threads the
+// slowest write() mostly measures the capture thread being descheduled.
+// Writes to the temporary directory.
+#include "bench.h"
+#include "netlyzer/network/capture_writer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    const double rate = argc > 1 ? std::strtod(argv[1], nullptr) : 3000000;
+    const double seconds = argc > 2 ? std::strtod(argv[2], nullptr) : 2;
+    const char* directory = std::getenv("TMPDIR");
+    const std::string path = std::string(directory ? directory : "/tmp") + "/netlyzer-bench-record.pcap";
+
+    std::vector<uint8_t> frame(1514, 0x5a);
+    std::printf("%.0f packets/s for %.0f s to %s\n", rate, seconds, path.c_str());
+    for (bool io_uring : {false, true}) {
+        CaptureWriter::Config config;
+        config.path = path;
+        config.use_io_uring = io_uring;
+        CaptureWriter writer;
+        if (!writer.open(config)) {
+            std::fprintf(stderr, "%s\n", writer.last_error().c_str());
+            return 1;
+        }
+
+        using clock = std::chrono::steady_clock;
+        const auto start = clock::now();
+        const uint64_t packets = static_cast<uint64_t>(rate * seconds);
+        double busy_ns = 0;
+        double worst_ns = 0;
+        for (uint64_t i = 0; i < packets; ++i) {
+            // Paced in bursts of 64, as a capture thread takes packets from
+            // a ring block.
+            if (i % 64 == 0) {
+                const auto due = start + std::chrono::nanoseconds(static_cast<uint64_t>(i * 1e9 / rate));
+                while (clock::now() < due) {
+                }
+            }
+            const uint32_t size = i % 8 == 0 ? 1514 : 66;
+            const auto before = clock::now();
+            writer.write(i * 1000, size, 0, frame.data(), size);
+            const double ns = std::chrono::duration<double, std::nano>(clock::now() - before).count();
+            busy_ns += ns;
+            worst_ns = std::max(worst_ns, ns);
+        }
+        const double elapsed = std::chrono::duration<double>(clock::now() - start).count();
+        writer.close();
+        const CaptureWriter::Statistics stats = writer.get_statistics();
+
+        std::printf("%s:\n", writer.backend() == CaptureWriter::Backend::IoUring ? "io_uring" : "writev");
+        bench::report("write() per packet", busy_ns / packets);
+        bench::report("slowest write()", worst_ns);
+        std::printf("  %-36s %9.0f packets/s\n", "offered", packets / elapsed);
+        std::printf("  %-36s %9.0f MB/s\n", "written", stats.bytes / elapsed / 1e6);
+        std::printf("  %-36s %9llu of %llu\n", "dropped", static_cast<unsigned long long>(stats.dropped_packets),
+                    static_cast<unsigned long long>(packets));
+        std::printf("  %-36s %9llu (%llu buffers at most)\n", "writes", static_cast<unsigned long long>(stats.writes),
+                    static_cast<unsigned long long>(stats.buffers_high_water));
+    }
+    unlink(path.c_str());
+    return 0;
+}
@@ -0,0 +1,64 @@
+// One's-complement summation throughput for each ChecksumVerifier path, and
+// the cost of verifying a whole decoded TCP packet.
+#include "bench.h"
+#include "netlyzer/network/checksum.h"
+#include <vector>
+
+namespace {
+
+void run_sum(size_t length)
+{
+    std::vector<uint8_t> data(length);
+    for (size_t i = 0; i < length; ++i)
+        data[i] = static_cast<uint8_t>(i * 131);
+
+    struct Variant { const char* name; ChecksumVerifier::Path path; };
+    const Variant variants[] = {
+        {"scalar", ChecksumVerifier::Path::Scalar},
+        {"SSE2", ChecksumVerifier::Path::Sse2},
+        {"AVX2", ChecksumVerifier::Path::Avx2},
+    };
+
+    std::printf("%zu-byte buffer\n", length);
+    double base = 0;
+    for (const Variant& variant : variants) {
+        if (!ChecksumVerifier::has_path(variant.path)) {
+            std::printf("  (no %s on this CPU)\n", variant.name);
+            continue;
+        }
+        const double ns = bench::ns_per_call([&](uint64_t) {
+            bench::do_not_optimize(ChecksumVerifier::fold(
+                ChecksumVerifier::add(data.data(), data.size(), 0, variant.path)));
+        });
+        if (base == 0)
+            base = ns;
+        std::printf("  %-36s %9.2f GB/s  (%.1fx)\n", variant.name, length / ns, base / ns);
+    }
+}
+
+} // namespace
+
+int main()
+{
+    run_sum(64);
+    run_sum(1500);
+    run_sum(9000);
+
+    // Full-size IPv4/TCP frame; checksums do not match, which costs the same.
+    std::vector<uint8_t> frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                                  0x45, 0, 0x05, 0xdc, 0, 0, 0x40, 0, 64, 6, 0, 0, 10, 0, 0, 1, 10, 0, 0, 2,
+                                  0x04, 0xd2, 0x00, 0x50, 0, 0, 0, 1, 0, 0, 0, 0, 0x50, 0x18, 0xff, 0xff, 0, 0, 0, 0};
+    frame.resize(14 + 1500, 0x5a);
+    DecodedPacket decoded;
+    PacketDecoder::decode(frame.data(), static_cast<uint32_t>(frame.size()),
+                          static_cast<uint32_t>(frame.size()), decoded);
+    std::printf("Verify 1514-byte IPv4/TCP frame\n");
+    const double ns = bench::ns_per_call([&](uint64_t) {
+        DecodedPacket packet = decoded;
+        ChecksumVerifier::verify(frame.data(), static_cast<uint32_t>(frame.size()), packet);
+        bench::do_not_optimize(packet.flags);
+    });
+    bench::report("IPv4 header + TCP", ns);
+    std::printf("  %-36s %9.2f GB/s\n", "", frame.size() / ns);
+    return 0;
+}
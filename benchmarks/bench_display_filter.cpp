@@ -0,0 +1,102 @@
+// Display filters over a large capture: resolving them through PacketIndex
+// bitmaps against scanning every row of the store, plus what the index
+// costs at ingest and in memory. Run with a row count to try other sizes.
+#include "bench.h"
+#include "netlyzer/core/display_filter.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace {
+
+// Clients 10.0.x.y talk to 16 servers: HTTPS and HTTP over TCP, DNS over UDP.
+std::vector<uint8_t> frame(uint32_t flow)
+{
+    const bool udp = flow % 5 == 0;
+    const uint16_t client_port = static_cast<uint16_t>(32768 + flow * 7 % 28000);
+    const uint16_t server_port = udp ? 53 : flow % 3 == 0 ? 80 : 443;
+    std::vector<uint8_t> bytes = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                                  0x45, 0, 0, 40, 0, 1, 0x40, 0, 64, static_cast<uint8_t>(udp ? 17 : 6), 0, 0,
+                                  10, 0, static_cast<uint8_t>(flow >> 8), static_cast<uint8_t>(flow),
+                                  192, 168, 0, static_cast<uint8_t>(flow % 16),
+                                  static_cast<uint8_t>(client_port >> 8), static_cast<uint8_t>(client_port),
+                                  static_cast<uint8_t>(server_port >> 8), static_cast<uint8_t>(server_port)};
+    if (udp)
+        bytes.insert(bytes.end(), {0, 8, 0, 0});
+    else
+        bytes.insert(bytes.end(), {0, 0, 0, 1, 0, 0, 0, 0, 0x50, 0x10, 0xff, 0xff, 0, 0, 0, 0});
+    return bytes;
+}
+
+double ms_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    const size_t rows = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 50000000;
+    std::vector<DecodedPacket> decoded(4096);
+    for (uint32_t flow = 0; flow < decoded.size(); ++flow) {
+        const std::vector<uint8_t> bytes = frame(flow);
+        PacketDecoder::decode(bytes.data(), static_cast<uint32_t>(bytes.size()), 1514, decoded[flow]);
+    }
+
+    // Headers only, so the store holds just the metadata columns.
+    PacketStore store;
+    PacketIndex index;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rows; ++i)
+        store.append(1700000000000000000ull + i * 10000, 1514, 0, nullptr, 0, decoded[(i * 2654435761u) & 4095]);
+    const double store_ms = ms_since(start);
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rows; ++i)
+        index.add(store.contents(), i);
+    const double index_ms = ms_since(start);
+
+    std::printf("%zu packets\n", rows);
+    bench::report("append to store, per packet", store_ms * 1e6 / rows);
+    bench::report("add to index, per packet", index_ms * 1e6 / rows);
+    std::printf("  index %.1f bytes per packet (store metadata %.1f)\n",
+                static_cast<double>(index.memory_bytes()) / rows,
+                static_cast<double>(store.contents().metadata_bytes()) / rows);
+
+    const char* const filters[] = {
+        "tcp",
+        "tcp.port == 443",
+        "ip.addr == 10.0.3.7",
+        "udp and ip.dst == 192.168.0.5",
+        "not tcp.port == 443 and not udp",
+        "tcp.srcport >= 60000",
+        "frame.time_relative >= 10 and frame.time_relative < 11",
+    };
+    for (const char* text : filters) {
+        DisplayFilter filter;
+        if (!filter.parse(text)) {
+            std::printf("  %s: %s\n", text, filter.last_error().c_str());
+            continue;
+        }
+        uint64_t matched = 0;
+        const double ns = bench::ns_per_call([&](uint64_t) {
+            matched = filter.evaluate(index, store.contents()).cardinality();
+        }, 1, 3);
+        std::printf("  %-56s %8.2f ms  %10llu rows\n", text, ns / 1e6, static_cast<unsigned long long>(matched));
+    }
+
+    // What every filter cost before: a pass over each row.
+    const PacketStore::Contents& contents = store.contents();
+    const double scan_ns = bench::ns_per_call([&](uint64_t) {
+        uint64_t matched = 0;
+        for (size_t i = 0; i < rows; ++i) {
+            const PacketStore::Row row = contents[i];
+            matched += row.has(DecodedPacket::TCP) && (row.source_port() == 443 || row.dest_port() == 443);
+        }
+        bench::do_not_optimize(matched);
+    }, 1, 1);
+    std::printf("  %-56s %8.2f ms\n", "tcp.port == 443, scanning the columns row by row", scan_ns / 1e6);
+    return 0;
+}
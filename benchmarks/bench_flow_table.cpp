@@ -0,0 +1,86 @@
+// Per-packet cost of FlowTable updates with many concurrent flows, one
+// packet at a time against whole TupleBatch blocks with prefetching.
+#include "bench.h"
+#include "netlyzer/network/flow_table.h"
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+
+namespace {
+
+constexpr size_t BLOCKS = 64;
+
+void run(size_t flows)
+{
+    // Packets of random flows, so nearly every lookup misses the cache.
+    std::mt19937 random(1);
+    const size_t packets = BLOCKS * TupleBatch::CAPACITY;
+    std::vector<DecodedPacket> decoded(packets);
+    std::vector<std::unique_ptr<TupleBatch>> blocks;
+    for (size_t b = 0; b < BLOCKS; ++b) {
+        auto batch = std::make_unique<TupleBatch>();
+        for (size_t i = 0; i < TupleBatch::CAPACITY; ++i) {
+            const uint32_t flow = static_cast<uint32_t>(random() % flows);
+            const uint32_t source = 0x0a000000u | (flow >> 4);
+            const uint16_t port = static_cast<uint16_t>(1024 + (flow & 15));
+            batch->timestamp_ns[i] = 1;
+            batch->wire_length[i] = 1514;
+            batch->source_ipv4[i] = source;
+            batch->dest_ipv4[i] = 0xc0a80001u;
+            batch->source_port[i] = port;
+            batch->dest_port[i] = 443;
+            batch->family[i] = TupleBatch::IPV4;
+            batch->protocol[i] = 6;
+            batch->tcp_flags[i] = 0x10;
+
+            DecodedPacket& packet = decoded[b * TupleBatch::CAPACITY + i];
+            std::memset(&packet, 0, sizeof(packet));
+            packet.flags = DecodedPacket::IPV4 | DecodedPacket::TCP;
+            const uint8_t source_bytes[4] = {10, static_cast<uint8_t>(source >> 16), static_cast<uint8_t>(source >> 8),
+                                             static_cast<uint8_t>(source)};
+            const uint8_t dest_bytes[4] = {192, 168, 0, 1};
+            std::memcpy(packet.source_address, source_bytes, 4);
+            std::memcpy(packet.dest_address, dest_bytes, 4);
+            packet.source_port = port;
+            packet.dest_port = 443;
+            packet.ip_protocol = 6;
+            packet.tcp_flags = 0x10;
+            packet.wire_length = 1514;
+        }
+        batch->count = TupleBatch::CAPACITY;
+        blocks.push_back(std::move(batch));
+    }
+
+    FlowTable::Config config;
+    config.capacity = flows * 2;
+    std::printf("%zu flows in %zu MiB, per packet\n", flows, config.capacity * FlowTable::SLOT_SIZE >> 20);
+
+    FlowTable by_packet(config);
+    for (const DecodedPacket& packet : decoded)
+        by_packet.update(packet, 1);
+    const double base = bench::ns_per_call([&](uint64_t) {
+        for (const DecodedPacket& packet : decoded)
+            by_packet.update(packet, 1);
+    }) / static_cast<double>(packets);
+    bench::report("update(DecodedPacket)", base);
+
+    FlowTable by_batch(config);
+    for (const auto& batch : blocks)
+        by_batch.update(*batch);
+    const double batched = bench::ns_per_call([&](uint64_t) {
+        for (const auto& batch : blocks)
+            by_batch.update(*batch);
+    }) / static_cast<double>(packets);
+    bench::report("update(TupleBatch), prefetched", batched, base);
+}
+
+} // namespace
+
+int main()
+{
+    run(1u << 12);
+    run(1u << 20);
+    run(1u << 22);
+    return 0;
+}
@@ -0,0 +1,147 @@
+// Per-call cost of the address and hex renderers in netlyzer/utils/format.h
+// against the implementations they replace.
+#include "bench.h"
+#include "netlyzer/utils/format.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// The previous PacketParser::mac_to_string.
+std::string mac_iostream(const uint8_t* mac)
+{
+    std::stringstream ss;
+    ss << std::hex << std::setfill('0');
+    for (int i = 0; i < 6; ++i) {
+        if (i > 0) ss << ":";
+        ss << std::setw(2) << static_cast<unsigned>(mac[i]);
+    }
+    return ss.str();
+}
+
+// Stand-in for HexDumpWidget's old per-byte QString::arg(): one formatted
+// append per byte.
+std::string hex_dump_per_byte(const uint8_t* data, size_t size)
+{
+    std::string result;
+    char text[32];
+    for (size_t i = 0; i < size; i += 16) {
+        std::snprintf(text, sizeof(text), "%04zX  ", i);
+        result += text;
+        std::string ascii;
+        for (size_t j = 0; j < 16; ++j) {
+            if (i + j < size) {
+                std::snprintf(text, sizeof(text), "%02X ", data[i + j]);
+                result += text;
+                ascii += (data[i + j] >= 32 && data[i + j] <= 126) ? static_cast<char>(data[i + j]) : '.';
+            } else {
+                result += "   ";
+                ascii += ' ';
+            }
+            if (j == 7)
+                result += " ";
+        }
+        result += " |" + ascii + "|\n";
+    }
+    return result;
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<uint8_t> packet(1514);
+    for (size_t i = 0; i < packet.size(); ++i)
+        packet[i] = static_cast<uint8_t>(i * 131 + 7);
+
+    std::printf("MAC address\n");
+    double base = bench::ns_per_call([&](uint64_t i) {
+        bench::do_not_optimize(mac_iostream(packet.data() + (i & 255)));
+    });
+    bench::report("stringstream (old mac_to_string)", base);
+    bench::report("format_mac", bench::ns_per_call([&](uint64_t i) {
+        char text[netlyzer::MAC_STRING_LENGTH];
+        bench::do_not_optimize(netlyzer::format_mac(packet.data() + (i & 255), text));
+        bench::do_not_optimize(text);
+    }), base);
+
+    std::printf("IPv4 address\n");
+    base = bench::ns_per_call([&](uint64_t i) {
+        struct in_addr address;
+        std::memcpy(&address, packet.data() + (i & 255), 4);
+        char text[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &address, text, sizeof(text));
+        bench::do_not_optimize(std::string(text));
+    });
+    bench::report("inet_ntop + std::string", base);
+    bench::report("inet_ntoa", bench::ns_per_call([&](uint64_t i) {
+        struct in_addr address;
+        std::memcpy(&address, packet.data() + (i & 255), 4);
+        bench::do_not_optimize(inet_ntoa(address));
+    }), base);
+    bench::report("format_ipv4", bench::ns_per_call([&](uint64_t i) {
+        uint32_t address;
+        std::memcpy(&address, packet.data() + (i & 255), 4);
+        char text[netlyzer::IPV4_STRING_MAX];
+        bench::do_not_optimize(netlyzer::format_ipv4(address, text));
+        bench::do_not_optimize(text);
+    }), base);
+
+    std::printf("IPv6 address\n");
+    std::vector<uint8_t> ipv6(16 * 256, 0);
+    for (size_t i = 0; i < 256; ++i) {
+        // A mix of compressible and dense addresses.
+        ipv6[i * 16] = 0x20;
+        ipv6[i * 16 + 1] = 0x01;
+        ipv6[i * 16 + 15] = static_cast<uint8_t>(i);
+        if (i & 1)
+            std::memcpy(&ipv6[i * 16 + 4], packet.data() + i, 8);
+    }
+    base = bench::ns_per_call([&](uint64_t i) {
+        char text[INET6_ADDRSTRLEN];
+        inet_ntop(AF_INET6, &ipv6[(i & 255) * 16], text, sizeof(text));
+        bench::do_not_optimize(text);
+    });
+    bench::report("inet_ntop", base);
+    bench::report("format_ipv6", bench::ns_per_call([&](uint64_t i) {
+        char text[netlyzer::IPV6_STRING_MAX];
+        bench::do_not_optimize(netlyzer::format_ipv6(&ipv6[(i & 255) * 16], text));
+        bench::do_not_optimize(text);
+    }), base);
+
+    std::printf("Hex dump of a %zu-byte frame\n", packet.size());
+    base = bench::ns_per_call([&](uint64_t) {
+        bench::do_not_optimize(hex_dump_per_byte(packet.data(), packet.size()));
+    });
+    bench::report("formatted append per byte", base);
+    std::vector<char> dump((packet.size() / 16 + 1) * netlyzer::HEX_DUMP_LINE_MAX);
+    bench::report("format_hex_dump_line", bench::ns_per_call([&](uint64_t) {
+        size_t length = 0;
+        for (size_t offset = 0; offset < packet.size(); offset += 16)
+            length += netlyzer::format_hex_dump_line(packet.data() + offset, packet.size() - offset,
+                                                     offset, dump.data() + length);
+        bench::do_not_optimize(length);
+        bench::do_not_optimize(dump.data());
+    }), base);
+
+    std::printf("Hex string of a %zu-byte frame\n", packet.size());
+    std::vector<char> hex(packet.size() * 2);
+    base = bench::ns_per_call([&](uint64_t) {
+        static const char digits[] = "0123456789abcdef";
+        for (size_t i = 0; i < packet.size(); ++i) {
+            hex[i * 2] = digits[packet[i] >> 4];
+            hex[i * 2 + 1] = digits[packet[i] & 0x0f];
+        }
+        bench::do_not_optimize(hex.data());
+    });
+    bench::report("nibble loop", base);
+    bench::report("format_hex", bench::ns_per_call([&](uint64_t) {
+        bench::do_not_optimize(netlyzer::format_hex(packet.data(), packet.size(), hex.data()));
+        bench::do_not_optimize(hex.data());
+    }), base);
+    return 0;
+}
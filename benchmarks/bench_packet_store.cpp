@@ -0,0 +1,171 @@
+// Cost of keeping every packet: PacketStore rows against a vector of decoded
+// records holding pooled buffers, as the GUI used to keep them. Reports time
+// and memory per packet, a scan over one column, and reading packet bytes
+// back once most of them have been spilled to disk or compressed. The
+// frames are synthetic headers over filler, so they compress better than
+// real traffic; compare codecs with each other rather than with captures.
+#include "bench.h"
+#include "netlyzer/core/packet_buffer.h"
+#include "netlyzer/core/packet_store.h"
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <vector>
+
+namespace {
+
+constexpr size_t PACKETS = 1u << 20;
+
+struct Record {
+    uint64_t timestamp_ns;
+    PacketBuffer buffer;
+    uint32_t length;
+    DecodedPacket decoded;
+};
+
+std::vector<uint8_t> tcp_frame(uint32_t flow)
+{
+    std::vector<uint8_t> frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                                  0x45, 0, 0, 112, 0, 1, 0x40, 0, 64, 6, 0, 0,
+                                  10, 0, static_cast<uint8_t>(flow >> 8), static_cast<uint8_t>(flow),
+                                  192, 168, 0, 1, 0x04, 0x00, 0x01, 0xbb,
+                                  0, 0, 0, 1, 0, 0, 0, 0, 0x50, 0x10, 0xff, 0xff, 0, 0, 0, 0};
+    frame.resize(126, 0x5a);
+    return frame;
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<std::vector<uint8_t>> frames;
+    std::vector<DecodedPacket> decoded;
+    for (uint32_t flow = 0; flow < 1024; ++flow) {
+        frames.push_back(tcp_frame(flow));
+        DecodedPacket packet;
+        PacketDecoder::decode(frames.back().data(), 126, 1514, packet);
+        decoded.push_back(packet);
+    }
+
+    std::printf("%zu packets of 126 captured bytes\n", PACKETS);
+
+    double record_ns = bench::ns_per_call([&](uint64_t) {
+        std::vector<Record> records;
+        for (size_t i = 0; i < PACKETS; ++i) {
+            const size_t flow = i & 1023;
+            records.push_back(Record{i, PacketBuffer::copy_of(frames[flow].data(), 126), 1514, decoded[flow]});
+        }
+        bench::do_not_optimize(records.data());
+    }, 1, 3) / PACKETS;
+    bench::report("append, vector of records", record_ns);
+
+    double store_ns = bench::ns_per_call([&](uint64_t) {
+        PacketStore store;
+        for (size_t i = 0; i < PACKETS; ++i) {
+            const size_t flow = i & 1023;
+            store.append(i, 1514, 0, frames[flow].data(), 126, decoded[flow]);
+        }
+        bench::do_not_optimize(store.size());
+    }, 1, 3) / PACKETS;
+    bench::report("append, PacketStore", store_ns, record_ns);
+
+    PacketStore store;
+    for (size_t i = 0; i < PACKETS; ++i) {
+        const size_t flow = i & 1023;
+        store.append(i, 1514, 0, frames[flow].data(), 126, decoded[flow]);
+    }
+    std::printf("  metadata per packet: %.1f bytes (a record is %zu bytes plus a %u-byte pool slot)\n",
+                static_cast<double>(store.contents().metadata_bytes()) / PACKETS, sizeof(Record),
+                PacketBuffer::copy_of(frames[0].data(), 126).capacity());
+
+    double rows_ns = bench::ns_per_call([&](uint64_t) {
+        uint64_t total = 0;
+        for (size_t i = 0; i < store.size(); ++i)
+            total += store[i].length();
+        bench::do_not_optimize(total);
+    }, 1, 3) / PACKETS;
+    bench::report("sum lengths, row by row", rows_ns);
+
+    double scan_ns = bench::ns_per_call([&](uint64_t) {
+        const auto& lengths = store.contents().lengths();
+        const size_t rows = store.size();
+        uint64_t total = 0;
+        for (size_t block = 0; block < PacketStore::block_count(rows); ++block) {
+            const uint32_t* values = lengths.block(block);
+            for (size_t i = 0; i < PacketStore::block_size(block, rows); ++i)
+                total += values[i];
+        }
+        bench::do_not_optimize(total);
+    }, 1, 3) / PACKETS;
+    bench::report("sum lengths, column blocks", scan_ns, rows_ns);
+
+    // The same packets under a budget of four segments, read back in order.
+    char directory[] = "/tmp/netlyzer-bench-XXXXXX";
+    if (!mkdtemp(directory))
+        return 0;
+    PacketStore::Config config;
+    config.spill_directory = directory;
+    config.memory_budget = 4 * PacketStore::ARENA_CHUNK_SIZE;
+    PacketStore spilled(config);
+    for (size_t i = 0; i < PACKETS; ++i) {
+        const size_t flow = i & 1023;
+        spilled.append(i, 1514, 0, frames[flow].data(), 126, decoded[flow]);
+    }
+    const auto read_all = [](const PacketStore& from) {
+        return bench::ns_per_call([&](uint64_t) {
+            PacketStore::Snapshot snapshot = from.snapshot();
+            uint64_t total = 0;
+            for (size_t i = 0; i < snapshot->size(); ++i)
+                total += (*snapshot)[i].data()[60];
+            bench::do_not_optimize(total);
+        }, 1, 3) / PACKETS;
+    };
+    const double resident_ns = read_all(store);
+    bench::report("read bytes, all resident", resident_ns);
+    bench::report("read bytes, spilled", read_all(spilled), resident_ns);
+
+    const PacketStore::Statistics stats = spilled.get_statistics();
+    std::printf("  %llu segments resident (%llu MiB), %llu spilled; %llu page-ins, %.1f us mean, %.1f us worst\n",
+                static_cast<unsigned long long>(stats.resident_segments),
+                static_cast<unsigned long long>(stats.resident_bytes >> 20),
+                static_cast<unsigned long long>(stats.spilled_segments),
+                static_cast<unsigned long long>(stats.page_ins),
+                stats.page_ins ? stats.page_in_ns / 1e3 / stats.page_ins : 0.0,
+                stats.max_page_in_ns / 1e3);
+    rmdir(directory);
+
+    const struct {
+        const char* name;
+        PacketStore::Codec codec;
+    } codecs[] = {{"zlib", PacketStore::Codec::Zlib}, {"lz4", PacketStore::Codec::Lz4}};
+    for (const auto& codec : codecs) {
+        PacketStore::Config compressed_config;
+        compressed_config.codec = codec.codec;
+        char name[64];
+        std::snprintf(name, sizeof(name), "append, %s", codec.name);
+        double append_ns = bench::ns_per_call([&](uint64_t) {
+            PacketStore compressed(compressed_config);
+            for (size_t i = 0; i < PACKETS; ++i) {
+                const size_t flow = i & 1023;
+                compressed.append(i, 1514, 0, frames[flow].data(), 126, decoded[flow]);
+            }
+            bench::do_not_optimize(compressed.size());
+        }, 1, 3) / PACKETS;
+        bench::report(name, append_ns, store_ns);
+
+        PacketStore compressed(compressed_config);
+        for (size_t i = 0; i < PACKETS; ++i) {
+            const size_t flow = i & 1023;
+            compressed.append(i, 1514, 0, frames[flow].data(), 126, decoded[flow]);
+        }
+        std::snprintf(name, sizeof(name), "read bytes, %s", codec.name);
+        bench::report(name, read_all(compressed), resident_ns);
+        const PacketStore::Statistics packed = compressed.get_statistics();
+        std::printf("  %.1f:1 over %llu segments, %.1f us mean block decode, %.1f us worst\n",
+                    static_cast<double>(packed.uncompressed_bytes) / (packed.compressed_bytes ? packed.compressed_bytes : 1),
+                    static_cast<unsigned long long>(packed.compressed_segments),
+                    packed.block_decodes ? packed.decode_ns / 1e3 / packed.block_decodes : 0.0,
+                    packed.max_decode_ns / 1e3);
+    }
+    return 0;
+}
@@ -0,0 +1,89 @@
+#ifndef DISPLAY_FILTER_H
+#define DISPLAY_FILTER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "netlyzer/core/packet_index.h"
+
+// The display filters a PacketIndex can answer, compiled once and then
+// evaluated to the set of matching rows. The syntax follows Wireshark for
+// the fields it covers:
+//
+//   tcp  udp  icmp  icmpv6  arp  ip  ipv6  vlan  gre  vxlan
+//   ip.addr  ip.src  ip.dst            == != an IPv4 address
+//   ipv6.addr  ipv6.src  ipv6.dst      == != an IPv6 address
+//   tcp.port  tcp.srcport  tcp.dstport
+//   udp.port  udp.srcport  udp.dstport == != < <= > >= a port
+//   frame.number                       == != < <= > >= a frame number
+//   frame.time_epoch  frame.time_relative
+//                                      == != < <= > >= seconds
+//   protocol                           == != a Protocol column value
+//
+// combined with and/&&, or/||, not/! and parentheses. A bare protocol name
+// matches every packet that carries it, as in Wireshark, so "ip" includes
+// TCP over IPv4. "a != b" is "not a == b".
+class DisplayFilter {
+public:
+    // False, with last_error() set, for text outside the syntax above; the
+    // previous filter is kept.
+    bool parse(const std::string& text);
+    const std::string& last_error() const { return error_; }
+    bool empty() const { return nodes_.empty(); }
+
+    // The rows of `index` that match; `contents` is what it was built from.
+    RowBitmap evaluate(const PacketIndex& index, const PacketStore::Contents& contents) const;
+    // Whether one row of `contents` matches, from its columns alone: for
+    // rows added after an evaluate(), without going back over the index.
+    bool matches(const PacketStore::Contents& contents, size_t row) const;
+
+private:
+    enum class Kind {
+        And,
+        Or,
+        Not,
+        Flags,              // every bit in `flags`
+        Address,
+        Port,
+        Number,
+        Time,
+        Protocol
+    };
+
+    enum class Compare {
+        Equal,
+        Less,
+        LessEqual,
+        Greater,
+        GreaterEqual
+    };
+
+    struct Node {
+        Kind kind = Kind::Flags;
+        int left = -1;
+        int right = -1;
+        uint32_t flags = 0;         // also required with the field below
+        bool source = true;         // addresses and ports: which side(s)
+        bool dest = true;
+        Compare compare = Compare::Equal;
+        uint8_t address[16] = {};
+        uint64_t value = 0;         // port, frame number or nanoseconds
+        bool relative = false;      // time since the first packet
+        std::string name;           // protocol
+    };
+
+    class Parser;
+    friend class Parser;
+
+    RowBitmap evaluate(int node, const PacketIndex& index, const PacketStore::Contents& contents) const;
+    bool matches(int node, const PacketStore::Contents& contents, size_t row) const;
+    // The index's own bitmap for a node that is just one, to combine
+    // without a copy; null otherwise.
+    const RowBitmap* lookup(int node, const PacketIndex& index) const;
+
+    std::vector<Node> nodes_;
+    int root_ = -1;
+    std::string error_;
+};
+
+#endif // DISPLAY_FILTER_H
@@ -0,0 +1,87 @@
+#ifndef EPOCH_RECLAIMER_H
+#define EPOCH_RECLAIMER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Epoch-based reclamation for many reader threads. A reader pins the
+// current epoch while it holds pointers into shared data; whoever unlinks
+// something retires it, and the retired memory is freed once every reader
+// that pinned an epoch up to the retirement has let go. Pinning is
+// lock-free: it claims one of MAX_READERS slots with a compare-and-swap and
+// writes the epoch there.
+//
+// Retiring is not: retire(), reclaim() and pending() share an unguarded
+// list, so only one thread may be in them at a time. Either a single writer
+// thread makes every call, or the owner serializes them under a lock of its
+// own, as PacketStore does with its mutex so that readers paging segments
+// in can retire what they evict. A thread may reclaim while it is pinned;
+// its own pin only holds back what was retired since.
+class EpochReclaimer {
+public:
+    static constexpr size_t MAX_READERS = 64;
+
+    // Keeps the epoch pinned until destroyed.
+    class Guard {
+    public:
+        Guard() = default;
+        Guard(Guard&& other) noexcept : slot_(std::exchange(other.slot_, nullptr)) {}
+        Guard& operator=(Guard&& other) noexcept
+        {
+            if (this != &other) {
+                release();
+                slot_ = std::exchange(other.slot_, nullptr);
+            }
+            return *this;
+        }
+        ~Guard() { release(); }
+
+        Guard(const Guard&) = delete;
+        Guard& operator=(const Guard&) = delete;
+
+    private:
+        friend class EpochReclaimer;
+        explicit Guard(std::atomic<uint64_t>* slot) : slot_(slot) {}
+        void release()
+        {
+            if (slot_)
+                slot_->store(0, std::memory_order_release);
+            slot_ = nullptr;
+        }
+
+        std::atomic<uint64_t>* slot_ = nullptr;
+    };
+
+    EpochReclaimer() = default;
+    ~EpochReclaimer();     // frees everything retired; no reader may be pinned
+
+    EpochReclaimer(const EpochReclaimer&) = delete;
+    EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+    // Any thread. Waits only if MAX_READERS guards are already held.
+    Guard pin() const;
+
+    // One thread at a time; see above. `free` runs once no reader can still
+    // see what it frees; call after the object has been unlinked.
+    void retire(std::function<void()> free);
+
+    // One thread at a time, as retire(). Frees what is safe to free now;
+    // returns how many.
+    size_t reclaim();
+    size_t pending() const { return retired_.size(); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> epoch{0};     // 0 when free
+    };
+
+    mutable Slot slots_[MAX_READERS];
+    std::atomic<uint64_t> epoch_{1};
+    std::vector<std::pair<uint64_t, std::function<void()>>> retired_;
+};
+
+#endif // EPOCH_RECLAIMER_H
@@ -0,0 +1,130 @@
+#ifndef PACKET_BUFFER_H
+#define PACKET_BUFFER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+class PacketBufferPool;
+
+// Reference-counted handle to a pooled packet buffer. Copying a handle only
+// bumps an atomic count; the buffer goes back to its pool's free list when
+// the last handle is dropped. The same handle travels from the capture thread
+// through parsing into the model and the hex view, so the bytes are written
+// once and never copied again.
+class PacketBuffer {
+public:
+    PacketBuffer() = default;
+    PacketBuffer(const PacketBuffer& other);
+    PacketBuffer(PacketBuffer&& other) noexcept;
+    PacketBuffer& operator=(const PacketBuffer& other);
+    PacketBuffer& operator=(PacketBuffer&& other) noexcept;
+    ~PacketBuffer() { release(); }
+
+    // Allocates from the process-wide pool and copies `size` bytes in.
+    static PacketBuffer copy_of(const uint8_t* data, uint32_t size);
+
+    explicit operator bool() const { return slot_ != nullptr; }
+    bool empty() const { return !slot_ || slot_->size == 0; }
+
+    const uint8_t* data() const { return slot_ ? payload() : nullptr; }
+    uint8_t* data() { return slot_ ? payload() : nullptr; }
+    uint32_t size() const { return slot_ ? slot_->size : 0; }
+    uint32_t capacity() const { return slot_ ? slot_->capacity : 0; }
+
+    // For the writer that filled data(); must not exceed capacity().
+    void set_size(uint32_t size) { if (slot_) slot_->size = size; }
+
+    uint32_t use_count() const { return slot_ ? slot_->refs.load(std::memory_order_relaxed) : 0; }
+
+private:
+    friend class PacketBufferPool;
+
+    // Lives directly in front of the payload inside a slab.
+    struct Slot {
+        std::atomic<uint32_t> refs;
+        uint32_t size;
+        uint32_t capacity;
+        uint16_t size_class;    // OVERSIZE for buffers that bypass the slabs
+        uint16_t reserved;
+        PacketBufferPool* pool;
+        Slot* next_free;
+    };
+    static constexpr size_t SLOT_HEADER = (sizeof(Slot) + 63) & ~size_t(63);
+
+    explicit PacketBuffer(Slot* slot) : slot_(slot) {}
+
+    uint8_t* payload() const { return reinterpret_cast<uint8_t*>(slot_) + SLOT_HEADER; }
+    void release();
+
+    Slot* slot_ = nullptr;
+};
+
+// Size-classed slab allocator for packet buffers. Each class carves 1 MiB (or
+// larger) slabs into equal slots and keeps freed slots on a free list, so in
+// steady state allocation is a pop from that list and never calls malloc. A
+// request that finds the free list empty counts as a miss and takes a new slab.
+class PacketBufferPool {
+public:
+    static constexpr uint16_t OVERSIZE = 0xffff;
+
+    struct Statistics {
+        uint64_t live_buffers = 0;
+        uint64_t live_bytes = 0;        // capacity of the buffers handed out
+        uint64_t reserved_bytes = 0;    // slab memory owned by the pool
+        uint64_t allocations = 0;
+        uint64_t pool_misses = 0;       // allocations that had to grow a slab
+        uint64_t oversize = 0;          // requests larger than the largest class
+        uint64_t failures = 0;          // refused because of the memory limit
+    };
+
+    explicit PacketBufferPool(size_t max_bytes = 0);
+    ~PacketBufferPool();
+
+    PacketBufferPool(const PacketBufferPool&) = delete;
+    PacketBufferPool& operator=(const PacketBufferPool&) = delete;
+
+    static PacketBufferPool& instance();
+
+    // Returns a buffer of at least `size` bytes with size() set to `size`, or
+    // an empty handle if the memory limit would be exceeded.
+    PacketBuffer allocate(uint32_t size);
+    PacketBuffer copy(const uint8_t* data, uint32_t size);
+
+    // Pre-allocates enough slabs for `count` buffers of `size` bytes.
+    void reserve(uint32_t size, size_t count);
+
+    Statistics get_statistics() const;
+
+private:
+    friend class PacketBuffer;
+
+    struct SizeClass {
+        uint32_t slot_size = 0;         // header plus payload
+        std::atomic_flag lock = ATOMIC_FLAG_INIT;
+        PacketBuffer::Slot* free_list = nullptr;
+    };
+
+    static constexpr size_t SLAB_SIZE = 1u << 20;
+    static constexpr size_t CLASS_COUNT = 10;
+
+    static int class_for(uint32_t size);
+    bool grow(size_t class_index);
+    void recycle(PacketBuffer::Slot* slot);
+
+    SizeClass classes_[CLASS_COUNT];
+    std::atomic_flag slabs_lock_ = ATOMIC_FLAG_INIT;
+    std::vector<uint8_t*> slabs_;
+    const size_t max_bytes_;
+
+    std::atomic<uint64_t> live_buffers_;
+    std::atomic<uint64_t> live_bytes_;
+    std::atomic<uint64_t> reserved_bytes_;
+    std::atomic<uint64_t> allocations_;
+    std::atomic<uint64_t> pool_misses_;
+    std::atomic<uint64_t> oversize_;
+    std::atomic<uint64_t> failures_;
+};
+
+#endif // PACKET_BUFFER_H
@@ -0,0 +1,59 @@
+#ifndef PACKET_INDEX_H
+#define PACKET_INDEX_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include "netlyzer/core/packet_store.h"
+#include "netlyzer/core/row_bitmap.h"
+
+// Secondary indexes over the rows of a PacketStore, so display filters
+// resolve by combining bitmaps instead of visiting every row. For each
+// decoder flag, protocol code, address id and port, the index keeps a
+// RowBitmap of the rows carrying it; addresses and ports are indexed
+// separately as source and destination. Timestamps get a zone map: the
+// earliest and latest timestamp of each column block, so a time range is
+// whole blocks plus a scan of the few blocks it cuts through.
+//
+// Rows are added in order as they are stored. Not thread-safe; the thread
+// that appends to the store usually keeps the index too.
+class PacketIndex {
+public:
+    PacketIndex();
+
+    // Indexes `row` of `contents`, which must be the next row in order.
+    void add(const PacketStore::Contents& contents, size_t row);
+    void clear();
+    size_t size() const { return rows_; }
+
+    // Empty bitmaps for values never seen.
+    const RowBitmap& flag_rows(DecodedPacket::Flag flag) const;
+    const RowBitmap& protocol_rows(uint8_t code) const { return protocols_[code]; }
+    const RowBitmap& source_address_rows(uint32_t id) const;
+    const RowBitmap& dest_address_rows(uint32_t id) const;
+    const RowBitmap& source_port_rows(uint16_t port) const { return source_ports_[port]; }
+    const RowBitmap& dest_port_rows(uint16_t port) const { return dest_ports_[port]; }
+
+    // Rows with first_ns <= timestamp <= last_ns; `contents` is the one the
+    // rows were added from.
+    RowBitmap time_rows(const PacketStore::Contents& contents, uint64_t first_ns, uint64_t last_ns) const;
+    // Every row indexed so far.
+    RowBitmap all_rows() const { return RowBitmap::range(0, static_cast<uint32_t>(rows_)); }
+
+    size_t memory_bytes() const;
+
+private:
+    static constexpr size_t FLAGS = 32;
+
+    size_t rows_ = 0;
+    std::vector<RowBitmap> flags_;
+    std::vector<RowBitmap> protocols_;
+    std::vector<RowBitmap> source_addresses_;   // by address id
+    std::vector<RowBitmap> dest_addresses_;
+    std::vector<RowBitmap> source_ports_;
+    std::vector<RowBitmap> dest_ports_;
+    std::vector<uint64_t> block_first_ns_;      // per PacketStore::BLOCK_ROWS rows
+    std::vector<uint64_t> block_last_ns_;
+};
+
+#endif // PACKET_INDEX_H
@@ -2,23 +2,24 @@
 #define PACKET_MODEL_H
 
 #include <QObject>
-#include <QByteArray>
-#include <QString>
-#include <QDateTime>
-
-struct PacketData {
-    int number;
-    QDateTime timestamp;
-    QString source;
-    QString destination;
-    QString protocol;
-    int length;
-    QString info;
-    QByteArray rawData;
-    
-    PacketData() : number(0), length(0) {}
-};
+#include <QVector>
+#include "netlyzer/core/display_filter.h"
+#include "netlyzer/core/packet_index.h"
+#include "netlyzer/core/parallel_dissector.h"
+#include "netlyzer/core/packet_store.h"
+#include "netlyzer/network/capture_file.h"
+#include "netlyzer/network/packet_capture.h"
 
+// Every packet of the current capture, for the GUI thread. Records are
+// copied into a PacketStore as they arrive, so the list keeps tens of bytes
+// per packet instead of a decoded record and a pooled buffer each, and
+// indexed in a PacketIndex for display filters. Row index i is frame number
+// i + 1. Frames read from a capture file are dissected on a pool with a
+// thread per core.
+//
+// Only the GUI thread adds and clears. Filter and statistics threads read
+// concurrently through store().snapshot(), without locks, while capture
+// keeps appending.
 class PacketModel : public QObject
 {
     Q_OBJECT
@@ -27,17 +28,41 @@ public:
     explicit PacketModel(QObject *parent = nullptr);
     ~PacketModel();
 
-    void addPacket(const PacketData &packet);
+    // Returns the frame number given to the first record.
+    int addPackets(const QVector<PacketRecord> &records);
+    // Appends frames read from `file` without copying their bytes, which
+    // stay in the file's mapping: the store must have been given
+    // file.mapping() through setStoreConfig() before the last
+    // clearPackets(). Only Ethernet frames are decoded; others keep just
+    // their lengths and timestamps. Returns the first frame number.
+    int addFileFrames(const CaptureFile &file, const CaptureFile::Frame *frames, size_t count);
     void clearPackets();
-    PacketData getPacket(int index) const;
-    int getPacketCount() const;
+    // Where and how much packet data to keep in RAM; applies from the next
+    // clearPackets().
+    void setStoreConfig(const PacketStore::Config &config) { m_store.set_config(config); }
+    PacketStore::Statistics storeStatistics() const { return m_store.get_statistics(); }
+    int getPacketCount() const { return static_cast<int>(m_store.size()); }
+
+    // GUI thread: a cheap view of the stored columns; index must be in range.
+    PacketStore::Row row(int index) const { return m_store.row(static_cast<size_t>(index)); }
+    const PacketStore &store() const { return m_store; }
+
+    // GUI thread: the rows matching a display filter, from the index.
+    RowBitmap filterRows(const DisplayFilter &filter) const { return filter.evaluate(m_index, m_store.contents()); }
+
+    // Rebuilds the full record, decoded again and with its own copy of the
+    // bytes, for the details and hex panes. False if index is out of range
+    // or its spilled bytes could not be mapped back in.
+    bool getPacket(int index, PacketRecord &record) const;
 
 signals:
-    void packetAdded(const PacketData &packet);
+    void packetsAdded(int first, int count);
     void packetsCleared();
 
 private:
-    QList<PacketData> m_packets;
+    PacketStore m_store;
+    PacketIndex m_index;
+    ParallelDissector m_dissector;
 };
 
 #endif // PACKET_MODEL_H
@@ -0,0 +1,465 @@
+#ifndef PACKET_STORE_H
+#define PACKET_STORE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include "netlyzer/core/epoch_reclaimer.h"
+#include "netlyzer/network/packet_decoder.h"
+
+// Every captured packet, kept column by column. Each field lives in its own
+// array, appended to in blocks so that growing never moves what is already
+// stored; the packet bytes go end to end into a separate arena. A row costs
+// 44 bytes of metadata: timestamp, lengths, flags, ports and a few one-byte
+// codes inline, addresses as indexes into a dictionary of the distinct
+// addresses seen, and the protocol name as an index into a dictionary of
+// names. Everything else in a DecodedPacket is derived again from the bytes
+// when a row is opened.
+//
+// One writer thread appends and clears; any number of reader threads read
+// without locks. The writer fills in a row, then publishes it by advancing a
+// row count with release semantics, so a reader sees complete rows up to the
+// count it loaded and nothing it reads is written again. clear() swaps in
+// fresh contents and retires the old ones through an EpochReclaimer, so a
+// reader holding a Snapshot keeps reading the contents it pinned.
+//
+// With a spill directory and a memory budget configured, the packet bytes
+// can outgrow RAM. The arena is cut into segments; once a segment is full
+// it is sealed, and when the resident segments exceed the budget the oldest
+// sealed ones are written to an unlinked file in the spill directory and
+// dropped from memory. Reading a spilled row maps its segment back in from
+// the file, evicting the longest-mapped segments to stay within budget. The
+// metadata columns always stay resident, so scans and filters on them never
+// touch the disk.
+//
+// With a codec configured, a segment is compressed as it is sealed, in
+// blocks of whole packets about COMPRESSION_BLOCK bytes long, and only the
+// compressed copy is kept or spilled. Reading a row decompresses its block
+// into a small cache shared by the segments; the oldest cached blocks are
+// dropped past Config::block_cache_bytes.
+//
+// Rows read from a capture file need no arena at all: append_mapped()
+// records where the packet's bytes sit in the file's mapping, given as
+// Config::mapped_file, and reading the row reads the mapping. A
+// ParallelDissector fills a large batch of such rows on several threads
+// for the writer, which still publishes them in order.
+//
+// Row i is frame number i + 1.
+class PacketStore {
+public:
+    static constexpr size_t BLOCK_ROWS = 65536;
+    static constexpr size_t ARENA_CHUNK_SIZE = 4u << 20;
+    static constexpr size_t COMPRESSION_BLOCK = 64u << 10;
+    static constexpr uint32_t NO_ADDRESS = 0xffffffffu;
+    static constexpr uint64_t MAPPED_OFFSET = uint64_t(1) << 63;   // offsets into Config::mapped_file
+
+    // Lz4 falls back to Zlib when built without liblz4.
+    enum class Codec {
+        None,
+        Zlib,
+        Lz4
+    };
+
+    struct Config {
+        std::string spill_directory;    // empty keeps every segment in memory
+        size_t memory_budget = 0;       // bytes of packet data kept in RAM; 0 for no limit
+        Codec codec = Codec::None;
+        size_t block_cache_bytes = 4u << 20;    // decompressed blocks kept for reading
+        std::shared_ptr<const uint8_t> mapped_file;     // held for as long as the contents
+    };
+
+    struct Statistics {
+        uint64_t resident_segments = 0;
+        uint64_t resident_bytes = 0;
+        uint64_t spilled_segments = 0;  // written out and not mapped in now
+        uint64_t spilled_bytes = 0;
+        uint64_t page_ins = 0;
+        uint64_t page_in_ns = 0;        // total time spent mapping segments back in
+        uint64_t max_page_in_ns = 0;
+        uint64_t spill_errors = 0;      // failed writes, maps or decodes; segments stay in memory
+        uint64_t compressed_segments = 0;
+        uint64_t uncompressed_bytes = 0;    // what the compressed segments held
+        uint64_t compressed_bytes = 0;      // and what they hold now
+        uint64_t compress_ns = 0;
+        uint64_t block_decodes = 0;         // cache misses
+        uint64_t decode_ns = 0;
+        uint64_t max_decode_ns = 0;
+        uint64_t cached_blocks = 0;
+        uint64_t cached_bytes = 0;
+    };
+
+    // "none", "zlib" or "lz4"; false for anything else.
+    static bool parse_codec(const std::string& name, Codec& codec);
+
+    // Blocks of a column, for scans over the first `rows` rows: every block
+    // is full except possibly the last.
+    static size_t block_count(size_t rows) { return (rows + BLOCK_ROWS - 1) / BLOCK_ROWS; }
+    static size_t block_size(size_t block, size_t rows)
+    {
+        return rows - block * BLOCK_ROWS < BLOCK_ROWS ? rows - block * BLOCK_ROWS : BLOCK_ROWS;
+    }
+
+    // Fixed-size blocks of one field, found through a two-level directory
+    // that is allocated as it fills and never reallocated, so a reader can
+    // index it while the writer appends.
+    template <typename T, size_t BlockRows = BLOCK_ROWS>
+    class Column {
+    public:
+        const T& operator[](size_t index) const { return block(index / BlockRows)[index % BlockRows]; }
+        const T* block(size_t index) const { return pages_[index / PAGE_BLOCKS][index % PAGE_BLOCKS].get(); }
+
+    private:
+        friend class PacketStore;
+        friend class ParallelDissector;
+
+        static constexpr size_t PAGE_BLOCKS = 256;
+        static constexpr size_t PAGES = 256;
+
+        // Writer side; `index` is the row being appended.
+        void store(size_t index, T value)
+        {
+            const size_t block = index / BlockRows;
+            if (index % BlockRows == 0) {
+                auto& page = pages_[block / PAGE_BLOCKS];
+                if (!page)
+                    page.reset(new std::unique_ptr<T[]>[PAGE_BLOCKS]);
+                page[block % PAGE_BLOCKS].reset(new T[BlockRows]);
+            }
+            pages_[block / PAGE_BLOCKS][block % PAGE_BLOCKS][index % BlockRows] = value;
+        }
+
+        // Writer side, for rows filled out of order by other threads: the
+        // writer allocates every block they will touch first, then each row
+        // is written through slot().
+        void allocate(size_t block)
+        {
+            auto& page = pages_[block / PAGE_BLOCKS];
+            if (!page)
+                page.reset(new std::unique_ptr<T[]>[PAGE_BLOCKS]);
+            if (!page[block % PAGE_BLOCKS])
+                page[block % PAGE_BLOCKS].reset(new T[BlockRows]);
+        }
+        T& slot(size_t index)
+        {
+            const size_t block = index / BlockRows;
+            return pages_[block / PAGE_BLOCKS][block % PAGE_BLOCKS][index % BlockRows];
+        }
+
+        std::unique_ptr<std::unique_ptr<T[]>[]> pages_[PAGES];
+    };
+
+    class Contents;
+
+    // A view of one stored packet; valid while its contents are (see
+    // Snapshot).
+    class Row {
+    public:
+        size_t index() const { return index_; }
+        uint64_t number() const { return index_ + 1; }
+        uint64_t timestamp_ns() const;
+        uint32_t length() const;
+        uint32_t captured_length() const;
+        uint32_t flags() const;
+        bool has(DecodedPacket::Flag flag) const { return (flags() & flag) != 0; }
+        uint8_t interface_id() const;
+        uint8_t ip_protocol() const;
+        uint8_t tcp_flags() const;
+        uint16_t source_port() const;
+        uint16_t dest_port() const;
+        // 16 bytes in network order, as in DecodedPacket.
+        const uint8_t* source_address() const;
+        const uint8_t* dest_address() const;
+        const char* protocol_name() const;
+        // Pages the row's segment back in if it was spilled. Stays valid
+        // while a Snapshot of these contents is held; null only if a spilled
+        // segment could not be mapped.
+        const uint8_t* data() const;
+
+        // Decodes the stored bytes again and restores the flags that were
+        // set after decoding (checksum results, REASSEMBLED).
+        void decode(DecodedPacket& packet) const;
+
+    private:
+        friend class Contents;
+        Row(const Contents* contents, size_t index) : contents_(contents), index_(index) {}
+
+        const Contents* contents_;
+        size_t index_;
+    };
+
+    // Everything stored since the last clear(). Reader methods may be called
+    // from any thread while the writer appends; rows below size() are final.
+    class Contents {
+    public:
+        size_t size() const { return rows_.load(std::memory_order_acquire); }
+        bool empty() const { return size() == 0; }
+        Row row(size_t index) const { return Row(this, index); }
+        Row operator[](size_t index) const { return row(index); }
+
+        const Column<uint64_t>& timestamps() const { return timestamps_; }
+        const Column<uint32_t>& lengths() const { return lengths_; }
+        const Column<uint32_t>& captured_lengths() const { return captured_lengths_; }
+        const Column<uint32_t>& flags() const { return flags_; }
+        const Column<uint32_t>& source_addresses() const { return source_addresses_; }
+        const Column<uint32_t>& dest_addresses() const { return dest_addresses_; }
+        const Column<uint16_t>& source_ports() const { return source_ports_; }
+        const Column<uint16_t>& dest_ports() const { return dest_ports_; }
+        const Column<uint8_t>& protocols() const { return protocols_; }
+        const Column<uint8_t>& ip_protocols() const { return ip_protocols_; }
+
+        // Dictionaries behind the address and protocol columns.
+        const uint8_t* address(uint32_t id) const { return addresses_[id].bytes; }
+        uint32_t find_address(const uint8_t* address) const;     // NO_ADDRESS if never seen
+        size_t address_count() const { return address_count_.load(std::memory_order_acquire); }
+        const char* protocol_name(uint8_t code) const { return protocol_names_[code]; }
+        size_t protocol_count() const { return protocol_count_.load(std::memory_order_acquire); }
+
+        // Bytes held for the columns and dictionaries, and for the packet bytes.
+        size_t metadata_bytes() const;
+        size_t data_bytes() const { return data_bytes_.load(std::memory_order_relaxed); }
+
+    private:
+        friend class PacketStore;
+        friend class Row;
+        friend class ParallelDissector;
+
+        struct Address {
+            uint8_t bytes[16];
+        };
+
+        // Open-addressed ids into the address column. When it fills, the
+        // writer builds a bigger one and keeps the old one until the contents
+        // go, since a reader may still be probing it.
+        struct AddressIndex {
+            explicit AddressIndex(size_t size);
+            size_t mask;
+            std::unique_ptr<std::atomic<uint32_t>[]> table;
+        };
+
+        // A piece of the packet-byte arena. `data` is what readers follow
+        // for uncompressed bytes: the heap copy while hot, the file mapping
+        // while paged in, null while only on disk. A compressed segment has
+        // null `data`; `packed` follows its compressed blocks the same way,
+        // and `blocks` holds whichever of them are decompressed. The block
+        // layout is final before `data` goes null; the rest changes under
+        // the store's mutex.
+        struct Segment {
+            std::atomic<uint8_t*> data{nullptr};
+            std::unique_ptr<uint8_t[]> memory;
+            size_t size = 0;                // allocated
+            size_t used = 0;                // final once sealed
+            uint64_t file_offset = 0;
+            bool spilled = false;           // has a copy in the spill file
+
+            bool compressed = false;
+            std::atomic<uint8_t*> packed{nullptr};
+            std::unique_ptr<uint8_t[]> packed_memory;
+            size_t packed_size = 0;
+            std::vector<uint32_t> block_starts;     // raw offset of each block
+            std::vector<uint32_t> packed_starts;    // its compressed offset, plus the end
+            std::unique_ptr<std::atomic<uint8_t*>[]> blocks;
+
+            size_t stored_size() const { return compressed ? packed_size : used; }
+        };
+
+        explicit Contents(PacketStore* store);
+        ~Contents();
+
+        uint32_t intern_address(const uint8_t* address);
+        uint8_t intern_protocol(const char* name);
+        void grow_address_index();
+        uint64_t store_data(const uint8_t* data, uint32_t length);
+        const uint8_t* data(uint64_t offset) const
+        {
+            if (offset & MAPPED_OFFSET)
+                return config_.mapped_file.get() + (offset & ~MAPPED_OFFSET);
+            Segment& segment = *segments_[offset >> 32];
+            const uint8_t* base = segment.data.load(std::memory_order_acquire);
+            if (base)
+                return base + (offset & 0xffffffffu);
+            return load(segment, static_cast<uint32_t>(offset));
+        }
+
+        // The slow path of data(): pages in or decompresses, taking the
+        // store's mutex if it has to.
+        const uint8_t* load(Segment& segment, uint32_t position) const;
+        void compress(Segment& segment);
+
+        // Under the store's mutex.
+        const uint8_t* page_in(Segment& segment) const;
+        const uint8_t* decode_block(Segment& segment, size_t block) const;
+        void enforce_budget(const Segment* keep) const;
+        bool spill(Segment& segment) const;
+        void drop(Segment& segment) const;
+
+        Column<uint64_t> timestamps_;
+        Column<uint64_t> offsets_;          // arena chunk in the high half, position in the low;
+                                            // or MAPPED_OFFSET and the file offset
+        Column<uint32_t> lengths_;
+        Column<uint32_t> captured_lengths_;
+        Column<uint32_t> flags_;
+        Column<uint32_t> source_addresses_;
+        Column<uint32_t> dest_addresses_;
+        Column<uint16_t> source_ports_;
+        Column<uint16_t> dest_ports_;
+        Column<uint8_t> protocols_;
+        Column<uint8_t> ip_protocols_;
+        Column<uint8_t> tcp_flags_;
+        Column<uint8_t> interfaces_;
+        std::atomic<size_t> rows_{0};
+
+        Column<Address, 4096> addresses_;
+        std::atomic<uint32_t> address_count_{0};
+        std::atomic<AddressIndex*> address_index_{nullptr};
+        std::vector<std::unique_ptr<AddressIndex>> address_indexes_;
+
+        const char* protocol_names_[256] = {};
+        std::atomic<size_t> protocol_count_{0};
+
+        PacketStore* store_;
+        const Config config_;
+        const Codec codec_;                 // config_.codec as built
+        Column<Segment*, 1024> segments_;
+        std::vector<std::unique_ptr<Segment>> segment_memory_;
+        Segment* current_segment_ = nullptr;
+        std::atomic<size_t> data_bytes_{0};
+
+        // Residency, oldest first; guarded by the store's mutex, and
+        // published in the atomics for get_statistics().
+        mutable std::deque<Segment*> hot_;          // sealed, still on the heap
+        mutable std::deque<Segment*> mapped_;       // paged back in from the file
+        mutable std::atomic<uint64_t> resident_segments_{0};
+        mutable std::atomic<uint64_t> resident_bytes_{0};
+        mutable std::atomic<uint64_t> spilled_segments_{0};
+        mutable std::atomic<uint64_t> spilled_bytes_{0};
+        mutable int spill_fd_ = -1;
+        mutable bool spill_failed_ = false;
+        mutable uint64_t spill_end_ = 0;
+
+        // Decompressed blocks, oldest first; also under the store's mutex.
+        struct CachedBlock {
+            Segment* segment;
+            size_t block;
+            size_t size;
+        };
+        mutable std::deque<CachedBlock> cached_;
+        mutable std::atomic<uint64_t> cached_blocks_{0};
+        mutable std::atomic<uint64_t> cached_bytes_{0};
+        std::vector<uint8_t> scratch_;              // writer's compression buffer
+        std::atomic<uint64_t> compressed_segments_{0};
+        std::atomic<uint64_t> uncompressed_bytes_{0};
+        std::atomic<uint64_t> compressed_bytes_{0};
+    };
+
+    // Pins the contents current when it was taken: they, and every row and
+    // column read through them, stay valid until the snapshot is destroyed,
+    // even if the writer clears the store meanwhile. New rows keep showing
+    // up in size(). Hold one for the length of a scan, not indefinitely;
+    // each pins one of EpochReclaimer::MAX_READERS slots.
+    class Snapshot {
+    public:
+        const Contents& operator*() const { return *contents_; }
+        const Contents* operator->() const { return contents_; }
+
+    private:
+        friend class PacketStore;
+        Snapshot(EpochReclaimer::Guard guard, const Contents* contents)
+            : guard_(std::move(guard)), contents_(contents) {}
+
+        EpochReclaimer::Guard guard_;
+        const Contents* contents_;
+    };
+
+    PacketStore();
+    explicit PacketStore(const Config& config);
+    ~PacketStore();
+
+    PacketStore(const PacketStore&) = delete;
+    PacketStore& operator=(const PacketStore&) = delete;
+
+    // Any thread.
+    Snapshot snapshot() const;
+
+    // Writer thread. Copies the captured bytes in and returns the new row's
+    // index. `length` is the length on the wire; `packet` is the decode of
+    // `data`.
+    size_t append(uint64_t timestamp_ns, uint32_t length, uint8_t interface_id, const uint8_t* data,
+                  uint32_t captured_length, const DecodedPacket& packet);
+    // Writer thread. Like append(), but the captured bytes stay where they
+    // are, `file_offset` bytes into Config::mapped_file.
+    size_t append_mapped(uint64_t timestamp_ns, uint32_t length, uint8_t interface_id, uint64_t file_offset,
+                         uint32_t captured_length, const DecodedPacket& packet);
+    void clear();
+    // Writer thread; applies from the next clear().
+    void set_config(const Config& config) { config_ = config; }
+
+    // Any thread.
+    Statistics get_statistics() const;
+
+    // Writer thread: the current contents, without pinning them, since only
+    // the writer replaces them.
+    const Contents& contents() const { return *current_.load(std::memory_order_relaxed); }
+    size_t size() const { return contents().size(); }
+    bool empty() const { return size() == 0; }
+    Row row(size_t index) const { return contents().row(index); }
+    Row operator[](size_t index) const { return row(index); }
+
+private:
+    friend class ParallelDissector;
+
+    size_t append_row(uint64_t timestamp_ns, uint32_t length, uint8_t interface_id, uint64_t offset,
+                      uint32_t captured_length, const DecodedPacket& packet);
+
+    Config config_;                         // for the next contents
+    std::atomic<Contents*> current_;
+    size_t rows_ = 0;                       // writer's copy of current_->rows_
+    mutable std::mutex mutex_;              // segment residency; every retire() and reclaim()
+    mutable EpochReclaimer epochs_;
+
+    // Over every contents so far; written under mutex_.
+    mutable std::atomic<uint64_t> page_ins_{0};
+    mutable std::atomic<uint64_t> page_in_ns_{0};
+    mutable std::atomic<uint64_t> max_page_in_ns_{0};
+    mutable std::atomic<uint64_t> spill_errors_{0};
+    std::atomic<uint64_t> compress_ns_{0};
+    mutable std::atomic<uint64_t> block_decodes_{0};
+    mutable std::atomic<uint64_t> decode_ns_{0};
+    mutable std::atomic<uint64_t> max_decode_ns_{0};
+};
+
+inline uint64_t PacketStore::Row::timestamp_ns() const { return contents_->timestamps_[index_]; }
+inline uint32_t PacketStore::Row::length() const { return contents_->lengths_[index_]; }
+inline uint32_t PacketStore::Row::captured_length() const { return contents_->captured_lengths_[index_]; }
+inline uint32_t PacketStore::Row::flags() const { return contents_->flags_[index_]; }
+inline uint8_t PacketStore::Row::interface_id() const { return contents_->interfaces_[index_]; }
+inline uint8_t PacketStore::Row::ip_protocol() const { return contents_->ip_protocols_[index_]; }
+inline uint8_t PacketStore::Row::tcp_flags() const { return contents_->tcp_flags_[index_]; }
+inline uint16_t PacketStore::Row::source_port() const { return contents_->source_ports_[index_]; }
+inline uint16_t PacketStore::Row::dest_port() const { return contents_->dest_ports_[index_]; }
+
+inline const uint8_t* PacketStore::Row::source_address() const
+{
+    return contents_->address(contents_->source_addresses_[index_]);
+}
+
+inline const uint8_t* PacketStore::Row::dest_address() const
+{
+    return contents_->address(contents_->dest_addresses_[index_]);
+}
+
+inline const char* PacketStore::Row::protocol_name() const
+{
+    return contents_->protocol_name(contents_->protocols_[index_]);
+}
+
+inline const uint8_t* PacketStore::Row::data() const
+{
+    return contents_->data(contents_->offsets_[index_]);
+}
+
+#endif // PACKET_STORE_H
@@ -0,0 +1,111 @@
+#ifndef PARALLEL_DISSECTOR_H
+#define PARALLEL_DISSECTOR_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "netlyzer/core/packet_store.h"
+#include "netlyzer/network/capture_file.h"
+
+// Appends frames from a capture file to a PacketStore, dissecting them on a
+// pool of threads.
+//
+// A batch is cut into chunks of CHUNK_ROWS rows, aligned so that no chunk
+// straddles a column block. Threads claim chunks from an atomic counter,
+// decode their frames and write the rows straight into the chunk's part of
+// every column. The address and protocol dictionaries are the only state
+// the rows share. Threads look values up in the store's dictionaries, which
+// take readers while the writer adds to them, and number what they do not
+// find yet in a small dictionary of the chunk's own. The writer stitches
+// the chunks together in frame order: it folds a finished chunk's
+// dictionary into the store's, renumbers just the rows that used it, and
+// publishes the chunk, then moves to the next. Once a file's addresses
+// have been seen, stitching is only publishing. While it waits for a
+// chunk, the writer dissects unclaimed ones itself. No lock is taken per
+// chunk or per row; the pool's mutex only wakes the helpers at the start
+// of a batch.
+//
+// Readers of the store see the rows appear in order, as with append().
+class ParallelDissector {
+public:
+    static constexpr size_t CHUNK_ROWS = 1024;
+
+    // `threads` includes the writer; 0 means one per core.
+    explicit ParallelDissector(unsigned threads = 0);
+    ~ParallelDissector();
+
+    ParallelDissector(const ParallelDissector&) = delete;
+    ParallelDissector& operator=(const ParallelDissector&) = delete;
+
+    unsigned threads() const { return static_cast<unsigned>(helpers_.size()) + 1; }
+
+    // Writer thread of `store`, whose Config::mapped_file must be
+    // file.mapping(). Appends the frames as append_mapped() would, one row
+    // each, and returns the index of the first. `decoded`, if given,
+    // receives each frame's decode. Only Ethernet frames are decoded;
+    // others keep their timestamps and lengths.
+    size_t append(PacketStore& store, const CaptureFile& file, const CaptureFile::Frame* frames, size_t count,
+                  DecodedPacket* decoded = nullptr);
+
+private:
+    struct Address {
+        uint8_t bytes[16];
+    };
+
+    // A row numbered in its chunk's dictionary: addresses with LOCAL_ID
+    // set, and the protocol if `protocol` is not -1.
+    struct Fixup {
+        size_t row;
+        int protocol;
+    };
+
+    // Rows [begin, end) and the values they use that the store's
+    // dictionaries did not have yet.
+    struct Chunk {
+        size_t begin = 0;
+        size_t end = 0;
+        std::vector<Address> addresses;
+        std::vector<uint32_t> table;        // open-addressed ids into addresses
+        std::vector<const char*> protocols;
+        std::vector<Fixup> fixups;
+        std::atomic<bool> done{false};
+    };
+
+    void run_helper();
+    // Claims and dissects the next chunk; false once none are left.
+    bool dissect_next();
+    void dissect(Chunk& chunk);
+    uint32_t address_id(Chunk& chunk, const uint8_t* address) const;
+    int local_protocol(Chunk& chunk, const char* name) const;
+    void stitch(Chunk& chunk);
+
+    // The batch in progress; set by the writer before the helpers wake.
+    PacketStore* store_ = nullptr;
+    PacketStore::Contents* contents_ = nullptr;
+    const CaptureFile* file_ = nullptr;
+    const CaptureFile::Frame* frames_ = nullptr;
+    DecodedPacket* decoded_ = nullptr;
+    size_t first_row_ = 0;
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+    size_t chunk_count_ = 0;
+    std::atomic<size_t> next_chunk_{0};
+    std::atomic<unsigned> busy_{0};         // helpers inside the batch
+
+    // Writer's scratch for stitching.
+    std::vector<uint32_t> address_ids_;
+    std::vector<uint8_t> protocol_codes_;
+
+    std::mutex mutex_;
+    std::condition_variable wake_;
+    uint64_t generation_ = 0;               // batches started
+    bool active_ = false;
+    bool stopping_ = false;
+    std::vector<std::thread> helpers_;
+};
+
+#endif // PARALLEL_DISSECTOR_H
@@ -0,0 +1,189 @@
+#ifndef REORDER_BUFFER_H
+#define REORDER_BUFFER_H
+
+#include "netlyzer/core/spsc_ring.h"
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+// Merges several per-source streams, each already in timestamp order, into a
+// single timestamp-ordered stream.
+//
+// Every source has its own bounded SPSC queue, so a busy source can only fill
+// its own queue and never delays or drops packets from the others. The single
+// consumer does a k-way merge over the queue heads. It only emits the oldest
+// head once every empty source has promised, through a push or advance(),
+// that nothing older is coming, or once the head has waited max_delay_ns
+// behind the newest timestamp seen.
+template <typename T>
+class ReorderBuffer {
+public:
+    struct Statistics {
+        uint64_t pushed = 0;
+        uint64_t emitted = 0;
+        uint64_t dropped = 0;   // rejected because the source queue was full
+        uint64_t late = 0;      // emitted behind an already-emitted timestamp
+        uint64_t forced = 0;    // emitted on timeout without every source caught up
+    };
+
+    ReorderBuffer(size_t sources, size_t capacity_per_source, uint64_t max_delay_ns)
+        : max_delay_ns_(max_delay_ns)
+        , last_emitted_(0)
+        , emitted_(0)
+        , late_(0)
+        , forced_(0)
+    {
+        sources_.reserve(sources);
+        for (size_t i = 0; i < sources; ++i)
+            sources_.emplace_back(new Source(capacity_per_source));
+    }
+
+    size_t sources() const { return sources_.size(); }
+
+    // Producer side; only the thread that owns `source` may call these.
+    bool push(size_t source, uint64_t timestamp_ns, T&& item)
+    {
+        Source& s = *sources_[source];
+        if (!s.queue.try_push(Entry{timestamp_ns, std::move(item)})) {
+            s.dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        s.pushed.fetch_add(1, std::memory_order_relaxed);
+        raise(s.watermark, timestamp_ns);
+        return true;
+    }
+
+    // Promises that `source` will not push anything older than timestamp_ns.
+    // Idle sources call this so they do not hold back the others.
+    void advance(size_t source, uint64_t timestamp_ns)
+    {
+        raise(sources_[source]->watermark, timestamp_ns);
+    }
+
+    // Consumer side. Passes every item that is safe to release to
+    // sink(timestamp_ns, T&&) in timestamp order and returns how many were
+    // released. now_ns, when given, lets items time out even if no source
+    // produces anything newer. With flush set, everything queued is released.
+    // At most `limit` items are released per call.
+    template <typename Sink>
+    size_t drain(Sink&& sink, uint64_t now_ns = 0, bool flush = false, size_t limit = SIZE_MAX)
+    {
+        size_t released = 0;
+        while (released < limit) {
+            Source* oldest = nullptr;
+            Entry* head = nullptr;
+            uint64_t newest = now_ns;
+            for (auto& s : sources_) {
+                const uint64_t mark = s->watermark.load(std::memory_order_acquire);
+                if (mark > newest)
+                    newest = mark;
+                Entry* entry = s->queue.front();
+                if (entry && (!head || entry->timestamp_ns < head->timestamp_ns)) {
+                    head = entry;
+                    oldest = s.get();
+                }
+            }
+            if (!head)
+                break;
+
+            // A source found empty above may have pushed something older
+            // since; then the head is picked again. Otherwise every source
+            // that is still empty must have promised nothing older.
+            bool overtaken = false;
+            bool safe = true;
+            for (auto& s : sources_) {
+                if (s.get() == oldest)
+                    continue;
+                const Entry* entry = s->queue.front();
+                if (entry) {
+                    if (entry->timestamp_ns < head->timestamp_ns) {
+                        overtaken = true;
+                        break;
+                    }
+                } else if (safe && s->watermark.load(std::memory_order_acquire) < head->timestamp_ns) {
+                    safe = false;
+                }
+            }
+            if (overtaken)
+                continue;
+
+            if (!safe && flush) {
+                safe = true;
+            } else if (!safe && head->timestamp_ns + max_delay_ns_ <= newest) {
+                safe = true;
+                forced_.fetch_add(1, std::memory_order_relaxed);
+            }
+            if (!safe)
+                break;
+
+            const uint64_t timestamp = head->timestamp_ns;
+            if (timestamp < last_emitted_)
+                late_.fetch_add(1, std::memory_order_relaxed);
+            else
+                last_emitted_ = timestamp;
+
+            sink(timestamp, std::move(head->item));
+            oldest->queue.pop();
+            ++released;
+        }
+        emitted_.fetch_add(released, std::memory_order_relaxed);
+        return released;
+    }
+
+    uint64_t dropped(size_t source) const
+    {
+        return sources_[source]->dropped.load(std::memory_order_relaxed);
+    }
+
+    size_t queued(size_t source) const { return sources_[source]->queue.size(); }
+
+    Statistics get_statistics() const
+    {
+        Statistics stats;
+        for (auto& s : sources_) {
+            stats.pushed += s->pushed.load(std::memory_order_relaxed);
+            stats.dropped += s->dropped.load(std::memory_order_relaxed);
+        }
+        stats.emitted = emitted_.load(std::memory_order_relaxed);
+        stats.late = late_.load(std::memory_order_relaxed);
+        stats.forced = forced_.load(std::memory_order_relaxed);
+        return stats;
+    }
+
+private:
+    struct Entry {
+        uint64_t timestamp_ns = 0;
+        T item = T();
+    };
+
+    struct Source {
+        explicit Source(size_t capacity)
+            : queue(capacity), watermark(0), pushed(0), dropped(0)
+        {
+        }
+        SpscRing<Entry> queue;
+        std::atomic<uint64_t> watermark;
+        std::atomic<uint64_t> pushed;
+        std::atomic<uint64_t> dropped;
+    };
+
+    static void raise(std::atomic<uint64_t>& mark, uint64_t value)
+    {
+        uint64_t current = mark.load(std::memory_order_relaxed);
+        while (value > current &&
+               !mark.compare_exchange_weak(current, value, std::memory_order_release,
+                                           std::memory_order_relaxed)) {
+        }
+    }
+
+    std::vector<std::unique_ptr<Source>> sources_;
+    const uint64_t max_delay_ns_;
+    uint64_t last_emitted_;
+    std::atomic<uint64_t> emitted_;
+    std::atomic<uint64_t> late_;
+    std::atomic<uint64_t> forced_;
+};
+
+#endif // REORDER_BUFFER_H
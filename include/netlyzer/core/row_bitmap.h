@@ -0,0 +1,97 @@
+#ifndef ROW_BITMAP_H
+#define ROW_BITMAP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+// A compressed set of row numbers, laid out as a roaring bitmap: rows are
+// grouped into chunks of 65536 by their high 16 bits, and each chunk that
+// holds any rows keeps their low 16 bits either as a sorted array (up to
+// ARRAY_MAX of them, two bytes a row) or as a 65536-bit bitmap (8 KiB, for
+// denser chunks). Sparse sets cost a few bytes a row, dense ones one bit,
+// and AND, OR and AND NOT work a chunk at a time: word by word between
+// bitmaps, by merging or probing otherwise.
+//
+// Rows are usually added in increasing order, which appends to the last
+// chunk; adding out of order works but inserts.
+class RowBitmap {
+public:
+    static constexpr size_t ARRAY_MAX = 4096;
+
+    RowBitmap() = default;
+
+    // Rows first up to, but not including, last.
+    static RowBitmap range(uint32_t first, uint32_t last);
+    // Every row in any of `sets`, in one pass; cheaper than OR-ing many
+    // sets one at a time.
+    static RowBitmap union_of(const std::vector<const RowBitmap*>& sets);
+
+    void add(uint32_t row);
+    // Rows first up to last; appends when they all come after this set.
+    void add_range(uint32_t first, uint32_t last);
+    bool contains(uint32_t row) const;
+    uint64_t cardinality() const;
+    bool empty() const { return chunks_.empty(); }
+    void clear() { chunks_.clear(); }
+
+    RowBitmap operator&(const RowBitmap& other) const;
+    RowBitmap operator|(const RowBitmap& other) const;
+    // Rows in this set and not in `other`.
+    RowBitmap and_not(const RowBitmap& other) const;
+    RowBitmap& operator&=(const RowBitmap& other) { return *this = *this & other; }
+    RowBitmap& operator|=(const RowBitmap& other) { return *this = *this | other; }
+
+    bool operator==(const RowBitmap& other) const;
+    bool operator!=(const RowBitmap& other) const { return !(*this == other); }
+
+    // Calls f(row) for every row, in increasing order.
+    template <typename F>
+    void for_each(F f) const;
+    std::vector<uint32_t> to_vector() const;
+
+    size_t memory_bytes() const;
+
+private:
+    static constexpr size_t WORDS = 65536 / 64;
+
+    // One 65536-row chunk; `words` is empty while the rows fit `values`.
+    struct Chunk {
+        uint16_t key = 0;
+        uint32_t count = 0;
+        std::vector<uint16_t> values;
+        std::vector<uint64_t> words;
+
+        bool is_bitmap() const { return !words.empty(); }
+        bool contains(uint16_t low) const;
+        void add(uint16_t low);
+        void to_bitmap();
+        // Back to an array if the count allows, after an AND or AND NOT.
+        void shrink();
+    };
+
+    static Chunk and_chunks(const Chunk& a, const Chunk& b);
+    static Chunk or_chunks(const Chunk& a, const Chunk& b);
+    static Chunk and_not_chunks(const Chunk& a, const Chunk& b);
+
+    std::vector<Chunk> chunks_;         // by key
+};
+
+template <typename F>
+void RowBitmap::for_each(F f) const
+{
+    for (const Chunk& chunk : chunks_) {
+        const uint32_t high = static_cast<uint32_t>(chunk.key) << 16;
+        if (!chunk.is_bitmap()) {
+            for (uint16_t low : chunk.values)
+                f(high | low);
+            continue;
+        }
+        for (size_t word = 0; word < WORDS; ++word) {
+            for (uint64_t bits = chunk.words[word]; bits != 0; bits &= bits - 1)
+                f(high | static_cast<uint32_t>(word * 64 + __builtin_ctzll(bits)));
+        }
+    }
+}
+
+#endif // ROW_BITMAP_H
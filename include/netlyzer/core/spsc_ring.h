@@ -0,0 +1,108 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <utility>
+
+// Bounded lock-free queue for exactly one producer thread and one consumer
+// thread. Capacity is rounded up to a power of two. Each side keeps a cached
+// copy of the other side's index so the shared cache lines are only touched
+// when the cached view says the ring is full or empty.
+template <typename T>
+class SpscRing {
+public:
+    explicit SpscRing(size_t capacity)
+        : mask_(round_up(capacity) - 1)
+        , slots_(new T[mask_ + 1])
+        , head_(0)
+        , cached_tail_(0)
+        , tail_(0)
+        , cached_head_(0)
+    {
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    // Producer side.
+    bool try_push(T&& value)
+    {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - cached_head_ > mask_) {
+            cached_head_ = head_.load(std::memory_order_acquire);
+            if (tail - cached_head_ > mask_)
+                return false;
+        }
+        slots_[tail & mask_] = std::move(value);
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool try_push(const T& value)
+    {
+        T copy(value);
+        return try_push(std::move(copy));
+    }
+
+    // Consumer side. Returns the oldest element, or nullptr when empty. The
+    // pointer stays valid until pop().
+    T* front()
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == cached_tail_) {
+            cached_tail_ = tail_.load(std::memory_order_acquire);
+            if (head == cached_tail_)
+                return nullptr;
+        }
+        return &slots_[head & mask_];
+    }
+
+    void pop()
+    {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        slots_[head & mask_] = T();
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    bool try_pop(T& out)
+    {
+        T* value = front();
+        if (!value)
+            return false;
+        out = std::move(*value);
+        pop();
+        return true;
+    }
+
+    // Approximate when called concurrently with the other side.
+    size_t size() const
+    {
+        return tail_.load(std::memory_order_acquire) - head_.load(std::memory_order_acquire);
+    }
+    bool empty() const { return size() == 0; }
+    size_t capacity() const { return mask_ + 1; }
+
+private:
+    static size_t round_up(size_t value)
+    {
+        size_t result = 2;
+        while (result < value)
+            result <<= 1;
+        return result;
+    }
+
+    const size_t mask_;
+    std::unique_ptr<T[]> slots_;
+
+    // Consumer-owned line.
+    alignas(64) std::atomic<size_t> head_;
+    size_t cached_tail_;
+
+    // Producer-owned line.
+    alignas(64) std::atomic<size_t> tail_;
+    size_t cached_head_;
+};
+
+#endif // SPSC_RING_H
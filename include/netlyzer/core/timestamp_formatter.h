@@ -0,0 +1,60 @@
+#ifndef TIMESTAMP_FORMATTER_H
+#define TIMESTAMP_FORMATTER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+// Packet timestamps are kept as nanoseconds since the epoch from capture to
+// storage and only turned into text for rows that are actually shown.
+//
+// Absolute times share their "hh:mm:ss" prefix with every other packet in the
+// same second, so the prefix is cached and only the fraction is formatted per
+// call. Relative and delta times are plain integer arithmetic on the same
+// value. A formatter caches state and must not be shared between threads.
+class TimestampFormatter {
+public:
+    enum class Mode {
+        Absolute,   // local time of day
+        Relative,   // seconds since the reference (first packet)
+        Delta       // seconds since the previous packet
+    };
+
+    static constexpr size_t MAX_LENGTH = 32;
+
+    explicit TimestampFormatter(Mode mode = Mode::Absolute, unsigned digits = 9);
+
+    void set_mode(Mode mode) { mode_ = mode; }
+    Mode mode() const { return mode_; }
+
+    // Fractional digits shown, 0 to 9. Extra digits are truncated, not rounded.
+    void set_digits(unsigned digits) { digits_ = digits > 9 ? 9 : digits; }
+    unsigned digits() const { return digits_; }
+
+    void set_reference(uint64_t reference_ns) { reference_ns_ = reference_ns; }
+    uint64_t reference() const { return reference_ns_; }
+
+    // Writes up to MAX_LENGTH characters, without a terminator, and returns
+    // the length. `previous_ns` is only used in Delta mode.
+    size_t format(uint64_t timestamp_ns, uint64_t previous_ns, char* out) const;
+    std::string format(uint64_t timestamp_ns, uint64_t previous_ns = 0) const;
+
+    static uint64_t from_timeval(int64_t seconds, int64_t fraction, bool nanoseconds)
+    {
+        return static_cast<uint64_t>(seconds) * 1000000000
+             + static_cast<uint64_t>(fraction) * (nanoseconds ? 1 : 1000);
+    }
+
+private:
+    size_t format_duration(uint64_t duration_ns, bool negative, char* out) const;
+    size_t format_fraction(uint32_t nanoseconds, char* out) const;
+
+    Mode mode_;
+    unsigned digits_;
+    uint64_t reference_ns_;
+
+    mutable int64_t cached_second_;
+    mutable char prefix_[8];        // "hh:mm:ss" for cached_second_
+};
+
+#endif // TIMESTAMP_FORMATTER_H
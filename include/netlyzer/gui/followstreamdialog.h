@@ -0,0 +1,83 @@
+#ifndef FOLLOWSTREAMDIALOG_H
+#define FOLLOWSTREAMDIALOG_H
+
+#include <QDialog>
+#include <QAbstractListModel>
+#include <QListView>
+#include <QComboBox>
+#include <QLabel>
+#include <QPushButton>
+#include <QVector>
+#include "netlyzer/network/tcp_reassembler.h"
+
+// Rows of a followed TCP stream, rendered only when the view asks for them.
+// The conversation is split into runs of one direction; each run is cut into
+// fixed-width rows, and data() reads a row's bytes through the index from
+// wherever the frames are stored, so scrolling through a multi-gigabyte
+// transfer only ever reads and formats the rows on screen.
+class StreamPageModel : public QAbstractListModel
+{
+    Q_OBJECT
+
+public:
+    enum class Mode {
+        Ascii,
+        HexDump
+    };
+
+    StreamPageModel(const TcpStreamIndex *index, TcpStreamIndex::FrameSource frames, QObject *parent = nullptr);
+
+    void setMode(Mode mode);
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+
+private:
+    struct Run {
+        quint64 position;
+        quint64 length;
+        quint64 firstRow;       // the gap marker, if any, then the data rows
+        quint8 direction;
+        bool gap;
+    };
+
+    void buildRuns();
+    int runForRow(quint64 row) const;
+    QString rowText(const Run &run, quint64 rowInRun) const;
+
+    const TcpStreamIndex *m_index;
+    TcpStreamIndex::FrameSource m_frames;
+    Mode m_mode;
+    QVector<Run> m_runs;
+    quint64 m_rowCount;
+};
+
+class FollowStreamDialog : public QDialog
+{
+    Q_OBJECT
+
+public:
+    // `frames` must stay valid for as long as the dialog is open.
+    FollowStreamDialog(TcpStreamIndex index, TcpStreamIndex::FrameSource frames, const QString &client,
+                       const QString &server, QWidget *parent = nullptr);
+    ~FollowStreamDialog();
+
+private slots:
+    void onModeChanged(int mode);
+
+private:
+    void setupUI();
+
+    TcpStreamIndex m_index;
+    TcpStreamIndex::FrameSource m_frames;
+    QString m_client;
+    QString m_server;
+
+    StreamPageModel *m_model;
+    QListView *m_view;
+    QComboBox *m_modeCombo;
+    QLabel *m_summaryLabel;
+    QPushButton *m_closeButton;
+};
+
+#endif // FOLLOWSTREAMDIALOG_H
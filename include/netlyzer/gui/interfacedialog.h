@@ -17,6 +17,7 @@ public:
     ~InterfaceDialog();
 
     QString selectedInterface() const;
+    QStringList selectedInterfaces() const;
 
 private slots:
     void refreshInterfaces();
@@ -32,7 +33,7 @@ private:
     QPushButton *m_refreshButton;
     QLabel *m_descriptionLabel;
     
-    QString m_selectedInterface;
+    QStringList m_selectedInterfaces;
 };
 
 #endif // INTERFACEDIALOG_H
@@ -9,15 +9,22 @@
 #include <QToolBar>
 #include <QStatusBar>
 #include <QAction>
+#include <QActionGroup>
 #include <QLabel>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QVector>
 #include <memory>
+#include "netlyzer/core/display_filter.h"
+#include "netlyzer/network/packet_capture.h"
 
 class PacketListWidget;
 class PacketDetailsWidget;
 class HexDumpWidget;
 class InterfaceDialog;
-class PacketCapture;
+class PacketModel;
+class CaptureFile;
+class QLineEdit;
 
 class MainWindow : public QMainWindow
 {
@@ -33,11 +40,19 @@ private slots:
     void selectInterface();
     void openFile();
     void saveFile();
+    void selectRecordFile(bool enabled);
     void showAbout();
     void clearPackets();
     void showStatistics();
+    void followTcpStream();
     void applyFilter();
+    void clearFilter();
     void updateStatus();
+    void onPacketsCaptured(const QVector<PacketRecord> &records);
+    void loadFileFrames();
+    void saveFileRows();
+    void onPacketSelected(int packetNumber);
+    void selectCaptureProfile(QAction *action);
 
 private:
     void setupUI();
@@ -45,11 +60,15 @@ private:
     void setupToolBar();
     void setupStatusBar();
     void connectSignals();
+    void loadCaptureProfiles();
+    void stopFileLoading();
+    void finishSaving();
 
     // UI Components
     QWidget *m_centralWidget;
     QSplitter *m_mainSplitter;
     QSplitter *m_rightSplitter;
+    QLineEdit *m_filterEdit;
     
     PacketListWidget *m_packetListWidget;
     PacketDetailsWidget *m_packetDetailsWidget;
@@ -61,10 +80,14 @@ private:
     QAction *m_selectInterfaceAction;
     QAction *m_openFileAction;
     QAction *m_saveFileAction;
+    QAction *m_recordAction;
     QAction *m_clearPacketsAction;
     QAction *m_exitAction;
     QAction *m_aboutAction;
     QAction *m_statisticsAction;
+    QAction *m_followStreamAction;
+    QMenu *m_profileMenu;
+    QActionGroup *m_profileGroup;
     
     // Status bar
     QLabel *m_statusLabel;
@@ -73,9 +96,28 @@ private:
     
     // Core components
     std::unique_ptr<PacketCapture> m_packetCapture;
+    PacketModel *m_packetModel;
+    CaptureProfiles m_captureProfiles;
+    // The last filter text that parsed; the list keeps its own copy to
+    // decide new packets with.
+    DisplayFilter m_displayFilter;
     QTimer *m_statusTimer;
+    // The open capture file while its frames are indexed a slice at a time,
+    // and after, for its interface names.
+    std::unique_ptr<CaptureFile> m_captureFile;
+    QTimer *m_fileTimer;
+    QElapsedTimer m_fileLoadTime;
+    // A save in progress: the rows as they were when it began, written out
+    // a slice at a time like a file is read in.
+    std::unique_ptr<CaptureWriter> m_saveWriter;
+    QTimer *m_saveTimer;
+    QElapsedTimer m_saveTime;
+    QString m_saveFileName;
+    size_t m_saveRow;
+    size_t m_saveRows;
     
-    QString m_currentInterface;
+    QStringList m_currentInterfaces;
+    int m_selectedPacket;
     bool m_isCapturing;
     int m_packetCount;
 };
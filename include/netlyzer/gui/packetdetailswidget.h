@@ -5,6 +5,7 @@
 #include <QTreeView>
 #include <QStandardItemModel>
 #include <QVBoxLayout>
+#include "netlyzer/network/packet_capture.h"
 
 class PacketDetailsWidget : public QWidget
 {
@@ -14,7 +15,9 @@ public:
     explicit PacketDetailsWidget(QWidget *parent = nullptr);
     ~PacketDetailsWidget();
 
-    void showPacketDetails(int packetNumber);
+    // Builds the tree from the record's decoded layers; header bytes are
+    // only read for fields the record does not keep (MAC addresses).
+    void showPacketDetails(const PacketRecord &record);
     void clearDetails();
 
 private:
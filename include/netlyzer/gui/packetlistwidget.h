@@ -5,22 +5,131 @@
 #include <QTableView>
 #include <QVBoxLayout>
 #include <QHeaderView>
-#include <QStandardItemModel>
-#include <QSortFilterProxyModel>
+#include <QAbstractTableModel>
+#include <functional>
+#include <vector>
+#include "netlyzer/core/display_filter.h"
+#include "netlyzer/core/row_bitmap.h"
+#include "netlyzer/core/timestamp_formatter.h"
+
+class PacketModel;
+
+// The packet list's rows, read from the PacketModel's store only when the
+// view asks for them: nothing is kept per packet beyond the store's own
+// columns. Unfiltered and in capture order, row i is packet i + 1;
+// otherwise the model keeps the stored row of each row shown, in order.
+// A new batch of packets is filtered and sorted by itself and merged in.
+// The text columns of the packet last asked for are formatted once and
+// kept, since the view asks for every column and role of a row in turn.
+class PacketTableModel : public QAbstractTableModel
+{
+    Q_OBJECT
+
+public:
+    enum Column {
+        NumberColumn,
+        TimeColumn,
+        InterfaceColumn,
+        SourceColumn,
+        DestinationColumn,
+        ProtocolColumn,
+        LengthColumn,
+        InfoColumn,
+        ColumnCount
+    };
+
+    // Time column: Qt::DisplayRole holds the timestamp itself, so sorting
+    // stays numeric, and this role the previous packet's for delta display.
+    static constexpr int PreviousTimestampRole = Qt::UserRole + 1;
+
+    explicit PacketTableModel(const PacketModel *packets, QObject *parent = nullptr);
+
+    // Names interface ids for the Interface column.
+    void setInterfaceNames(std::function<QString(quint8)> names);
+
+    // Shows the packets added to the PacketModel since the last call, as
+    // far as the filter lets them.
+    void appendRows();
+    // Shows none, after the PacketModel was cleared; the filter stays.
+    void clearRows();
+
+    // Shows only `rows`, which `filter` gave for the packets so far; later
+    // packets are decided by the filter one at a time.
+    void setDisplayFilter(const DisplayFilter &filter, const RowBitmap &rows);
+    // Shows only packets with `text` in a text column, ignoring case; an
+    // empty one shows them all.
+    void setTextFilter(const QString &text);
+    // The packet number shown in `row`.
+    int packetNumber(int row) const { return static_cast<int>(packetAt(row)) + 1; }
+
+    int rowCount(const QModelIndex &parent = QModelIndex()) const override;
+    int columnCount(const QModelIndex &parent = QModelIndex()) const override;
+    QVariant data(const QModelIndex &index, int role = Qt::DisplayRole) const override;
+    QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
+    void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
+private:
+    enum class Filter {
+        None,
+        Display,
+        Text
+    };
+
+    struct RowText {
+        QString interfaceName;
+        QString source;
+        QString destination;
+        QString protocol;
+        QString info;
+    };
+
+    // Packets are stored rows, numbered from 0.
+    uint32_t packetAt(int row) const { return m_mapped ? m_rows[row] : static_cast<uint32_t>(row); }
+    int rowOf(uint32_t packet) const;
+    RowText formatRow(uint32_t packet) const;
+    const RowText &rowText(uint32_t packet) const;
+    static const QString &columnText(const RowText &text, int column);
+    bool accepts(uint32_t packet) const;
+    // Whether `a` is shown above `b` in the current sort order.
+    bool before(uint32_t a, uint32_t b) const;
+    bool inCaptureOrder() const;
+    void sortRows();
+    // Rebuilds m_rows for a new filter, inside a model reset.
+    void filterRows();
+
+    const PacketModel *m_packets;
+    std::function<QString(quint8)> m_interfaceNames;
+    int m_packetCount;
+    Filter m_filter;
+    DisplayFilter m_displayFilter;
+    QString m_text;
+    bool m_mapped;
+    std::vector<uint32_t> m_rows;
+    int m_sortColumn;
+    Qt::SortOrder m_sortOrder;
+    mutable qint64 m_cachedPacket;
+    mutable RowText m_cachedText;
+};
 
 class PacketListWidget : public QWidget
 {
     Q_OBJECT
 
 public:
-    explicit PacketListWidget(QWidget *parent = nullptr);
+    explicit PacketListWidget(const PacketModel *packets, QWidget *parent = nullptr);
     ~PacketListWidget();
 
-    void addPacket(int number, const QString &time, const QString &source, 
-                   const QString &destination, const QString &protocol, 
-                   int length, const QString &info);
+    void setInterfaceNames(std::function<QString(quint8)> names);
+    // Shows the packets added to the PacketModel since the last call, as one
+    // batch, so the view repaints and scrolls once instead of once per row.
+    void addPackets();
     void clearPackets();
+    // Shows rows whose text contains `filter`; an empty one shows them all.
     void applyFilter(const QString &filter);
+    // Shows only `rows`, numbered from 0 for the first packet, which
+    // `filter` matched; packets added later are shown if it matches them.
+    void setDisplayFilter(const DisplayFilter &filter, const RowBitmap &rows);
+    void setTimeDisplayMode(TimestampFormatter::Mode mode);
 
 signals:
     void packetSelected(int packetNumber);
@@ -31,11 +140,14 @@ private slots:
 private:
     void setupUI();
     void setupModel();
+    void beginBatch();
+    void endBatch();
 
+    const PacketModel *m_packets;
     QTableView *m_tableView;
-    QStandardItemModel *m_model;
-    QSortFilterProxyModel *m_proxyModel;
+    PacketTableModel *m_model;
     QVBoxLayout *m_layout;
+    TimestampFormatter m_timestampFormatter;
 };
 
 #endif // PACKETLISTWIDGET_H
@@ -0,0 +1,92 @@
+#ifndef CAPTURE_EVENT_LOOP_H
+#define CAPTURE_EVENT_LOOP_H
+
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <string>
+
+// Readiness loop for a capture descriptor (pcap selectable fd or packet ring
+// socket). The capture thread drains everything that is ready, records the
+// batch, and then sleeps in epoll until the kernel has more data or another
+// thread calls wakeup(). In busy-poll mode it never sleeps.
+class CaptureEventLoop {
+public:
+    struct Config {
+        bool busy_poll = false;
+        uint32_t busy_poll_usec = 50;   // SO_BUSY_POLL budget for the socket
+        int idle_timeout_ms = 100;      // upper bound on a single epoll sleep
+        size_t max_batch = 4096;        // packets drained before re-checking for stop
+    };
+
+    enum class Event {
+        Readable,
+        Wakeup,
+        Timeout,
+        Error
+    };
+
+    // Batch sizes are bucketed by power of two: bucket i counts batches of
+    // [2^i, 2^(i+1)) packets, the last bucket collects everything larger.
+    static constexpr size_t BATCH_BUCKETS = 16;
+
+    struct Statistics {
+        uint64_t wakeups = 0;           // epoll returned with the capture fd ready
+        uint64_t timeouts = 0;          // epoll returned with nothing ready
+        uint64_t empty_batches = 0;     // drains that found no packets
+        uint64_t batches = 0;
+        uint64_t packets = 0;
+        uint64_t max_batch = 0;
+        uint64_t idle_ns = 0;           // time spent sleeping or spinning idle
+        uint64_t batch_histogram[BATCH_BUCKETS] = {};
+
+        // Folds another loop's counters into this one.
+        void accumulate(const Statistics& other);
+    };
+
+    CaptureEventLoop();
+    ~CaptureEventLoop();
+
+    CaptureEventLoop(const CaptureEventLoop&) = delete;
+    CaptureEventLoop& operator=(const CaptureEventLoop&) = delete;
+
+    bool open(int capture_fd, const Config& config);
+    void close();
+    bool is_open() const { return epoll_fd_ >= 0; }
+    const Config& config() const { return config_; }
+
+    // Sleeps until the capture fd is readable, wakeup() is called or the idle
+    // timeout expires. Returns immediately in busy-poll mode.
+    Event wait();
+
+    // Interrupts a wait() in progress. Safe to call from any thread.
+    void wakeup();
+
+    // Called by the capture thread after every drain.
+    void record_batch(size_t packets);
+
+    Statistics get_statistics() const;
+    void reset_statistics();
+    const std::string& last_error() const { return error_; }
+
+private:
+    void add_idle(uint64_t ns) { idle_ns_.fetch_add(ns, std::memory_order_relaxed); }
+
+    int epoll_fd_;
+    int wakeup_fd_;
+    int capture_fd_;
+    Config config_;
+    std::string error_;
+    uint64_t busy_idle_start_ns_;
+
+    std::atomic<uint64_t> wakeups_;
+    std::atomic<uint64_t> timeouts_;
+    std::atomic<uint64_t> empty_batches_;
+    std::atomic<uint64_t> batches_;
+    std::atomic<uint64_t> packets_;
+    std::atomic<uint64_t> max_batch_;
+    std::atomic<uint64_t> idle_ns_;
+    std::atomic<uint64_t> batch_histogram_[BATCH_BUCKETS];
+};
+
+#endif // CAPTURE_EVENT_LOOP_H
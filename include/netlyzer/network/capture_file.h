@@ -0,0 +1,113 @@
+#ifndef CAPTURE_FILE_H
+#define CAPTURE_FILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+
+// A pcap or pcapng file, mapped read-only and walked in place.
+//
+// read() makes one forward pass over the record headers, handing back where
+// each frame's bytes start in the file along with its timestamp, lengths
+// and interface, and nothing is copied: the bytes are read straight from
+// the mapping, which mapping() shares so that it outlives the reader for as
+// long as anything still points into it. The pass stops after each batch,
+// so a caller can show the first frames of a multi-gigabyte file at once
+// and index the rest a batch at a time.
+//
+// Reads pcap with microsecond or nanosecond timestamps and pcapng section
+// headers, interface descriptions (with if_tsresol and if_tsoffset),
+// enhanced, simple and obsolete packet blocks, in either byte order; other
+// pcapng blocks are skipped. Timestamps come back in nanoseconds.
+class CaptureFile {
+public:
+    static constexpr uint16_t LINKTYPE_ETHERNET = 1;
+
+    enum class Format {
+        Pcap,
+        PcapNg
+    };
+
+    struct Frame {
+        uint64_t offset = 0;            // of the packet bytes in the file
+        uint64_t timestamp_ns = 0;
+        uint32_t captured_length = 0;
+        uint32_t length = 0;            // on the wire
+        uint32_t interface = 0;         // numbered across pcapng sections
+        uint16_t link_type = LINKTYPE_ETHERNET;
+    };
+
+    CaptureFile();
+    ~CaptureFile();
+
+    CaptureFile(const CaptureFile&) = delete;
+    CaptureFile& operator=(const CaptureFile&) = delete;
+
+    // False, with last_error() set, if the file cannot be mapped or is
+    // neither pcap nor pcapng.
+    bool open(const std::string& path);
+    void close();
+    bool is_open() const { return base_ != nullptr; }
+    const std::string& last_error() const { return error_; }
+
+    // Fills in up to max_frames frames from where the last call stopped and
+    // returns how many; 0 once done().
+    size_t read(Frame* frames, size_t max_frames);
+    // Past the last frame, or stopped at a record that runs off the end of
+    // the file or is malformed; truncated() tells which, with the reason in
+    // last_error(). Every frame before it was returned.
+    bool done() const { return done_; }
+    bool truncated() const { return truncated_; }
+
+    Format format() const { return format_; }
+    uint64_t size() const { return size_; }
+    uint64_t position() const { return position_; }
+
+    const uint8_t* data(const Frame& frame) const { return base_ + frame.offset; }
+    // The whole file; unmapped when the last copy goes.
+    std::shared_ptr<const uint8_t> mapping() const { return mapping_; }
+
+    // Interfaces seen so far: one for pcap, one per IDB for pcapng. The name
+    // is if_name, or empty.
+    size_t interface_count() const { return interfaces_.size(); }
+    uint16_t link_type(size_t interface) const { return interfaces_[interface].link_type; }
+    const std::string& interface_name(size_t interface) const { return interfaces_[interface].name; }
+
+private:
+    struct Interface {
+        uint16_t link_type = LINKTYPE_ETHERNET;
+        uint32_t snaplen = 0;
+        bool binary_resolution = false;     // if_tsresol is a power of two
+        uint8_t resolution = 6;             // units of 10^-n (or 2^-n) seconds
+        int64_t offset_seconds = 0;         // if_tsoffset
+        std::string name;
+    };
+
+    bool stop(const std::string& reason);
+    uint16_t read16(uint64_t position) const;
+    uint32_t read32(uint64_t position) const;
+    uint64_t read64(uint64_t position) const;
+    uint64_t timestamp(const Interface& interface, uint64_t units) const;
+
+    bool read_pcap(Frame& frame);
+    bool read_pcapng(Frame& frame);
+    bool read_section(uint64_t position, uint32_t length);
+    bool read_interface(uint64_t position, uint32_t length);
+
+    const uint8_t* base_ = nullptr;
+    std::shared_ptr<const uint8_t> mapping_;
+    uint64_t size_ = 0;
+    uint64_t position_ = 0;
+    Format format_ = Format::Pcap;
+    bool swapped_ = false;              // the file's byte order is not ours
+    bool nanoseconds_ = false;          // pcap only
+    bool done_ = true;
+    bool truncated_ = false;
+    std::vector<Interface> interfaces_;
+    size_t section_interfaces_ = 0;     // first interface of this pcapng section
+    std::string error_;
+};
+
+#endif // CAPTURE_FILE_H
@@ -0,0 +1,69 @@
+#ifndef CAPTURE_PROFILE_H
+#define CAPTURE_PROFILE_H
+
+#include <string>
+#include <vector>
+#include <pcap.h>
+
+// Named set of live-capture settings. A deployment picks the trade-off
+// between fidelity and throughput in config.json instead of in code; e.g. a
+// headers-only profile with a small snaplen and a large kernel buffer keeps
+// up with a much busier link than full-packet capture.
+struct CaptureProfile {
+    std::string name = "default";
+    int snaplen = 262144;               // bytes kept per packet
+    int buffer_size_mb = 0;             // kernel buffer; 0 keeps the libpcap default
+    int timeout_ms = 1000;              // read timeout, ignored in immediate mode
+    bool promiscuous = true;
+    bool immediate_mode = false;        // deliver each packet as it arrives
+    bool nanosecond_timestamps = false; // ask for PCAP_TSTAMP_PRECISION_NANO
+    std::string timestamp_type;         // e.g. "adapter"; empty uses the default clock
+    std::string filter;                 // BPF expression applied on open
+    bool verify_checksums = false;      // run ChecksumVerifier on every decoded packet
+    int reassembly_mb = 0;              // memory cap for IP fragment reassembly; 0 disables it
+    int flow_table_mb = 0;              // fixed size of the flow table; 0 disables flow tracking
+    int packet_memory_mb = 0;           // packet bytes kept in RAM; 0 keeps everything resident
+    std::string spill_directory;        // where older packet bytes go past packet_memory_mb
+    std::string packet_compression = "none";    // codec for stored packet bytes: none, zlib or lz4
+    int record_buffer_mb = 64;          // queued for disk when recording; packets drop past it
+    int ring_file_mb = 0;               // start a new record file after this size; 0 = no limit
+    int ring_file_seconds = 0;          // or after this much capture time; 0 = no limit
+    int ring_files = 0;                 // record files kept when rotating; 0 keeps them all
+};
+
+// The profiles known to the application: a built-in "default" plus whatever
+// config.json defines, in the form
+//
+//   { "capture": { "default_profile": "headers-only",
+//                  "profiles": { "headers-only": { "snaplen": 128, ... } } } }
+//
+// Keys a profile leaves out keep the values of CaptureProfile above.
+class CaptureProfiles {
+public:
+    CaptureProfiles();
+
+    // On failure the already loaded profiles are left untouched.
+    bool load_file(const std::string& path);
+    bool load(const std::string& json);
+
+    const CaptureProfile* find(const std::string& name) const;
+    const CaptureProfile& default_profile() const;
+    std::vector<std::string> names() const;
+
+    const std::string& last_error() const { return error_; }
+
+private:
+    std::vector<CaptureProfile> profiles_;
+    std::string default_name_;
+    std::string error_;
+};
+
+// Opens an interface through pcap_create/pcap_activate with the profile's
+// settings and installs its filter. Returns nullptr and sets `error` on
+// failure; activation warnings are reported in `error` but not fatal.
+pcap_t* open_capture(const std::string& interface_name, const CaptureProfile& profile, std::string& error);
+
+// True when the handle delivers nanoseconds in pcap_pkthdr::ts.tv_usec.
+bool has_nanosecond_timestamps(pcap_t* handle);
+
+#endif // CAPTURE_PROFILE_H
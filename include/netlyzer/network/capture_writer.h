@@ -0,0 +1,169 @@
+#ifndef CAPTURE_WRITER_H
+#define CAPTURE_WRITER_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/uio.h>
+
+// Writes packets to a pcap or pcapng file from a thread of its own.
+//
+// write() only copies the record into the current buffer, under a lock held
+// for that copy, and hands the buffer to the I/O thread once it is full.
+// Buffers are large and page-aligned; the I/O thread gathers every full one
+// queued for a file into a single writev, or, where the kernel has
+// io_uring and the output is a regular file, keeps several such writes in
+// flight at their file offsets. A buffer that has sat partly filled for
+// FLUSH_INTERVAL_MS is written out too, so a quiet capture still reaches
+// the disk.
+//
+// The buffers are the whole queue: if the disk falls behind and none is
+// free, write() drops the packet and counts it instead of waiting, unless
+// Config::drop_when_full is off (for saving a file, where nothing is
+// arriving and every packet must go out).
+//
+// Like dumpcap's ring buffer, the output can move to a new file after a
+// number of bytes or seconds, keeping only the last ring_files of them.
+// Files are then named prefix_NNNNN_YYYYmmddHHMMSS.ext after Config::path;
+// time is measured in packet timestamps, from each file's first packet.
+class CaptureWriter {
+public:
+    static constexpr uint16_t LINKTYPE_ETHERNET = 1;
+    static constexpr int FLUSH_INTERVAL_MS = 500;
+
+    enum class Format {
+        Pcap,
+        PcapNg
+    };
+
+    enum class Backend {
+        IoUring,
+        Writev
+    };
+
+    // One per interface id passed to write(); pcap files take the first.
+    struct Interface {
+        std::string name;
+        uint16_t link_type = LINKTYPE_ETHERNET;
+    };
+
+    struct Config {
+        std::string path;
+        Format format = Format::Pcap;
+        uint32_t snaplen = 262144;
+        std::vector<Interface> interfaces;      // empty = one Ethernet interface
+        size_t buffer_size = 4u << 20;          // rounded up to the page size
+        size_t buffer_count = 16;
+        uint64_t rotate_bytes = 0;              // 0 = no limit
+        uint64_t rotate_seconds = 0;            // 0 = no limit
+        size_t ring_files = 0;                  // when rotating; 0 = keep every file
+        bool use_io_uring = true;
+        bool drop_when_full = true;
+    };
+
+    struct Statistics {
+        uint64_t packets = 0;                   // taken by write()
+        uint64_t bytes = 0;                     // reached the disk, file headers included
+        uint64_t dropped_packets = 0;           // no free buffer
+        uint64_t dropped_bytes = 0;
+        uint64_t files = 0;
+        uint64_t writes = 0;                    // writev calls or io_uring requests
+        uint64_t write_errors = 0;
+        uint64_t buffers_high_water = 0;        // most buffers in use at once
+    };
+
+    CaptureWriter();
+    ~CaptureWriter();
+
+    CaptureWriter(const CaptureWriter&) = delete;
+    CaptureWriter& operator=(const CaptureWriter&) = delete;
+
+    // Creates the first file and starts the I/O thread. False, with
+    // last_error() set, if the file cannot be created or the buffers cannot
+    // hold a snaplen record.
+    bool open(const Config& config);
+    // Writes out everything taken so far and stops the I/O thread.
+    void close();
+    bool is_open() const { return thread_.joinable(); }
+    const std::string& last_error() const { return error_; }
+    Backend backend() const { return backend_; }
+
+    // Any thread. Truncates to the snaplen; false if the packet was dropped
+    // or the writer is not open.
+    bool write(uint64_t timestamp_ns, uint32_t length, uint32_t interface, const uint8_t* data,
+               uint32_t captured_length);
+
+    Statistics get_statistics() const;
+
+private:
+    class Ring;
+
+    // Queued in place of a buffer where the output moves to a new file.
+    static constexpr int END_OF_FILE = -1;
+
+    // One io_uring write of consecutive buffers.
+    struct Request {
+        std::vector<int> buffers;
+        std::vector<iovec> iov;                 // read by the kernel until completion
+        uint64_t offset = 0;
+        uint64_t bytes = 0;
+    };
+
+    // The I/O thread's part.
+    void run();
+    bool open_file();
+    void close_file();
+    void submit(std::vector<int>& buffers);
+    void complete(uint64_t request, int result);
+    void drain(bool wait_all);
+    void abandon_ring();
+    void release(const std::vector<int>& buffers, uint64_t bytes, bool failed);
+    std::string file_name(uint64_t index) const;
+
+    bool fail(const std::string& what);
+    // mutex_ held.
+    void seal();
+    bool take_buffer(std::unique_lock<std::mutex>& lock);
+
+    Config config_;
+    Backend backend_ = Backend::Writev;
+    size_t buffer_size_ = 0;
+    std::vector<uint8_t*> buffers_;
+    std::vector<uint32_t> used_;                // bytes filled in each buffer
+    std::vector<uint8_t> file_header_;
+
+    mutable std::mutex mutex_;
+    std::condition_variable work_;              // something queued, or stopping
+    std::condition_variable space_;             // a buffer came free
+    std::vector<int> free_;
+    std::deque<int> queue_;                     // full buffers, in file order
+    int current_ = -1;                          // buffer being filled
+    uint64_t filled_at_ms_ = 0;                 // when current_ took its first record
+    uint64_t file_bytes_ = 0;                   // of the file being filled
+    uint64_t file_start_ns_ = 0;
+    bool file_has_packets_ = false;
+    bool header_pending_ = false;               // the file header is not in a buffer yet
+    bool accepting_ = false;
+    bool stopping_ = false;
+    Statistics stats_;
+
+    // Owned by the I/O thread once it runs.
+    std::thread thread_;
+    std::unique_ptr<Ring> ring_;
+    int fd_ = -1;
+    uint64_t file_offset_ = 0;
+    uint64_t file_index_ = 0;
+    std::deque<std::string> ring_names_;
+    std::vector<Request> requests_;             // by io_uring user_data
+    std::vector<uint64_t> idle_requests_;
+    size_t in_flight_ = 0;
+    std::string error_;
+};
+
+#endif // CAPTURE_WRITER_H
@@ -0,0 +1,51 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include "netlyzer/network/packet_decoder.h"
+
+// Totals kept by whoever runs the verification stage; safe to update from
+// several capture threads.
+struct ChecksumCounters {
+    std::atomic<uint64_t> verified{0};          // packets with at least one checksum checked
+    std::atomic<uint64_t> bad_ip{0};
+    std::atomic<uint64_t> bad_l4{0};
+    std::atomic<uint64_t> offloaded{0};         // L4 checksum left for the NIC to fill in
+    std::atomic<uint64_t> unverifiable{0};      // cut short by snaplen, or a fragment
+};
+
+// Optional decode stage that checks the IPv4 header, TCP, UDP, ICMP and
+// ICMPv6 checksums of a DecodedPacket and records the outcome in its flags.
+//
+// Frames this host sends are usually captured before the NIC computes the
+// transport checksum; those carry only the pseudo-header sum and are flagged
+// CHECKSUM_OFFLOAD rather than BAD_L4_CHECKSUM, so SPAN-port corruption can
+// be told apart from offload artifacts.
+class ChecksumVerifier {
+public:
+    enum class Path {
+        Best,
+        Scalar,
+        Sse2,
+        Avx2
+    };
+
+    static bool has_path(Path path);
+
+    // One's-complement sum of `length` bytes added to `sum`, in the byte
+    // order of the data (RFC 1071 section 2). Only the last chunk of a chain
+    // may have an odd length.
+    static uint64_t add(const uint8_t* data, size_t length, uint64_t sum = 0, Path path = Path::Best);
+
+    // Folds a sum to 16 bits; a correct checksum region folds to 0xffff.
+    static uint16_t fold(uint64_t sum);
+
+    // Verifies what `packet` describes in `data`. Checksums that are not
+    // fully captured, and transport checksums of fragments, are skipped.
+    static void verify(const uint8_t* data, uint32_t caplen, DecodedPacket& packet,
+                       ChecksumCounters* counters = nullptr);
+};
+
+#endif // CHECKSUM_H
@@ -0,0 +1,192 @@
+#ifndef FLOW_TABLE_H
+#define FLOW_TABLE_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include "netlyzer/network/packet_decoder.h"
+#include "netlyzer/network/tuple_batch.h"
+
+// Per-connection counters for every IP flow seen, in a table whose memory is
+// fixed when it is created.
+//
+// Flows are keyed on (addresses, ports, protocol) with the endpoints in a
+// fixed order, so both directions of a connection hash to the same slot. The
+// table is open-addressed with linear probing over 128-byte slots that hold
+// the key inline; removal shifts later entries back instead of leaving
+// tombstones, so probe sequences stay short as flows come and go. Once
+// 7/8 of the slots are taken, a new flow evicts the least recently seen of
+// the few flows at its home position.
+//
+// Expiry runs on a hierarchical timer wheel (four levels of 64 buckets)
+// driven by packet timestamps, so no pass ever scans the table. A flow is
+// scheduled once and only rescheduled when its timer fires early: packets
+// just move last_seen_ns, and the timer checks it when it comes due.
+//   idle     no packet for idle_timeout_ns (closed_timeout_ns once a TCP
+//            flow has seen RST or a FIN each way); the flow is removed
+//   active   reported every active_timeout_ns while the flow lasts, with
+//            its counters restarted, as NetFlow exporters do
+//
+// Not thread-safe apart from get_statistics(); use one per capture thread.
+class FlowTable {
+public:
+    enum class TcpState : uint8_t {
+        None,               // not TCP
+        SynSent,
+        SynReceived,
+        Established,        // also flows picked up mid-connection
+        Closing,            // FIN from one side
+        Closed              // FIN from both sides, or RST
+    };
+
+    enum class Expiry {
+        Idle,
+        Closed,
+        Active,
+        Evicted
+    };
+
+    struct Key {
+        uint8_t address[2][16];     // network order; IPv4 uses the first four bytes
+        uint16_t port[2];
+        uint8_t protocol;
+        uint8_t family;             // 4 or 6; 0 marks a free slot
+        uint16_t reserved;          // zero; pads the key to five words
+    };
+
+    static_assert(sizeof(Key) == 40 && offsetof(Key, port) == 32, "keys are hashed and compared as words");
+
+    struct Flow {
+        Key key;                    // endpoints in a fixed order, the same both ways
+        uint8_t initiator;          // endpoint that sent the first packet, or the SYN
+        TcpState tcp_state;
+        uint8_t tcp_flags[2];       // union of the flags each endpoint sent
+        uint64_t packets[2];        // sent by each endpoint
+        uint64_t bytes[2];
+        uint64_t first_seen_ns;
+        uint64_t last_seen_ns;
+    };
+
+    struct Config {
+        size_t capacity = 1u << 20;                     // slots; rounded down to a power of two
+        uint64_t idle_timeout_ns = 60000000000ull;
+        uint64_t closed_timeout_ns = 5000000000ull;
+        uint64_t active_timeout_ns = 1800000000000ull;
+        uint64_t tick_ns = 100000000;                   // timer resolution
+    };
+
+    struct Statistics {
+        uint64_t packets = 0;
+        uint64_t flows = 0;             // created so far
+        uint64_t active = 0;            // in the table now
+        uint64_t idle_expired = 0;
+        uint64_t closed_expired = 0;
+        uint64_t active_reports = 0;
+        uint64_t evicted = 0;
+
+        void accumulate(const Statistics& other);
+    };
+
+    // Called for every flow that leaves the table or is reported; the flow is
+    // only valid during the call.
+    using ExpiryCallback = std::function<void(const Flow&, Expiry)>;
+
+    // Bytes per slot, for sizing a table from a memory budget.
+    static constexpr size_t SLOT_SIZE = 128;
+
+    FlowTable();
+    explicit FlowTable(const Config& config);
+    ~FlowTable();
+
+    FlowTable(const FlowTable&) = delete;
+    FlowTable& operator=(const FlowTable&) = delete;
+
+    void set_expiry_callback(ExpiryCallback callback) { callback_ = std::move(callback); }
+
+    // Counts one decoded packet; packets that are not IP are ignored.
+    void update(const DecodedPacket& packet, uint64_t timestamp_ns);
+
+    // Counts a block of packets. Keys are hashed up front and slots
+    // prefetched a few packets ahead, so the cache misses of a batch overlap.
+    void update(const TupleBatch& batch);
+
+    // Runs the timers up to now_ns, e.g. while no packets arrive.
+    void advance(uint64_t now_ns);
+
+    // Either direction of the packet's flow, or null.
+    const Flow* find(const DecodedPacket& packet) const;
+
+    size_t size() const { return size_; }
+    size_t capacity() const { return mask_ + 1; }
+
+    Statistics get_statistics() const;
+
+private:
+    // Hash and key share the first cache line; the counters fill the second.
+    struct alignas(64) Slot {
+        uint32_t hash;
+        uint32_t timer_prev;
+        uint32_t timer_next;
+        uint16_t timer_bucket;
+        Flow flow;
+    };
+
+    static_assert(sizeof(Slot) == SLOT_SIZE, "flow slots should stay two cache lines");
+
+    static constexpr unsigned WHEEL_BITS = 6;
+    static constexpr unsigned WHEEL_LEVELS = 4;
+    static constexpr size_t WHEEL_BUCKETS = size_t(1) << WHEEL_BITS;
+
+    // Endpoint order and hash of a key; `from` is the sender's endpoint.
+    struct Probe {
+        Key key;
+        uint32_t hash;
+        uint8_t from;
+    };
+
+    static void make_probe(const uint8_t* source, const uint8_t* dest, uint16_t source_port, uint16_t dest_port,
+                           uint8_t protocol, uint8_t family, Probe& probe);
+    static uint32_t hash_key(const uint64_t* words);
+
+    void prefetch(uint32_t hash) const;
+    void touch(const Probe& probe, uint64_t timestamp_ns, uint32_t length, uint8_t tcp_flags);
+    size_t find_or_insert(const Probe& probe, bool& created);
+    size_t lookup(const Probe& probe) const;
+    void evict(uint32_t hash);
+    void remove(size_t index);
+    void move_slot(size_t from, size_t to);
+    void restart(Flow& flow, uint64_t timestamp_ns);
+
+    uint64_t deadline(const Flow& flow) const;
+    void schedule(size_t index);
+    void link(size_t index, size_t bucket);
+    void unlink(size_t index);
+    void run_timers(uint64_t now_ns);
+    void run_bucket(size_t bucket);
+    void publish();
+
+    Config config_;
+    Slot* slots_ = nullptr;             // mapped, so it can use huge pages
+    size_t mapped_bytes_ = 0;
+    size_t mask_ = 0;
+    size_t size_ = 0;
+    size_t max_size_ = 0;
+
+    uint32_t wheel_[WHEEL_LEVELS * WHEEL_BUCKETS];
+    uint64_t tick_ = 0;                 // the wheel has run every tick before this one
+    bool started_ = false;
+
+    ExpiryCallback callback_;
+    Statistics stats_;
+
+    std::atomic<uint64_t> packets_{0};
+    std::atomic<uint64_t> flows_{0};
+    std::atomic<uint64_t> active_{0};
+    std::atomic<uint64_t> idle_expired_{0};
+    std::atomic<uint64_t> closed_expired_{0};
+    std::atomic<uint64_t> active_reports_{0};
+    std::atomic<uint64_t> evicted_{0};
+};
+
+#endif // FLOW_TABLE_H
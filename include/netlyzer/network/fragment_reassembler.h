@@ -0,0 +1,135 @@
+#ifndef FRAGMENT_REASSEMBLER_H
+#define FRAGMENT_REASSEMBLER_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <list>
+#include <unordered_map>
+#include <vector>
+#include "netlyzer/core/packet_buffer.h"
+#include "netlyzer/network/packet_decoder.h"
+
+// Puts IPv4 and IPv6 fragments back together so that fragmented datagrams
+// (large DNS answers, NFS, video over UDP) reach the decoder with their
+// transport header. Fragments are keyed on (source, destination,
+// identification, protocol).
+//
+// Each fragment's data is copied once, straight to its final place in a
+// pooled buffer laid out as a whole frame: the link and IP headers of the
+// first fragment followed by the datagram. When the last hole closes, the IP
+// header is patched (lengths, fragment fields and checksum; the IPv6
+// fragment header is dropped) and that same buffer is returned, ready for
+// PacketDecoder::decode. For UDP the first fragment gives the datagram size,
+// so in-order fragments never move once written.
+//
+// Pending buffers are capped at max_bytes of capacity; the oldest datagrams
+// are evicted to make room. A datagram is dropped when its first fragment is
+// older than timeout_ns. Overlapping data keeps the bytes that arrived first;
+// IPv6 datagrams with overlaps are discarded (RFC 5722).
+//
+// Not thread-safe apart from get_statistics(); use one per capture thread.
+// Fragments inside GRE or VXLAN are not reassembled.
+class FragmentReassembler {
+public:
+    struct Config {
+        size_t max_bytes = 16u << 20;
+        uint64_t timeout_ns = 30000000000ull;   // Linux ipfrag_time
+        size_t max_datagrams = 4096;
+    };
+
+    struct Statistics {
+        uint64_t fragments = 0;
+        uint64_t reassembled = 0;
+        uint64_t timeouts = 0;
+        uint64_t evictions = 0;         // dropped to stay within max_bytes or max_datagrams
+        uint64_t overlaps = 0;          // fragments overlapping data already held
+        uint64_t invalid = 0;           // cut short by snaplen, oversized or inconsistent
+        uint64_t pending = 0;
+        uint64_t pending_bytes = 0;     // buffer capacity held by pending datagrams
+
+        void accumulate(const Statistics& other);
+    };
+
+    FragmentReassembler();
+    explicit FragmentReassembler(const Config& config);
+
+    // Feeds one frame that decode() flagged FRAGMENT. Returns the
+    // reassembled frame when this fragment completes its datagram and an
+    // empty handle otherwise; `data` is not retained. Also expires datagrams
+    // that timed out before timestamp_ns.
+    PacketBuffer add(const uint8_t* data, uint32_t caplen, const DecodedPacket& packet, uint64_t timestamp_ns);
+
+    // Drops datagrams whose first fragment arrived before now_ns - timeout_ns.
+    void expire(uint64_t now_ns);
+
+    Statistics get_statistics() const;
+
+private:
+    struct Key {
+        uint8_t source[16];
+        uint8_t dest[16];
+        uint32_t id;
+        uint8_t protocol;
+        uint8_t family;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    // Byte ranges of the datagram received so far, sorted and merged.
+    using Range = std::pair<uint32_t, uint32_t>;
+
+    struct Datagram {
+        PacketBuffer buffer;            // headers, then the datagram at `headroom`
+        std::vector<Range> ranges;
+        std::list<Key>::iterator arrival;
+        uint64_t first_seen_ns = 0;
+        uint32_t total = 0;             // datagram length, once the last fragment is in
+        uint16_t headroom = 0;
+        uint16_t network_offset = 0;
+        uint16_t next_header_at = 0;    // IPv6: field that names the fragment header
+        bool have_first = false;        // headers come from the offset-0 fragment
+    };
+
+    // What one frame says about its fragment.
+    struct Fragment {
+        Key key;
+        const uint8_t* payload;
+        uint32_t offset;
+        uint32_t length;
+        uint32_t size_hint;             // datagram length if the first fragment tells it
+        uint16_t headroom;              // frame bytes ahead of the fragment data
+        uint16_t network_offset;
+        uint16_t next_header_at;
+        bool more;
+    };
+
+    using Map = std::unordered_map<Key, Datagram, KeyHash>;
+
+    bool parse(const uint8_t* data, uint32_t caplen, const DecodedPacket& packet, Fragment& fragment) const;
+    bool reserve(Datagram& datagram, uint16_t headroom, uint32_t end, uint32_t hint);
+    bool make_room(size_t bytes, const Datagram* keep);
+    void drop(Map::iterator it);
+    PacketBuffer finish(Map::iterator it);
+    void publish();
+
+    Config config_;
+    Map datagrams_;
+    std::list<Key> arrival_;        // oldest first
+    size_t held_bytes_ = 0;
+
+    std::atomic<uint64_t> fragments_{0};
+    std::atomic<uint64_t> reassembled_{0};
+    std::atomic<uint64_t> timeouts_{0};
+    std::atomic<uint64_t> evictions_{0};
+    std::atomic<uint64_t> overlaps_{0};
+    std::atomic<uint64_t> invalid_{0};
+    std::atomic<uint64_t> pending_{0};
+    std::atomic<uint64_t> pending_bytes_{0};
+};
+
+#endif // FRAGMENT_REASSEMBLER_H
@@ -5,41 +5,144 @@
 #include <QThread>
 #include <QMutex>
 #include <QString>
+#include <QStringList>
+#include <QByteArray>
+#include <QVector>
+#include <QTimer>
 #include <pcap.h>
 #include <atomic>
+#include <memory>
+#include <vector>
+#include "netlyzer/core/reorder_buffer.h"
+#include "netlyzer/core/packet_buffer.h"
+#include "netlyzer/network/capture_profile.h"
+#include "netlyzer/network/capture_writer.h"
+#include "netlyzer/network/packet_decoder.h"
+#include "netlyzer/network/checksum.h"
+#include "netlyzer/network/fragment_reassembler.h"
+#include "netlyzer/network/flow_table.h"
+
+// Compact description of one captured packet, handed from the capture
+// threads to the GUI in batches. The bytes live in a pooled PacketBuffer that
+// the record shares with anything else holding the packet; use
+// PacketCapture::packetData() to read them in place. The frame is decoded
+// once on the capture thread; the list, details tree, filters and statistics
+// all work from `decoded`.
+struct PacketRecord {
+    quint64 timestampNs = 0;
+    PacketBuffer buffer;
+    quint32 number = 0;
+    quint32 length = 0;
+    quint32 capturedLength = 0;
+    quint8 interfaceId = 0;
+    DecodedPacket decoded = {};
+};
+
+Q_DECLARE_METATYPE(PacketRecord)
 
 class PacketCapture : public QObject
 {
     Q_OBJECT
 
 public:
+    // One open interface. Each source has its own pcap handle, worker thread
+    // and merge queue, so a busy interface can only drop its own packets.
+    struct CaptureSource {
+        PacketCapture *capture = nullptr;
+        int id = 0;
+        QString name;
+        pcap_t *handle = nullptr;
+        QThread *thread = nullptr;
+        bool nanosecondTimestamps = false;
+        std::unique_ptr<FragmentReassembler> reassembler;   // null unless the profile enables it
+        std::unique_ptr<FlowTable> flows;                   // likewise
+    };
+
+    struct InterfaceStatistics {
+        QString name;
+        quint64 received = 0;
+        quint64 dropped = 0;            // kernel buffer overflow
+        quint64 interfaceDropped = 0;   // dropped by the NIC or driver
+        quint64 queueDropped = 0;       // merge queue for this interface was full
+    };
+
     explicit PacketCapture(QObject *parent = nullptr);
     ~PacketCapture();
 
+    // Used by the next startCapture().
+    void setCaptureProfile(const CaptureProfile &profile) { m_profile = profile; }
+    const CaptureProfile &captureProfile() const { return m_profile; }
+
+    // Every packet of the next startCapture() is also written to this file,
+    // pcapng if it ends in .pcapng and pcap otherwise, rotated as the
+    // profile's ring_* keys say. Empty records nothing.
+    void setRecordPath(const QString &path) { m_recordPath = path; }
+    const QString &recordPath() const { return m_recordPath; }
+    bool isRecording() const { return m_recorder && m_recorder->is_open(); }
+    // Of the current recording, or the last one once stopped.
+    CaptureWriter::Statistics recordingStatistics() const;
+    // Why the last startCapture() could not record, if it could not.
+    const QString &recordingError() const { return m_recordingError; }
+
     bool startCapture(const QString &interface);
+    bool startCapture(const QStringList &interfaces);
     void stopCapture();
     bool isCapturing() const { return m_isCapturing; }
     int getPacketCount() const { return m_packetCount; }
 
+    int interfaceCount() const { return static_cast<int>(m_sources.size()); }
+    QString interfaceName(int interfaceId) const;
+    // Name and link type of each interface by id, for writing the packets
+    // out; of the current capture, or the last one once stopped.
+    const std::vector<CaptureWriter::Interface> &capturedInterfaces() const { return m_interfaces; }
+    QVector<InterfaceStatistics> interfaceStatistics() const;
+    // All zero unless the profile has verify_checksums set.
+    const ChecksumCounters &checksumCounters() const { return m_checksumCounters; }
+    // Summed over the open interfaces.
+    FragmentReassembler::Statistics reassemblyStatistics() const;
+    // Summed over the open interfaces; all zero unless the profile sets
+    // flow_table_mb. A flow seen on two interfaces is counted on each.
+    FlowTable::Statistics flowStatistics() const;
+
+    // Packet bytes for a delivered record, without copying. Valid while the
+    // record (or another copy of its buffer handle) is alive.
+    static QByteArray packetData(const PacketRecord &record);
+
+    static QString formatSource(const PacketRecord &record);
+    static QString formatDestination(const PacketRecord &record);
+    static QString protocolName(const PacketRecord &record);
+    static QString packetInfo(const PacketRecord &record, const QByteArray &data);
+
 signals:
-    void packetCaptured(int number, const QString &time, const QString &source,
-                       const QString &destination, const QString &protocol,
-                       int length, const QString &info, const QByteArray &data);
+    // Emitted on the GUI thread at most once per frame with every record
+    // merged since the last one.
+    void packetsCaptured(const QVector<PacketRecord> &records);
 
 public:
     static void packetHandler(u_char *userData, const struct pcap_pkthdr *pkthdr, const u_char *packet);
 
+private slots:
+    void drainMergedPackets();
+
 private:
-    void processPacket(const struct pcap_pkthdr *pkthdr, const u_char *packet);
-    QString formatTimestamp(const struct timeval &tv);
-    QString parsePacketInfo(const u_char *packet, int length);
+    void processPacket(CaptureSource *source, const struct pcap_pkthdr *pkthdr, const u_char *packet);
+    void closeSources();
 
-    pcap_t *m_handle;
-    QThread *m_captureThread;
+    std::vector<std::unique_ptr<CaptureSource>> m_sources;
+    std::vector<CaptureWriter::Interface> m_interfaces;
+    std::unique_ptr<ReorderBuffer<PacketRecord>> m_mergeBuffer;
+    QVector<PacketRecord> m_batch;
+    QTimer *m_mergeTimer;
+    CaptureProfile m_profile;
+    QString m_recordPath;
+    QString m_recordingError;
+    // Written to from every capture thread; kept after stopCapture() for its
+    // statistics.
+    std::unique_ptr<CaptureWriter> m_recorder;
+    ChecksumCounters m_checksumCounters;
     std::atomic<bool> m_isCapturing;
     std::atomic<int> m_packetCount;
     QMutex m_mutex;
-    QString m_interface;
 };
 
 class CaptureWorker : public QObject
@@ -47,14 +150,13 @@ class CaptureWorker : public QObject
     Q_OBJECT
 
 public:
-    CaptureWorker(pcap_t *handle, PacketCapture *capture);
+    explicit CaptureWorker(PacketCapture::CaptureSource *source);
 
 public slots:
     void startLoop();
 
 private:
-    pcap_t *m_handle;
-    PacketCapture *m_capture;
+    PacketCapture::CaptureSource *m_source;
 };
 
 #endif // PACKET_CAPTURE_H
@@ -0,0 +1,114 @@
+#ifndef PACKET_DECODER_H
+#define PACKET_DECODER_H
+
+#include <cstdint>
+#include <cstddef>
+
+// Everything the application needs to know about a frame, found by walking
+// its headers once. The record is fixed-size and trivially copyable; the list
+// view, details tree, filters and statistics all read it instead of parsing
+// the bytes again. Offsets index into the captured frame and are 0 when the
+// layer is absent (the link layer always starts at 0).
+//
+// Tunnels are decapsulated: for GRE and VXLAN traffic the addresses, ports
+// and offsets describe the innermost packet, so flows are counted by what is
+// inside the tunnel. outer_network_offset points back at the outer IP header.
+struct DecodedPacket {
+    enum Flag : uint32_t {
+        VLAN        = 1u << 0,
+        ARP         = 1u << 1,
+        IPV4        = 1u << 2,
+        IPV6        = 1u << 3,
+        TCP         = 1u << 4,
+        UDP         = 1u << 5,
+        ICMP        = 1u << 6,
+        ICMPV6      = 1u << 7,
+        FRAGMENT    = 1u << 8,      // IP fragment (more-fragments or non-zero offset)
+        TRUNCATED   = 1u << 9,      // a header ran past the captured length
+        MALFORMED   = 1u << 10,     // a header had an impossible length field
+        GRE         = 1u << 11,     // decapsulated from GRE
+        VXLAN       = 1u << 12,     // decapsulated from VXLAN
+
+        // Set by ChecksumVerifier, never by decode().
+        CHECKSUM_VERIFIED   = 1u << 13, // every checksum the packet carries was checked
+        BAD_IP_CHECKSUM     = 1u << 14,
+        BAD_L4_CHECKSUM     = 1u << 15,
+        CHECKSUM_OFFLOAD    = 1u << 16, // L4 checksum still holds only the pseudo-header sum
+
+        // Set by callers that decode a FragmentReassembler frame.
+        REASSEMBLED         = 1u << 17
+    };
+
+    // Network byte order. IPv4 uses the first four bytes; for ARP these are
+    // the sender and target protocol addresses.
+    uint8_t source_address[16];
+    uint8_t dest_address[16];
+
+    uint32_t flags;
+    uint32_t wire_length;
+    uint32_t captured_length;
+    uint32_t tcp_sequence;
+    uint32_t tcp_acknowledgment;
+    uint32_t tunnel_id;             // VXLAN network identifier or GRE key
+
+    uint16_t network_offset;
+    uint16_t transport_offset;
+    uint16_t payload_offset;
+    uint16_t payload_length;        // as declared by the headers, not clipped to the capture
+    uint16_t ethertype;             // innermost, after any VLAN tags
+    uint16_t vlan_id;               // outermost tag
+    uint16_t source_port;
+    uint16_t dest_port;
+    uint16_t tcp_window;
+    uint16_t arp_operation;
+    uint16_t outer_network_offset;  // 0 unless decapsulated
+
+    uint8_t ip_protocol;
+    uint8_t ttl;                    // hop limit for IPv6
+    uint8_t tcp_flags;
+    uint8_t icmp_type;
+    uint8_t icmp_code;
+    uint8_t vlan_count;             // 802.1Q/802.1ad tags seen, outer and inner frames
+    uint8_t tunnel_depth;
+    uint8_t reserved;
+
+    bool has(Flag flag) const { return (flags & flag) != 0; }
+    bool is_ip() const { return (flags & (IPV4 | IPV6)) != 0; }
+
+    // Host byte order; only meaningful with IPV4 or ARP set.
+    uint32_t ipv4_source() const { return load_ipv4(source_address); }
+    uint32_t ipv4_dest() const { return load_ipv4(dest_address); }
+
+private:
+    static uint32_t load_ipv4(const uint8_t* address)
+    {
+        return (static_cast<uint32_t>(address[0]) << 24) | (static_cast<uint32_t>(address[1]) << 16)
+             | (static_cast<uint32_t>(address[2]) << 8) | address[3];
+    }
+};
+
+class PacketDecoder {
+public:
+    // Walks the frame once, front to back, through a chain of dissectors
+    // picked from compile-time dispatch tables: ethertype (802.1Q, 802.1ad,
+    // IPv4, IPv6, ARP), IP protocol (IPv6 extension headers, TCP, UDP, ICMP,
+    // GRE) and UDP port (VXLAN). Always fills `packet`; problems show up as
+    // TRUNCATED or MALFORMED with the layers decoded so far.
+    static void decode(const uint8_t* data, uint32_t captured_length, uint32_t wire_length,
+                       DecodedPacket& packet);
+
+    // True for UDP destination ports that decode() decapsulates (VXLAN).
+    static bool is_tunnel_port(uint16_t port);
+
+    // Short name of the innermost recognised protocol, e.g. "TCP", "ARP",
+    // "IPv6" or "Ethernet".
+    static const char* protocol_name(const DecodedPacket& packet);
+
+    // Source and destination for display: IP or ARP protocol addresses.
+    // Returns 0 when there is none.
+    static size_t format_source(const DecodedPacket& packet, char* out);
+    static size_t format_dest(const DecodedPacket& packet, char* out);
+    static constexpr size_t ADDRESS_STRING_MAX = 45;
+};
+
+#endif // PACKET_DECODER_H
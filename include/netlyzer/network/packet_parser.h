@@ -3,16 +3,92 @@
 
 #include <string>
 #include <cstdint>
+#include <cstddef>
 #include <netinet/ip.h>
 #include <netinet/tcp.h>
 #include <netinet/udp.h>
 #include <netinet/if_ether.h>
 #include <arpa/inet.h>
-#include <sstream>
-#include <iomanip>
 
 class PacketParser {
 public:
+    // View API. Each view_* call checks the header against the captured
+    // length and fills a trivially copyable view with numeric fields in host
+    // byte order and offsets into the original buffer; nothing is allocated.
+    // Turning a view into text is a separate step (format_* below), so
+    // callers only pay for it on the fields they actually show.
+
+    struct MacAddress {
+        uint8_t bytes[6];
+    };
+
+    struct EthernetView {
+        MacAddress dest;
+        MacAddress source;
+        uint16_t ethertype;
+        uint16_t payload_offset;    // first byte after the header
+    };
+
+    struct IPv4View {
+        uint32_t source;            // host byte order
+        uint32_t dest;
+        uint16_t offset;            // of the header in the buffer
+        uint16_t payload_offset;
+        uint16_t total_length;
+        uint16_t identification;
+        uint16_t fragment_offset;   // in bytes
+        uint16_t checksum;
+        uint8_t version;
+        uint8_t header_length;      // in bytes
+        uint8_t type_of_service;
+        uint8_t flags;              // top three bits of the fragment field
+        uint8_t ttl;
+        uint8_t protocol;
+    };
+
+    struct TCPView {
+        uint32_t sequence_number;
+        uint32_t acknowledgment_number;
+        uint16_t offset;
+        uint16_t payload_offset;
+        uint16_t source_port;
+        uint16_t dest_port;
+        uint16_t window_size;
+        uint16_t checksum;
+        uint16_t urgent_pointer;
+        uint8_t header_length;      // in bytes
+        uint8_t flags;
+    };
+
+    struct UDPView {
+        uint16_t offset;
+        uint16_t payload_offset;
+        uint16_t source_port;
+        uint16_t dest_port;
+        uint16_t length;
+        uint16_t checksum;
+    };
+
+    // Return false, leaving `view` unspecified, when the header does not fit
+    // in `caplen` bytes starting at `offset` or is malformed.
+    static bool view_ethernet(const uint8_t* data, size_t caplen, EthernetView& view);
+    static bool view_ipv4(const uint8_t* data, size_t caplen, size_t offset, IPv4View& view);
+    static bool view_tcp(const uint8_t* data, size_t caplen, size_t offset, TCPView& view);
+    static bool view_udp(const uint8_t* data, size_t caplen, size_t offset, UDPView& view);
+
+    // Write into caller buffers, without a terminator, and return the length.
+    // See netlyzer/utils/format.h for the other renderers.
+    static constexpr size_t MAC_STRING_LENGTH = 17;     // "aa:bb:cc:dd:ee:ff"
+    static constexpr size_t IPV4_STRING_MAX = 15;       // "255.255.255.255"
+    static size_t format_mac(const MacAddress& mac, char* out);
+    static size_t format_ipv4(uint32_t address, char* out);
+
+    static std::string mac_to_string(const MacAddress& mac);
+    static std::string ipv4_to_string(uint32_t address);
+
+    // Original API, kept for existing callers. These trust the caller to
+    // have checked the length and render every address as a string; new
+    // code should use the views.
     struct EthernetHeader {
         std::string source_mac;
         std::string dest_mac;
@@ -31,6 +107,7 @@ public:
         uint16_t checksum;
         std::string source_ip;
         std::string dest_ip;
+        bool malformed;             // IHL below 5; the fields are as read
     };
 
     struct TCPHeader {
@@ -43,6 +120,7 @@ public:
         uint16_t window_size;
         uint16_t checksum;
         uint16_t urgent_pointer;
+        bool malformed;             // data offset below 5; the fields are as read
     };
 
     struct UDPHeader {
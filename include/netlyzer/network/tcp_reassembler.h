@@ -0,0 +1,213 @@
+#ifndef TCP_REASSEMBLER_H
+#define TCP_REASSEMBLER_H
+
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <list>
+#include <map>
+#include <unordered_map>
+#include <vector>
+#include "netlyzer/core/packet_buffer.h"
+#include "netlyzer/network/packet_decoder.h"
+
+// Turns TCP segments into ordered byte streams, one per direction of each
+// connection, and hands contiguous ranges to a callback as soon as they are
+// in order.
+//
+// Bytes are numbered from 0 in each direction, starting after the SYN when
+// the handshake was captured and at the first segment seen otherwise.
+// Retransmitted bytes and overlaps with data already delivered are trimmed
+// off; among segments waiting out of order, the one that arrived first wins.
+//
+// Waiting segments are not copied: each keeps a handle to the pooled buffer
+// of its frame, and that buffer's capacity is what the memory budgets count.
+// Frames passed as plain bytes, e.g. read from a PacketStore, are copied
+// into a pooled buffer only if their segment has to wait.
+// When a direction would hold more than max_flow_bytes, or all streams more
+// than max_bytes, the policy decides what happens to the held data:
+//   Spill  delivers it in order, flagging gaps where data is missing;
+//   Drop   discards it.
+// Either way the direction moves on past the hole instead of waiting for
+// data the capture may never have seen. Idle streams are spilled and
+// forgotten after idle_timeout_ns; a SYN on a closed stream starts a new one.
+//
+// Not thread-safe; feed it from one thread.
+class TcpReassembler {
+public:
+    enum class Policy {
+        Spill,
+        Drop
+    };
+
+    struct Config {
+        size_t max_bytes = 64u << 20;
+        size_t max_flow_bytes = 4u << 20;       // per direction
+        size_t max_streams = 65536;
+        uint64_t idle_timeout_ns = 120000000000ull;
+        Policy policy = Policy::Spill;
+    };
+
+    // A contiguous range of one direction's bytes. `data` points into
+    // `frame`; copy the handle to keep the bytes without copying them. For a
+    // frame passed as plain bytes and delivered straight away, `frame` is
+    // null and `data` is only valid during the callback.
+    struct Chunk {
+        uint64_t stream;                // numbered in order of appearance
+        uint8_t direction;              // 0 from the side that opened the connection
+        bool gap;                       // bytes just before `offset` are missing
+        uint64_t offset;                // within this direction's bytes
+        const uint8_t* data;
+        uint32_t length;
+        const PacketBuffer* frame;
+        uint32_t data_offset;           // of `data` within the frame
+        uint64_t packet_id;             // as passed to add()
+    };
+
+    struct Statistics {
+        uint64_t segments = 0;
+        uint64_t delivered_bytes = 0;
+        uint64_t retransmitted_bytes = 0;   // trimmed as already delivered
+        uint64_t out_of_order = 0;          // segments that had to wait
+        uint64_t gaps = 0;                  // holes skipped by a spill or drop
+        uint64_t dropped_bytes = 0;         // discarded by the Drop policy
+        uint64_t streams = 0;               // opened so far
+        uint64_t active_streams = 0;
+        uint64_t held_bytes = 0;
+
+        void accumulate(const Statistics& other);
+    };
+
+    using ChunkCallback = std::function<void(const Chunk&)>;
+
+    explicit TcpReassembler(ChunkCallback callback);
+    TcpReassembler(const Config& config, ChunkCallback callback);
+
+    // Feeds one packet that decode() flagged TCP; `frame` holds the bytes
+    // `packet` was decoded from and is retained only if the segment has to
+    // wait. Returns the stream the segment belongs to.
+    uint64_t add(const PacketBuffer& frame, const DecodedPacket& packet, uint64_t packet_id,
+                 uint64_t timestamp_ns);
+    // The same for `size` bytes the caller keeps; they are only read during
+    // the call.
+    uint64_t add(const uint8_t* data, uint32_t size, const DecodedPacket& packet, uint64_t packet_id,
+                 uint64_t timestamp_ns);
+
+    // Spills and forgets streams idle since before now_ns - idle_timeout_ns.
+    void expire(uint64_t now_ns);
+
+    // Spills and forgets every stream, e.g. at the end of a file.
+    void flush();
+
+    Statistics get_statistics() const;
+
+private:
+    struct Endpoint {
+        uint8_t address[16];
+        uint16_t port;
+    };
+
+    // Endpoints in a fixed order, so both directions find the same stream.
+    struct Key {
+        Endpoint low;
+        Endpoint high;
+        uint8_t family;
+
+        bool operator==(const Key& other) const;
+    };
+
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+
+    struct Segment {
+        PacketBuffer frame;             // null until a plain-bytes segment waits
+        const uint8_t* bytes;           // of the frame
+        uint64_t packet_id;
+        uint32_t data_offset;
+        uint32_t length;
+    };
+
+    struct Half {
+        std::map<uint64_t, Segment> waiting;    // by offset
+        uint64_t next = 0;                      // offset of the next byte to deliver
+        uint32_t base = 0;                      // sequence number of offset 0
+        size_t held = 0;
+        bool started = false;
+        bool gap = false;                       // next delivery follows missing data
+        bool closed = false;                    // FIN or RST seen
+    };
+
+    struct Stream {
+        uint64_t id = 0;
+        uint8_t initiator = 0;                  // 0 if Key::low opened the connection
+        Half half[2];
+        uint64_t last_seen_ns = 0;
+        std::list<Key>::iterator lru;
+    };
+
+    using Map = std::unordered_map<Key, Stream, KeyHash>;
+
+    uint64_t add_frame(const PacketBuffer* frame, const uint8_t* data, uint32_t size, const DecodedPacket& packet,
+                       uint64_t packet_id, uint64_t timestamp_ns);
+    void insert(Stream& stream, uint8_t direction, Segment&& segment, uint64_t offset);
+    void deliver(Stream& stream, uint8_t direction, const Segment& segment, uint64_t offset);
+    void drain(Stream& stream, uint8_t direction);
+    void relieve(Stream& stream, uint8_t direction, Policy policy);
+    void spill(Stream& stream);
+    void release(Half& half, const Segment& segment);
+    void make_room();
+    void erase(Map::iterator it);
+
+    Config config_;
+    ChunkCallback callback_;
+    Map streams_;
+    std::list<Key> lru_;                        // least recently active first
+    size_t held_bytes_ = 0;
+    Statistics stats_;
+};
+
+// Where every delivered byte of one stream lives, for viewers that page
+// through a conversation without materializing it. Both directions are laid
+// end to end in delivery order; each entry names the packet its bytes are in
+// and where in that frame, but holds none of them, so a multi-gigabyte
+// transfer costs 32 bytes per segment and its frames stay wherever the
+// caller stores them. read() fetches them through a FrameSource.
+class TcpStreamIndex {
+public:
+    // The captured bytes of the packet passed to TcpReassembler::add() as
+    // `packet_id`, valid until the next call; null if they are gone.
+    using FrameSource = std::function<const uint8_t*(uint64_t packet_id)>;
+
+    struct Entry {
+        uint64_t position;              // in the conversation
+        uint64_t packet_id;
+        uint32_t data_offset;
+        uint32_t length;
+        uint8_t direction;
+        bool gap;
+    };
+
+    void append(const TcpReassembler::Chunk& chunk);
+    void clear();
+
+    uint64_t size() const { return size_; }
+    uint64_t bytes(uint8_t direction) const { return bytes_[direction & 1]; }
+    size_t gaps() const { return gaps_; }
+    const std::vector<Entry>& entries() const { return entries_; }
+
+    // Index of the entry holding `position`; entries().size() past the end.
+    size_t find(uint64_t position) const;
+
+    // Copies up to `length` bytes starting at `position`; returns how many,
+    // stopping short at a frame `frames` cannot return.
+    size_t read(uint64_t position, uint8_t* out, size_t length, const FrameSource& frames) const;
+
+private:
+    std::vector<Entry> entries_;
+    uint64_t size_ = 0;
+    uint64_t bytes_[2] = {0, 0};
+    size_t gaps_ = 0;
+};
+
+#endif // TCP_REASSEMBLER_H
@@ -0,0 +1,105 @@
+#ifndef TPACKET_RING_H
+#define TPACKET_RING_H
+
+#include <string>
+#include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <functional>
+#include <vector>
+
+// AF_PACKET TPACKET_V3 receive ring.
+//
+// The kernel fills fixed-size blocks with frames and hands a block over once it
+// is full or its retire timeout expires. The reader walks every frame of a
+// retired block in place and then returns the whole block, so there is no
+// syscall and no copy per packet.
+class TPacketRing {
+public:
+    // How the kernel spreads packets across the sockets of a fanout group.
+    // Values match PACKET_FANOUT_*.
+    enum class FanoutMode : uint16_t {
+        Hash = 0,           // by flow hash; both directions of a flow land together
+        LoadBalance = 1,    // round robin
+        Cpu = 2             // by receiving CPU
+    };
+
+    struct Config {
+        uint32_t block_size = 1u << 22;     // bytes, multiple of the page size
+        uint32_t block_count = 64;
+        uint32_t frame_size = 1u << 11;     // frame slot hint, must divide block_size
+        uint32_t block_timeout_ms = 10;     // retire partially filled blocks after this
+        bool promiscuous = true;
+        uint16_t fanout_group = 0;          // 0 = not part of a fanout group
+        FanoutMode fanout_mode = FanoutMode::Hash;
+    };
+
+    // A frame borrowed straight out of the ring. The pointer is only valid
+    // until the callback that received it returns.
+    struct Frame {
+        const uint8_t* data = nullptr;
+        uint32_t caplen = 0;
+        uint32_t len = 0;
+        uint32_t ts_sec = 0;
+        uint32_t ts_nsec = 0;
+        uint32_t rxhash = 0;
+    };
+
+    struct Statistics {
+        uint64_t packets = 0;
+        uint64_t drops = 0;
+        uint64_t queue_freezes = 0;
+        uint64_t blocks = 0;
+    };
+
+    using FrameCallback = std::function<void(const Frame&)>;
+    // Receives every frame of one block at once; the frames stay valid
+    // until the callback returns.
+    using BlockCallback = std::function<void(const Frame* frames, size_t count)>;
+
+    TPacketRing();
+    ~TPacketRing();
+
+    TPacketRing(const TPacketRing&) = delete;
+    TPacketRing& operator=(const TPacketRing&) = delete;
+
+    bool open(const std::string& interface_name, const Config& config);
+    void close();
+    bool is_open() const { return fd_ >= 0; }
+    int fd() const { return fd_; }
+    // As opened, after any adjustment by the caller's profile.
+    const Config& config() const { return config_; }
+
+    // Compiles a pcap filter expression and attaches it to the socket.
+    bool set_filter(const std::string& expression);
+
+    // Walks the blocks the kernel has retired, stopping after the block that
+    // takes the count past max_frames, and returns the number of frames
+    // passed to the callback. Never blocks.
+    size_t read_blocks(const FrameCallback& callback, size_t max_frames = SIZE_MAX);
+    size_t read_block_batches(const BlockCallback& callback, size_t max_frames = SIZE_MAX);
+
+    // Blocks until a block is ready or the timeout expires.
+    bool wait(int timeout_ms);
+
+    Statistics get_statistics();
+    const std::string& last_error() const { return error_; }
+    // errno of the call behind last_error(), or 0 if it was not a system call.
+    int last_error_number() const { return error_number_; }
+
+private:
+    bool fail(const std::string& what);
+
+    int fd_;
+    uint8_t* map_;
+    size_t map_size_;
+    Config config_;
+    uint32_t current_block_;
+    std::vector<Frame> block_frames_;
+    std::string error_;
+    int error_number_;
+    Statistics statistics_;             // kernel counters, accumulated by get_statistics()
+    std::atomic<uint64_t> blocks_;      // counted on the capture thread
+};
+
+#endif // TPACKET_RING_H
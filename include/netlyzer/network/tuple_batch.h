@@ -0,0 +1,59 @@
+#ifndef TUPLE_BATCH_H
+#define TUPLE_BATCH_H
+
+#include <cstdint>
+#include <cstddef>
+#include "netlyzer/network/tpacket_ring.h"
+
+// The fields flow tracking and statistics need, for a block of frames, one
+// column per field so aggregators can run over whole arrays. Tunnelled
+// frames describe the inner packet, as DecodedPacket does.
+struct TupleBatch {
+    static constexpr size_t CAPACITY = 256;
+
+    enum Family : uint8_t {
+        OTHER = 0,
+        IPV4 = 4,
+        IPV6 = 6
+    };
+
+    size_t count = 0;
+
+    alignas(64) uint64_t timestamp_ns[CAPACITY];
+    alignas(64) uint32_t wire_length[CAPACITY];
+    alignas(64) uint32_t source_ipv4[CAPACITY];         // host byte order; family IPV4 only
+    alignas(64) uint32_t dest_ipv4[CAPACITY];
+    alignas(64) uint16_t source_port[CAPACITY];         // 0 unless TCP or UDP
+    alignas(64) uint16_t dest_port[CAPACITY];
+    alignas(64) uint16_t ip_length[CAPACITY];           // IPv4 total length, IPv6 payload + 40
+    alignas(64) uint8_t family[CAPACITY];
+    alignas(64) uint8_t protocol[CAPACITY];
+    alignas(64) uint8_t tcp_flags[CAPACITY];
+    alignas(64) uint8_t source_ipv6[CAPACITY][16];      // network byte order; family IPV6 only
+    alignas(64) uint8_t dest_ipv6[CAPACITY][16];
+
+    bool full() const { return count == CAPACITY; }
+    void clear() { count = 0; }
+};
+
+// Fills TupleBatch columns from a block of frames. On x86-64 CPUs with AVX2
+// untagged and single-tagged IPv4 TCP/UDP/ICMP frames are handled four at a
+// time with masked gathers; everything else (IPv6, QinQ, tunnels, fragments,
+// short captures) goes through PacketDecoder one frame at a time, so both
+// paths give identical results.
+class TupleExtractor {
+public:
+    using Frame = TPacketRing::Frame;
+
+    enum class Path {
+        Best,       // vector path when the CPU has it
+        Scalar
+    };
+
+    // Appends frames until the batch is full and returns how many were taken.
+    static size_t extract(const Frame* frames, size_t count, TupleBatch& batch, Path path = Path::Best);
+
+    static bool has_vector_path();
+};
+
+#endif // TUPLE_BATCH_H
@@ -0,0 +1,65 @@
+#ifndef NETLYZER_FORMAT_H
+#define NETLYZER_FORMAT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+
+namespace netlyzer {
+
+// Allocation-free renderers for the text every view shows: addresses and
+// hex. Each writes into a caller buffer of at least the stated size, without
+// a terminator, and returns the number of characters written. Byte-to-text
+// conversion goes through lookup tables, and long hex runs use SSE2 where the
+// target has it.
+
+constexpr size_t MAC_STRING_LENGTH = 17;        // "aa:bb:cc:dd:ee:ff"
+constexpr size_t IPV4_STRING_MAX = 15;          // "255.255.255.255"
+constexpr size_t IPV6_STRING_MAX = 45;          // "ffff:...:ffff:255.255.255.255"
+constexpr size_t HEX_DUMP_BYTES_PER_LINE = 16;
+constexpr size_t HEX_DUMP_LINE_MAX = 80;
+
+// 2 * length characters.
+size_t format_hex(const uint8_t* data, size_t length, char* out, bool uppercase = false);
+
+// 3 * length - 1 characters, e.g. "de:ad:be:ef".
+size_t format_hex_separated(const uint8_t* data, size_t length, char separator, char* out,
+                            bool uppercase = false);
+
+size_t format_mac(const uint8_t* mac, char* out);
+
+// `address` in host byte order.
+size_t format_ipv4(uint32_t address, char* out);
+
+// RFC 5952 canonical text: lowercase, no leading zeros, the longest run of
+// two or more zero groups (the first on a tie) replaced by "::", and
+// IPv4-mapped addresses in mixed notation. `address` is in network order.
+size_t format_ipv6(const uint8_t* address, char* out);
+
+// One hex dump line for up to 16 bytes starting at `offset`:
+//   "0010  45 00 00 3c 1c 46 40 00  40 06 b1 e6 ac 10 0a 63  |E..<.F@.@......c|\n"
+// Short lines are padded so the ASCII column lines up.
+size_t format_hex_dump_line(const uint8_t* data, size_t length, size_t offset, char* out,
+                            bool uppercase = true);
+
+inline std::string mac_to_string(const uint8_t* mac)
+{
+    char text[MAC_STRING_LENGTH];
+    return std::string(text, format_mac(mac, text));
+}
+
+inline std::string ipv4_to_string(uint32_t address)
+{
+    char text[IPV4_STRING_MAX];
+    return std::string(text, format_ipv4(address, text));
+}
+
+inline std::string ipv6_to_string(const uint8_t* address)
+{
+    char text[IPV6_STRING_MAX];
+    return std::string(text, format_ipv6(address, text));
+}
+
+} // namespace netlyzer
+
+#endif // NETLYZER_FORMAT_H
@@ -0,0 +1,509 @@
+#include "netlyzer/core/display_filter.h"
+#include <arpa/inet.h>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+
+namespace {
+
+struct LayerName {
+    const char* name;
+    DecodedPacket::Flag flag;
+};
+
+const LayerName LAYERS[] = {
+    {"tcp", DecodedPacket::TCP},   {"udp", DecodedPacket::UDP},       {"icmp", DecodedPacket::ICMP},
+    {"icmpv6", DecodedPacket::ICMPV6}, {"arp", DecodedPacket::ARP},   {"ip", DecodedPacket::IPV4},
+    {"ipv6", DecodedPacket::IPV6}, {"vlan", DecodedPacket::VLAN},     {"gre", DecodedPacket::GRE},
+    {"vxlan", DecodedPacket::VXLAN},
+};
+
+bool same_text(const std::string& a, const char* b)
+{
+    const size_t length = std::strlen(b);
+    if (a.size() != length)
+        return false;
+    for (size_t i = 0; i < length; ++i) {
+        if (std::tolower(static_cast<unsigned char>(a[i])) != std::tolower(static_cast<unsigned char>(b[i])))
+            return false;
+    }
+    return true;
+}
+
+bool is_word_char(char c)
+{
+    return std::isalnum(static_cast<unsigned char>(c)) || c == '.' || c == '_' || c == ':' || c == '-';
+}
+
+} // namespace
+
+class DisplayFilter::Parser {
+public:
+    Parser(const std::string& text, std::vector<Node>& nodes) : text_(text), nodes_(nodes) {}
+
+    // The root node, or -1 with `error` set.
+    int parse(std::string& error)
+    {
+        next();
+        int root = parse_or();
+        if (root >= 0 && !token_.empty())
+            fail("unexpected '" + token_ + "'");
+        if (!error_.empty()) {
+            error = error_;
+            return -1;
+        }
+        return root;
+    }
+
+private:
+    // Tokens: words, quoted strings, operators and parentheses. An empty
+    // token is the end of the text.
+    void next()
+    {
+        while (pos_ < text_.size() && std::isspace(static_cast<unsigned char>(text_[pos_])))
+            ++pos_;
+        quoted_ = false;
+        if (pos_ == text_.size()) {
+            token_.clear();
+            return;
+        }
+        const char c = text_[pos_];
+        if (c == '"') {
+            const size_t end = text_.find('"', pos_ + 1);
+            if (end == std::string::npos) {
+                fail("unterminated string");
+                token_.clear();
+                pos_ = text_.size();
+                return;
+            }
+            token_ = text_.substr(pos_ + 1, end - pos_ - 1);
+            quoted_ = true;
+            pos_ = end + 1;
+            return;
+        }
+        if (is_word_char(c)) {
+            const size_t start = pos_;
+            while (pos_ < text_.size() && is_word_char(text_[pos_]))
+                ++pos_;
+            token_ = text_.substr(start, pos_ - start);
+            return;
+        }
+        static const char* const OPERATORS[] = {"==", "!=", "<=", ">=", "&&", "||", "<", ">", "!", "(", ")"};
+        for (const char* op : OPERATORS) {
+            if (text_.compare(pos_, std::strlen(op), op) == 0) {
+                token_ = op;
+                pos_ += token_.size();
+                return;
+            }
+        }
+        token_ = std::string(1, c);
+        ++pos_;
+    }
+
+    bool is(const char* word) const { return !quoted_ && same_text(token_, word); }
+
+    void fail(const std::string& message)
+    {
+        if (error_.empty())
+            error_ = message;
+    }
+
+    int add(Node node)
+    {
+        nodes_.push_back(std::move(node));
+        return static_cast<int>(nodes_.size() - 1);
+    }
+
+    int join(Kind kind, int left, int right)
+    {
+        Node node;
+        node.kind = kind;
+        node.left = left;
+        node.right = right;
+        return add(node);
+    }
+
+    int parse_or()
+    {
+        int left = parse_and();
+        while (left >= 0 && (is("or") || is("||"))) {
+            next();
+            const int right = parse_and();
+            left = right < 0 ? -1 : join(Kind::Or, left, right);
+        }
+        return left;
+    }
+
+    int parse_and()
+    {
+        int left = parse_unary();
+        while (left >= 0 && (is("and") || is("&&"))) {
+            next();
+            const int right = parse_unary();
+            left = right < 0 ? -1 : join(Kind::And, left, right);
+        }
+        return left;
+    }
+
+    int parse_unary()
+    {
+        if (is("not") || is("!")) {
+            next();
+            const int operand = parse_unary();
+            return operand < 0 ? -1 : join(Kind::Not, operand, -1);
+        }
+        if (is("(")) {
+            next();
+            const int inner = parse_or();
+            if (inner < 0)
+                return -1;
+            if (!is(")")) {
+                fail("missing ')'");
+                return -1;
+            }
+            next();
+            return inner;
+        }
+        return parse_term();
+    }
+
+    int parse_term()
+    {
+        if (token_.empty() || quoted_ || !is_word_char(token_[0])) {
+            fail(token_.empty() ? "expected a field" : "unexpected '" + token_ + "'");
+            return -1;
+        }
+        const std::string field = token_;
+        next();
+
+        for (const LayerName& layer : LAYERS) {
+            if (same_text(field, layer.name)) {
+                Node node;
+                node.kind = Kind::Flags;
+                node.flags = layer.flag;
+                return add(node);
+            }
+        }
+
+        Node node;
+        if (!parse_field(field, node)) {
+            fail("unknown field '" + field + "'");
+            return -1;
+        }
+
+        bool negate = false;
+        if (is("==") || is("eq")) {
+            node.compare = Compare::Equal;
+        } else if (is("!=") || is("ne")) {
+            negate = true;
+        } else if (is("<") || is("lt")) {
+            node.compare = Compare::Less;
+        } else if (is("<=") || is("le")) {
+            node.compare = Compare::LessEqual;
+        } else if (is(">") || is("gt")) {
+            node.compare = Compare::Greater;
+        } else if (is(">=") || is("ge")) {
+            node.compare = Compare::GreaterEqual;
+        } else {
+            fail("expected a comparison after '" + field + "'");
+            return -1;
+        }
+        const bool ordered = node.compare != Compare::Equal;
+        next();
+        if (token_.empty()) {
+            fail("expected a value after '" + field + "'");
+            return -1;
+        }
+        const std::string value = token_;
+        next();
+
+        if (ordered && (node.kind == Kind::Address || node.kind == Kind::Protocol)) {
+            fail("'" + field + "' only compares with == and !=");
+            return -1;
+        }
+        if (!parse_value(value, node)) {
+            fail("bad value '" + value + "' for '" + field + "'");
+            return -1;
+        }
+        const int term = add(node);
+        return negate ? join(Kind::Not, term, -1) : term;
+    }
+
+    static bool parse_field(const std::string& field, Node& node)
+    {
+        const size_t dot = field.find('.');
+        const std::string layer = field.substr(0, dot);
+        const std::string name = dot == std::string::npos ? std::string() : field.substr(dot + 1);
+
+        if (same_text(field, "protocol")) {
+            node.kind = Kind::Protocol;
+            return true;
+        }
+        if (same_text(layer, "ip") || same_text(layer, "ipv6")) {
+            node.kind = Kind::Address;
+            node.flags = same_text(layer, "ip") ? DecodedPacket::IPV4 : DecodedPacket::IPV6;
+        } else if (same_text(layer, "tcp") || same_text(layer, "udp")) {
+            node.kind = Kind::Port;
+            node.flags = same_text(layer, "tcp") ? DecodedPacket::TCP : DecodedPacket::UDP;
+        } else if (same_text(layer, "frame")) {
+            if (same_text(name, "number")) {
+                node.kind = Kind::Number;
+                return true;
+            }
+            node.kind = Kind::Time;
+            node.relative = same_text(name, "time_relative");
+            return node.relative || same_text(name, "time_epoch");
+        } else {
+            return false;
+        }
+
+        const char* both = node.kind == Kind::Address ? "addr" : "port";
+        const char* source = node.kind == Kind::Address ? "src" : "srcport";
+        const char* dest = node.kind == Kind::Address ? "dst" : "dstport";
+        if (same_text(name, both))
+            return true;
+        node.dest = same_text(name, source) ? false : node.dest;
+        node.source = same_text(name, dest) ? false : node.source;
+        return node.source != node.dest;
+    }
+
+    bool parse_value(const std::string& value, Node& node) const
+    {
+        char* end = nullptr;
+        switch (node.kind) {
+        case Kind::Address:
+            return inet_pton(node.flags == DecodedPacket::IPV4 ? AF_INET : AF_INET6, value.c_str(),
+                             node.address) == 1;
+        case Kind::Protocol:
+            node.name = value;
+            return true;
+        case Kind::Port:
+        case Kind::Number: {
+            if (value.empty() || !std::isdigit(static_cast<unsigned char>(value[0])))
+                return false;
+            node.value = std::strtoull(value.c_str(), &end, 10);
+            const uint64_t limit = node.kind == Kind::Port ? 65535 : std::numeric_limits<uint32_t>::max();
+            return *end == '\0' && node.value <= limit;
+        }
+        case Kind::Time: {
+            const double seconds = std::strtod(value.c_str(), &end);
+            if (*end != '\0' || !(seconds >= 0) || seconds > 1.8e10)
+                return false;
+            node.value = static_cast<uint64_t>(std::llround(seconds * 1e9));
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    const std::string& text_;
+    std::vector<Node>& nodes_;
+    size_t pos_ = 0;
+    std::string token_;
+    bool quoted_ = false;
+    std::string error_;
+};
+
+namespace {
+
+// The values a comparison accepts, as an inclusive range within [0, max];
+// false if there are none.
+template <typename Compare>
+bool bounds(Compare compare, uint64_t value, uint64_t max, uint64_t& low, uint64_t& high)
+{
+    low = 0;
+    high = max;
+    switch (compare) {
+    case Compare::Equal:
+        low = high = value;
+        return value <= max;
+    case Compare::Less:
+        high = value - 1;
+        return value > 0;
+    case Compare::LessEqual:
+        high = std::min(value, max);
+        return true;
+    case Compare::Greater:
+        low = value + 1;
+        return value < max;
+    case Compare::GreaterEqual:
+        low = value;
+        return value <= max;
+    }
+    return false;
+}
+
+} // namespace
+
+bool DisplayFilter::parse(const std::string& text)
+{
+    std::vector<Node> nodes;
+    std::string error;
+    const int root = Parser(text, nodes).parse(error);
+    if (root < 0) {
+        error_ = error;
+        return false;
+    }
+    nodes_ = std::move(nodes);
+    root_ = root;
+    error_.clear();
+    return true;
+}
+
+RowBitmap DisplayFilter::evaluate(const PacketIndex& index, const PacketStore::Contents& contents) const
+{
+    if (root_ < 0)
+        return index.all_rows();
+    return evaluate(root_, index, contents);
+}
+
+const RowBitmap* DisplayFilter::lookup(int at, const PacketIndex& index) const
+{
+    const Node& node = nodes_[at];
+    return node.kind == Kind::Flags ? &index.flag_rows(static_cast<DecodedPacket::Flag>(node.flags)) : nullptr;
+}
+
+RowBitmap DisplayFilter::evaluate(int at, const PacketIndex& index, const PacketStore::Contents& contents) const
+{
+    const Node& node = nodes_[at];
+    switch (node.kind) {
+    case Kind::And:
+    case Kind::Or: {
+        const RowBitmap* left = lookup(node.left, index);
+        const RowBitmap* right = lookup(node.right, index);
+        if (left && right)
+            return node.kind == Kind::And ? *left & *right : *left | *right;
+        // Keep the computed side, and combine the other in place if it is
+        // the index's.
+        RowBitmap rows = evaluate(left ? node.right : node.left, index, contents);
+        if (node.kind == Kind::And && rows.empty())
+            return rows;
+        const RowBitmap* other = left ? left : right;
+        if (!other)
+            return node.kind == Kind::And ? rows & evaluate(node.right, index, contents)
+                                          : rows | evaluate(node.right, index, contents);
+        return node.kind == Kind::And ? rows & *other : rows | *other;
+    }
+    case Kind::Not: {
+        const RowBitmap* operand = lookup(node.left, index);
+        return operand ? index.all_rows().and_not(*operand)
+                       : index.all_rows().and_not(evaluate(node.left, index, contents));
+    }
+    case Kind::Flags:
+        return index.flag_rows(static_cast<DecodedPacket::Flag>(node.flags));
+    case Kind::Address: {
+        const uint32_t id = contents.find_address(node.address);
+        if (id == PacketStore::NO_ADDRESS)
+            return RowBitmap();
+        RowBitmap rows = node.source ? index.source_address_rows(id) : RowBitmap();
+        if (node.dest)
+            rows |= index.dest_address_rows(id);
+        // IPv4 and IPv6 addresses share the dictionary.
+        return rows & index.flag_rows(static_cast<DecodedPacket::Flag>(node.flags));
+    }
+    case Kind::Port: {
+        uint64_t low;
+        uint64_t high;
+        if (!bounds(node.compare, node.value, 65535, low, high))
+            return RowBitmap();
+        std::vector<const RowBitmap*> ports;
+        for (uint64_t port = low; port <= high; ++port) {
+            if (node.source && !index.source_port_rows(static_cast<uint16_t>(port)).empty())
+                ports.push_back(&index.source_port_rows(static_cast<uint16_t>(port)));
+            if (node.dest && !index.dest_port_rows(static_cast<uint16_t>(port)).empty())
+                ports.push_back(&index.dest_port_rows(static_cast<uint16_t>(port)));
+        }
+        if (ports.empty())
+            return RowBitmap();
+        return RowBitmap::union_of(ports) & index.flag_rows(static_cast<DecodedPacket::Flag>(node.flags));
+    }
+    case Kind::Number: {
+        uint64_t low;
+        uint64_t high;
+        if (index.size() == 0 || !bounds(node.compare, node.value, index.size(), low, high) || high == 0)
+            return RowBitmap();
+        // Frame n is row n - 1.
+        return RowBitmap::range(static_cast<uint32_t>(low == 0 ? 0 : low - 1), static_cast<uint32_t>(high));
+    }
+    case Kind::Time: {
+        if (index.size() == 0)
+            return RowBitmap();
+        const uint64_t base = node.relative ? contents.timestamps()[0] : 0;
+        const uint64_t max = std::numeric_limits<uint64_t>::max() - base;
+        uint64_t low;
+        uint64_t high;
+        if (!bounds(node.compare, node.value, max, low, high))
+            return RowBitmap();
+        return index.time_rows(contents, base + low, base + high);
+    }
+    case Kind::Protocol:
+        for (size_t code = 0; code < contents.protocol_count(); ++code) {
+            if (same_text(node.name, contents.protocol_name(static_cast<uint8_t>(code))))
+                return index.protocol_rows(static_cast<uint8_t>(code));
+        }
+        return RowBitmap();
+    }
+    return RowBitmap();
+}
+
+bool DisplayFilter::matches(const PacketStore::Contents& contents, size_t row) const
+{
+    return root_ < 0 || matches(root_, contents, row);
+}
+
+bool DisplayFilter::matches(int at, const PacketStore::Contents& contents, size_t row) const
+{
+    // The same answers as evaluate(), one row at a time.
+    const Node& node = nodes_[at];
+    const uint32_t flags = contents.flags()[row];
+    switch (node.kind) {
+    case Kind::And:
+        return matches(node.left, contents, row) && matches(node.right, contents, row);
+    case Kind::Or:
+        return matches(node.left, contents, row) || matches(node.right, contents, row);
+    case Kind::Not:
+        return !matches(node.left, contents, row);
+    case Kind::Flags:
+        // The index keeps single-bit flags only.
+        return node.flags != 0 && (node.flags & (node.flags - 1)) == 0 && (flags & node.flags) != 0;
+    case Kind::Address: {
+        if (!(flags & node.flags))
+            return false;
+        const uint32_t id = contents.find_address(node.address);
+        return id != PacketStore::NO_ADDRESS
+            && ((node.source && contents.source_addresses()[row] == id)
+                || (node.dest && contents.dest_addresses()[row] == id));
+    }
+    case Kind::Port: {
+        uint64_t low;
+        uint64_t high;
+        if (!(flags & node.flags) || !bounds(node.compare, node.value, 65535, low, high))
+            return false;
+        const uint16_t source = contents.source_ports()[row];
+        const uint16_t dest = contents.dest_ports()[row];
+        return (node.source && source >= low && source <= high) || (node.dest && dest >= low && dest <= high);
+    }
+    case Kind::Number: {
+        uint64_t low;
+        uint64_t high;
+        const uint64_t number = row + 1;
+        return bounds(node.compare, node.value, std::numeric_limits<uint32_t>::max(), low, high)
+            && number >= low && number <= high;
+    }
+    case Kind::Time: {
+        const uint64_t base = node.relative ? contents.timestamps()[0] : 0;
+        const uint64_t max = std::numeric_limits<uint64_t>::max() - base;
+        uint64_t low;
+        uint64_t high;
+        const uint64_t timestamp = contents.timestamps()[row];
+        return bounds(node.compare, node.value, max, low, high) && timestamp >= base + low
+            && timestamp <= base + high;
+    }
+    case Kind::Protocol:
+        return same_text(node.name, contents.protocol_name(contents.protocols()[row]));
+    }
+    return false;
+}
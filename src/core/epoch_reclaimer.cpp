@@ -0,0 +1,57 @@
+#include "netlyzer/core/epoch_reclaimer.h"
+#include <thread>
+
+EpochReclaimer::~EpochReclaimer()
+{
+    for (auto& entry : retired_)
+        entry.second();
+}
+
+EpochReclaimer::Guard EpochReclaimer::pin() const
+{
+    for (;;) {
+        for (Slot& slot : slots_) {
+            uint64_t free = 0;
+            const uint64_t epoch = epoch_.load(std::memory_order_seq_cst);
+            // Sequentially consistent, so the writer's scan in reclaim() sees
+            // the pin before this reader can load anything it then unlinks.
+            if (slot.epoch.load(std::memory_order_relaxed) == 0
+                && slot.epoch.compare_exchange_strong(free, epoch, std::memory_order_seq_cst))
+                return Guard(&slot.epoch);
+        }
+        std::this_thread::yield();
+    }
+}
+
+void EpochReclaimer::retire(std::function<void()> free)
+{
+    // Readers pinned at this epoch or earlier may have seen the object.
+    const uint64_t epoch = epoch_.fetch_add(1, std::memory_order_seq_cst);
+    retired_.emplace_back(epoch, std::move(free));
+}
+
+size_t EpochReclaimer::reclaim()
+{
+    if (retired_.empty())
+        return 0;
+
+    uint64_t oldest = epoch_.load(std::memory_order_seq_cst);
+    for (const Slot& slot : slots_) {
+        const uint64_t pinned = slot.epoch.load(std::memory_order_seq_cst);
+        if (pinned != 0 && pinned < oldest)
+            oldest = pinned;
+    }
+
+    size_t freed = 0;
+    size_t kept = 0;
+    for (size_t i = 0; i < retired_.size(); ++i) {
+        if (retired_[i].first < oldest) {
+            retired_[i].second();
+            ++freed;
+        } else {
+            retired_[kept++] = std::move(retired_[i]);
+        }
+    }
+    retired_.resize(kept);
+    return freed;
+}
@@ -0,0 +1,270 @@
+#include "netlyzer/core/packet_buffer.h"
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <thread>
+
+namespace {
+
+constexpr uint32_t CLASS_PAYLOAD[] = {
+    128, 256, 512, 1024, 2048, 4096, 9216, 16384, 65536, 262144
+};
+
+class SpinLock {
+public:
+    explicit SpinLock(std::atomic_flag& flag) : flag_(flag)
+    {
+        while (flag_.test_and_set(std::memory_order_acquire))
+            std::this_thread::yield();
+    }
+    ~SpinLock() { flag_.clear(std::memory_order_release); }
+
+private:
+    std::atomic_flag& flag_;
+};
+
+} // namespace
+
+// PacketBuffer
+
+PacketBuffer::PacketBuffer(const PacketBuffer& other) : slot_(other.slot_)
+{
+    if (slot_)
+        slot_->refs.fetch_add(1, std::memory_order_relaxed);
+}
+
+PacketBuffer::PacketBuffer(PacketBuffer&& other) noexcept : slot_(other.slot_)
+{
+    other.slot_ = nullptr;
+}
+
+PacketBuffer& PacketBuffer::operator=(const PacketBuffer& other)
+{
+    if (slot_ != other.slot_) {
+        if (other.slot_)
+            other.slot_->refs.fetch_add(1, std::memory_order_relaxed);
+        release();
+        slot_ = other.slot_;
+    }
+    return *this;
+}
+
+PacketBuffer& PacketBuffer::operator=(PacketBuffer&& other) noexcept
+{
+    if (this != &other) {
+        release();
+        slot_ = other.slot_;
+        other.slot_ = nullptr;
+    }
+    return *this;
+}
+
+PacketBuffer PacketBuffer::copy_of(const uint8_t* data, uint32_t size)
+{
+    return PacketBufferPool::instance().copy(data, size);
+}
+
+void PacketBuffer::release()
+{
+    if (slot_ && slot_->refs.fetch_sub(1, std::memory_order_acq_rel) == 1)
+        slot_->pool->recycle(slot_);
+    slot_ = nullptr;
+}
+
+// PacketBufferPool
+
+PacketBufferPool::PacketBufferPool(size_t max_bytes)
+    : max_bytes_(max_bytes)
+    , live_buffers_(0)
+    , live_bytes_(0)
+    , reserved_bytes_(0)
+    , allocations_(0)
+    , pool_misses_(0)
+    , oversize_(0)
+    , failures_(0)
+{
+    static_assert(sizeof(CLASS_PAYLOAD) / sizeof(CLASS_PAYLOAD[0]) == CLASS_COUNT, "size classes");
+    for (size_t i = 0; i < CLASS_COUNT; ++i)
+        classes_[i].slot_size = static_cast<uint32_t>(PacketBuffer::SLOT_HEADER + CLASS_PAYLOAD[i]);
+}
+
+PacketBufferPool::~PacketBufferPool()
+{
+    for (uint8_t* slab : slabs_)
+        std::free(slab);
+}
+
+PacketBufferPool& PacketBufferPool::instance()
+{
+    static PacketBufferPool pool;
+    return pool;
+}
+
+int PacketBufferPool::class_for(uint32_t size)
+{
+    for (size_t i = 0; i < CLASS_COUNT; ++i) {
+        if (size <= CLASS_PAYLOAD[i])
+            return static_cast<int>(i);
+    }
+    return -1;
+}
+
+bool PacketBufferPool::grow(size_t class_index)
+{
+    SizeClass& size_class = classes_[class_index];
+    size_t slab_size = SLAB_SIZE;
+    while (slab_size < static_cast<size_t>(size_class.slot_size) * 4)
+        slab_size <<= 1;
+
+    if (max_bytes_ != 0 && reserved_bytes_.load(std::memory_order_relaxed) + slab_size > max_bytes_)
+        return false;
+
+    auto* slab = static_cast<uint8_t*>(std::aligned_alloc(64, slab_size));
+    if (!slab)
+        return false;
+
+    {
+        SpinLock lock(slabs_lock_);
+        slabs_.push_back(slab);
+    }
+    reserved_bytes_.fetch_add(slab_size, std::memory_order_relaxed);
+
+    // Thread the new slots onto a private list, then splice it in.
+    const size_t count = slab_size / size_class.slot_size;
+    PacketBuffer::Slot* head = nullptr;
+    for (size_t i = count; i-- > 0;) {
+        auto* slot = new (slab + i * size_class.slot_size) PacketBuffer::Slot;
+        slot->refs.store(0, std::memory_order_relaxed);
+        slot->size = 0;
+        slot->capacity = CLASS_PAYLOAD[class_index];
+        slot->size_class = static_cast<uint16_t>(class_index);
+        slot->reserved = 0;
+        slot->pool = this;
+        slot->next_free = head;
+        head = slot;
+    }
+
+    PacketBuffer::Slot* tail = reinterpret_cast<PacketBuffer::Slot*>(
+        slab + (count - 1) * size_class.slot_size);
+    SpinLock lock(size_class.lock);
+    tail->next_free = size_class.free_list;
+    size_class.free_list = head;
+    return true;
+}
+
+PacketBuffer PacketBufferPool::allocate(uint32_t size)
+{
+    allocations_.fetch_add(1, std::memory_order_relaxed);
+
+    PacketBuffer::Slot* slot = nullptr;
+    const int class_index = class_for(size);
+
+    if (class_index < 0) {
+        // Bigger than any class (e.g. a reassembled jumbo datagram); these
+        // are rare enough to come straight from the heap.
+        const size_t bytes = (PacketBuffer::SLOT_HEADER + size + 63) & ~size_t(63);
+        if (max_bytes_ != 0 && reserved_bytes_.load(std::memory_order_relaxed) + bytes > max_bytes_) {
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            return PacketBuffer();
+        }
+        void* memory = std::aligned_alloc(64, bytes);
+        if (!memory) {
+            failures_.fetch_add(1, std::memory_order_relaxed);
+            return PacketBuffer();
+        }
+        slot = new (memory) PacketBuffer::Slot;
+        slot->capacity = size;
+        slot->size_class = OVERSIZE;
+        slot->reserved = 0;
+        slot->pool = this;
+        slot->next_free = nullptr;
+        reserved_bytes_.fetch_add(bytes, std::memory_order_relaxed);
+        oversize_.fetch_add(1, std::memory_order_relaxed);
+        pool_misses_.fetch_add(1, std::memory_order_relaxed);
+    } else {
+        SizeClass& size_class = classes_[class_index];
+        bool missed = false;
+        for (;;) {
+            {
+                SpinLock lock(size_class.lock);
+                slot = size_class.free_list;
+                if (slot)
+                    size_class.free_list = slot->next_free;
+            }
+            if (slot)
+                break;
+            // Another thread may take the new slots before we get back to the
+            // list, in which case we simply grow again.
+            if (!grow(static_cast<size_t>(class_index))) {
+                failures_.fetch_add(1, std::memory_order_relaxed);
+                return PacketBuffer();
+            }
+            if (!missed) {
+                pool_misses_.fetch_add(1, std::memory_order_relaxed);
+                missed = true;
+            }
+        }
+    }
+
+    slot->refs.store(1, std::memory_order_relaxed);
+    slot->size = size;
+    live_buffers_.fetch_add(1, std::memory_order_relaxed);
+    live_bytes_.fetch_add(slot->capacity, std::memory_order_relaxed);
+    return PacketBuffer(slot);
+}
+
+PacketBuffer PacketBufferPool::copy(const uint8_t* data, uint32_t size)
+{
+    PacketBuffer buffer = allocate(size);
+    if (buffer && size > 0)
+        std::memcpy(buffer.data(), data, size);
+    return buffer;
+}
+
+void PacketBufferPool::reserve(uint32_t size, size_t count)
+{
+    const int class_index = class_for(size);
+    if (class_index < 0)
+        return;
+
+    const size_t slot_size = classes_[class_index].slot_size;
+    size_t reserved = 0;
+    while (reserved < count * slot_size) {
+        size_t before = reserved_bytes_.load(std::memory_order_relaxed);
+        if (!grow(static_cast<size_t>(class_index)))
+            break;
+        reserved += reserved_bytes_.load(std::memory_order_relaxed) - before;
+    }
+}
+
+void PacketBufferPool::recycle(PacketBuffer::Slot* slot)
+{
+    live_buffers_.fetch_sub(1, std::memory_order_relaxed);
+    live_bytes_.fetch_sub(slot->capacity, std::memory_order_relaxed);
+
+    if (slot->size_class == OVERSIZE) {
+        reserved_bytes_.fetch_sub((PacketBuffer::SLOT_HEADER + slot->capacity + 63) & ~size_t(63),
+                                  std::memory_order_relaxed);
+        slot->~Slot();
+        std::free(slot);
+        return;
+    }
+
+    SizeClass& size_class = classes_[slot->size_class];
+    SpinLock lock(size_class.lock);
+    slot->next_free = size_class.free_list;
+    size_class.free_list = slot;
+}
+
+PacketBufferPool::Statistics PacketBufferPool::get_statistics() const
+{
+    Statistics stats;
+    stats.live_buffers = live_buffers_.load(std::memory_order_relaxed);
+    stats.live_bytes = live_bytes_.load(std::memory_order_relaxed);
+    stats.reserved_bytes = reserved_bytes_.load(std::memory_order_relaxed);
+    stats.allocations = allocations_.load(std::memory_order_relaxed);
+    stats.pool_misses = pool_misses_.load(std::memory_order_relaxed);
+    stats.oversize = oversize_.load(std::memory_order_relaxed);
+    stats.failures = failures_.load(std::memory_order_relaxed);
+    return stats;
+}
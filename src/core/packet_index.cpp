@@ -0,0 +1,118 @@
+#include "netlyzer/core/packet_index.h"
+#include <algorithm>
+
+namespace {
+
+const RowBitmap NO_ROWS;
+
+} // namespace
+
+PacketIndex::PacketIndex()
+    : flags_(FLAGS)
+    , protocols_(256)
+    , source_ports_(65536)
+    , dest_ports_(65536)
+{
+}
+
+void PacketIndex::add(const PacketStore::Contents& contents, size_t row)
+{
+    const uint32_t index = static_cast<uint32_t>(row);
+    for (uint32_t flags = contents.flags()[row]; flags != 0; flags &= flags - 1)
+        flags_[__builtin_ctz(flags)].add(index);
+    protocols_[contents.protocols()[row]].add(index);
+
+    // Ids are handed out in order, so a new one is at most one past the end.
+    const uint32_t source = contents.source_addresses()[row];
+    const uint32_t dest = contents.dest_addresses()[row];
+    const size_t ids = std::max(source, dest) + size_t(1);
+    if (source_addresses_.size() < ids) {
+        source_addresses_.resize(ids);
+        dest_addresses_.resize(ids);
+    }
+    source_addresses_[source].add(index);
+    dest_addresses_[dest].add(index);
+
+    if (contents.flags()[row] & (DecodedPacket::TCP | DecodedPacket::UDP)) {
+        source_ports_[contents.source_ports()[row]].add(index);
+        dest_ports_[contents.dest_ports()[row]].add(index);
+    }
+
+    const uint64_t timestamp = contents.timestamps()[row];
+    if (row % PacketStore::BLOCK_ROWS == 0) {
+        block_first_ns_.push_back(timestamp);
+        block_last_ns_.push_back(timestamp);
+    } else {
+        uint64_t& first = block_first_ns_.back();
+        uint64_t& last = block_last_ns_.back();
+        first = std::min(first, timestamp);
+        last = std::max(last, timestamp);
+    }
+    rows_ = row + 1;
+}
+
+void PacketIndex::clear()
+{
+    for (auto* bitmaps : {&flags_, &protocols_, &source_ports_, &dest_ports_}) {
+        for (RowBitmap& bitmap : *bitmaps)
+            bitmap.clear();
+    }
+    source_addresses_.clear();
+    dest_addresses_.clear();
+    block_first_ns_.clear();
+    block_last_ns_.clear();
+    rows_ = 0;
+}
+
+const RowBitmap& PacketIndex::flag_rows(DecodedPacket::Flag flag) const
+{
+    // One bit only; anything else has no bitmap of its own.
+    if (flag == 0 || (flag & (flag - 1)) != 0)
+        return NO_ROWS;
+    return flags_[__builtin_ctz(flag)];
+}
+
+const RowBitmap& PacketIndex::source_address_rows(uint32_t id) const
+{
+    return id < source_addresses_.size() ? source_addresses_[id] : NO_ROWS;
+}
+
+const RowBitmap& PacketIndex::dest_address_rows(uint32_t id) const
+{
+    return id < dest_addresses_.size() ? dest_addresses_[id] : NO_ROWS;
+}
+
+RowBitmap PacketIndex::time_rows(const PacketStore::Contents& contents, uint64_t first_ns, uint64_t last_ns) const
+{
+    RowBitmap rows;
+    for (size_t block = 0; block < block_first_ns_.size(); ++block) {
+        if (block_last_ns_[block] < first_ns || block_first_ns_[block] > last_ns)
+            continue;
+        const size_t begin = block * PacketStore::BLOCK_ROWS;
+        const size_t end = begin + PacketStore::block_size(block, rows_);
+        if (block_first_ns_[block] >= first_ns && block_last_ns_[block] <= last_ns) {
+            rows.add_range(static_cast<uint32_t>(begin), static_cast<uint32_t>(end));
+            continue;
+        }
+        // Cut by the range: look at each timestamp in the block.
+        const uint64_t* timestamps = contents.timestamps().block(block);
+        for (size_t row = begin; row < end; ++row) {
+            const uint64_t timestamp = timestamps[row - begin];
+            if (timestamp >= first_ns && timestamp <= last_ns)
+                rows.add(static_cast<uint32_t>(row));
+        }
+    }
+    return rows;
+}
+
+size_t PacketIndex::memory_bytes() const
+{
+    size_t total = (block_first_ns_.capacity() + block_last_ns_.capacity()) * sizeof(uint64_t);
+    for (const auto* bitmaps : {&flags_, &protocols_, &source_addresses_, &dest_addresses_, &source_ports_,
+                                &dest_ports_}) {
+        total += bitmaps->capacity() * sizeof(RowBitmap);
+        for (const RowBitmap& bitmap : *bitmaps)
+            total += bitmap.memory_bytes();
+    }
+    return total;
+}
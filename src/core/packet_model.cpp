@@ -7,27 +7,59 @@ PacketModel::PacketModel(QObject *parent)
 
 PacketModel::~PacketModel() = default;
 
-void PacketModel::addPacket(const PacketData &packet)
+int PacketModel::addPackets(const QVector<PacketRecord> &records)
 {
-    m_packets.append(packet);
-    emit packetAdded(packet);
+    const int first = getPacketCount() + 1;
+    for (const PacketRecord &record : records) {
+        const size_t row = m_store.append(record.timestampNs, record.length, record.interfaceId,
+                                          record.buffer.data(), record.capturedLength, record.decoded);
+        m_index.add(m_store.contents(), row);
+    }
+    if (!records.isEmpty()) {
+        emit packetsAdded(first, records.size());
+    }
+    return first;
 }
 
-void PacketModel::clearPackets()
+int PacketModel::addFileFrames(const CaptureFile &file, const CaptureFile::Frame *frames, size_t count)
 {
-    m_packets.clear();
-    emit packetsCleared();
+    const int first = getPacketCount() + 1;
+    const size_t firstRow = m_dissector.append(m_store, file, frames, count);
+    for (size_t i = 0; i < count; ++i) {
+        m_index.add(m_store.contents(), firstRow + i);
+    }
+    if (count > 0) {
+        emit packetsAdded(first, static_cast<int>(count));
+    }
+    return first;
 }
 
-PacketData PacketModel::getPacket(int index) const
+void PacketModel::clearPackets()
 {
-    if (index >= 0 && index < m_packets.size()) {
-        return m_packets[index];
-    }
-    return PacketData();
+    m_store.clear();
+    m_index.clear();
+    emit packetsCleared();
 }
 
-int PacketModel::getPacketCount() const
+bool PacketModel::getPacket(int index, PacketRecord &record) const
 {
-    return m_packets.size();
+    if (index < 0 || index >= getPacketCount()) {
+        return false;
+    }
+    // Pinned, so the bytes stay mapped while they are copied even if capture
+    // pushes their segment back out to disk meanwhile.
+    const PacketStore::Snapshot snapshot = m_store.snapshot();
+    const PacketStore::Row packet = (*snapshot)[static_cast<size_t>(index)];
+    const uint8_t *data = packet.data();
+    if (!data && packet.captured_length() > 0) {
+        return false;
+    }
+    record.timestampNs = packet.timestamp_ns();
+    record.number = static_cast<quint32>(packet.number());
+    record.length = packet.length();
+    record.capturedLength = packet.captured_length();
+    record.interfaceId = packet.interface_id();
+    record.buffer = PacketBuffer::copy_of(data, packet.captured_length());
+    packet.decode(record.decoded);
+    return true;
 }
@@ -0,0 +1,609 @@
+#include "netlyzer/core/packet_store.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include <zlib.h>
+#ifdef NETLYZER_HAVE_LZ4
+#include <lz4.h>
+#endif
+
+namespace {
+
+// Set after decode() by other stages, so they have to be kept.
+constexpr uint32_t STICKY_FLAGS = DecodedPacket::CHECKSUM_VERIFIED | DecodedPacket::BAD_IP_CHECKSUM
+                                | DecodedPacket::BAD_L4_CHECKSUM | DecodedPacket::CHECKSUM_OFFLOAD
+                                | DecodedPacket::REASSEMBLED;
+
+constexpr size_t MAX_PROTOCOLS = 256;
+constexpr size_t ADDRESS_BLOCK = 4096;
+constexpr size_t MIN_ADDRESS_INDEX = 64;
+
+// Per row: timestamp, offset, two lengths, flags, two address ids, two
+// ports and four one-byte codes.
+constexpr size_t ROW_BYTES = 8 + 8 + 4 * 5 + 2 * 2 + 4;
+
+uint64_t hash_address(const uint8_t* address)
+{
+    uint64_t low;
+    uint64_t high;
+    std::memcpy(&low, address, 8);
+    std::memcpy(&high, address + 8, 8);
+    uint64_t hash = (low * 0x9e3779b97f4a7c15ull) ^ (high * 0xc2b2ae3d27d4eb4full);
+    return hash ^ (hash >> 31);
+}
+
+uint64_t elapsed_ns(std::chrono::steady_clock::time_point start)
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now() - start).count());
+}
+
+PacketStore::Codec built_codec(PacketStore::Codec codec)
+{
+#ifndef NETLYZER_HAVE_LZ4
+    if (codec == PacketStore::Codec::Lz4)
+        return PacketStore::Codec::Zlib;
+#endif
+    return codec;
+}
+
+size_t compress_bound(PacketStore::Codec codec, size_t length)
+{
+#ifdef NETLYZER_HAVE_LZ4
+    if (codec == PacketStore::Codec::Lz4)
+        return static_cast<size_t>(LZ4_compressBound(static_cast<int>(length)));
+#endif
+    (void)codec;
+    return compressBound(static_cast<uLong>(length));
+}
+
+// Bytes written to `out`, or 0 if the codec failed.
+size_t compress_block(PacketStore::Codec codec, const uint8_t* in, size_t length, uint8_t* out, size_t capacity)
+{
+#ifdef NETLYZER_HAVE_LZ4
+    if (codec == PacketStore::Codec::Lz4) {
+        const int written = LZ4_compress_default(reinterpret_cast<const char*>(in), reinterpret_cast<char*>(out),
+                                                 static_cast<int>(length), static_cast<int>(capacity));
+        return written > 0 ? static_cast<size_t>(written) : 0;
+    }
+#endif
+    (void)codec;
+    uLongf written = static_cast<uLongf>(capacity);
+    // The fastest level: most of the gain on packet data is from headers
+    // and padding, which level 1 already finds.
+    return compress2(out, &written, in, static_cast<uLong>(length), Z_BEST_SPEED) == Z_OK ? written : 0;
+}
+
+bool decompress_block(PacketStore::Codec codec, const uint8_t* in, size_t packed_length, uint8_t* out,
+                      size_t length)
+{
+#ifdef NETLYZER_HAVE_LZ4
+    if (codec == PacketStore::Codec::Lz4) {
+        return LZ4_decompress_safe(reinterpret_cast<const char*>(in), reinterpret_cast<char*>(out),
+                                   static_cast<int>(packed_length), static_cast<int>(length))
+            == static_cast<int>(length);
+    }
+#endif
+    (void)codec;
+    uLongf written = static_cast<uLongf>(length);
+    return uncompress(out, &written, in, static_cast<uLong>(packed_length)) == Z_OK && written == length;
+}
+
+} // namespace
+
+bool PacketStore::parse_codec(const std::string& name, Codec& codec)
+{
+    if (name == "none")
+        codec = Codec::None;
+    else if (name == "zlib")
+        codec = Codec::Zlib;
+    else if (name == "lz4")
+        codec = Codec::Lz4;
+    else
+        return false;
+    return true;
+}
+
+void PacketStore::Row::decode(DecodedPacket& packet) const
+{
+    const uint32_t stored = flags();
+    const uint8_t* bytes = data();
+    const uint32_t captured = bytes ? captured_length() : 0;
+    // A reassembled datagram was decoded as if it had been captured whole.
+    const uint32_t wire = (stored & DecodedPacket::REASSEMBLED) ? captured : length();
+    PacketDecoder::decode(bytes, captured, wire, packet);
+    packet.flags |= stored & STICKY_FLAGS;
+}
+
+PacketStore::Contents::AddressIndex::AddressIndex(size_t size)
+    : mask(size - 1)
+    , table(new std::atomic<uint32_t>[size])
+{
+    for (size_t i = 0; i < size; ++i)
+        table[i].store(NO_ADDRESS, std::memory_order_relaxed);
+}
+
+PacketStore::Contents::Contents(PacketStore* store)
+    : store_(store)
+    , config_(store->config_)
+    , codec_(built_codec(config_.codec))
+{
+}
+
+PacketStore::Contents::~Contents()
+{
+    for (const CachedBlock& cached : cached_)
+        delete[] cached.segment->blocks[cached.block].load(std::memory_order_relaxed);
+    for (Segment* segment : mapped_) {
+        uint8_t* base = (segment->compressed ? segment->packed : segment->data).load(std::memory_order_relaxed);
+        munmap(base, segment->stored_size());
+    }
+    if (spill_fd_ >= 0)
+        close(spill_fd_);
+}
+
+uint32_t PacketStore::Contents::find_address(const uint8_t* address) const
+{
+    const AddressIndex* index = address_index_.load(std::memory_order_acquire);
+    if (!index)
+        return NO_ADDRESS;
+    // An id in a slot was stored after its address, with release.
+    for (size_t slot = hash_address(address) & index->mask;; slot = (slot + 1) & index->mask) {
+        const uint32_t id = index->table[slot].load(std::memory_order_acquire);
+        if (id == NO_ADDRESS || std::memcmp(addresses_[id].bytes, address, 16) == 0)
+            return id;
+    }
+}
+
+uint32_t PacketStore::Contents::intern_address(const uint8_t* address)
+{
+    const uint32_t count = address_count_.load(std::memory_order_relaxed);
+    // Kept at most half full, so probes stay short and always end.
+    AddressIndex* index = address_index_.load(std::memory_order_relaxed);
+    if (!index || (count + 1) * 2 > index->mask + 1) {
+        grow_address_index();
+        index = address_index_.load(std::memory_order_relaxed);
+    }
+
+    size_t slot = hash_address(address) & index->mask;
+    for (;; slot = (slot + 1) & index->mask) {
+        const uint32_t id = index->table[slot].load(std::memory_order_relaxed);
+        if (id == NO_ADDRESS)
+            break;
+        if (std::memcmp(addresses_[id].bytes, address, 16) == 0)
+            return id;
+    }
+
+    Address entry;
+    std::memcpy(entry.bytes, address, 16);
+    addresses_.store(count, entry);
+    index->table[slot].store(count, std::memory_order_release);
+    address_count_.store(count + 1, std::memory_order_release);
+    return count;
+}
+
+void PacketStore::Contents::grow_address_index()
+{
+    const AddressIndex* old = address_index_.load(std::memory_order_relaxed);
+    auto index = std::make_unique<AddressIndex>(old ? (old->mask + 1) * 2 : MIN_ADDRESS_INDEX);
+    const uint32_t count = address_count_.load(std::memory_order_relaxed);
+    for (uint32_t id = 0; id < count; ++id) {
+        size_t slot = hash_address(addresses_[id].bytes) & index->mask;
+        while (index->table[slot].load(std::memory_order_relaxed) != NO_ADDRESS)
+            slot = (slot + 1) & index->mask;
+        index->table[slot].store(id, std::memory_order_relaxed);
+    }
+    address_index_.store(index.get(), std::memory_order_release);
+    address_indexes_.push_back(std::move(index));
+}
+
+uint8_t PacketStore::Contents::intern_protocol(const char* name)
+{
+    // Names come from PacketDecoder::protocol_name, so they are few and
+    // usually the same pointer.
+    const size_t count = protocol_count_.load(std::memory_order_relaxed);
+    for (size_t code = 0; code < count; ++code) {
+        if (protocol_names_[code] == name || std::strcmp(protocol_names_[code], name) == 0)
+            return static_cast<uint8_t>(code);
+    }
+    if (count == MAX_PROTOCOLS)
+        return static_cast<uint8_t>(MAX_PROTOCOLS - 1);
+    protocol_names_[count] = name;
+    protocol_count_.store(count + 1, std::memory_order_release);
+    return static_cast<uint8_t>(count);
+}
+
+uint64_t PacketStore::Contents::store_data(const uint8_t* data, uint32_t length)
+{
+    // Packets never straddle segments; one larger than a segment gets its own.
+    Segment* segment = current_segment_;
+    if (!segment || segment->used + length > segment->size) {
+        if (segment && codec_ != Codec::None)
+            compress(*segment);
+        auto created = std::make_unique<Segment>();
+        created->size = std::max<size_t>(ARENA_CHUNK_SIZE, length);
+        created->memory.reset(new uint8_t[created->size]);
+        created->data.store(created->memory.get(), std::memory_order_relaxed);
+        {
+            std::lock_guard<std::mutex> lock(store_->mutex_);
+            if (segment && segment->packed_memory) {
+                // Readers that find `data` gone see the blocks, published first.
+                segment->compressed = true;
+                segment->packed.store(segment->packed_memory.get(), std::memory_order_release);
+                segment->data.store(nullptr, std::memory_order_release);
+                uint8_t* memory = segment->memory.release();
+                store_->epochs_.retire([memory] { delete[] memory; });
+                resident_bytes_.fetch_sub(segment->size - segment->packed_size, std::memory_order_relaxed);
+            }
+            if (segment)
+                hot_.push_back(segment);
+            resident_segments_.fetch_add(1, std::memory_order_relaxed);
+            resident_bytes_.fetch_add(created->size, std::memory_order_relaxed);
+            enforce_budget(created.get());
+            store_->epochs_.reclaim();
+        }
+        segments_.store(segment_memory_.size(), created.get());
+        segment_memory_.push_back(std::move(created));
+        segment = current_segment_ = segment_memory_.back().get();
+    }
+
+    // Blocks to be compressed end on packet boundaries, so a row is always
+    // within one of them.
+    if (codec_ != Codec::None
+        && (segment->block_starts.empty()
+            || (segment->used > segment->block_starts.back()
+                && segment->used - segment->block_starts.back() + length > COMPRESSION_BLOCK)))
+        segment->block_starts.push_back(static_cast<uint32_t>(segment->used));
+
+    const uint64_t offset = (static_cast<uint64_t>(segment_memory_.size() - 1) << 32) | segment->used;
+    if (length != 0)
+        std::memcpy(segment->memory.get() + segment->used, data, length);
+    segment->used += length;
+    data_bytes_.store(data_bytes_.load(std::memory_order_relaxed) + length, std::memory_order_relaxed);
+    return offset;
+}
+
+void PacketStore::Contents::compress(Segment& segment)
+{
+    // Readers may still be reading the raw bytes; they are only read here.
+    const auto start = std::chrono::steady_clock::now();
+    const size_t count = segment.block_starts.size();
+    size_t bound = 0;
+    for (size_t block = 0; block < count; ++block) {
+        const size_t end = block + 1 < count ? segment.block_starts[block + 1] : segment.used;
+        bound += compress_bound(codec_, end - segment.block_starts[block]);
+    }
+    if (scratch_.size() < bound)
+        scratch_.resize(bound);
+
+    size_t packed = 0;
+    segment.packed_starts.reserve(count + 1);
+    for (size_t block = 0; block < count; ++block) {
+        const size_t first = segment.block_starts[block];
+        const size_t length = (block + 1 < count ? segment.block_starts[block + 1] : segment.used) - first;
+        const uint8_t* raw = segment.memory.get() + first;
+        size_t written = compress_block(codec_, raw, length, scratch_.data() + packed, bound - packed);
+        // Blocks that do not shrink are kept as they are, and known by
+        // their unchanged length.
+        if (written == 0 || written >= length) {
+            std::memcpy(scratch_.data() + packed, raw, length);
+            written = length;
+        }
+        segment.packed_starts.push_back(static_cast<uint32_t>(packed));
+        packed += written;
+    }
+    segment.packed_starts.push_back(static_cast<uint32_t>(packed));
+
+    segment.packed_memory.reset(new uint8_t[packed ? packed : 1]);
+    if (packed != 0)
+        std::memcpy(segment.packed_memory.get(), scratch_.data(), packed);
+    segment.packed_size = packed;
+    segment.blocks.reset(new std::atomic<uint8_t*>[count ? count : 1]());
+
+    compressed_segments_.fetch_add(1, std::memory_order_relaxed);
+    uncompressed_bytes_.fetch_add(segment.used, std::memory_order_relaxed);
+    compressed_bytes_.fetch_add(packed, std::memory_order_relaxed);
+    store_->compress_ns_.fetch_add(elapsed_ns(start), std::memory_order_relaxed);
+}
+
+const uint8_t* PacketStore::Contents::load(Segment& segment, uint32_t position) const
+{
+    if (!segment.compressed) {
+        std::lock_guard<std::mutex> lock(store_->mutex_);
+        // Another reader may have mapped it while we waited.
+        const uint8_t* base = segment.data.load(std::memory_order_acquire);
+        if (!base)
+            base = page_in(segment);
+        return base ? base + position : nullptr;
+    }
+
+    // The row is in the last block starting at or before it.
+    const auto& starts = segment.block_starts;
+    const size_t block = static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), position)
+                                             - starts.begin()) - 1;
+    const uint8_t* bytes = segment.blocks[block].load(std::memory_order_acquire);
+    if (!bytes) {
+        std::lock_guard<std::mutex> lock(store_->mutex_);
+        bytes = decode_block(segment, block);
+    }
+    return bytes ? bytes + (position - starts[block]) : nullptr;
+}
+
+const uint8_t* PacketStore::Contents::page_in(Segment& segment) const
+{
+    static const uint8_t empty = 0;
+    const size_t size = segment.stored_size();
+    if (size == 0)
+        return &empty;
+
+    const auto start = std::chrono::steady_clock::now();
+    void* map = mmap(nullptr, size, PROT_READ, MAP_SHARED | MAP_POPULATE, spill_fd_,
+                     static_cast<off_t>(segment.file_offset));
+    if (map == MAP_FAILED) {
+        store_->spill_errors_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    const uint64_t ns = elapsed_ns(start);
+    store_->page_ins_.fetch_add(1, std::memory_order_relaxed);
+    store_->page_in_ns_.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > store_->max_page_in_ns_.load(std::memory_order_relaxed))
+        store_->max_page_in_ns_.store(ns, std::memory_order_relaxed);
+
+    (segment.compressed ? segment.packed : segment.data).store(static_cast<uint8_t*>(map),
+                                                               std::memory_order_release);
+    mapped_.push_back(&segment);
+    spilled_segments_.fetch_sub(1, std::memory_order_relaxed);
+    spilled_bytes_.fetch_sub(size, std::memory_order_relaxed);
+    resident_segments_.fetch_add(1, std::memory_order_relaxed);
+    resident_bytes_.fetch_add(size, std::memory_order_relaxed);
+    enforce_budget(&segment);
+    store_->epochs_.reclaim();
+    return static_cast<const uint8_t*>(map);
+}
+
+const uint8_t* PacketStore::Contents::decode_block(Segment& segment, size_t block) const
+{
+    static const uint8_t empty = 0;
+    const uint8_t* bytes = segment.blocks[block].load(std::memory_order_acquire);
+    if (bytes)
+        return bytes;
+    const size_t count = segment.block_starts.size();
+    const size_t first = segment.block_starts[block];
+    const size_t length = (block + 1 < count ? segment.block_starts[block + 1] : segment.used) - first;
+    if (length == 0)
+        return &empty;
+    const uint8_t* packed = segment.packed.load(std::memory_order_acquire);
+    if (!packed && !(packed = page_in(segment)))
+        return nullptr;
+
+    const auto start = std::chrono::steady_clock::now();
+    const size_t packed_length = segment.packed_starts[block + 1] - segment.packed_starts[block];
+    uint8_t* decoded = new uint8_t[length];
+    if (packed_length == length) {
+        std::memcpy(decoded, packed + segment.packed_starts[block], length);
+    } else if (!decompress_block(codec_, packed + segment.packed_starts[block], packed_length, decoded, length)) {
+        delete[] decoded;
+        store_->spill_errors_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+    const uint64_t ns = elapsed_ns(start);
+    store_->block_decodes_.fetch_add(1, std::memory_order_relaxed);
+    store_->decode_ns_.fetch_add(ns, std::memory_order_relaxed);
+    if (ns > store_->max_decode_ns_.load(std::memory_order_relaxed))
+        store_->max_decode_ns_.store(ns, std::memory_order_relaxed);
+
+    segment.blocks[block].store(decoded, std::memory_order_release);
+    cached_.push_back(CachedBlock{&segment, block, length});
+    cached_blocks_.fetch_add(1, std::memory_order_relaxed);
+    cached_bytes_.fetch_add(length, std::memory_order_relaxed);
+    // The oldest blocks go first, never the one just decoded; readers
+    // still inside one keep it until their snapshots end.
+    while (cached_bytes_.load(std::memory_order_relaxed) > config_.block_cache_bytes && cached_.size() > 1) {
+        const CachedBlock evicted = cached_.front();
+        cached_.pop_front();
+        uint8_t* memory = evicted.segment->blocks[evicted.block].exchange(nullptr, std::memory_order_acq_rel);
+        store_->epochs_.retire([memory] { delete[] memory; });
+        cached_blocks_.fetch_sub(1, std::memory_order_relaxed);
+        cached_bytes_.fetch_sub(evicted.size, std::memory_order_relaxed);
+    }
+    store_->epochs_.reclaim();
+    return decoded;
+}
+
+void PacketStore::Contents::enforce_budget(const Segment* keep) const
+{
+    if (config_.memory_budget == 0 || config_.spill_directory.empty())
+        return;
+    // Mapped segments are already on disk, so they go first; then the
+    // oldest sealed segments are written out.
+    while (resident_bytes_.load(std::memory_order_relaxed) > config_.memory_budget) {
+        if (!mapped_.empty() && mapped_.front() != keep) {
+            Segment* segment = mapped_.front();
+            mapped_.pop_front();
+            drop(*segment);
+        } else if (!hot_.empty() && spill(*hot_.front())) {
+            Segment* segment = hot_.front();
+            hot_.pop_front();
+            drop(*segment);
+        } else {
+            break;
+        }
+    }
+}
+
+bool PacketStore::Contents::spill(Segment& segment) const
+{
+    if (spill_failed_)
+        return false;
+    if (spill_fd_ < 0) {
+        // Unlinked at once, so the file goes away with the descriptor even
+        // if the process does not exit cleanly.
+        std::string path = config_.spill_directory + "/netlyzer-spill-XXXXXX";
+        spill_fd_ = mkstemp(&path[0]);
+        if (spill_fd_ < 0) {
+            spill_failed_ = true;
+            store_->spill_errors_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        unlink(path.c_str());
+    }
+
+    // Mappings start on a page boundary.
+    const uint64_t page = static_cast<uint64_t>(sysconf(_SC_PAGESIZE));
+    const uint64_t offset = (spill_end_ + page - 1) / page * page;
+    const uint8_t* bytes = segment.compressed ? segment.packed_memory.get() : segment.memory.get();
+    const size_t size = segment.stored_size();
+    size_t written = 0;
+    while (written < size) {
+        const ssize_t result = pwrite(spill_fd_, bytes + written, size - written,
+                                      static_cast<off_t>(offset + written));
+        if (result <= 0) {
+            store_->spill_errors_.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        written += static_cast<size_t>(result);
+    }
+    segment.file_offset = offset;
+    segment.spilled = true;
+    spill_end_ = offset + size;
+    return true;
+}
+
+void PacketStore::Contents::drop(Segment& segment) const
+{
+    // Readers may still hold pointers into the segment; it is freed once
+    // they have all let go of their snapshots.
+    uint8_t* base = (segment.compressed ? segment.packed : segment.data).exchange(nullptr, std::memory_order_acq_rel);
+    const size_t length = segment.stored_size();
+    size_t resident = length;
+    if (segment.memory) {
+        resident = segment.size;
+        uint8_t* memory = segment.memory.release();
+        store_->epochs_.retire([memory] { delete[] memory; });
+    } else if (segment.packed_memory) {
+        uint8_t* memory = segment.packed_memory.release();
+        store_->epochs_.retire([memory] { delete[] memory; });
+    } else {
+        store_->epochs_.retire([base, length] { munmap(base, length); });
+    }
+    resident_segments_.fetch_sub(1, std::memory_order_relaxed);
+    resident_bytes_.fetch_sub(resident, std::memory_order_relaxed);
+    spilled_segments_.fetch_add(1, std::memory_order_relaxed);
+    spilled_bytes_.fetch_add(length, std::memory_order_relaxed);
+}
+
+size_t PacketStore::Contents::metadata_bytes() const
+{
+    // Blocks are allocated whole. Every smaller address index is kept too,
+    // which together come to about as much as the current one.
+    const AddressIndex* index = address_index_.load(std::memory_order_acquire);
+    const size_t index_slots = index ? 2 * (index->mask + 1) - MIN_ADDRESS_INDEX : 0;
+    const size_t address_blocks = (address_count() + ADDRESS_BLOCK - 1) / ADDRESS_BLOCK;
+    return block_count(size()) * BLOCK_ROWS * ROW_BYTES + address_blocks * ADDRESS_BLOCK * sizeof(Address)
+         + index_slots * sizeof(uint32_t);
+}
+
+PacketStore::PacketStore()
+    : PacketStore(Config())
+{
+}
+
+PacketStore::PacketStore(const Config& config)
+    : config_(config)
+    , current_(new Contents(this))
+{
+}
+
+PacketStore::~PacketStore()
+{
+    delete current_.load(std::memory_order_relaxed);
+}
+
+PacketStore::Snapshot PacketStore::snapshot() const
+{
+    // Pin first: the contents loaded afterwards cannot be freed under us.
+    EpochReclaimer::Guard guard = epochs_.pin();
+    return Snapshot(std::move(guard), current_.load(std::memory_order_seq_cst));
+}
+
+size_t PacketStore::append(uint64_t timestamp_ns, uint32_t length, uint8_t interface_id, const uint8_t* data,
+                           uint32_t captured_length, const DecodedPacket& packet)
+{
+    const uint64_t offset = current_.load(std::memory_order_relaxed)->store_data(data, captured_length);
+    return append_row(timestamp_ns, length, interface_id, offset, captured_length, packet);
+}
+
+size_t PacketStore::append_mapped(uint64_t timestamp_ns, uint32_t length, uint8_t interface_id,
+                                  uint64_t file_offset, uint32_t captured_length, const DecodedPacket& packet)
+{
+    return append_row(timestamp_ns, length, interface_id, MAPPED_OFFSET | file_offset, captured_length, packet);
+}
+
+size_t PacketStore::append_row(uint64_t timestamp_ns, uint32_t length, uint8_t interface_id, uint64_t offset,
+                               uint32_t captured_length, const DecodedPacket& packet)
+{
+    Contents& contents = *current_.load(std::memory_order_relaxed);
+    const size_t index = rows_;
+    contents.offsets_.store(index, offset);
+    contents.timestamps_.store(index, timestamp_ns);
+    contents.lengths_.store(index, length);
+    contents.captured_lengths_.store(index, captured_length);
+    contents.flags_.store(index, packet.flags);
+    contents.source_addresses_.store(index, contents.intern_address(packet.source_address));
+    contents.dest_addresses_.store(index, contents.intern_address(packet.dest_address));
+    contents.source_ports_.store(index, packet.source_port);
+    contents.dest_ports_.store(index, packet.dest_port);
+    contents.protocols_.store(index, contents.intern_protocol(PacketDecoder::protocol_name(packet)));
+    contents.ip_protocols_.store(index, packet.ip_protocol);
+    contents.tcp_flags_.store(index, packet.tcp_flags);
+    contents.interfaces_.store(index, interface_id);
+
+    // Publish the row; readers never look past rows_.
+    rows_ = index + 1;
+    contents.rows_.store(rows_, std::memory_order_release);
+
+    // Whatever clear() or eviction retired goes once the readers that
+    // pinned it do.
+    if (index % BLOCK_ROWS == 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        epochs_.reclaim();
+    }
+    return index;
+}
+
+void PacketStore::clear()
+{
+    Contents* fresh = new Contents(this);
+    std::lock_guard<std::mutex> lock(mutex_);
+    Contents* old = current_.exchange(fresh, std::memory_order_seq_cst);
+    rows_ = 0;
+    epochs_.retire([old] { delete old; });
+    epochs_.reclaim();
+}
+
+PacketStore::Statistics PacketStore::get_statistics() const
+{
+    Snapshot snapshot = this->snapshot();
+    Statistics stats;
+    stats.resident_segments = snapshot->resident_segments_.load(std::memory_order_relaxed);
+    stats.resident_bytes = snapshot->resident_bytes_.load(std::memory_order_relaxed);
+    stats.spilled_segments = snapshot->spilled_segments_.load(std::memory_order_relaxed);
+    stats.spilled_bytes = snapshot->spilled_bytes_.load(std::memory_order_relaxed);
+    stats.page_ins = page_ins_.load(std::memory_order_relaxed);
+    stats.page_in_ns = page_in_ns_.load(std::memory_order_relaxed);
+    stats.max_page_in_ns = max_page_in_ns_.load(std::memory_order_relaxed);
+    stats.spill_errors = spill_errors_.load(std::memory_order_relaxed);
+    stats.compressed_segments = snapshot->compressed_segments_.load(std::memory_order_relaxed);
+    stats.uncompressed_bytes = snapshot->uncompressed_bytes_.load(std::memory_order_relaxed);
+    stats.compressed_bytes = snapshot->compressed_bytes_.load(std::memory_order_relaxed);
+    stats.compress_ns = compress_ns_.load(std::memory_order_relaxed);
+    stats.block_decodes = block_decodes_.load(std::memory_order_relaxed);
+    stats.decode_ns = decode_ns_.load(std::memory_order_relaxed);
+    stats.max_decode_ns = max_decode_ns_.load(std::memory_order_relaxed);
+    stats.cached_blocks = snapshot->cached_blocks_.load(std::memory_order_relaxed);
+    stats.cached_bytes = snapshot->cached_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,261 @@
+#include "netlyzer/core/parallel_dissector.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t NO_ID = 0xffffffffu;
+constexpr uint32_t LOCAL_ID = 0x80000000u;
+// Two addresses a row, kept at most half full.
+constexpr size_t CHUNK_SLOTS = 4 * ParallelDissector::CHUNK_ROWS;
+constexpr size_t MAX_PROTOCOLS = 256;
+
+static_assert(PacketStore::BLOCK_ROWS % ParallelDissector::CHUNK_ROWS == 0, "chunks must not straddle blocks");
+
+size_t hash_address(const uint8_t* address)
+{
+    uint64_t low;
+    uint64_t high;
+    std::memcpy(&low, address, 8);
+    std::memcpy(&high, address + 8, 8);
+    const uint64_t hash = (low * 0x9e3779b97f4a7c15ull) ^ (high * 0xc2b2ae3d27d4eb4full);
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+} // namespace
+
+ParallelDissector::ParallelDissector(unsigned threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned i = 1; i < threads; ++i)
+        helpers_.emplace_back([this] { run_helper(); });
+}
+
+ParallelDissector::~ParallelDissector()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    wake_.notify_all();
+    for (std::thread& helper : helpers_)
+        helper.join();
+}
+
+size_t ParallelDissector::append(PacketStore& store, const CaptureFile& file, const CaptureFile::Frame* frames,
+                                 size_t count, DecodedPacket* decoded)
+{
+    const size_t first = store.rows_;
+    if (count == 0)
+        return first;
+    PacketStore::Contents& contents = *store.current_.load(std::memory_order_relaxed);
+    const size_t last = first + count;
+
+    // Every block the batch touches exists before any thread writes to it.
+    for (size_t block = first / PacketStore::BLOCK_ROWS; block <= (last - 1) / PacketStore::BLOCK_ROWS; ++block) {
+        contents.timestamps_.allocate(block);
+        contents.offsets_.allocate(block);
+        contents.lengths_.allocate(block);
+        contents.captured_lengths_.allocate(block);
+        contents.flags_.allocate(block);
+        contents.source_addresses_.allocate(block);
+        contents.dest_addresses_.allocate(block);
+        contents.source_ports_.allocate(block);
+        contents.dest_ports_.allocate(block);
+        contents.protocols_.allocate(block);
+        contents.ip_protocols_.allocate(block);
+        contents.tcp_flags_.allocate(block);
+        contents.interfaces_.allocate(block);
+    }
+
+    chunk_count_ = 0;
+    for (size_t begin = first; begin < last; ++chunk_count_) {
+        if (chunks_.size() == chunk_count_) {
+            chunks_.push_back(std::make_unique<Chunk>());
+            chunks_.back()->table.resize(CHUNK_SLOTS);
+        }
+        Chunk& chunk = *chunks_[chunk_count_];
+        chunk.begin = begin;
+        chunk.end = std::min(last, (begin / CHUNK_ROWS + 1) * CHUNK_ROWS);
+        chunk.done.store(false, std::memory_order_relaxed);
+        begin = chunk.end;
+    }
+    store_ = &store;
+    contents_ = &contents;
+    file_ = &file;
+    frames_ = frames;
+    decoded_ = decoded;
+    first_row_ = first;
+    next_chunk_.store(0, std::memory_order_relaxed);
+
+    if (!helpers_.empty()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_ = true;
+            ++generation_;
+        }
+        wake_.notify_all();
+    }
+
+    for (size_t index = 0; index < chunk_count_; ++index) {
+        Chunk& chunk = *chunks_[index];
+        while (!chunk.done.load(std::memory_order_acquire)) {
+            if (!dissect_next())
+                std::this_thread::yield();
+        }
+        stitch(chunk);
+    }
+
+    if (!helpers_.empty()) {
+        // No helper joins the batch after this, and those in it are only
+        // finding the counter exhausted.
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            active_ = false;
+        }
+        while (busy_.load(std::memory_order_acquire) != 0)
+            std::this_thread::yield();
+    }
+    return first;
+}
+
+void ParallelDissector::run_helper()
+{
+    uint64_t seen = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            wake_.wait(lock, [&] { return stopping_ || generation_ != seen; });
+            if (stopping_)
+                return;
+            seen = generation_;
+            if (!active_)
+                continue;
+            busy_.fetch_add(1, std::memory_order_relaxed);
+        }
+        while (dissect_next()) {
+        }
+        busy_.fetch_sub(1, std::memory_order_release);
+    }
+}
+
+bool ParallelDissector::dissect_next()
+{
+    const size_t index = next_chunk_.fetch_add(1, std::memory_order_relaxed);
+    if (index >= chunk_count_)
+        return false;
+    Chunk& chunk = *chunks_[index];
+    dissect(chunk);
+    chunk.done.store(true, std::memory_order_release);
+    return true;
+}
+
+void ParallelDissector::dissect(Chunk& chunk)
+{
+    PacketStore::Contents& contents = *contents_;
+    chunk.addresses.clear();
+    chunk.protocols.clear();
+    chunk.fixups.clear();
+    std::fill(chunk.table.begin(), chunk.table.end(), NO_ID);
+
+    DecodedPacket scratch;
+    for (size_t row = chunk.begin; row < chunk.end; ++row) {
+        const CaptureFile::Frame& frame = frames_[row - first_row_];
+        DecodedPacket& packet = decoded_ ? decoded_[row - first_row_] : scratch;
+        if (frame.link_type == CaptureFile::LINKTYPE_ETHERNET)
+            PacketDecoder::decode(file_->data(frame), frame.captured_length, frame.length, packet);
+        else
+            packet = DecodedPacket();
+
+        contents.offsets_.slot(row) = PacketStore::MAPPED_OFFSET | frame.offset;
+        contents.timestamps_.slot(row) = frame.timestamp_ns;
+        contents.lengths_.slot(row) = frame.length;
+        contents.captured_lengths_.slot(row) = frame.captured_length;
+        contents.flags_.slot(row) = packet.flags;
+        const uint32_t source = address_id(chunk, packet.source_address);
+        const uint32_t dest = address_id(chunk, packet.dest_address);
+        contents.source_addresses_.slot(row) = source;
+        contents.dest_addresses_.slot(row) = dest;
+        contents.source_ports_.slot(row) = packet.source_port;
+        contents.dest_ports_.slot(row) = packet.dest_port;
+
+        // Protocol names are few and static, so compared by pointer.
+        const char* name = PacketDecoder::protocol_name(packet);
+        const size_t protocols = contents.protocol_count();
+        size_t code = 0;
+        while (code < protocols && contents.protocol_names_[code] != name)
+            ++code;
+        const int local = code < protocols ? -1 : local_protocol(chunk, name);
+        contents.protocols_.slot(row) = static_cast<uint8_t>(code < protocols ? code : 0);
+        if (((source | dest) & LOCAL_ID) || local >= 0)
+            chunk.fixups.push_back({row, local});
+        contents.ip_protocols_.slot(row) = packet.ip_protocol;
+        contents.tcp_flags_.slot(row) = packet.tcp_flags;
+        contents.interfaces_.slot(row) = static_cast<uint8_t>(std::min<uint32_t>(frame.interface, 255));
+    }
+}
+
+uint32_t ParallelDissector::address_id(Chunk& chunk, const uint8_t* address) const
+{
+    const uint32_t id = contents_->find_address(address);
+    if (id != PacketStore::NO_ADDRESS)
+        return id;
+
+    const size_t mask = chunk.table.size() - 1;
+    size_t slot = hash_address(address) & mask;
+    for (;; slot = (slot + 1) & mask) {
+        const uint32_t local = chunk.table[slot];
+        if (local == NO_ID)
+            break;
+        if (std::memcmp(chunk.addresses[local].bytes, address, 16) == 0)
+            return LOCAL_ID | local;
+    }
+    const uint32_t local = static_cast<uint32_t>(chunk.addresses.size());
+    chunk.addresses.emplace_back();
+    std::memcpy(chunk.addresses.back().bytes, address, 16);
+    chunk.table[slot] = local;
+    return LOCAL_ID | local;
+}
+
+int ParallelDissector::local_protocol(Chunk& chunk, const char* name) const
+{
+    for (size_t code = 0; code < chunk.protocols.size(); ++code) {
+        if (chunk.protocols[code] == name)
+            return static_cast<int>(code);
+    }
+    if (chunk.protocols.size() == MAX_PROTOCOLS)
+        return static_cast<int>(MAX_PROTOCOLS - 1);
+    chunk.protocols.push_back(name);
+    return static_cast<int>(chunk.protocols.size() - 1);
+}
+
+void ParallelDissector::stitch(Chunk& chunk)
+{
+    PacketStore::Contents& contents = *contents_;
+    address_ids_.resize(chunk.addresses.size());
+    for (size_t id = 0; id < chunk.addresses.size(); ++id)
+        address_ids_[id] = contents.intern_address(chunk.addresses[id].bytes);
+    protocol_codes_.resize(chunk.protocols.size());
+    for (size_t code = 0; code < chunk.protocols.size(); ++code)
+        protocol_codes_[code] = contents.intern_protocol(chunk.protocols[code]);
+
+    for (const Fixup& fixup : chunk.fixups) {
+        uint32_t& source = contents.source_addresses_.slot(fixup.row);
+        uint32_t& dest = contents.dest_addresses_.slot(fixup.row);
+        if (source & LOCAL_ID)
+            source = address_ids_[source & ~LOCAL_ID];
+        if (dest & LOCAL_ID)
+            dest = address_ids_[dest & ~LOCAL_ID];
+        if (fixup.protocol >= 0)
+            contents.protocols_.slot(fixup.row) = protocol_codes_[fixup.protocol];
+    }
+
+    // Publish, as append() does row by row.
+    store_->rows_ = chunk.end;
+    contents.rows_.store(chunk.end, std::memory_order_release);
+    if (chunk.begin % PacketStore::BLOCK_ROWS == 0) {
+        std::lock_guard<std::mutex> lock(store_->mutex_);
+        store_->epochs_.reclaim();
+    }
+}
@@ -0,0 +1,353 @@
+#include "netlyzer/core/row_bitmap.h"
+#include <algorithm>
+#include <iterator>
+
+namespace {
+
+uint16_t low_bits(uint32_t row) { return static_cast<uint16_t>(row & 0xffff); }
+uint16_t high_bits(uint32_t row) { return static_cast<uint16_t>(row >> 16); }
+
+} // namespace
+
+bool RowBitmap::Chunk::contains(uint16_t low) const
+{
+    if (is_bitmap())
+        return (words[low / 64] >> (low % 64)) & 1;
+    return std::binary_search(values.begin(), values.end(), low);
+}
+
+void RowBitmap::Chunk::add(uint16_t low)
+{
+    if (is_bitmap()) {
+        const uint64_t bit = 1ull << (low % 64);
+        if (!(words[low / 64] & bit)) {
+            words[low / 64] |= bit;
+            ++count;
+        }
+        return;
+    }
+    if (values.empty() || values.back() < low) {
+        values.push_back(low);
+    } else {
+        auto at = std::lower_bound(values.begin(), values.end(), low);
+        if (*at == low)
+            return;
+        values.insert(at, low);
+    }
+    if (++count > ARRAY_MAX)
+        to_bitmap();
+}
+
+void RowBitmap::Chunk::to_bitmap()
+{
+    words.assign(WORDS, 0);
+    for (uint16_t low : values)
+        words[low / 64] |= 1ull << (low % 64);
+    values.clear();
+    values.shrink_to_fit();
+}
+
+void RowBitmap::Chunk::shrink()
+{
+    if (!is_bitmap() || count > ARRAY_MAX)
+        return;
+    values.reserve(count);
+    for (size_t word = 0; word < WORDS; ++word) {
+        for (uint64_t bits = words[word]; bits != 0; bits &= bits - 1)
+            values.push_back(static_cast<uint16_t>(word * 64 + __builtin_ctzll(bits)));
+    }
+    words.clear();
+    words.shrink_to_fit();
+}
+
+RowBitmap RowBitmap::range(uint32_t first, uint32_t last)
+{
+    RowBitmap bitmap;
+    while (first < last) {
+        // Up to the end of this chunk, or `last`.
+        const uint32_t end = static_cast<uint32_t>(std::min<uint64_t>(last, (static_cast<uint64_t>(first) | 0xffff) + 1));
+        Chunk chunk;
+        chunk.key = high_bits(first);
+        chunk.count = end - first;
+        if (chunk.count <= ARRAY_MAX) {
+            for (uint32_t row = first; row < end; ++row)
+                chunk.values.push_back(low_bits(row));
+        } else {
+            // Whole words at once, the two ends masked.
+            chunk.words.assign(WORDS, 0);
+            const uint32_t low = low_bits(first);
+            const uint32_t high = low + chunk.count;     // one past, up to 65536
+            for (uint32_t word = low / 64; word * 64 < high; ++word) {
+                uint64_t bits = ~0ull;
+                if (word == low / 64)
+                    bits &= ~0ull << (low % 64);
+                if ((word + 1) * 64 > high)
+                    bits &= ~0ull >> (64 - high % 64);
+                chunk.words[word] = bits;
+            }
+        }
+        bitmap.chunks_.push_back(std::move(chunk));
+        first = end;
+    }
+    return bitmap;
+}
+
+RowBitmap RowBitmap::union_of(const std::vector<const RowBitmap*>& sets)
+{
+    if (sets.size() == 1)
+        return *sets.front();
+    // Every chunk key that occurs is gathered as bits, then shrunk back.
+    std::vector<std::vector<uint64_t>> dense;
+    for (const RowBitmap* set : sets) {
+        for (const Chunk& chunk : set->chunks_) {
+            if (dense.size() <= chunk.key)
+                dense.resize(chunk.key + size_t(1));
+            std::vector<uint64_t>& words = dense[chunk.key];
+            if (words.empty())
+                words.assign(WORDS, 0);
+            if (chunk.is_bitmap()) {
+                for (size_t word = 0; word < WORDS; ++word)
+                    words[word] |= chunk.words[word];
+            } else {
+                for (uint16_t low : chunk.values)
+                    words[low / 64] |= 1ull << (low % 64);
+            }
+        }
+    }
+
+    RowBitmap result;
+    for (size_t key = 0; key < dense.size(); ++key) {
+        if (dense[key].empty())
+            continue;
+        Chunk chunk;
+        chunk.key = static_cast<uint16_t>(key);
+        chunk.words = std::move(dense[key]);
+        for (uint64_t word : chunk.words)
+            chunk.count += static_cast<uint32_t>(__builtin_popcountll(word));
+        chunk.shrink();
+        result.chunks_.push_back(std::move(chunk));
+    }
+    return result;
+}
+
+void RowBitmap::add(uint32_t row)
+{
+    const uint16_t key = high_bits(row);
+    if (chunks_.empty() || chunks_.back().key < key) {
+        chunks_.emplace_back();
+        chunks_.back().key = key;
+        chunks_.back().add(low_bits(row));
+        return;
+    }
+    if (chunks_.back().key == key) {
+        chunks_.back().add(low_bits(row));
+        return;
+    }
+    auto at = std::lower_bound(chunks_.begin(), chunks_.end(), key,
+                               [](const Chunk& chunk, uint16_t k) { return chunk.key < k; });
+    if (at->key != key) {
+        at = chunks_.emplace(at);
+        at->key = key;
+    }
+    at->add(low_bits(row));
+}
+
+void RowBitmap::add_range(uint32_t first, uint32_t last)
+{
+    RowBitmap range = RowBitmap::range(first, last);
+    if (range.empty())
+        return;
+    if (!chunks_.empty() && chunks_.back().key >= range.chunks_.front().key) {
+        *this |= range;
+        return;
+    }
+    for (Chunk& chunk : range.chunks_)
+        chunks_.push_back(std::move(chunk));
+}
+
+bool RowBitmap::contains(uint32_t row) const
+{
+    const uint16_t key = high_bits(row);
+    auto at = std::lower_bound(chunks_.begin(), chunks_.end(), key,
+                               [](const Chunk& chunk, uint16_t k) { return chunk.key < k; });
+    return at != chunks_.end() && at->key == key && at->contains(low_bits(row));
+}
+
+uint64_t RowBitmap::cardinality() const
+{
+    uint64_t total = 0;
+    for (const Chunk& chunk : chunks_)
+        total += chunk.count;
+    return total;
+}
+
+RowBitmap::Chunk RowBitmap::and_chunks(const Chunk& a, const Chunk& b)
+{
+    Chunk result;
+    result.key = a.key;
+    if (a.is_bitmap() && b.is_bitmap()) {
+        result.words.resize(WORDS);
+        for (size_t word = 0; word < WORDS; ++word) {
+            result.words[word] = a.words[word] & b.words[word];
+            result.count += static_cast<uint32_t>(__builtin_popcountll(result.words[word]));
+        }
+        result.shrink();
+    } else if (a.is_bitmap() || b.is_bitmap()) {
+        const Chunk& array = a.is_bitmap() ? b : a;
+        const Chunk& bitmap = a.is_bitmap() ? a : b;
+        for (uint16_t low : array.values) {
+            if (bitmap.contains(low))
+                result.values.push_back(low);
+        }
+        result.count = static_cast<uint32_t>(result.values.size());
+    } else {
+        std::set_intersection(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                              std::back_inserter(result.values));
+        result.count = static_cast<uint32_t>(result.values.size());
+    }
+    return result;
+}
+
+RowBitmap::Chunk RowBitmap::or_chunks(const Chunk& a, const Chunk& b)
+{
+    Chunk result;
+    result.key = a.key;
+    if (!a.is_bitmap() && !b.is_bitmap() && a.count + b.count <= ARRAY_MAX) {
+        std::set_union(a.values.begin(), a.values.end(), b.values.begin(), b.values.end(),
+                       std::back_inserter(result.values));
+        result.count = static_cast<uint32_t>(result.values.size());
+        return result;
+    }
+
+    result.words.assign(WORDS, 0);
+    for (const Chunk* chunk : {&a, &b}) {
+        if (chunk->is_bitmap()) {
+            for (size_t word = 0; word < WORDS; ++word)
+                result.words[word] |= chunk->words[word];
+        } else {
+            for (uint16_t low : chunk->values)
+                result.words[low / 64] |= 1ull << (low % 64);
+        }
+    }
+    for (uint64_t word : result.words)
+        result.count += static_cast<uint32_t>(__builtin_popcountll(word));
+    // Two arrays can overlap enough to fit in one after all.
+    result.shrink();
+    return result;
+}
+
+RowBitmap::Chunk RowBitmap::and_not_chunks(const Chunk& a, const Chunk& b)
+{
+    Chunk result;
+    result.key = a.key;
+    if (a.is_bitmap()) {
+        result.words = a.words;
+        if (b.is_bitmap()) {
+            for (size_t word = 0; word < WORDS; ++word)
+                result.words[word] &= ~b.words[word];
+        } else {
+            for (uint16_t low : b.values)
+                result.words[low / 64] &= ~(1ull << (low % 64));
+        }
+        for (uint64_t word : result.words)
+            result.count += static_cast<uint32_t>(__builtin_popcountll(word));
+        result.shrink();
+    } else {
+        for (uint16_t low : a.values) {
+            if (!b.contains(low))
+                result.values.push_back(low);
+        }
+        result.count = static_cast<uint32_t>(result.values.size());
+    }
+    return result;
+}
+
+RowBitmap RowBitmap::operator&(const RowBitmap& other) const
+{
+    RowBitmap result;
+    auto a = chunks_.begin();
+    auto b = other.chunks_.begin();
+    while (a != chunks_.end() && b != other.chunks_.end()) {
+        if (a->key < b->key) {
+            ++a;
+        } else if (b->key < a->key) {
+            ++b;
+        } else {
+            Chunk chunk = and_chunks(*a++, *b++);
+            if (chunk.count != 0)
+                result.chunks_.push_back(std::move(chunk));
+        }
+    }
+    return result;
+}
+
+RowBitmap RowBitmap::operator|(const RowBitmap& other) const
+{
+    RowBitmap result;
+    result.chunks_.reserve(std::max(chunks_.size(), other.chunks_.size()));
+    auto a = chunks_.begin();
+    auto b = other.chunks_.begin();
+    while (a != chunks_.end() || b != other.chunks_.end()) {
+        if (b == other.chunks_.end() || (a != chunks_.end() && a->key < b->key))
+            result.chunks_.push_back(*a++);
+        else if (a == chunks_.end() || b->key < a->key)
+            result.chunks_.push_back(*b++);
+        else
+            result.chunks_.push_back(or_chunks(*a++, *b++));
+    }
+    return result;
+}
+
+RowBitmap RowBitmap::and_not(const RowBitmap& other) const
+{
+    RowBitmap result;
+    auto b = other.chunks_.begin();
+    for (const Chunk& chunk : chunks_) {
+        while (b != other.chunks_.end() && b->key < chunk.key)
+            ++b;
+        if (b == other.chunks_.end() || b->key != chunk.key) {
+            result.chunks_.push_back(chunk);
+            continue;
+        }
+        Chunk rest = and_not_chunks(chunk, *b);
+        if (rest.count != 0)
+            result.chunks_.push_back(std::move(rest));
+    }
+    return result;
+}
+
+bool RowBitmap::operator==(const RowBitmap& other) const
+{
+    if (chunks_.size() != other.chunks_.size())
+        return false;
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        const Chunk& a = chunks_[i];
+        const Chunk& b = other.chunks_[i];
+        if (a.key != b.key || a.count != b.count)
+            return false;
+        // The same rows may be held either way round.
+        if (a.is_bitmap() == b.is_bitmap()) {
+            if (a.values != b.values || a.words != b.words)
+                return false;
+        } else if (and_chunks(a, b).count != a.count) {
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<uint32_t> RowBitmap::to_vector() const
+{
+    std::vector<uint32_t> rows;
+    rows.reserve(cardinality());
+    for_each([&](uint32_t row) { rows.push_back(row); });
+    return rows;
+}
+
+size_t RowBitmap::memory_bytes() const
+{
+    size_t total = chunks_.capacity() * sizeof(Chunk);
+    for (const Chunk& chunk : chunks_)
+        total += chunk.values.capacity() * sizeof(uint16_t) + chunk.words.capacity() * sizeof(uint64_t);
+    return total;
+}
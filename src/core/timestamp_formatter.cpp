@@ -0,0 +1,131 @@
+#include "netlyzer/core/timestamp_formatter.h"
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+constexpr uint64_t NS_PER_SECOND = 1000000000;
+
+// "00" through "99", so digits are emitted two at a time.
+struct DigitPairs {
+    char pairs[200];
+
+    constexpr DigitPairs() : pairs()
+    {
+        for (int i = 0; i < 100; ++i) {
+            pairs[i * 2] = static_cast<char>('0' + i / 10);
+            pairs[i * 2 + 1] = static_cast<char>('0' + i % 10);
+        }
+    }
+};
+
+constexpr DigitPairs DIGITS;
+
+void write_pair(unsigned value, char* out)
+{
+    std::memcpy(out, DIGITS.pairs + value * 2, 2);
+}
+
+// Writes `value` in decimal with no padding; returns the length.
+size_t write_unsigned(uint64_t value, char* out)
+{
+    char buffer[20];
+    size_t length = 0;
+    while (value >= 100) {
+        length += 2;
+        write_pair(static_cast<unsigned>(value % 100), buffer + sizeof(buffer) - length);
+        value /= 100;
+    }
+    if (value >= 10) {
+        length += 2;
+        write_pair(static_cast<unsigned>(value), buffer + sizeof(buffer) - length);
+    } else {
+        buffer[sizeof(buffer) - ++length] = static_cast<char>('0' + value);
+    }
+    std::memcpy(out, buffer + sizeof(buffer) - length, length);
+    return length;
+}
+
+} // namespace
+
+TimestampFormatter::TimestampFormatter(Mode mode, unsigned digits)
+    : mode_(mode)
+    , digits_(digits > 9 ? 9 : digits)
+    , reference_ns_(0)
+    , cached_second_(-1)
+    , prefix_()
+{
+}
+
+size_t TimestampFormatter::format_fraction(uint32_t nanoseconds, char* out) const
+{
+    if (digits_ == 0)
+        return 0;
+
+    // Nine digits, left padded, then cut to the requested precision.
+    char digits[10];
+    digits[0] = static_cast<char>('0' + nanoseconds / 100000000);
+    uint32_t rest = nanoseconds % 100000000;
+    write_pair(rest / 1000000, digits + 1);
+    write_pair(rest / 10000 % 100, digits + 3);
+    write_pair(rest / 100 % 100, digits + 5);
+    write_pair(rest % 100, digits + 7);
+
+    out[0] = '.';
+    std::memcpy(out + 1, digits, digits_);
+    return digits_ + 1;
+}
+
+size_t TimestampFormatter::format_duration(uint64_t duration_ns, bool negative, char* out) const
+{
+    size_t length = 0;
+    if (negative)
+        out[length++] = '-';
+    length += write_unsigned(duration_ns / NS_PER_SECOND, out + length);
+    length += format_fraction(static_cast<uint32_t>(duration_ns % NS_PER_SECOND), out + length);
+    return length;
+}
+
+size_t TimestampFormatter::format(uint64_t timestamp_ns, uint64_t previous_ns, char* out) const
+{
+    switch (mode_) {
+    case Mode::Relative:
+        if (timestamp_ns < reference_ns_)
+            return format_duration(reference_ns_ - timestamp_ns, true, out);
+        return format_duration(timestamp_ns - reference_ns_, false, out);
+
+    case Mode::Delta:
+        // The first packet, or one that arrived out of order, shows zero.
+        return format_duration(previous_ns != 0 && timestamp_ns > previous_ns
+                               ? timestamp_ns - previous_ns : 0, false, out);
+
+    case Mode::Absolute:
+        break;
+    }
+
+    const int64_t second = static_cast<int64_t>(timestamp_ns / NS_PER_SECOND);
+    if (second != cached_second_) {
+        // localtime_r only runs when the second changes, which at capture
+        // rates means once per thousands of rows.
+        time_t seconds = static_cast<time_t>(second);
+        struct tm local;
+        if (!localtime_r(&seconds, &local))
+            std::memset(&local, 0, sizeof(local));
+        write_pair(static_cast<unsigned>(local.tm_hour), prefix_);
+        prefix_[2] = ':';
+        write_pair(static_cast<unsigned>(local.tm_min), prefix_ + 3);
+        prefix_[5] = ':';
+        write_pair(static_cast<unsigned>(local.tm_sec % 60), prefix_ + 6);
+        cached_second_ = second;
+    }
+
+    std::memcpy(out, prefix_, sizeof(prefix_));
+    return sizeof(prefix_) + format_fraction(static_cast<uint32_t>(timestamp_ns % NS_PER_SECOND),
+                                             out + sizeof(prefix_));
+}
+
+std::string TimestampFormatter::format(uint64_t timestamp_ns, uint64_t previous_ns) const
+{
+    char buffer[MAX_LENGTH];
+    return std::string(buffer, format(timestamp_ns, previous_ns, buffer));
+}
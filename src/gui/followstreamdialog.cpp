@@ -0,0 +1,219 @@
+#include "netlyzer/gui/followstreamdialog.h"
+#include "netlyzer/utils/format.h"
+#include <QVBoxLayout>
+#include <QHBoxLayout>
+#include <QColor>
+#include <QFont>
+#include <QLocale>
+#include <algorithm>
+#include <climits>
+#include <utility>
+
+namespace {
+
+// Wide enough for a terminal-style text line; hex rows follow the hex dump.
+constexpr quint64 ASCII_BYTES_PER_ROW = 64;
+
+QString directionBytes(const QString &from, const QString &to, quint64 bytes)
+{
+    return QString("%1 → %2: %3 bytes").arg(from, to, QLocale().toString(bytes));
+}
+
+} // namespace
+
+StreamPageModel::StreamPageModel(const TcpStreamIndex *index, TcpStreamIndex::FrameSource frames, QObject *parent)
+    : QAbstractListModel(parent)
+    , m_index(index)
+    , m_frames(std::move(frames))
+    , m_mode(Mode::Ascii)
+    , m_rowCount(0)
+{
+    buildRuns();
+}
+
+void StreamPageModel::setMode(Mode mode)
+{
+    if (mode == m_mode) {
+        return;
+    }
+    beginResetModel();
+    m_mode = mode;
+    buildRuns();
+    endResetModel();
+}
+
+void StreamPageModel::buildRuns()
+{
+    // One run per change of direction or gap: a handful per request and
+    // response, never one per byte or row.
+    const quint64 bytesPerRow = m_mode == Mode::HexDump ? netlyzer::HEX_DUMP_BYTES_PER_LINE : ASCII_BYTES_PER_ROW;
+    m_runs.clear();
+    m_rowCount = 0;
+    for (const TcpStreamIndex::Entry &entry : m_index->entries()) {
+        if (m_runs.isEmpty() || entry.gap || m_runs.last().direction != entry.direction) {
+            if (!m_runs.isEmpty()) {
+                m_rowCount += (m_runs.last().length + bytesPerRow - 1) / bytesPerRow;
+            }
+            m_runs.append(Run{entry.position, 0, m_rowCount, entry.direction, entry.gap});
+            if (entry.gap) {
+                ++m_rowCount;
+            }
+        }
+        m_runs.last().length += entry.length;
+    }
+    if (!m_runs.isEmpty()) {
+        m_rowCount += (m_runs.last().length + bytesPerRow - 1) / bytesPerRow;
+    }
+}
+
+int StreamPageModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return static_cast<int>(std::min<quint64>(m_rowCount, INT_MAX));
+}
+
+int StreamPageModel::runForRow(quint64 row) const
+{
+    auto after = std::upper_bound(m_runs.begin(), m_runs.end(), row,
+                                  [](quint64 value, const Run &run) { return value < run.firstRow; });
+    return static_cast<int>(after - m_runs.begin()) - 1;
+}
+
+QString StreamPageModel::rowText(const Run &run, quint64 rowInRun) const
+{
+    const quint64 bytesPerRow = m_mode == Mode::HexDump ? netlyzer::HEX_DUMP_BYTES_PER_LINE : ASCII_BYTES_PER_ROW;
+    const quint64 position = run.position + rowInRun * bytesPerRow;
+    uint8_t bytes[ASCII_BYTES_PER_ROW];
+    const size_t length = m_index->read(position, bytes,
+                                        std::min(bytesPerRow, run.position + run.length - position), m_frames);
+
+    if (m_mode == Mode::HexDump) {
+        char line[netlyzer::HEX_DUMP_LINE_MAX];
+        size_t size = netlyzer::format_hex_dump_line(bytes, length, position, line);
+        if (size > 0 && line[size - 1] == '\n') {
+            --size;
+        }
+        return QString::fromLatin1(line, static_cast<int>(size));
+    }
+
+    char text[ASCII_BYTES_PER_ROW];
+    for (size_t i = 0; i < length; ++i) {
+        text[i] = (bytes[i] >= 0x20 && bytes[i] < 0x7f) ? static_cast<char>(bytes[i]) : '.';
+    }
+    return QString::fromLatin1(text, static_cast<int>(length));
+}
+
+QVariant StreamPageModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || m_runs.isEmpty()) {
+        return QVariant();
+    }
+
+    const quint64 row = static_cast<quint64>(index.row());
+    const int runIndex = runForRow(row);
+    if (runIndex < 0) {
+        return QVariant();
+    }
+    const Run &run = m_runs[runIndex];
+    const bool marker = run.gap && row == run.firstRow;
+
+    switch (role) {
+    case Qt::DisplayRole:
+        if (marker) {
+            return QString("[missing data]");
+        }
+        return rowText(run, row - run.firstRow - (run.gap ? 1 : 0));
+    case Qt::ForegroundRole:
+        if (marker) {
+            return QColor(Qt::darkGray);
+        }
+        return run.direction == 0 ? QColor(0x7f, 0x00, 0x00) : QColor(0x00, 0x00, 0x7f);
+    case Qt::BackgroundRole:
+        if (marker) {
+            return QVariant();
+        }
+        return run.direction == 0 ? QColor(0xfb, 0xed, 0xed) : QColor(0xed, 0xed, 0xfb);
+    case Qt::ToolTipRole:
+        if (marker) {
+            return QString("Bytes here were not captured or were given up on to stay within memory limits");
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+FollowStreamDialog::FollowStreamDialog(TcpStreamIndex index, TcpStreamIndex::FrameSource frames,
+                                       const QString &client, const QString &server, QWidget *parent)
+    : QDialog(parent)
+    , m_index(std::move(index))
+    , m_frames(std::move(frames))
+    , m_client(client)
+    , m_server(server)
+    , m_model(nullptr)
+    , m_view(nullptr)
+    , m_modeCombo(nullptr)
+    , m_summaryLabel(nullptr)
+    , m_closeButton(nullptr)
+{
+    setWindowTitle(QString("Follow TCP Stream (%1 ↔ %2)").arg(client, server));
+    setAttribute(Qt::WA_DeleteOnClose);
+    resize(800, 600);
+
+    setupUI();
+}
+
+FollowStreamDialog::~FollowStreamDialog() = default;
+
+void FollowStreamDialog::setupUI()
+{
+    auto *mainLayout = new QVBoxLayout(this);
+
+    m_model = new StreamPageModel(&m_index, m_frames, this);
+
+    // Uniform rows let the view size its scroll range from rowCount() alone
+    // instead of measuring every row.
+    m_view = new QListView(this);
+    m_view->setModel(m_model);
+    m_view->setUniformItemSizes(true);
+    m_view->setSelectionMode(QAbstractItemView::ExtendedSelection);
+    QFont font("Consolas, Monaco, monospace");
+    font.setPointSize(9);
+    font.setStyleHint(QFont::Monospace);
+    m_view->setFont(font);
+    mainLayout->addWidget(m_view, 1);
+
+    QString summary = directionBytes(m_client, m_server, m_index.bytes(0)) + "    "
+                    + directionBytes(m_server, m_client, m_index.bytes(1));
+    if (m_index.gaps() > 0) {
+        summary += QString("    %1 gaps").arg(m_index.gaps());
+    }
+    m_summaryLabel = new QLabel(summary, this);
+    m_summaryLabel->setStyleSheet("color: #666; margin: 5px 0;");
+    mainLayout->addWidget(m_summaryLabel);
+
+    auto *buttonLayout = new QHBoxLayout();
+
+    m_modeCombo = new QComboBox(this);
+    m_modeCombo->addItem("ASCII");
+    m_modeCombo->addItem("Hex Dump");
+    m_closeButton = new QPushButton("Close", this);
+
+    buttonLayout->addWidget(new QLabel("Show data as", this));
+    buttonLayout->addWidget(m_modeCombo);
+    buttonLayout->addStretch();
+    buttonLayout->addWidget(m_closeButton);
+
+    mainLayout->addLayout(buttonLayout);
+
+    connect(m_modeCombo, QOverload<int>::of(&QComboBox::currentIndexChanged),
+            this, &FollowStreamDialog::onModeChanged);
+    connect(m_closeButton, &QPushButton::clicked, this, &QDialog::close);
+}
+
+void FollowStreamDialog::onModeChanged(int mode)
+{
+    m_model->setMode(mode == 1 ? StreamPageModel::Mode::HexDump : StreamPageModel::Mode::Ascii);
+}
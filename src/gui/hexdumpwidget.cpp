@@ -1,5 +1,6 @@
 #include "netlyzer/gui/hexdumpwidget.h"
 #include <QFont>
+#include "netlyzer/utils/format.h"
 
 HexDumpWidget::HexDumpWidget(QWidget *parent)
     : QWidget(parent)
@@ -44,41 +45,17 @@ void HexDumpWidget::clearData()
 
 QString HexDumpWidget::formatHexDump(const QByteArray &data)
 {
-    QString result;
-    const int bytesPerLine = 16;
-    
-    for (int i = 0; i < data.size(); i += bytesPerLine) {
-        // Offset
-        result += QString("%1  ").arg(i, 4, 16, QChar('0')).toUpper();
-        
-        // Hex bytes
-        QString hexPart;
-        QString asciiPart;
-        
-        for (int j = 0; j < bytesPerLine; ++j) {
-            if (i + j < data.size()) {
-                unsigned char byte = static_cast<unsigned char>(data[i + j]);
-                hexPart += QString("%1 ").arg(byte, 2, 16, QChar('0')).toUpper();
-                
-                // ASCII representation
-                if (byte >= 32 && byte <= 126) {
-                    asciiPart += QChar(byte);
-                } else {
-                    asciiPart += '.';
-                }
-            } else {
-                hexPart += "   ";
-                asciiPart += ' ';
-            }
-            
-            // Add extra space after 8 bytes
-            if (j == 7) {
-                hexPart += " ";
-            }
-        }
-        
-        result += hexPart + " |" + asciiPart + "|\n";
+    // Lines are rendered straight into one Latin-1 buffer and converted to a
+    // QString once, instead of a QString::arg() per byte.
+    const auto *bytes = reinterpret_cast<const uint8_t*>(data.constData());
+    const size_t size = static_cast<size_t>(data.size());
+    const size_t lines = (size + netlyzer::HEX_DUMP_BYTES_PER_LINE - 1) / netlyzer::HEX_DUMP_BYTES_PER_LINE;
+
+    QByteArray text(static_cast<int>(lines * netlyzer::HEX_DUMP_LINE_MAX), Qt::Uninitialized);
+    size_t length = 0;
+    for (size_t offset = 0; offset < size; offset += netlyzer::HEX_DUMP_BYTES_PER_LINE) {
+        length += netlyzer::format_hex_dump_line(bytes + offset, size - offset, offset,
+                                                 text.data() + length);
     }
-    
-    return result;
+    return QString::fromLatin1(text.constData(), static_cast<int>(length));
 }
@@ -25,13 +25,14 @@ void InterfaceDialog::setupUI()
     auto *mainLayout = new QVBoxLayout(this);
     
     // Description
-    auto *titleLabel = new QLabel("Select a network interface to capture packets:", this);
+    auto *titleLabel = new QLabel("Select one or more network interfaces to capture packets:", this);
     titleLabel->setStyleSheet("font-weight: bold; margin-bottom: 10px;");
     mainLayout->addWidget(titleLabel);
     
     // Interface list
     m_interfaceList = new QListWidget(this);
     m_interfaceList->setAlternatingRowColors(true);
+    m_interfaceList->setSelectionMode(QAbstractItemView::ExtendedSelection);
     mainLayout->addWidget(m_interfaceList);
     
     // Description label
@@ -111,23 +112,26 @@ void InterfaceDialog::refreshInterfaces()
 {
     populateInterfaces();
     m_okButton->setEnabled(false);
-    m_selectedInterface.clear();
+    m_selectedInterfaces.clear();
     m_descriptionLabel->setText("Select an interface to see its description.");
 }
 
 void InterfaceDialog::onSelectionChanged()
 {
-    auto *currentItem = m_interfaceList->currentItem();
-    if (currentItem && currentItem->flags() & Qt::ItemIsSelectable) {
-        m_selectedInterface = currentItem->text();
+    m_selectedInterfaces.clear();
+    QStringList descriptions;
+
+    for (auto *item : m_interfaceList->selectedItems()) {
+        if (item->flags() & Qt::ItemIsSelectable) {
+            m_selectedInterfaces << item->text();
+            descriptions << QString("%1: %2").arg(item->text(), item->data(Qt::UserRole).toString());
+        }
+    }
+
+    if (!m_selectedInterfaces.isEmpty()) {
         m_okButton->setEnabled(true);
-        
-        QString description = currentItem->data(Qt::UserRole).toString();
-        m_descriptionLabel->setText(QString("Interface: %1\nDescription: %2")
-                                   .arg(m_selectedInterface)
-                                   .arg(description));
+        m_descriptionLabel->setText(descriptions.join("\n"));
     } else {
-        m_selectedInterface.clear();
         m_okButton->setEnabled(false);
         m_descriptionLabel->setText("Select an interface to see its description.");
     }
@@ -135,5 +139,10 @@ void InterfaceDialog::onSelectionChanged()
 
 QString InterfaceDialog::selectedInterface() const
 {
-    return m_selectedInterface;
+    return m_selectedInterfaces.value(0);
+}
+
+QStringList InterfaceDialog::selectedInterfaces() const
+{
+    return m_selectedInterfaces;
 }
@@ -3,7 +3,12 @@
 #include "netlyzer/gui/packetdetailswidget.h"
 #include "netlyzer/gui/hexdumpwidget.h"
 #include "netlyzer/gui/interfacedialog.h"
+#include "netlyzer/gui/followstreamdialog.h"
+#include "netlyzer/network/capture_file.h"
+#include "netlyzer/network/capture_writer.h"
 #include "netlyzer/network/packet_capture.h"
+#include "netlyzer/network/tcp_reassembler.h"
+#include "netlyzer/core/packet_model.h"
 
 #include <QApplication>
 #include <QMessageBox>
@@ -11,20 +16,74 @@
 #include <QLineEdit>
 #include <QToolButton>
 #include <QProgressBar>
+#include <QDir>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <algorithm>
+#include <map>
+#include <vector>
+
+namespace {
+
+// Capture files are read on the GUI thread, which owns the model, in
+// slices short enough to keep the window responsive; the first slice puts
+// the first screen of rows up before openFile() returns. Later batches are
+// larger, so that each spreads over the dissector's threads.
+const int FILE_SLICE_MS = 50;
+const size_t FIRST_FILE_BATCH = 4096;
+const size_t FILE_BATCH = 32768;
+// Saving goes the same way, in slices of the same length; the clock is read
+// once per batch of rows.
+const size_t SAVE_BATCH = 1024;
+
+// True when row `index` carries the same address and port pair as `selected`,
+// either way round. Reads only the store's columns; addresses are compared
+// by their dictionary ids.
+bool sameConnection(const PacketStore::Contents &store, size_t index, const PacketStore::Row &selected)
+{
+    const quint32 families = DecodedPacket::IPV4 | DecodedPacket::IPV6;
+    if (!(store.flags()[index] & DecodedPacket::TCP)
+        || (store.flags()[index] & families) != (selected.flags() & families)) {
+        return false;
+    }
+    const quint32 source = store.source_addresses()[index];
+    const quint32 dest = store.dest_addresses()[index];
+    const quint16 sourcePort = store.source_ports()[index];
+    const quint16 destPort = store.dest_ports()[index];
+    const quint32 selectedSource = store.source_addresses()[selected.index()];
+    const quint32 selectedDest = store.dest_addresses()[selected.index()];
+    if (source == selectedSource && dest == selectedDest
+        && sourcePort == selected.source_port() && destPort == selected.dest_port()) {
+        return true;
+    }
+    return source == selectedDest && dest == selectedSource
+        && sourcePort == selected.dest_port() && destPort == selected.source_port();
+}
+
+} // namespace
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , m_centralWidget(nullptr)
     , m_mainSplitter(nullptr)
     , m_rightSplitter(nullptr)
+    , m_filterEdit(nullptr)
     , m_packetListWidget(nullptr)
     , m_packetDetailsWidget(nullptr)
     , m_hexDumpWidget(nullptr)
+    , m_profileMenu(nullptr)
+    , m_profileGroup(nullptr)
     , m_statusLabel(nullptr)
     , m_packetCountLabel(nullptr)
     , m_interfaceLabel(nullptr)
     , m_packetCapture(nullptr)
+    , m_packetModel(new PacketModel(this))
     , m_statusTimer(new QTimer(this))
+    , m_fileTimer(new QTimer(this))
+    , m_saveTimer(new QTimer(this))
+    , m_saveRow(0)
+    , m_saveRows(0)
+    , m_selectedPacket(-1)
     , m_isCapturing(false)
     , m_packetCount(0)
 {
@@ -40,10 +99,20 @@ MainWindow::MainWindow(QWidget *parent)
     
     // Initialize packet capture
     m_packetCapture = std::make_unique<PacketCapture>();
+    connect(m_packetCapture.get(), &PacketCapture::packetsCaptured,
+            this, &MainWindow::onPacketsCaptured);
+    loadCaptureProfiles();
     
     // Setup status timer
     m_statusTimer->setInterval(1000); // Update every second
     connect(m_statusTimer, &QTimer::timeout, this, &MainWindow::updateStatus);
+
+    // Zero interval: the next slice of a capture file as soon as the event
+    // loop is idle
+    m_fileTimer->setInterval(0);
+    connect(m_fileTimer, &QTimer::timeout, this, &MainWindow::loadFileFrames);
+    m_saveTimer->setInterval(0);
+    connect(m_saveTimer, &QTimer::timeout, this, &MainWindow::saveFileRows);
 }
 
 MainWindow::~MainWindow() = default;
@@ -59,15 +128,18 @@ void MainWindow::setupUI()
     // Create filter bar
     auto *filterLayout = new QHBoxLayout();
     auto *filterLabel = new QLabel("Filter:", this);
-    auto *filterEdit = new QLineEdit(this);
-    filterEdit->setPlaceholderText("Enter display filter (e.g., tcp.port == 80)");
+    m_filterEdit = new QLineEdit(this);
+    m_filterEdit->setPlaceholderText("Enter display filter (e.g., tcp.port == 80)");
     auto *applyFilterBtn = new QToolButton(this);
     applyFilterBtn->setText("Apply");
     auto *clearFilterBtn = new QToolButton(this);
     clearFilterBtn->setText("Clear");
+    connect(m_filterEdit, &QLineEdit::returnPressed, this, &MainWindow::applyFilter);
+    connect(applyFilterBtn, &QToolButton::clicked, this, &MainWindow::applyFilter);
+    connect(clearFilterBtn, &QToolButton::clicked, this, &MainWindow::clearFilter);
     
     filterLayout->addWidget(filterLabel);
-    filterLayout->addWidget(filterEdit, 1);
+    filterLayout->addWidget(m_filterEdit, 1);
     filterLayout->addWidget(applyFilterBtn);
     filterLayout->addWidget(clearFilterBtn);
     
@@ -78,7 +150,14 @@ void MainWindow::setupUI()
     m_rightSplitter = new QSplitter(Qt::Vertical, this);
     
     // Create widgets
-    m_packetListWidget = new PacketListWidget(this);
+    m_packetListWidget = new PacketListWidget(m_packetModel, this);
+    m_packetListWidget->setInterfaceNames([this](quint8 id) {
+        if (m_captureFile) {
+            return id < m_captureFile->interface_count()
+                ? QString::fromStdString(m_captureFile->interface_name(id)) : QString();
+        }
+        return m_packetCapture ? m_packetCapture->interfaceName(id) : QString();
+    });
     m_packetDetailsWidget = new PacketDetailsWidget(this);
     m_hexDumpWidget = new HexDumpWidget(this);
     
@@ -129,11 +208,19 @@ void MainWindow::setupMenus()
     m_stopCaptureAction->setShortcut(QKeySequence("Ctrl+E"));
     m_stopCaptureAction->setIcon(QIcon(":/icons/stop.png"));
     m_stopCaptureAction->setEnabled(false);
+
+    m_recordAction = new QAction("&Record to File...", this);
+    m_recordAction->setCheckable(true);
     
     captureMenu->addAction(m_selectInterfaceAction);
     captureMenu->addSeparator();
     captureMenu->addAction(m_startCaptureAction);
     captureMenu->addAction(m_stopCaptureAction);
+    captureMenu->addAction(m_recordAction);
+    captureMenu->addSeparator();
+    m_profileMenu = captureMenu->addMenu("&Profile");
+    m_profileGroup = new QActionGroup(this);
+    m_profileGroup->setExclusive(true);
     
     // View menu
     auto *viewMenu = menuBar()->addMenu("&View");
@@ -143,6 +230,25 @@ void MainWindow::setupMenus()
     m_clearPacketsAction->setIcon(QIcon(":/icons/clear.png"));
     
     viewMenu->addAction(m_clearPacketsAction);
+    viewMenu->addSeparator();
+
+    auto *timeMenu = viewMenu->addMenu("&Time Display Format");
+    auto *timeGroup = new QActionGroup(this);
+    const QList<QPair<QString, TimestampFormatter::Mode>> timeModes = {
+        {"&Time of Day", TimestampFormatter::Mode::Absolute},
+        {"Seconds Since &First Packet", TimestampFormatter::Mode::Relative},
+        {"Seconds Since &Previous Packet", TimestampFormatter::Mode::Delta}
+    };
+    for (const auto &timeMode : timeModes) {
+        auto *action = timeMenu->addAction(timeMode.first);
+        action->setCheckable(true);
+        action->setChecked(timeMode.second == TimestampFormatter::Mode::Absolute);
+        timeGroup->addAction(action);
+        const TimestampFormatter::Mode mode = timeMode.second;
+        connect(action, &QAction::triggered, this, [this, mode]() {
+            m_packetListWidget->setTimeDisplayMode(mode);
+        });
+    }
     
     // Statistics menu
     auto *statisticsMenu = menuBar()->addMenu("&Statistics");
@@ -152,6 +258,15 @@ void MainWindow::setupMenus()
     
     statisticsMenu->addAction(m_statisticsAction);
     
+    // Analyze menu
+    auto *analyzeMenu = menuBar()->addMenu("&Analyze");
+    
+    m_followStreamAction = new QAction("Follow &TCP Stream", this);
+    m_followStreamAction->setShortcut(QKeySequence("Ctrl+Alt+Shift+T"));
+    m_followStreamAction->setEnabled(false);
+    
+    analyzeMenu->addAction(m_followStreamAction);
+    
     // Help menu
     auto *helpMenu = menuBar()->addMenu("&Help");
     
@@ -194,25 +309,92 @@ void MainWindow::connectSignals()
     connect(m_selectInterfaceAction, &QAction::triggered, this, &MainWindow::selectInterface);
     connect(m_openFileAction, &QAction::triggered, this, &MainWindow::openFile);
     connect(m_saveFileAction, &QAction::triggered, this, &MainWindow::saveFile);
+    connect(m_recordAction, &QAction::toggled, this, &MainWindow::selectRecordFile);
     connect(m_clearPacketsAction, &QAction::triggered, this, &MainWindow::clearPackets);
     connect(m_statisticsAction, &QAction::triggered, this, &MainWindow::showStatistics);
+    connect(m_followStreamAction, &QAction::triggered, this, &MainWindow::followTcpStream);
     connect(m_aboutAction, &QAction::triggered, this, &MainWindow::showAbout);
     connect(m_exitAction, &QAction::triggered, this, &QWidget::close);
+    
+    // Packet selection
+    connect(m_packetListWidget, &PacketListWidget::packetSelected, this, &MainWindow::onPacketSelected);
+    connect(m_profileGroup, &QActionGroup::triggered, this, &MainWindow::selectCaptureProfile);
+}
+
+void MainWindow::loadCaptureProfiles()
+{
+    // config.json is looked up in the working directory first, then next to
+    // the executable, so both source-tree runs and installs find it.
+    QStringList candidates = {
+        QDir::current().filePath("config.json"),
+        QDir(QCoreApplication::applicationDirPath()).filePath("config.json")
+    };
+    for (const QString &path : candidates) {
+        if (!QFileInfo::exists(path)) {
+            continue;
+        }
+        if (!m_captureProfiles.load_file(path.toStdString())) {
+            QMessageBox::warning(this, "Configuration",
+                QString("Ignoring capture profiles in %1:\n%2")
+                    .arg(path, QString::fromStdString(m_captureProfiles.last_error())));
+        }
+        break;
+    }
+
+    const std::string current = m_captureProfiles.default_profile().name;
+    for (const std::string &name : m_captureProfiles.names()) {
+        auto *action = m_profileMenu->addAction(QString::fromStdString(name));
+        action->setCheckable(true);
+        action->setChecked(name == current);
+        m_profileGroup->addAction(action);
+    }
+    m_packetCapture->setCaptureProfile(m_captureProfiles.default_profile());
+}
+
+void MainWindow::selectCaptureProfile(QAction *action)
+{
+    const CaptureProfile *profile = m_captureProfiles.find(action->text().toStdString());
+    if (profile && m_packetCapture) {
+        m_packetCapture->setCaptureProfile(*profile);
+        m_statusLabel->setText(QString("Capture profile: %1").arg(action->text()));
+    }
 }
 
 void MainWindow::startCapture()
 {
-    if (m_currentInterface.isEmpty()) {
+    if (m_currentInterfaces.isEmpty()) {
         selectInterface();
         return;
     }
     
-    if (m_packetCapture && m_packetCapture->startCapture(m_currentInterface)) {
+    // Packet numbers restart with every capture, under the memory budget of
+    // the profile about to be used
+    if (m_packetCapture) {
+        const CaptureProfile &profile = m_packetCapture->captureProfile();
+        PacketStore::Config storeConfig;
+        storeConfig.memory_budget = static_cast<size_t>(profile.packet_memory_mb) << 20;
+        storeConfig.spill_directory = profile.spill_directory;
+        PacketStore::parse_codec(profile.packet_compression, storeConfig.codec);
+        m_packetModel->setStoreConfig(storeConfig);
+    }
+    clearPackets();
+    
+    if (m_packetCapture && m_packetCapture->startCapture(m_currentInterfaces)) {
         m_isCapturing = true;
         m_startCaptureAction->setEnabled(false);
         m_stopCaptureAction->setEnabled(true);
-        m_statusLabel->setText("Capturing packets...");
+        m_profileMenu->setEnabled(false);
+        m_recordAction->setEnabled(false);
+        if (m_packetCapture->isRecording()) {
+            m_statusLabel->setText(QString("Capturing packets, recording to %1...")
+                                   .arg(QFileInfo(m_packetCapture->recordPath()).fileName()));
+        } else {
+            m_statusLabel->setText("Capturing packets...");
+        }
         m_statusTimer->start();
+    } else if (m_packetCapture && !m_packetCapture->recordingError().isEmpty()) {
+        QMessageBox::critical(this, "Error", QString("Cannot record the capture:\n%1")
+                              .arg(m_packetCapture->recordingError()));
     } else {
         QMessageBox::critical(this, "Error", "Failed to start packet capture!");
     }
@@ -227,16 +409,19 @@ void MainWindow::stopCapture()
     m_isCapturing = false;
     m_startCaptureAction->setEnabled(true);
     m_stopCaptureAction->setEnabled(false);
+    m_profileMenu->setEnabled(true);
+    m_recordAction->setEnabled(true);
     m_statusLabel->setText("Capture stopped");
     m_statusTimer->stop();
+    updateStatus();
 }
 
 void MainWindow::selectInterface()
 {
     InterfaceDialog dialog(this);
     if (dialog.exec() == QDialog::Accepted) {
-        m_currentInterface = dialog.selectedInterface();
-        m_interfaceLabel->setText(QString("Interface: %1").arg(m_currentInterface));
+        m_currentInterfaces = dialog.selectedInterfaces();
+        m_interfaceLabel->setText(QString("Interface: %1").arg(m_currentInterfaces.join(", ")));
     }
 }
 
@@ -245,28 +430,217 @@ void MainWindow::openFile()
     QString fileName = QFileDialog::getOpenFileName(this,
         "Open Capture File", "", "PCAP Files (*.pcap *.pcapng);;All Files (*)");
     
-    if (!fileName.isEmpty()) {
-        // TODO: Implement file opening
-        m_statusLabel->setText(QString("Opened: %1").arg(fileName));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    auto file = std::make_unique<CaptureFile>();
+    if (!file->open(fileName.toStdString())) {
+        QMessageBox::critical(this, "Error", QString("Cannot open %1:\n%2")
+                              .arg(fileName, QString::fromStdString(file->last_error())));
+        return;
+    }
+    if (m_isCapturing) {
+        stopCapture();
+    }
+
+    // Rows point into the file's mapping rather than holding copies of its
+    // bytes, so the store keeps the mapping for as long as they do
+    PacketStore::Config storeConfig;
+    storeConfig.mapped_file = file->mapping();
+    m_packetModel->setStoreConfig(storeConfig);
+    clearPackets();
+
+    m_captureFile = std::move(file);
+    m_fileLoadTime.start();
+    m_interfaceLabel->setText(QString("File: %1").arg(QFileInfo(fileName).fileName()));
+    loadFileFrames();
+    if (m_captureFile && !m_captureFile->done()) {
+        m_fileTimer->start();
+    }
+}
+
+void MainWindow::loadFileFrames()
+{
+    if (!m_captureFile) {
+        m_fileTimer->stop();
+        return;
+    }
+
+    QElapsedTimer slice;
+    slice.start();
+    std::vector<CaptureFile::Frame> frames(FILE_BATCH);
+    while (!m_captureFile->done() && slice.elapsed() < FILE_SLICE_MS) {
+        const size_t batch = m_packetModel->getPacketCount() == 0 ? FIRST_FILE_BATCH : FILE_BATCH;
+        const size_t count = m_captureFile->read(frames.data(), batch);
+        if (count == 0) {
+            break;
+        }
+        m_packetModel->addFileFrames(*m_captureFile, frames.data(), count);
+        m_packetListWidget->addPackets();
+    }
+
+    m_packetCount = m_packetModel->getPacketCount();
+    m_packetCountLabel->setText(QString("Packets: %1").arg(m_packetCount));
+    const int percent = m_captureFile->size()
+        ? static_cast<int>(m_captureFile->position() * 100 / m_captureFile->size()) : 100;
+    if (!m_captureFile->done()) {
+        m_statusLabel->setText(QString("Loading... %1%").arg(percent));
+        return;
+    }
+
+    m_fileTimer->stop();
+    if (m_captureFile->truncated()) {
+        m_statusLabel->setText(QString("Loaded %1 packets; stopped at %2% (%3)")
+                               .arg(m_packetCount).arg(percent)
+                               .arg(QString::fromStdString(m_captureFile->last_error())));
+    } else {
+        m_statusLabel->setText(QString("Loaded %1 packets in %2 ms")
+                               .arg(m_packetCount).arg(m_fileLoadTime.elapsed()));
     }
 }
 
+void MainWindow::stopFileLoading()
+{
+    m_fileTimer->stop();
+    m_captureFile.reset();
+}
+
 void MainWindow::saveFile()
 {
+    if (m_saveWriter) {
+        return;
+    }
     QString fileName = QFileDialog::getSaveFileName(this,
-        "Save Capture File", "", "PCAP Files (*.pcap);;All Files (*)");
+        "Save Capture File", "", "PCAP Files (*.pcap);;PCAPNG Files (*.pcapng);;All Files (*)");
     
-    if (!fileName.isEmpty()) {
-        // TODO: Implement file saving
-        m_statusLabel->setText(QString("Saved: %1").arg(fileName));
+    if (fileName.isEmpty()) {
+        return;
+    }
+
+    // The rows go out through the writer that records live captures, which
+    // here waits for the disk instead of dropping
+    CaptureWriter::Config config;
+    config.path = fileName.toStdString();
+    config.format = fileName.endsWith(".pcapng", Qt::CaseInsensitive)
+        ? CaptureWriter::Format::PcapNg : CaptureWriter::Format::Pcap;
+    config.drop_when_full = false;
+    if (m_captureFile) {
+        for (size_t i = 0; i < m_captureFile->interface_count(); ++i) {
+            config.interfaces.push_back({m_captureFile->interface_name(i), m_captureFile->link_type(i)});
+        }
+    } else {
+        config.interfaces = m_packetCapture->capturedInterfaces();
+    }
+
+    auto writer = std::make_unique<CaptureWriter>();
+    if (!writer->open(config)) {
+        QMessageBox::critical(this, "Error", QString("Cannot save %1:\n%2")
+                              .arg(fileName, QString::fromStdString(writer->last_error())));
+        return;
     }
+    m_saveWriter = std::move(writer);
+    m_saveFileName = fileName;
+    m_saveRow = 0;
+    m_saveRows = static_cast<size_t>(m_packetModel->getPacketCount());
+    m_saveTime.start();
+    m_saveFileAction->setEnabled(false);
+    saveFileRows();
+    if (m_saveWriter) {
+        m_saveTimer->start();
+    }
+}
+
+void MainWindow::saveFileRows()
+{
+    if (!m_saveWriter) {
+        m_saveTimer->stop();
+        return;
+    }
+
+    QElapsedTimer slice;
+    slice.start();
+    {
+        // Pinned for this slice, so spilled rows stay mapped while they are
+        // copied out
+        const PacketStore::Snapshot snapshot = m_packetModel->store().snapshot();
+        while (m_saveRow < m_saveRows && slice.elapsed() < FILE_SLICE_MS) {
+            const size_t end = std::min(m_saveRows, m_saveRow + SAVE_BATCH);
+            for (; m_saveRow < end; ++m_saveRow) {
+                const PacketStore::Row row = (*snapshot)[m_saveRow];
+                const uint8_t *data = row.data();
+                const uint32_t caplen = data ? row.captured_length() : 0;
+                // A reassembled datagram holds more bytes than the fragment
+                // that completed it had on the wire; it goes out as if it
+                // had been captured whole, as Row::decode() reads it.
+                const uint32_t length = row.has(DecodedPacket::REASSEMBLED) ? caplen : row.length();
+                m_saveWriter->write(row.timestamp_ns(), length, row.interface_id(), data, caplen);
+            }
+        }
+    }
+
+    if (m_saveRow < m_saveRows) {
+        m_statusLabel->setText(QString("Saving... %1%").arg(m_saveRow * 100 / m_saveRows));
+        return;
+    }
+    finishSaving();
+}
+
+void MainWindow::finishSaving()
+{
+    m_saveTimer->stop();
+    if (!m_saveWriter) {
+        return;
+    }
+    m_saveWriter->close();
+    const CaptureWriter::Statistics stats = m_saveWriter->get_statistics();
+    m_saveWriter.reset();
+    m_saveFileAction->setEnabled(true);
+
+    if (stats.write_errors > 0) {
+        QMessageBox::critical(this, "Error", QString("Writing %1 failed; the file is incomplete.")
+                              .arg(m_saveFileName));
+        return;
+    }
+    if (m_saveRow < m_saveRows) {
+        m_statusLabel->setText(QString("Saving stopped after %1 of %2 packets; %3 is incomplete")
+                               .arg(m_saveRow).arg(m_saveRows).arg(QFileInfo(m_saveFileName).fileName()));
+        return;
+    }
+    m_statusLabel->setText(QString("Saved %1 packets to %2 in %3 ms")
+                           .arg(stats.packets).arg(QFileInfo(m_saveFileName).fileName())
+                           .arg(m_saveTime.elapsed()));
+}
+
+void MainWindow::selectRecordFile(bool enabled)
+{
+    if (!enabled) {
+        m_packetCapture->setRecordPath(QString());
+        m_recordAction->setText("&Record to File...");
+        return;
+    }
+    const QString fileName = QFileDialog::getSaveFileName(this,
+        "Record Capture To", "", "PCAP Files (*.pcap);;PCAPNG Files (*.pcapng);;All Files (*)");
+    if (fileName.isEmpty()) {
+        m_recordAction->setChecked(false);
+        return;
+    }
+    m_packetCapture->setRecordPath(fileName);
+    m_recordAction->setText(QString("&Record to %1").arg(QFileInfo(fileName).fileName()));
+    m_statusLabel->setText(QString("The next capture is recorded to %1").arg(fileName));
 }
 
 void MainWindow::clearPackets()
 {
+    // The rows still to save go with the store
+    finishSaving();
+    stopFileLoading();
     m_packetListWidget->clearPackets();
     m_packetDetailsWidget->clearDetails();
     m_hexDumpWidget->clearData();
+    m_packetModel->clearPackets();
+    m_selectedPacket = -1;
+    m_followStreamAction->setEnabled(false);
     m_packetCount = 0;
     updateStatus();
 }
@@ -277,6 +651,74 @@ void MainWindow::showStatistics()
     QMessageBox::information(this, "Statistics", "Statistics feature coming soon!");
 }
 
+void MainWindow::followTcpStream()
+{
+    const PacketStore::Contents &store = m_packetModel->store().contents();
+    if (m_selectedPacket < 0 || m_selectedPacket >= m_packetModel->getPacketCount()) {
+        return;
+    }
+    const PacketStore::Row selected = m_packetModel->row(m_selectedPacket);
+    if (!selected.has(DecodedPacket::TCP)) {
+        return;
+    }
+
+    // Only this connection's packets are decoded again and go through the
+    // reassembler, straight from the store's bytes. Its chunks are indexed
+    // per stream so that a port pair reused after a close stays apart; the
+    // index records frame numbers and offsets, and the dialog reads the
+    // bytes back from the store as it renders them.
+    std::map<quint64, TcpStreamIndex> streams;
+    TcpReassembler reassembler([&streams](const TcpReassembler::Chunk &chunk) {
+        streams[chunk.stream].append(chunk);
+    });
+    quint64 followed = 0;
+    DecodedPacket decoded;
+    for (size_t i = 0; i < store.size(); ++i) {
+        if (!sameConnection(store, i, selected)) {
+            continue;
+        }
+        const PacketStore::Row row = store.row(i);
+        row.decode(decoded);
+        const uint8_t *bytes = row.data();
+        if (!bytes) {
+            continue;
+        }
+        const quint64 stream = reassembler.add(bytes, row.captured_length(), decoded, row.number(),
+                                               row.timestamp_ns());
+        if (static_cast<int>(i) == m_selectedPacket) {
+            followed = stream;
+        }
+    }
+    reassembler.flush();
+
+    TcpStreamIndex &index = streams[followed];
+    if (index.size() == 0) {
+        QMessageBox::information(this, "Follow TCP Stream", "This TCP stream carries no data.");
+        return;
+    }
+
+    // Name the endpoints after the first data packet; direction 0 is the side
+    // that opened the connection.
+    PacketRecord opener;
+    m_packetModel->getPacket(static_cast<int>(index.entries().front().packet_id) - 1, opener);
+    const bool openerSent = index.entries().front().direction == 0;
+    const QString source = QString("%1:%2").arg(PacketCapture::formatSource(opener)).arg(opener.decoded.source_port);
+    const QString dest = QString("%1:%2").arg(PacketCapture::formatDestination(opener)).arg(opener.decoded.dest_port);
+
+    // Frame numbers only mean this capture; the dialog goes with it.
+    const PacketModel *model = m_packetModel;
+    auto frames = [model](uint64_t number) -> const uint8_t * {
+        if (number == 0 || number > static_cast<uint64_t>(model->getPacketCount())) {
+            return nullptr;
+        }
+        return model->row(static_cast<int>(number - 1)).data();
+    };
+    auto *dialog = new FollowStreamDialog(std::move(index), frames, openerSent ? source : dest,
+                                          openerSent ? dest : source, this);
+    connect(m_packetModel, &PacketModel::packetsCleared, dialog, &QDialog::close);
+    dialog->show();
+}
+
 void MainWindow::showAbout()
 {
     QMessageBox::about(this, "About NetLyzer",
@@ -294,7 +736,33 @@ void MainWindow::showAbout()
 
 void MainWindow::applyFilter()
 {
-    // TODO: Implement filtering
+    const QString text = m_filterEdit->text().trimmed();
+    if (text.isEmpty()) {
+        clearFilter();
+        return;
+    }
+
+    // Display filters resolve through the index; anything else is searched
+    // for in the list's text, as before.
+    if (!m_displayFilter.parse(text.toStdString())) {
+        m_packetListWidget->applyFilter(text);
+        m_statusLabel->setText(QString("Searching packet text (%1)")
+                                   .arg(QString::fromStdString(m_displayFilter.last_error())));
+        return;
+    }
+    QElapsedTimer timer;
+    timer.start();
+    const RowBitmap rows = m_packetModel->filterRows(m_displayFilter);
+    const qint64 resolvedMs = timer.elapsed();
+    m_packetListWidget->setDisplayFilter(m_displayFilter, rows);
+    m_statusLabel->setText(QString("Filter matched %1 of %2 packets (%3 ms)")
+                               .arg(rows.cardinality()).arg(m_packetModel->getPacketCount()).arg(resolvedMs));
+}
+
+void MainWindow::clearFilter()
+{
+    m_filterEdit->clear();
+    m_packetListWidget->applyFilter(QString());
 }
 
 void MainWindow::updateStatus()
@@ -302,5 +770,61 @@ void MainWindow::updateStatus()
     if (m_packetCapture) {
         m_packetCount = m_packetCapture->getPacketCount();
         m_packetCountLabel->setText(QString("Packets: %1").arg(m_packetCount));
+
+        // Per-interface drops, so a single overloaded NIC is easy to spot
+        QStringList drops;
+        for (const auto &stats : m_packetCapture->interfaceStatistics()) {
+            quint64 total = stats.dropped + stats.interfaceDropped + stats.queueDropped;
+            drops << QString("%1: %2 dropped").arg(stats.name).arg(total);
+        }
+        // The disk falling behind drops packets from the recording only
+        const CaptureWriter::Statistics recording = m_packetCapture->recordingStatistics();
+        if (recording.files > 0) {
+            drops << QString("Recorded %1 packets, %2 MB in %3 files; %4 not written, %5 write errors")
+                         .arg(recording.packets).arg(recording.bytes >> 20).arg(recording.files)
+                         .arg(recording.dropped_packets).arg(recording.write_errors);
+        }
+        if (!drops.isEmpty()) {
+            m_interfaceLabel->setToolTip(drops.join("\n"));
+        }
+    }
+
+    const PacketStore::Statistics store = m_packetModel->storeStatistics();
+    QStringList storeLines;
+    if (store.compressed_segments > 0) {
+        storeLines << QString("Packet bytes compressed %1:1, %2 us mean block decode")
+                          .arg(static_cast<double>(store.uncompressed_bytes) / qMax<quint64>(store.compressed_bytes, 1), 0, 'f', 1)
+                          .arg(store.block_decodes ? store.decode_ns / store.block_decodes / 1000 : 0);
+    }
+    if (store.spilled_segments > 0 || store.spill_errors > 0) {
+        storeLines << QString("%1 MB in memory, %2 MB spilled to disk\n%3 page-ins, %4 us worst\n%5 spill errors")
+                          .arg(store.resident_bytes >> 20).arg(store.spilled_bytes >> 20)
+                          .arg(store.page_ins).arg(store.max_page_in_ns / 1000).arg(store.spill_errors);
+    }
+    if (!storeLines.isEmpty()) {
+        m_packetCountLabel->setToolTip(storeLines.join("\n"));
+    }
+}
+
+void MainWindow::onPacketsCaptured(const QVector<PacketRecord> &records)
+{
+    // Rows are numbered by their place in the model, which is also how
+    // onPacketSelected finds them again.
+    m_packetModel->addPackets(records);
+    // The list decides only the new rows against its filter.
+    m_packetListWidget->addPackets();
+}
+
+void MainWindow::onPacketSelected(int packetNumber)
+{
+    int index = packetNumber - 1;
+    PacketRecord record;
+    if (!m_packetModel->getPacket(index, record)) {
+        return;
     }
+
+    m_selectedPacket = index;
+    m_followStreamAction->setEnabled(record.decoded.has(DecodedPacket::TCP));
+    m_packetDetailsWidget->showPacketDetails(record);
+    m_hexDumpWidget->showHexData(PacketCapture::packetData(record));
 }
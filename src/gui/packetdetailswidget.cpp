@@ -1,6 +1,7 @@
 #include "netlyzer/gui/packetdetailswidget.h"
 #include <QHeaderView>
 #include <QFont>
+#include "netlyzer/utils/format.h"
 
 PacketDetailsWidget::PacketDetailsWidget(QWidget *parent)
     : QWidget(parent)
@@ -39,43 +40,116 @@ void PacketDetailsWidget::setupUI()
     m_layout->addWidget(m_treeView);
 }
 
-void PacketDetailsWidget::showPacketDetails(int packetNumber)
+void PacketDetailsWidget::showPacketDetails(const PacketRecord &record)
 {
     clearDetails();
-    
-    // TODO: Get actual packet data and parse it
-    // For now, show sample data
-    
-    auto *frameItem = new QStandardItem(QString("Frame %1").arg(packetNumber));
-    frameItem->appendRow({new QStandardItem("Frame Length"), new QStandardItem("64 bytes")});
-    frameItem->appendRow({new QStandardItem("Capture Length"), new QStandardItem("64 bytes")});
-    frameItem->appendRow({new QStandardItem("Arrival Time"), new QStandardItem("2024-01-01 12:00:00.123456")});
-    m_model->appendRow(frameItem);
-    
-    auto *ethItem = new QStandardItem("Ethernet II");
-    ethItem->appendRow({new QStandardItem("Destination"), new QStandardItem("aa:bb:cc:dd:ee:ff")});
-    ethItem->appendRow({new QStandardItem("Source"), new QStandardItem("11:22:33:44:55:66")});
-    ethItem->appendRow({new QStandardItem("Type"), new QStandardItem("IPv4 (0x0800)")});
-    m_model->appendRow(ethItem);
-    
-    auto *ipItem = new QStandardItem("Internet Protocol Version 4");
-    ipItem->appendRow({new QStandardItem("Version"), new QStandardItem("4")});
-    ipItem->appendRow({new QStandardItem("Header Length"), new QStandardItem("20 bytes")});
-    ipItem->appendRow({new QStandardItem("Total Length"), new QStandardItem("52")});
-    ipItem->appendRow({new QStandardItem("Protocol"), new QStandardItem("TCP (6)")});
-    ipItem->appendRow({new QStandardItem("Source Address"), new QStandardItem("192.168.1.100")});
-    ipItem->appendRow({new QStandardItem("Destination Address"), new QStandardItem("192.168.1.1")});
-    m_model->appendRow(ipItem);
-    
-    auto *tcpItem = new QStandardItem("Transmission Control Protocol");
-    tcpItem->appendRow({new QStandardItem("Source Port"), new QStandardItem("12345")});
-    tcpItem->appendRow({new QStandardItem("Destination Port"), new QStandardItem("80")});
-    tcpItem->appendRow({new QStandardItem("Sequence Number"), new QStandardItem("1234567890")});
-    tcpItem->appendRow({new QStandardItem("Flags"), new QStandardItem("0x018 (PSH, ACK)")});
-    tcpItem->appendRow({new QStandardItem("Window Size"), new QStandardItem("65535")});
-    m_model->appendRow(tcpItem);
-    
-    // Expand all items
+
+    const DecodedPacket &decoded = record.decoded;
+    const QByteArray data = PacketCapture::packetData(record);
+    const uint8_t *bytes = reinterpret_cast<const uint8_t *>(data.constData());
+
+    QStringList frame = {"Frame Length", QString("%1 bytes").arg(record.length)};
+    if (decoded.has(DecodedPacket::REASSEMBLED)) {
+        // Everything below describes the whole datagram this fragment completed.
+        frame << "Reassembled Length" << QString("%1 bytes").arg(decoded.wire_length);
+    } else {
+        frame << "Capture Length" << QString("%1 bytes").arg(decoded.captured_length);
+    }
+    addProtocolLayer(QString("Frame %1").arg(record.number), frame);
+
+    if (data.size() >= 14) {
+        char dest[netlyzer::MAC_STRING_LENGTH];
+        char source[netlyzer::MAC_STRING_LENGTH];
+        QStringList fields = {
+            "Destination", QString::fromLatin1(dest, static_cast<int>(netlyzer::format_mac(bytes, dest))),
+            "Source", QString::fromLatin1(source, static_cast<int>(netlyzer::format_mac(bytes + 6, source))),
+        };
+        if (decoded.has(DecodedPacket::VLAN)) {
+            fields << "VLAN ID" << QString::number(decoded.vlan_id)
+                   << "VLAN Tags" << QString::number(decoded.vlan_count);
+        }
+        fields << "Type" << QString("0x%1").arg(decoded.ethertype, 4, 16, QChar('0'));
+        addProtocolLayer("Ethernet II", fields);
+    }
+
+    if (decoded.tunnel_depth > 0) {
+        const bool vxlan = decoded.has(DecodedPacket::VXLAN);
+        addProtocolLayer(vxlan ? "Virtual eXtensible LAN" : "Generic Routing Encapsulation", {
+            vxlan ? "VXLAN Network Identifier" : "Key", QString::number(decoded.tunnel_id),
+            "Outer Header Offset", QString::number(decoded.outer_network_offset),
+            "Tunnel Depth", QString::number(decoded.tunnel_depth),
+        });
+    }
+
+    const QString source = PacketCapture::formatSource(record);
+    const QString destination = PacketCapture::formatDestination(record);
+
+    if (decoded.has(DecodedPacket::ARP)) {
+        addProtocolLayer("Address Resolution Protocol", {
+            "Opcode", QString::number(decoded.arp_operation),
+            "Sender IP Address", source,
+            "Target IP Address", destination,
+        });
+    } else if (decoded.is_ip()) {
+        const bool v4 = decoded.has(DecodedPacket::IPV4);
+        QStringList fields = {
+            "Version", v4 ? "4" : "6",
+            v4 ? "Time to Live" : "Hop Limit", QString::number(decoded.ttl),
+            "Protocol", QString::number(decoded.ip_protocol),
+            "Source Address", source,
+            "Destination Address", destination,
+        };
+        if (decoded.has(DecodedPacket::FRAGMENT)) {
+            fields << "Fragment" << "yes";
+        }
+        addProtocolLayer(v4 ? "Internet Protocol Version 4" : "Internet Protocol Version 6", fields);
+    }
+
+    if (decoded.has(DecodedPacket::TCP)) {
+        addProtocolLayer("Transmission Control Protocol", {
+            "Source Port", QString::number(decoded.source_port),
+            "Destination Port", QString::number(decoded.dest_port),
+            "Sequence Number", QString::number(decoded.tcp_sequence),
+            "Acknowledgment Number", QString::number(decoded.tcp_acknowledgment),
+            "Flags", QString("0x%1").arg(decoded.tcp_flags, 3, 16, QChar('0')),
+            "Window Size", QString::number(decoded.tcp_window),
+            "Payload Length", QString::number(decoded.payload_length),
+        });
+    } else if (decoded.has(DecodedPacket::UDP)) {
+        addProtocolLayer("User Datagram Protocol", {
+            "Source Port", QString::number(decoded.source_port),
+            "Destination Port", QString::number(decoded.dest_port),
+            "Payload Length", QString::number(decoded.payload_length),
+        });
+    } else if (decoded.has(DecodedPacket::ICMP) || decoded.has(DecodedPacket::ICMPV6)) {
+        addProtocolLayer(decoded.has(DecodedPacket::ICMP) ? "Internet Control Message Protocol"
+                                                          : "Internet Control Message Protocol v6", {
+            "Type", QString::number(decoded.icmp_type),
+            "Code", QString::number(decoded.icmp_code),
+        });
+    }
+
+    QStringList expert;
+    if (decoded.has(DecodedPacket::TRUNCATED) || decoded.has(DecodedPacket::MALFORMED)) {
+        expert << "Warning" << (decoded.has(DecodedPacket::TRUNCATED) ? "Header truncated by capture length"
+                                                                       : "Malformed header");
+    }
+    if (decoded.has(DecodedPacket::BAD_IP_CHECKSUM)) {
+        expert << "Error" << "Bad IPv4 header checksum";
+    }
+    if (decoded.has(DecodedPacket::BAD_L4_CHECKSUM)) {
+        expert << "Error" << "Bad transport checksum";
+    }
+    if (decoded.has(DecodedPacket::CHECKSUM_OFFLOAD)) {
+        expert << "Note" << "Transport checksum left to NIC offload";
+    }
+    if (decoded.has(DecodedPacket::REASSEMBLED)) {
+        expert << "Note" << "Reassembled from IP fragments";
+    }
+    if (!expert.isEmpty()) {
+        addProtocolLayer("Expert Info", expert);
+    }
+
     m_treeView->expandAll();
 }
 
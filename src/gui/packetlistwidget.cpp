@@ -1,12 +1,472 @@
 #include "netlyzer/gui/packetlistwidget.h"
+#include "netlyzer/core/packet_model.h"
+#include "netlyzer/network/packet_capture.h"
 #include <QHeaderView>
 #include <QFont>
+#include <QColor>
+#include <QStyledItemDelegate>
+#include <algorithm>
+#include <numeric>
+#include <utility>
 
-PacketListWidget::PacketListWidget(QWidget *parent)
+namespace {
+
+const char *const COLUMN_NAMES[PacketTableModel::ColumnCount] = {
+    "No.", "Time", "Interface", "Source", "Destination", "Protocol", "Length", "Info"
+};
+
+class TimestampDelegate : public QStyledItemDelegate
+{
+public:
+    TimestampDelegate(const TimestampFormatter *formatter, QObject *parent)
+        : QStyledItemDelegate(parent)
+        , m_formatter(formatter)
+    {
+    }
+
+protected:
+    void initStyleOption(QStyleOptionViewItem *option, const QModelIndex &index) const override
+    {
+        QStyledItemDelegate::initStyleOption(option, index);
+        char text[TimestampFormatter::MAX_LENGTH];
+        size_t length = m_formatter->format(index.data(Qt::DisplayRole).toULongLong(),
+                                            index.data(PacketTableModel::PreviousTimestampRole).toULongLong(),
+                                            text);
+        option->text = QString::fromLatin1(text, static_cast<int>(length));
+    }
+
+private:
+    const TimestampFormatter *m_formatter;
+};
+
+template <typename T>
+int compareValues(T a, T b)
+{
+    return a < b ? -1 : (b < a ? 1 : 0);
+}
+
+} // namespace
+
+PacketTableModel::PacketTableModel(const PacketModel *packets, QObject *parent)
+    : QAbstractTableModel(parent)
+    , m_packets(packets)
+    , m_packetCount(0)
+    , m_filter(Filter::None)
+    , m_mapped(false)
+    , m_sortColumn(-1)
+    , m_sortOrder(Qt::AscendingOrder)
+    , m_cachedPacket(-1)
+{
+}
+
+void PacketTableModel::setInterfaceNames(std::function<QString(quint8)> names)
+{
+    m_interfaceNames = std::move(names);
+    m_cachedPacket = -1;
+}
+
+void PacketTableModel::appendRows()
+{
+    const int count = m_packets->getPacketCount();
+    if (count <= m_packetCount) {
+        return;
+    }
+    const uint32_t first = static_cast<uint32_t>(m_packetCount);
+    if (!m_mapped) {
+        beginInsertRows(QModelIndex(), m_packetCount, count - 1);
+        m_packetCount = count;
+        endInsertRows();
+        return;
+    }
+
+    // Only the new packets are decided; the ones shown keep their place.
+    std::vector<uint32_t> added;
+    for (uint32_t packet = first; packet < static_cast<uint32_t>(count); ++packet) {
+        if (accepts(packet)) {
+            added.push_back(packet);
+        }
+    }
+    m_packetCount = count;
+    if (added.empty()) {
+        return;
+    }
+    const auto shownBefore = [this](uint32_t a, uint32_t b) { return before(a, b); };
+    if (!inCaptureOrder()) {
+        std::sort(added.begin(), added.end(), shownBefore);
+    }
+
+    const size_t shown = m_rows.size();
+    beginInsertRows(QModelIndex(), static_cast<int>(shown), static_cast<int>(shown + added.size() - 1));
+    m_rows.insert(m_rows.end(), added.begin(), added.end());
+    endInsertRows();
+    if (shown == 0 || !before(added.front(), m_rows[shown - 1])) {
+        return;
+    }
+
+    // Then moved into place. A search for each new row rather than a merge,
+    // which would compare, and for text columns format, every row shown.
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList from = persistentIndexList();
+    std::vector<size_t> places(added.size());
+    for (size_t i = 0; i < added.size(); ++i) {
+        places[i] = std::upper_bound(m_rows.begin(), m_rows.begin() + shown, added[i], shownBefore) - m_rows.begin();
+    }
+    std::vector<uint32_t> merged;
+    merged.reserve(m_rows.size());
+    size_t next = 0;
+    for (size_t i = 0; i < added.size(); ++i) {
+        merged.insert(merged.end(), m_rows.begin() + next, m_rows.begin() + places[i]);
+        merged.push_back(added[i]);
+        next = places[i];
+    }
+    merged.insert(merged.end(), m_rows.begin() + next, m_rows.begin() + shown);
+    m_rows.swap(merged);
+
+    QModelIndexList to;
+    for (const QModelIndex &index : from) {
+        const size_t row = static_cast<size_t>(index.row());
+        const size_t moved = row < shown
+            ? row + (std::upper_bound(places.begin(), places.end(), row) - places.begin())
+            : places[row - shown] + (row - shown);
+        to.append(createIndex(static_cast<int>(moved), index.column()));
+    }
+    changePersistentIndexList(from, to);
+    emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+void PacketTableModel::clearRows()
+{
+    beginResetModel();
+    m_packetCount = 0;
+    m_rows.clear();
+    m_cachedPacket = -1;
+    endResetModel();
+}
+
+void PacketTableModel::setDisplayFilter(const DisplayFilter &filter, const RowBitmap &rows)
+{
+    beginResetModel();
+    m_filter = Filter::Display;
+    m_displayFilter = filter;
+    m_text.clear();
+    // Read straight from the bitmap; packets not shown yet are left to
+    // appendRows().
+    m_rows = rows.to_vector();
+    m_rows.erase(std::lower_bound(m_rows.begin(), m_rows.end(), static_cast<uint32_t>(m_packetCount)),
+                 m_rows.end());
+    m_mapped = true;
+    sortRows();
+    endResetModel();
+}
+
+void PacketTableModel::setTextFilter(const QString &text)
+{
+    beginResetModel();
+    m_filter = text.isEmpty() ? Filter::None : Filter::Text;
+    m_text = text;
+    filterRows();
+    endResetModel();
+}
+
+void PacketTableModel::filterRows()
+{
+    m_rows.clear();
+    if (m_filter == Filter::None && inCaptureOrder()) {
+        m_mapped = false;
+        m_rows.shrink_to_fit();
+        return;
+    }
+    m_mapped = true;
+    for (uint32_t packet = 0; packet < static_cast<uint32_t>(m_packetCount); ++packet) {
+        if (accepts(packet)) {
+            m_rows.push_back(packet);
+        }
+    }
+    sortRows();
+}
+
+const QString &PacketTableModel::columnText(const RowText &text, int column)
+{
+    switch (column) {
+    case InterfaceColumn:
+        return text.interfaceName;
+    case SourceColumn:
+        return text.source;
+    case DestinationColumn:
+        return text.destination;
+    case ProtocolColumn:
+        return text.protocol;
+    default:
+        return text.info;
+    }
+}
+
+bool PacketTableModel::accepts(uint32_t packet) const
+{
+    switch (m_filter) {
+    case Filter::Display:
+        return m_displayFilter.matches(m_packets->store().contents(), packet);
+    case Filter::Text: {
+        const RowText text = formatRow(packet);
+        for (const QString *column : {&text.interfaceName, &text.source, &text.destination, &text.protocol,
+                                      &text.info}) {
+            if (column->contains(m_text, Qt::CaseInsensitive)) {
+                return true;
+            }
+        }
+        return false;
+    }
+    default:
+        return true;
+    }
+}
+
+bool PacketTableModel::inCaptureOrder() const
+{
+    return m_sortColumn < 0 || (m_sortColumn == NumberColumn && m_sortOrder == Qt::AscendingOrder);
+}
+
+bool PacketTableModel::before(uint32_t a, uint32_t b) const
+{
+    const PacketStore::Contents &contents = m_packets->store().contents();
+    int order = 0;
+    switch (m_sortColumn) {
+    case TimeColumn:
+        order = compareValues(contents.timestamps()[a], contents.timestamps()[b]);
+        break;
+    case LengthColumn:
+        order = compareValues(contents.lengths()[a], contents.lengths()[b]);
+        break;
+    case InterfaceColumn:
+    case SourceColumn:
+    case DestinationColumn:
+    case ProtocolColumn:
+    case InfoColumn:
+        order = QString::compare(columnText(formatRow(a), m_sortColumn), columnText(formatRow(b), m_sortColumn));
+        break;
+    default:
+        // By number, or unsorted
+        order = m_sortColumn == NumberColumn ? compareValues(a, b) : 0;
+        break;
+    }
+    // Ties stay in capture order, as a stable sort keeps them.
+    if (order == 0) {
+        return a < b;
+    }
+    return m_sortOrder == Qt::AscendingOrder ? order < 0 : order > 0;
+}
+
+void PacketTableModel::sortRows()
+{
+    const auto shownBefore = [this](uint32_t a, uint32_t b) { return before(a, b); };
+    switch (m_sortColumn) {
+    case InterfaceColumn:
+    case SourceColumn:
+    case DestinationColumn:
+    case ProtocolColumn:
+    case InfoColumn:
+        break;
+    default:
+        // Rows from a bitmap or a scan are in capture order already.
+        if (!inCaptureOrder()) {
+            std::sort(m_rows.begin(), m_rows.end(), shownBefore);
+        }
+        return;
+    }
+
+    // Text is formatted once per row, not once per comparison.
+    std::vector<std::pair<QString, uint32_t>> keyed;
+    keyed.reserve(m_rows.size());
+    for (uint32_t packet : m_rows) {
+        keyed.emplace_back(columnText(formatRow(packet), m_sortColumn), packet);
+    }
+    const bool ascending = m_sortOrder == Qt::AscendingOrder;
+    std::sort(keyed.begin(), keyed.end(), [ascending](const auto &a, const auto &b) {
+        const int order = QString::compare(a.first, b.first);
+        if (order == 0) {
+            return a.second < b.second;
+        }
+        return ascending ? order < 0 : order > 0;
+    });
+    for (size_t i = 0; i < keyed.size(); ++i) {
+        m_rows[i] = keyed[i].second;
+    }
+}
+
+void PacketTableModel::sort(int column, Qt::SortOrder order)
+{
+    if (column == m_sortColumn && order == m_sortOrder) {
+        return;
+    }
+
+    emit layoutAboutToBeChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+    const QModelIndexList from = persistentIndexList();
+    std::vector<uint32_t> packets;
+    packets.reserve(from.size());
+    for (const QModelIndex &index : from) {
+        packets.push_back(packetAt(index.row()));
+    }
+
+    m_sortColumn = column;
+    m_sortOrder = order;
+    if (m_filter == Filter::None && inCaptureOrder()) {
+        m_mapped = false;
+        std::vector<uint32_t>().swap(m_rows);
+    } else {
+        if (!m_mapped) {
+            m_rows.resize(static_cast<size_t>(m_packetCount));
+            std::iota(m_rows.begin(), m_rows.end(), 0u);
+            m_mapped = true;
+        }
+        if (inCaptureOrder()) {
+            std::sort(m_rows.begin(), m_rows.end());
+        } else {
+            sortRows();
+        }
+    }
+
+    QModelIndexList to;
+    for (int i = 0; i < from.size(); ++i) {
+        const int row = rowOf(packets[i]);
+        to.append(row < 0 ? QModelIndex() : createIndex(row, from[i].column()));
+    }
+    changePersistentIndexList(from, to);
+    emit layoutChanged(QList<QPersistentModelIndex>(), QAbstractItemModel::VerticalSortHint);
+}
+
+int PacketTableModel::rowOf(uint32_t packet) const
+{
+    if (!m_mapped) {
+        return packet < static_cast<uint32_t>(m_packetCount) ? static_cast<int>(packet) : -1;
+    }
+    // The rows shown are sorted by before(), which orders every pair.
+    const auto found = std::lower_bound(m_rows.begin(), m_rows.end(), packet,
+                                        [this](uint32_t a, uint32_t b) { return before(a, b); });
+    return found != m_rows.end() && *found == packet ? static_cast<int>(found - m_rows.begin()) : -1;
+}
+
+int PacketTableModel::rowCount(const QModelIndex &parent) const
+{
+    if (parent.isValid()) {
+        return 0;
+    }
+    return m_mapped ? static_cast<int>(m_rows.size()) : m_packetCount;
+}
+
+int PacketTableModel::columnCount(const QModelIndex &parent) const
+{
+    return parent.isValid() ? 0 : ColumnCount;
+}
+
+PacketTableModel::RowText PacketTableModel::formatRow(uint32_t packet) const
+{
+    // Pinned, as getPacket() does, so the bytes stay mapped while the Info
+    // column reads them; they are not copied.
+    const PacketStore::Snapshot snapshot = m_packets->store().snapshot();
+    const PacketStore::Row row = (*snapshot)[packet];
+    PacketRecord record;
+    record.timestampNs = row.timestamp_ns();
+    record.number = static_cast<quint32>(row.number());
+    record.length = row.length();
+    record.capturedLength = row.captured_length();
+    record.interfaceId = row.interface_id();
+    row.decode(record.decoded);
+    const uint8_t *bytes = row.data();
+    const QByteArray data = QByteArray::fromRawData(reinterpret_cast<const char *>(bytes),
+                                                    bytes ? static_cast<int>(record.capturedLength) : 0);
+
+    RowText text;
+    text.interfaceName = m_interfaceNames ? m_interfaceNames(record.interfaceId) : QString();
+    text.source = PacketCapture::formatSource(record);
+    text.destination = PacketCapture::formatDestination(record);
+    text.protocol = PacketCapture::protocolName(record);
+    text.info = PacketCapture::packetInfo(record, data);
+    return text;
+}
+
+const PacketTableModel::RowText &PacketTableModel::rowText(uint32_t packet) const
+{
+    if (packet != m_cachedPacket) {
+        m_cachedText = formatRow(packet);
+        m_cachedPacket = packet;
+    }
+    return m_cachedText;
+}
+
+QVariant PacketTableModel::data(const QModelIndex &index, int role) const
+{
+    if (!index.isValid() || index.row() >= rowCount()) {
+        return QVariant();
+    }
+
+    const uint32_t packet = packetAt(index.row());
+    const PacketStore::Contents &contents = m_packets->store().contents();
+    switch (role) {
+    case Qt::DisplayRole:
+        switch (index.column()) {
+        case NumberColumn:
+            return packet + 1;
+        case TimeColumn:
+            return QVariant::fromValue<qulonglong>(contents.timestamps()[packet]);
+        case InterfaceColumn:
+            return rowText(packet).interfaceName;
+        case SourceColumn:
+            return rowText(packet).source;
+        case DestinationColumn:
+            return rowText(packet).destination;
+        case ProtocolColumn:
+            return rowText(packet).protocol;
+        case LengthColumn:
+            return contents.lengths()[packet];
+        case InfoColumn:
+            return rowText(packet).info;
+        default:
+            return QVariant();
+        }
+    case PreviousTimestampRole:
+        if (index.column() != TimeColumn) {
+            return QVariant();
+        }
+        return QVariant::fromValue<qulonglong>(packet > 0 ? contents.timestamps()[packet - 1] : 0);
+    case Qt::TextAlignmentRole:
+        if (index.column() == NumberColumn || index.column() == ProtocolColumn) {
+            return static_cast<int>(Qt::AlignCenter);
+        }
+        if (index.column() == LengthColumn) {
+            return static_cast<int>(Qt::AlignRight | Qt::AlignVCenter);
+        }
+        return QVariant();
+    case Qt::BackgroundRole:
+        // Color code protocols
+        if (index.column() == ProtocolColumn) {
+            const QString &protocol = rowText(packet).protocol;
+            if (protocol == "TCP") {
+                return QColor(220, 255, 220);
+            } else if (protocol == "UDP") {
+                return QColor(255, 255, 220);
+            } else if (protocol == "ICMP") {
+                return QColor(255, 220, 220);
+            }
+        }
+        return QVariant();
+    default:
+        return QVariant();
+    }
+}
+
+QVariant PacketTableModel::headerData(int section, Qt::Orientation orientation, int role) const
+{
+    if (orientation == Qt::Horizontal && role == Qt::DisplayRole && section >= 0 && section < ColumnCount) {
+        return QString(COLUMN_NAMES[section]);
+    }
+    return QAbstractTableModel::headerData(section, orientation, role);
+}
+
+PacketListWidget::PacketListWidget(const PacketModel *packets, QWidget *parent)
     : QWidget(parent)
+    , m_packets(packets)
     , m_tableView(nullptr)
     , m_model(nullptr)
-    , m_proxyModel(nullptr)
     , m_layout(nullptr)
 {
     setupUI();
@@ -37,88 +497,76 @@ void PacketListWidget::setupUI()
 
 void PacketListWidget::setupModel()
 {
-    m_model = new QStandardItemModel(this);
-    m_model->setHorizontalHeaderLabels({
-        "No.", "Time", "Source", "Destination", "Protocol", "Length", "Info"
-    });
+    m_model = new PacketTableModel(m_packets, this);
     
-    m_proxyModel = new QSortFilterProxyModel(this);
-    m_proxyModel->setSourceModel(m_model);
-    m_proxyModel->setFilterCaseSensitivity(Qt::CaseInsensitive);
-    
-    m_tableView->setModel(m_proxyModel);
+    m_tableView->setModel(m_model);
+    m_tableView->setItemDelegateForColumn(PacketTableModel::TimeColumn,
+                                          new TimestampDelegate(&m_timestampFormatter, this));
     
     // Set column widths
     m_tableView->horizontalHeader()->setStretchLastSection(true);
     m_tableView->setColumnWidth(0, 60);   // No.
     m_tableView->setColumnWidth(1, 120);  // Time
-    m_tableView->setColumnWidth(2, 120);  // Source
-    m_tableView->setColumnWidth(3, 120);  // Destination
-    m_tableView->setColumnWidth(4, 80);   // Protocol
-    m_tableView->setColumnWidth(5, 80);   // Length
+    m_tableView->setColumnWidth(2, 80);   // Interface
+    m_tableView->setColumnWidth(3, 120);  // Source
+    m_tableView->setColumnWidth(4, 120);  // Destination
+    m_tableView->setColumnWidth(5, 80);   // Protocol
+    m_tableView->setColumnWidth(6, 80);   // Length
     
     // Connect selection signal
     connect(m_tableView->selectionModel(), &QItemSelectionModel::currentRowChanged,
             this, &PacketListWidget::onSelectionChanged);
 }
 
-void PacketListWidget::addPacket(int number, const QString &time, const QString &source,
-                                const QString &destination, const QString &protocol,
-                                int length, const QString &info)
+void PacketListWidget::setInterfaceNames(std::function<QString(quint8)> names)
 {
-    QList<QStandardItem*> items;
-    
-    auto *numberItem = new QStandardItem(QString::number(number));
-    numberItem->setTextAlignment(Qt::AlignCenter);
-    items << numberItem;
-    
-    auto *timeItem = new QStandardItem(time);
-    items << timeItem;
-    
-    auto *sourceItem = new QStandardItem(source);
-    items << sourceItem;
-    
-    auto *destItem = new QStandardItem(destination);
-    items << destItem;
-    
-    auto *protocolItem = new QStandardItem(protocol);
-    protocolItem->setTextAlignment(Qt::AlignCenter);
-    
-    // Color code protocols
-    if (protocol == "TCP") {
-        protocolItem->setBackground(QColor(220, 255, 220));
-    } else if (protocol == "UDP") {
-        protocolItem->setBackground(QColor(255, 255, 220));
-    } else if (protocol == "ICMP") {
-        protocolItem->setBackground(QColor(255, 220, 220));
+    m_model->setInterfaceNames(std::move(names));
+}
+
+void PacketListWidget::addPackets()
+{
+    const bool first = m_model->rowCount() == 0;
+    beginBatch();
+    m_model->appendRows();
+    if (first && m_model->rowCount() > 0) {
+        m_timestampFormatter.set_reference(m_packets->row(0).timestamp_ns());
     }
-    
-    items << protocolItem;
-    
-    auto *lengthItem = new QStandardItem(QString::number(length));
-    lengthItem->setTextAlignment(Qt::AlignRight | Qt::AlignVCenter);
-    items << lengthItem;
-    
-    auto *infoItem = new QStandardItem(info);
-    items << infoItem;
-    
-    m_model->appendRow(items);
-    
-    // Auto-scroll to bottom
+    endBatch();
+}
+
+void PacketListWidget::beginBatch()
+{
+    // Sorting stays on: the model sorts only the inserted rows and merges
+    // them in, where turning it back on would re-sort every row on each
+    // batch.
+    m_tableView->setUpdatesEnabled(false);
+}
+
+void PacketListWidget::endBatch()
+{
+    m_tableView->setUpdatesEnabled(true);
     m_tableView->scrollToBottom();
 }
 
 void PacketListWidget::clearPackets()
 {
-    m_model->clear();
-    m_model->setHorizontalHeaderLabels({
-        "No.", "Time", "Source", "Destination", "Protocol", "Length", "Info"
-    });
+    m_model->clearRows();
 }
 
 void PacketListWidget::applyFilter(const QString &filter)
 {
-    m_proxyModel->setFilterWildcard(filter);
+    m_model->setTextFilter(filter);
+}
+
+void PacketListWidget::setDisplayFilter(const DisplayFilter &filter, const RowBitmap &rows)
+{
+    m_model->setDisplayFilter(filter, rows);
+}
+
+void PacketListWidget::setTimeDisplayMode(TimestampFormatter::Mode mode)
+{
+    m_timestampFormatter.set_mode(mode);
+    m_tableView->viewport()->update();
 }
 
 void PacketListWidget::onSelectionChanged(const QModelIndex &current, const QModelIndex &previous)
@@ -126,8 +574,6 @@ void PacketListWidget::onSelectionChanged(const QModelIndex &current, const QMod
     Q_UNUSED(previous)
     
     if (current.isValid()) {
-        QModelIndex sourceIndex = m_proxyModel->mapToSource(current);
-        int packetNumber = m_model->item(sourceIndex.row(), 0)->text().toInt();
-        emit packetSelected(packetNumber);
+        emit packetSelected(m_model->packetNumber(current.row()));
     }
 }
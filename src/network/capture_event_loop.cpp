@@ -0,0 +1,213 @@
+#include "netlyzer/network/capture_event_loop.h"
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+uint64_t now_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+size_t batch_bucket(size_t packets)
+{
+    size_t bucket = 0;
+    while (packets > 1 && bucket + 1 < CaptureEventLoop::BATCH_BUCKETS) {
+        packets >>= 1;
+        ++bucket;
+    }
+    return bucket;
+}
+
+} // namespace
+
+void CaptureEventLoop::Statistics::accumulate(const Statistics& other)
+{
+    wakeups += other.wakeups;
+    timeouts += other.timeouts;
+    empty_batches += other.empty_batches;
+    batches += other.batches;
+    packets += other.packets;
+    if (other.max_batch > max_batch)
+        max_batch = other.max_batch;
+    idle_ns += other.idle_ns;
+    for (size_t i = 0; i < BATCH_BUCKETS; ++i)
+        batch_histogram[i] += other.batch_histogram[i];
+}
+
+CaptureEventLoop::CaptureEventLoop()
+    : epoll_fd_(-1)
+    , wakeup_fd_(-1)
+    , capture_fd_(-1)
+    , busy_idle_start_ns_(0)
+{
+    reset_statistics();
+}
+
+CaptureEventLoop::~CaptureEventLoop()
+{
+    close();
+}
+
+bool CaptureEventLoop::open(int capture_fd, const Config& config)
+{
+    close();
+    config_ = config;
+    capture_fd_ = capture_fd;
+
+    if (capture_fd < 0) {
+        error_ = "capture handle has no selectable descriptor";
+        return false;
+    }
+
+    if (config_.busy_poll && config_.busy_poll_usec > 0) {
+        // Lets the kernel spin on the NIC queue for us; not all descriptors
+        // are sockets, so a failure here is not fatal.
+        int usec = static_cast<int>(config_.busy_poll_usec);
+        setsockopt(capture_fd, SOL_SOCKET, SO_BUSY_POLL, &usec, sizeof(usec));
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    wakeup_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (epoll_fd_ < 0 || wakeup_fd_ < 0) {
+        error_ = std::string("epoll setup: ") + std::strerror(errno);
+        close();
+        return false;
+    }
+
+    epoll_event event{};
+    event.events = EPOLLIN;
+    event.data.fd = capture_fd;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, capture_fd, &event) != 0) {
+        error_ = std::string("epoll_ctl(capture): ") + std::strerror(errno);
+        close();
+        return false;
+    }
+
+    event.data.fd = wakeup_fd_;
+    if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, wakeup_fd_, &event) != 0) {
+        error_ = std::string("epoll_ctl(wakeup): ") + std::strerror(errno);
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void CaptureEventLoop::close()
+{
+    if (epoll_fd_ >= 0) {
+        ::close(epoll_fd_);
+        epoll_fd_ = -1;
+    }
+    if (wakeup_fd_ >= 0) {
+        ::close(wakeup_fd_);
+        wakeup_fd_ = -1;
+    }
+    capture_fd_ = -1;
+    busy_idle_start_ns_ = 0;
+}
+
+CaptureEventLoop::Event CaptureEventLoop::wait()
+{
+    if (epoll_fd_ < 0)
+        return Event::Error;
+    if (config_.busy_poll)
+        return Event::Readable;
+
+    epoll_event events[2];
+    uint64_t start = now_ns();
+    int ready;
+    do {
+        ready = epoll_wait(epoll_fd_, events, 2, config_.idle_timeout_ms);
+    } while (ready < 0 && errno == EINTR);
+    add_idle(now_ns() - start);
+
+    if (ready < 0) {
+        error_ = std::string("epoll_wait: ") + std::strerror(errno);
+        return Event::Error;
+    }
+    if (ready == 0) {
+        timeouts_.fetch_add(1, std::memory_order_relaxed);
+        return Event::Timeout;
+    }
+
+    Event result = Event::Readable;
+    for (int i = 0; i < ready; ++i) {
+        if (events[i].data.fd == wakeup_fd_) {
+            uint64_t value;
+            while (read(wakeup_fd_, &value, sizeof(value)) > 0) {
+            }
+            result = Event::Wakeup;
+        }
+    }
+    if (result == Event::Readable)
+        wakeups_.fetch_add(1, std::memory_order_relaxed);
+    return result;
+}
+
+void CaptureEventLoop::wakeup()
+{
+    if (wakeup_fd_ >= 0) {
+        uint64_t one = 1;
+        ssize_t written = write(wakeup_fd_, &one, sizeof(one));
+        (void)written;
+    }
+}
+
+void CaptureEventLoop::record_batch(size_t packets)
+{
+    if (packets == 0) {
+        empty_batches_.fetch_add(1, std::memory_order_relaxed);
+        if (config_.busy_poll && busy_idle_start_ns_ == 0)
+            busy_idle_start_ns_ = now_ns();
+        return;
+    }
+
+    if (busy_idle_start_ns_ != 0) {
+        add_idle(now_ns() - busy_idle_start_ns_);
+        busy_idle_start_ns_ = 0;
+    }
+
+    batches_.fetch_add(1, std::memory_order_relaxed);
+    packets_.fetch_add(packets, std::memory_order_relaxed);
+    batch_histogram_[batch_bucket(packets)].fetch_add(1, std::memory_order_relaxed);
+
+    // Only the capture thread writes max_batch_, so load/compare/store is enough.
+    if (packets > max_batch_.load(std::memory_order_relaxed))
+        max_batch_.store(packets, std::memory_order_relaxed);
+}
+
+CaptureEventLoop::Statistics CaptureEventLoop::get_statistics() const
+{
+    Statistics stats;
+    stats.wakeups = wakeups_.load(std::memory_order_relaxed);
+    stats.timeouts = timeouts_.load(std::memory_order_relaxed);
+    stats.empty_batches = empty_batches_.load(std::memory_order_relaxed);
+    stats.batches = batches_.load(std::memory_order_relaxed);
+    stats.packets = packets_.load(std::memory_order_relaxed);
+    stats.max_batch = max_batch_.load(std::memory_order_relaxed);
+    stats.idle_ns = idle_ns_.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < BATCH_BUCKETS; ++i)
+        stats.batch_histogram[i] = batch_histogram_[i].load(std::memory_order_relaxed);
+    return stats;
+}
+
+void CaptureEventLoop::reset_statistics()
+{
+    wakeups_ = 0;
+    timeouts_ = 0;
+    empty_batches_ = 0;
+    batches_ = 0;
+    packets_ = 0;
+    max_batch_ = 0;
+    idle_ns_ = 0;
+    for (auto& bucket : batch_histogram_)
+        bucket = 0;
+}
@@ -0,0 +1,333 @@
+#include "netlyzer/network/capture_file.h"
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+namespace {
+
+constexpr uint32_t PCAP_MAGIC = 0xa1b2c3d4;
+constexpr uint32_t PCAP_MAGIC_SWAPPED = 0xd4c3b2a1;
+constexpr uint32_t PCAP_NANO_MAGIC = 0xa1b23c4d;
+constexpr uint32_t PCAP_NANO_MAGIC_SWAPPED = 0x4d3cb2a1;
+constexpr uint64_t PCAP_HEADER = 24;
+constexpr uint64_t PCAP_RECORD_HEADER = 16;
+
+// Block types; the section header's reads the same in either byte order.
+constexpr uint32_t SECTION_HEADER_BLOCK = 0x0a0d0d0a;
+constexpr uint32_t INTERFACE_BLOCK = 1;
+constexpr uint32_t OBSOLETE_PACKET_BLOCK = 2;
+constexpr uint32_t SIMPLE_PACKET_BLOCK = 3;
+constexpr uint32_t ENHANCED_PACKET_BLOCK = 6;
+constexpr uint32_t BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+
+constexpr uint16_t OPTION_END = 0;
+constexpr uint16_t OPTION_IF_NAME = 2;
+constexpr uint16_t OPTION_IF_TSRESOL = 9;
+constexpr uint16_t OPTION_IF_TSOFFSET = 14;
+
+constexpr uint64_t NS_PER_SECOND = 1000000000;
+constexpr uint64_t POWERS_OF_TEN[] = {1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000,
+                                      1000000000, 10000000000ull, 100000000000ull, 1000000000000ull,
+                                      10000000000000ull, 100000000000000ull, 1000000000000000ull,
+                                      10000000000000000ull, 100000000000000000ull,
+                                      1000000000000000000ull, 10000000000000000000ull};
+
+std::string at(uint64_t position)
+{
+    return " at offset " + std::to_string(position);
+}
+
+} // namespace
+
+CaptureFile::CaptureFile() = default;
+
+CaptureFile::~CaptureFile() = default;
+
+bool CaptureFile::open(const std::string& path)
+{
+    close();
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        error_ = path + ": " + std::strerror(errno);
+        return false;
+    }
+    struct stat status;
+    if (fstat(fd, &status) != 0) {
+        error_ = path + ": " + std::strerror(errno);
+        ::close(fd);
+        return false;
+    }
+    const uint64_t size = static_cast<uint64_t>(status.st_size);
+    if (size < 12) {
+        error_ = path + ": too short for a capture file";
+        ::close(fd);
+        return false;
+    }
+    // Private and read-only: nothing is written back, and the pages are the
+    // page cache's own until then.
+    void* map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    const int map_errno = errno;
+    ::close(fd);
+    if (map == MAP_FAILED) {
+        error_ = path + ": mmap: " + std::strerror(map_errno);
+        return false;
+    }
+    base_ = static_cast<const uint8_t*>(map);
+    mapping_.reset(base_, [size](const uint8_t* base) { munmap(const_cast<uint8_t*>(base), size); });
+    size_ = size;
+
+    uint32_t magic;
+    std::memcpy(&magic, base_, sizeof(magic));
+    if (magic == SECTION_HEADER_BLOCK) {
+        // The byte order comes from the section header, read as a block.
+        format_ = Format::PcapNg;
+        done_ = false;
+        return true;
+    }
+    format_ = Format::Pcap;
+    swapped_ = magic == PCAP_MAGIC_SWAPPED || magic == PCAP_NANO_MAGIC_SWAPPED;
+    nanoseconds_ = magic == PCAP_NANO_MAGIC || magic == PCAP_NANO_MAGIC_SWAPPED;
+    if (!swapped_ && !nanoseconds_ && magic != PCAP_MAGIC) {
+        close();
+        error_ = path + ": not a pcap or pcapng file";
+        return false;
+    }
+    if (size < PCAP_HEADER) {
+        close();
+        error_ = path + ": pcap header cut off";
+        return false;
+    }
+    Interface interface;
+    interface.snaplen = read32(16);
+    // The upper bits of the link type field describe an FCS, if any.
+    interface.link_type = static_cast<uint16_t>(read32(20));
+    interface.resolution = nanoseconds_ ? 9 : 6;
+    interfaces_.push_back(interface);
+    position_ = PCAP_HEADER;
+    done_ = position_ == size_;
+    return true;
+}
+
+void CaptureFile::close()
+{
+    base_ = nullptr;
+    mapping_.reset();
+    size_ = 0;
+    position_ = 0;
+    swapped_ = false;
+    nanoseconds_ = false;
+    done_ = true;
+    truncated_ = false;
+    interfaces_.clear();
+    section_interfaces_ = 0;
+    error_.clear();
+}
+
+size_t CaptureFile::read(Frame* frames, size_t max_frames)
+{
+    size_t count = 0;
+    while (count < max_frames && !done_) {
+        if (format_ == Format::Pcap ? read_pcap(frames[count]) : read_pcapng(frames[count]))
+            ++count;
+    }
+    return count;
+}
+
+bool CaptureFile::stop(const std::string& reason)
+{
+    error_ = reason;
+    done_ = true;
+    truncated_ = true;
+    return false;
+}
+
+uint16_t CaptureFile::read16(uint64_t position) const
+{
+    uint16_t value;
+    std::memcpy(&value, base_ + position, sizeof(value));
+    return swapped_ ? __builtin_bswap16(value) : value;
+}
+
+uint32_t CaptureFile::read32(uint64_t position) const
+{
+    uint32_t value;
+    std::memcpy(&value, base_ + position, sizeof(value));
+    return swapped_ ? __builtin_bswap32(value) : value;
+}
+
+uint64_t CaptureFile::read64(uint64_t position) const
+{
+    uint64_t value;
+    std::memcpy(&value, base_ + position, sizeof(value));
+    return swapped_ ? __builtin_bswap64(value) : value;
+}
+
+uint64_t CaptureFile::timestamp(const Interface& interface, uint64_t units) const
+{
+    uint64_t ns;
+    if (interface.binary_resolution) {
+        // Whole seconds, then the fraction scaled without overflowing.
+        unsigned shift = interface.resolution;
+        uint64_t fraction = units & ((uint64_t(1) << shift) - 1);
+        ns = (units >> shift) * NS_PER_SECOND;
+        if (shift > 32) {
+            fraction >>= shift - 32;
+            shift = 32;
+        }
+        ns += fraction * NS_PER_SECOND >> shift;
+    } else if (interface.resolution <= 9) {
+        ns = units * POWERS_OF_TEN[9 - interface.resolution];
+    } else {
+        ns = units / POWERS_OF_TEN[interface.resolution - 9];
+    }
+    return ns + static_cast<uint64_t>(interface.offset_seconds) * NS_PER_SECOND;
+}
+
+bool CaptureFile::read_pcap(Frame& frame)
+{
+    const uint64_t position = position_;
+    if (position == size_) {
+        done_ = true;
+        return false;
+    }
+    if (size_ - position < PCAP_RECORD_HEADER)
+        return stop("record header cut off" + at(position));
+    const uint32_t captured = read32(position + 8);
+    if (captured > size_ - position - PCAP_RECORD_HEADER)
+        return stop("packet runs past the end of the file" + at(position));
+
+    const uint64_t fraction = read32(position + 4);
+    frame.offset = position + PCAP_RECORD_HEADER;
+    frame.timestamp_ns = read32(position) * NS_PER_SECOND + (nanoseconds_ ? fraction : fraction * 1000);
+    frame.captured_length = captured;
+    frame.length = read32(position + 12);
+    frame.interface = 0;
+    frame.link_type = interfaces_[0].link_type;
+    position_ = frame.offset + captured;
+    return true;
+}
+
+bool CaptureFile::read_pcapng(Frame& frame)
+{
+    const uint64_t position = position_;
+    if (position == size_) {
+        done_ = true;
+        return false;
+    }
+    if (size_ - position < 12)
+        return stop("block header cut off" + at(position));
+    const uint32_t type = read32(position);
+    if (type == SECTION_HEADER_BLOCK) {
+        uint32_t magic;
+        std::memcpy(&magic, base_ + position + 8, sizeof(magic));
+        if (magic == BYTE_ORDER_MAGIC)
+            swapped_ = false;
+        else if (magic == __builtin_bswap32(BYTE_ORDER_MAGIC))
+            swapped_ = true;
+        else
+            return stop("bad byte-order magic in section header" + at(position));
+    }
+    const uint32_t length = read32(position + 4);
+    if (length < 12 || length % 4 != 0)
+        return stop("malformed block length" + at(position));
+    if (length > size_ - position)
+        return stop("block runs past the end of the file" + at(position));
+    if (read32(position + length - 4) != length)
+        return stop("block lengths disagree" + at(position));
+    position_ = position + length;
+
+    const size_t section_interfaces = interfaces_.size() - section_interfaces_;
+    switch (type) {
+    case SECTION_HEADER_BLOCK:
+        read_section(position, length);
+        return false;
+    case INTERFACE_BLOCK:
+        read_interface(position, length);
+        return false;
+    case ENHANCED_PACKET_BLOCK:
+    case OBSOLETE_PACKET_BLOCK: {
+        if (length < 32)
+            return stop("packet block too short" + at(position));
+        const uint32_t interface = type == ENHANCED_PACKET_BLOCK ? read32(position + 8) : read16(position + 8);
+        if (interface >= section_interfaces)
+            return stop("packet for an undescribed interface" + at(position));
+        const uint32_t captured = read32(position + 20);
+        if (captured > length - 32)
+            return stop("packet runs past its block" + at(position));
+        frame.interface = static_cast<uint32_t>(section_interfaces_ + interface);
+        const Interface& described = interfaces_[frame.interface];
+        frame.offset = position + 28;
+        frame.timestamp_ns = timestamp(described, uint64_t(read32(position + 12)) << 32 | read32(position + 16));
+        frame.captured_length = captured;
+        frame.length = read32(position + 24);
+        frame.link_type = described.link_type;
+        return true;
+    }
+    case SIMPLE_PACKET_BLOCK: {
+        // Always the section's first interface, and no timestamp.
+        if (length < 16 || section_interfaces == 0)
+            return stop("malformed simple packet block" + at(position));
+        frame.interface = static_cast<uint32_t>(section_interfaces_);
+        const Interface& described = interfaces_[frame.interface];
+        frame.offset = position + 12;
+        frame.timestamp_ns = 0;
+        frame.length = read32(position + 8);
+        frame.captured_length = std::min(frame.length, length - 16);
+        if (described.snaplen != 0)
+            frame.captured_length = std::min(frame.captured_length, described.snaplen);
+        frame.link_type = described.link_type;
+        return true;
+    }
+    default:
+        // Name resolution, statistics, custom blocks and the like.
+        return false;
+    }
+}
+
+bool CaptureFile::read_section(uint64_t position, uint32_t length)
+{
+    if (length < 28)
+        return stop("section header too short" + at(position));
+    if (read16(position + 12) != 1)
+        return stop("unsupported pcapng version" + at(position));
+    // Interface ids start again with each section.
+    section_interfaces_ = interfaces_.size();
+    return true;
+}
+
+bool CaptureFile::read_interface(uint64_t position, uint32_t length)
+{
+    if (length < 20)
+        return stop("interface description too short" + at(position));
+    Interface interface;
+    interface.link_type = read16(position + 8);
+    interface.snaplen = read32(position + 12);
+
+    const uint64_t end = position + length - 4;
+    for (uint64_t option = position + 16; option + 4 <= end;) {
+        const uint16_t code = read16(option);
+        const uint16_t size = read16(option + 2);
+        const uint64_t value = option + 4;
+        // A malformed option ends the list; what came before it stands.
+        if (code == OPTION_END || size > end - value)
+            break;
+        if (code == OPTION_IF_NAME) {
+            const char* name = reinterpret_cast<const char*>(base_ + value);
+            interface.name.assign(name, strnlen(name, size));
+        } else if (code == OPTION_IF_TSRESOL && size >= 1) {
+            interface.binary_resolution = (base_[value] & 0x80) != 0;
+            interface.resolution = base_[value] & 0x7f;
+            // Nothing real is finer; the clamp keeps the scaling in range.
+            interface.resolution = std::min<uint8_t>(interface.resolution, interface.binary_resolution ? 63 : 19);
+        } else if (code == OPTION_IF_TSOFFSET && size >= 8) {
+            interface.offset_seconds = static_cast<int64_t>(read64(value));
+        }
+        option = value + ((size + 3u) & ~3u);
+    }
+    interfaces_.push_back(std::move(interface));
+    return true;
+}
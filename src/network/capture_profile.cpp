@@ -0,0 +1,509 @@
+#include "netlyzer/network/capture_profile.h"
+#include "netlyzer/core/packet_store.h"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+// Just enough JSON for config.json: no streaming and no number edge cases
+// beyond what strtod handles.
+struct JsonValue {
+    enum class Type { Null, Bool, Number, String, Array, Object };
+
+    Type type = Type::Null;
+    bool boolean = false;
+    double number = 0;
+    std::string string;
+    std::vector<std::string> keys;      // objects only, parallel to items
+    std::vector<JsonValue> items;
+
+    const JsonValue* member(const std::string& key) const
+    {
+        for (size_t i = 0; i < keys.size(); ++i) {
+            if (keys[i] == key)
+                return &items[i];
+        }
+        return nullptr;
+    }
+};
+
+class JsonParser {
+public:
+    explicit JsonParser(const std::string& text) : text_(text), pos_(0) {}
+
+    bool parse(JsonValue& value, std::string& error)
+    {
+        if (!parse_value(value, 0)) {
+            error = error_ + " at offset " + std::to_string(pos_);
+            return false;
+        }
+        skip_space();
+        if (pos_ != text_.size()) {
+            error = "trailing characters at offset " + std::to_string(pos_);
+            return false;
+        }
+        return true;
+    }
+
+private:
+    static constexpr int MAX_DEPTH = 32;
+
+    void skip_space()
+    {
+        while (pos_ < text_.size() && (text_[pos_] == ' ' || text_[pos_] == '\t'
+                                       || text_[pos_] == '\n' || text_[pos_] == '\r'))
+            ++pos_;
+    }
+
+    bool fail(const char* what)
+    {
+        error_ = what;
+        return false;
+    }
+
+    bool literal(const char* word)
+    {
+        size_t length = std::char_traits<char>::length(word);
+        if (text_.compare(pos_, length, word) != 0)
+            return fail("invalid literal");
+        pos_ += length;
+        return true;
+    }
+
+    bool parse_value(JsonValue& value, int depth)
+    {
+        if (depth > MAX_DEPTH)
+            return fail("nesting too deep");
+        skip_space();
+        if (pos_ >= text_.size())
+            return fail("unexpected end of input");
+
+        switch (text_[pos_]) {
+        case '{': return parse_object(value, depth);
+        case '[': return parse_array(value, depth);
+        case '"':
+            value.type = JsonValue::Type::String;
+            return parse_string(value.string);
+        case 't':
+            value.type = JsonValue::Type::Bool;
+            value.boolean = true;
+            return literal("true");
+        case 'f':
+            value.type = JsonValue::Type::Bool;
+            value.boolean = false;
+            return literal("false");
+        case 'n':
+            value.type = JsonValue::Type::Null;
+            return literal("null");
+        default:
+            return parse_number(value);
+        }
+    }
+
+    bool parse_object(JsonValue& value, int depth)
+    {
+        value.type = JsonValue::Type::Object;
+        ++pos_;
+        skip_space();
+        if (pos_ < text_.size() && text_[pos_] == '}') {
+            ++pos_;
+            return true;
+        }
+        for (;;) {
+            skip_space();
+            std::string key;
+            if (pos_ >= text_.size() || text_[pos_] != '"' || !parse_string(key))
+                return fail("expected object key");
+            skip_space();
+            if (pos_ >= text_.size() || text_[pos_] != ':')
+                return fail("expected ':'");
+            ++pos_;
+            value.keys.push_back(std::move(key));
+            value.items.emplace_back();
+            if (!parse_value(value.items.back(), depth + 1))
+                return false;
+            skip_space();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                ++pos_;
+                continue;
+            }
+            if (pos_ < text_.size() && text_[pos_] == '}') {
+                ++pos_;
+                return true;
+            }
+            return fail("expected ',' or '}'");
+        }
+    }
+
+    bool parse_array(JsonValue& value, int depth)
+    {
+        value.type = JsonValue::Type::Array;
+        ++pos_;
+        skip_space();
+        if (pos_ < text_.size() && text_[pos_] == ']') {
+            ++pos_;
+            return true;
+        }
+        for (;;) {
+            value.items.emplace_back();
+            if (!parse_value(value.items.back(), depth + 1))
+                return false;
+            skip_space();
+            if (pos_ < text_.size() && text_[pos_] == ',') {
+                ++pos_;
+                continue;
+            }
+            if (pos_ < text_.size() && text_[pos_] == ']') {
+                ++pos_;
+                return true;
+            }
+            return fail("expected ',' or ']'");
+        }
+    }
+
+    bool parse_string(std::string& out)
+    {
+        ++pos_;
+        while (pos_ < text_.size()) {
+            char c = text_[pos_++];
+            if (c == '"')
+                return true;
+            if (c != '\\') {
+                out += c;
+                continue;
+            }
+            if (pos_ >= text_.size())
+                break;
+            char escape = text_[pos_++];
+            switch (escape) {
+            case '"': out += '"'; break;
+            case '\\': out += '\\'; break;
+            case '/': out += '/'; break;
+            case 'b': out += '\b'; break;
+            case 'f': out += '\f'; break;
+            case 'n': out += '\n'; break;
+            case 'r': out += '\r'; break;
+            case 't': out += '\t'; break;
+            case 'u': {
+                if (pos_ + 4 > text_.size())
+                    return fail("truncated \\u escape");
+                unsigned code = static_cast<unsigned>(std::strtoul(text_.substr(pos_, 4).c_str(), nullptr, 16));
+                pos_ += 4;
+                // Basic multilingual plane only; config values are ASCII in practice.
+                if (code < 0x80) {
+                    out += static_cast<char>(code);
+                } else if (code < 0x800) {
+                    out += static_cast<char>(0xc0 | (code >> 6));
+                    out += static_cast<char>(0x80 | (code & 0x3f));
+                } else {
+                    out += static_cast<char>(0xe0 | (code >> 12));
+                    out += static_cast<char>(0x80 | ((code >> 6) & 0x3f));
+                    out += static_cast<char>(0x80 | (code & 0x3f));
+                }
+                break;
+            }
+            default:
+                return fail("invalid escape");
+            }
+        }
+        return fail("unterminated string");
+    }
+
+    bool parse_number(JsonValue& value)
+    {
+        const char* begin = text_.c_str() + pos_;
+        char* end = nullptr;
+        double number = std::strtod(begin, &end);
+        if (end == begin)
+            return fail("unexpected character");
+        value.type = JsonValue::Type::Number;
+        value.number = number;
+        pos_ += static_cast<size_t>(end - begin);
+        return true;
+    }
+
+    const std::string& text_;
+    size_t pos_;
+    std::string error_;
+};
+
+bool read_int(const JsonValue& value, const std::string& key, int minimum, int& out, std::string& error)
+{
+    if (value.type != JsonValue::Type::Number || value.number != std::floor(value.number)
+        || value.number < minimum || value.number > 1e9) {
+        error = "'" + key + "' must be an integer >= " + std::to_string(minimum);
+        return false;
+    }
+    out = static_cast<int>(value.number);
+    return true;
+}
+
+bool read_bool(const JsonValue& value, const std::string& key, bool& out, std::string& error)
+{
+    if (value.type != JsonValue::Type::Bool) {
+        error = "'" + key + "' must be true or false";
+        return false;
+    }
+    out = value.boolean;
+    return true;
+}
+
+bool read_string(const JsonValue& value, const std::string& key, std::string& out, std::string& error)
+{
+    if (value.type != JsonValue::Type::String) {
+        error = "'" + key + "' must be a string";
+        return false;
+    }
+    out = value.string;
+    return true;
+}
+
+bool read_profile(const JsonValue& object, CaptureProfile& profile, std::string& error)
+{
+    if (object.type != JsonValue::Type::Object) {
+        error = "must be an object";
+        return false;
+    }
+    for (size_t i = 0; i < object.keys.size(); ++i) {
+        const std::string& key = object.keys[i];
+        const JsonValue& value = object.items[i];
+        bool ok;
+        if (key == "snaplen")
+            ok = read_int(value, key, 1, profile.snaplen, error);
+        else if (key == "buffer_mb") {
+            // pcap_set_buffer_size takes an int number of bytes.
+            ok = read_int(value, key, 0, profile.buffer_size_mb, error);
+            if (ok && profile.buffer_size_mb > 2047) {
+                error = "'buffer_mb' must be at most 2047";
+                ok = false;
+            }
+        }
+        else if (key == "timeout_ms")
+            ok = read_int(value, key, 0, profile.timeout_ms, error);
+        else if (key == "promiscuous")
+            ok = read_bool(value, key, profile.promiscuous, error);
+        else if (key == "immediate")
+            ok = read_bool(value, key, profile.immediate_mode, error);
+        else if (key == "nanosecond_timestamps")
+            ok = read_bool(value, key, profile.nanosecond_timestamps, error);
+        else if (key == "timestamp_type")
+            ok = read_string(value, key, profile.timestamp_type, error);
+        else if (key == "filter")
+            ok = read_string(value, key, profile.filter, error);
+        else if (key == "verify_checksums")
+            ok = read_bool(value, key, profile.verify_checksums, error);
+        else if (key == "reassembly_mb")
+            ok = read_int(value, key, 0, profile.reassembly_mb, error);
+        else if (key == "flow_table_mb")
+            ok = read_int(value, key, 0, profile.flow_table_mb, error);
+        else if (key == "packet_memory_mb")
+            ok = read_int(value, key, 0, profile.packet_memory_mb, error);
+        else if (key == "spill_directory")
+            ok = read_string(value, key, profile.spill_directory, error);
+        else if (key == "packet_compression") {
+            PacketStore::Codec codec;
+            ok = read_string(value, key, profile.packet_compression, error);
+            if (ok && !PacketStore::parse_codec(profile.packet_compression, codec)) {
+                error = "'packet_compression' must be none, zlib or lz4";
+                ok = false;
+            }
+        }
+        else if (key == "record_buffer_mb")
+            ok = read_int(value, key, 1, profile.record_buffer_mb, error);
+        else if (key == "ring_file_mb")
+            ok = read_int(value, key, 0, profile.ring_file_mb, error);
+        else if (key == "ring_file_seconds")
+            ok = read_int(value, key, 0, profile.ring_file_seconds, error);
+        else if (key == "ring_files")
+            ok = read_int(value, key, 0, profile.ring_files, error);
+        else {
+            error = "unknown key '" + key + "'";
+            ok = false;
+        }
+        if (!ok)
+            return false;
+    }
+    return true;
+}
+
+} // namespace
+
+CaptureProfiles::CaptureProfiles()
+    : profiles_(1)
+    , default_name_("default")
+{
+}
+
+bool CaptureProfiles::load_file(const std::string& path)
+{
+    std::ifstream file(path);
+    if (!file) {
+        error_ = "cannot open " + path;
+        return false;
+    }
+    std::stringstream contents;
+    contents << file.rdbuf();
+    return load(contents.str());
+}
+
+bool CaptureProfiles::load(const std::string& json)
+{
+    // An empty config file simply means "no profiles configured".
+    if (json.find_first_not_of(" \t\r\n") == std::string::npos) {
+        error_.clear();
+        return true;
+    }
+
+    JsonValue root;
+    if (!JsonParser(json).parse(root, error_))
+        return false;
+    if (root.type != JsonValue::Type::Object) {
+        error_ = "config root must be an object";
+        return false;
+    }
+
+    const JsonValue* capture = root.member("capture");
+    if (!capture) {
+        error_.clear();
+        return true;
+    }
+    if (capture->type != JsonValue::Type::Object) {
+        error_ = "'capture' must be an object";
+        return false;
+    }
+
+    std::vector<CaptureProfile> profiles(1);
+    if (const JsonValue* list = capture->member("profiles")) {
+        if (list->type != JsonValue::Type::Object) {
+            error_ = "'capture.profiles' must be an object";
+            return false;
+        }
+        for (size_t i = 0; i < list->keys.size(); ++i) {
+            CaptureProfile profile;
+            profile.name = list->keys[i];
+            std::string error;
+            if (!read_profile(list->items[i], profile, error)) {
+                error_ = "profile '" + profile.name + "': " + error;
+                return false;
+            }
+            if (profile.name == "default") {
+                profiles[0] = profile;
+            } else {
+                profiles.push_back(profile);
+            }
+        }
+    }
+
+    std::string default_name = "default";
+    if (const JsonValue* name = capture->member("default_profile")) {
+        if (!read_string(*name, "capture.default_profile", default_name, error_))
+            return false;
+    }
+
+    bool known = false;
+    for (const CaptureProfile& profile : profiles)
+        known = known || profile.name == default_name;
+    if (!known) {
+        error_ = "default profile '" + default_name + "' is not defined";
+        return false;
+    }
+
+    profiles_ = std::move(profiles);
+    default_name_ = default_name;
+    error_.clear();
+    return true;
+}
+
+const CaptureProfile* CaptureProfiles::find(const std::string& name) const
+{
+    for (const CaptureProfile& profile : profiles_) {
+        if (profile.name == name)
+            return &profile;
+    }
+    return nullptr;
+}
+
+const CaptureProfile& CaptureProfiles::default_profile() const
+{
+    const CaptureProfile* profile = find(default_name_);
+    return profile ? *profile : profiles_.front();
+}
+
+std::vector<std::string> CaptureProfiles::names() const
+{
+    std::vector<std::string> names;
+    for (const CaptureProfile& profile : profiles_)
+        names.push_back(profile.name);
+    return names;
+}
+
+pcap_t* open_capture(const std::string& interface_name, const CaptureProfile& profile, std::string& error)
+{
+    char errbuf[PCAP_ERRBUF_SIZE];
+    errbuf[0] = '\0';
+    error.clear();
+
+    pcap_t* handle = pcap_create(interface_name.c_str(), errbuf);
+    if (!handle) {
+        error = errbuf;
+        return nullptr;
+    }
+
+    auto fail = [&](const std::string& what) -> pcap_t* {
+        error = what;
+        pcap_close(handle);
+        return nullptr;
+    };
+
+    // These only fail on an already activated handle, so their results are
+    // not interesting; pcap_activate reports anything the platform rejects.
+    pcap_set_snaplen(handle, profile.snaplen);
+    pcap_set_promisc(handle, profile.promiscuous ? 1 : 0);
+    pcap_set_timeout(handle, profile.timeout_ms);
+    if (profile.buffer_size_mb > 0)
+        pcap_set_buffer_size(handle, profile.buffer_size_mb << 20);
+    if (profile.immediate_mode)
+        pcap_set_immediate_mode(handle, 1);
+
+    if (!profile.timestamp_type.empty()) {
+        int type = pcap_tstamp_type_name_to_val(profile.timestamp_type.c_str());
+        if (type < 0)
+            return fail("unknown timestamp type '" + profile.timestamp_type + "'");
+        if (pcap_set_tstamp_type(handle, type) != 0)
+            return fail("timestamp type '" + profile.timestamp_type + "' is not supported");
+    }
+    if (profile.nanosecond_timestamps
+        && pcap_set_tstamp_precision(handle, PCAP_TSTAMP_PRECISION_NANO) != 0) {
+        // Not fatal: packets just arrive with microsecond timestamps.
+        error = "nanosecond timestamps are not supported, using microseconds";
+    }
+
+    int status = pcap_activate(handle);
+    if (status < 0) {
+        std::string message = pcap_statustostr(status);
+        if (status == PCAP_ERROR)
+            message = pcap_geterr(handle);
+        return fail(message);
+    }
+    if (status > 0)
+        error = std::string("warning: ") + pcap_statustostr(status);
+
+    if (!profile.filter.empty()) {
+        bpf_program program;
+        if (pcap_compile(handle, &program, profile.filter.c_str(), 1, PCAP_NETMASK_UNKNOWN) != 0)
+            return fail(std::string("filter: ") + pcap_geterr(handle));
+        int result = pcap_setfilter(handle, &program);
+        pcap_freecode(&program);
+        if (result != 0)
+            return fail(std::string("filter: ") + pcap_geterr(handle));
+    }
+
+    return handle;
+}
+
+bool has_nanosecond_timestamps(pcap_t* handle)
+{
+    return handle && pcap_get_tstamp_precision(handle) == PCAP_TSTAMP_PRECISION_NANO;
+}
@@ -0,0 +1,709 @@
+#include "netlyzer/network/capture_writer.h"
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+
+namespace {
+
+constexpr uint32_t PCAP_NANOSECOND_MAGIC = 0xa1b23c4d;
+constexpr uint32_t PCAPNG_SECTION_HEADER = 0x0a0d0d0a;
+constexpr uint32_t PCAPNG_BYTE_ORDER_MAGIC = 0x1a2b3c4d;
+constexpr uint32_t PCAPNG_INTERFACE_DESCRIPTION = 1;
+constexpr uint32_t PCAPNG_ENHANCED_PACKET = 6;
+constexpr uint16_t OPTION_END = 0;
+constexpr uint16_t OPTION_IF_NAME = 2;
+constexpr uint16_t OPTION_IF_TSRESOL = 9;
+// Buffers gathered into one write.
+constexpr size_t MAX_BATCH = 64;
+
+uint64_t now_ms()
+{
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint32_t pad4(uint32_t length)
+{
+    return (length + 3) & ~3u;
+}
+
+void put16(std::vector<uint8_t>& out, uint16_t value)
+{
+    const size_t at = out.size();
+    out.resize(at + 2);
+    std::memcpy(&out[at], &value, 2);
+}
+
+void put32(std::vector<uint8_t>& out, uint32_t value)
+{
+    const size_t at = out.size();
+    out.resize(at + 4);
+    std::memcpy(&out[at], &value, 4);
+}
+
+void put32(uint8_t*& out, uint32_t value)
+{
+    std::memcpy(out, &value, 4);
+    out += 4;
+}
+
+// Written in our own byte order, which the magic numbers record.
+std::vector<uint8_t> file_header(const CaptureWriter::Config& config)
+{
+    std::vector<uint8_t> out;
+    if (config.format == CaptureWriter::Format::Pcap) {
+        put32(out, PCAP_NANOSECOND_MAGIC);
+        put16(out, 2);
+        put16(out, 4);
+        put32(out, 0);
+        put32(out, 0);
+        put32(out, config.snaplen);
+        put32(out, config.interfaces.front().link_type);
+        return out;
+    }
+
+    put32(out, PCAPNG_SECTION_HEADER);
+    put32(out, 28);
+    put32(out, PCAPNG_BYTE_ORDER_MAGIC);
+    put16(out, 1);
+    put16(out, 0);
+    put32(out, 0xffffffffu);                // section length unknown
+    put32(out, 0xffffffffu);
+    put32(out, 28);
+    for (const CaptureWriter::Interface& interface : config.interfaces) {
+        const size_t start = out.size();
+        put32(out, PCAPNG_INTERFACE_DESCRIPTION);
+        put32(out, 0);
+        put16(out, interface.link_type);
+        put16(out, 0);
+        put32(out, config.snaplen);
+        if (!interface.name.empty()) {
+            const uint16_t length = static_cast<uint16_t>(std::min<size_t>(interface.name.size(), 0xfff0));
+            put16(out, OPTION_IF_NAME);
+            put16(out, length);
+            out.insert(out.end(), interface.name.begin(), interface.name.begin() + length);
+            out.resize(out.size() + pad4(length) - length, 0);
+        }
+        put16(out, OPTION_IF_TSRESOL);
+        put16(out, 1);
+        put32(out, 9);                      // nanoseconds, then padding
+        put16(out, OPTION_END);
+        put16(out, 0);
+        const uint32_t length = static_cast<uint32_t>(out.size() - start + 4);
+        std::memcpy(&out[start + 4], &length, 4);
+        put32(out, length);
+    }
+    return out;
+}
+
+uint32_t record_size(CaptureWriter::Format format, uint32_t captured_length)
+{
+    return format == CaptureWriter::Format::Pcap ? 16 + captured_length : 32 + pad4(captured_length);
+}
+
+// Writes what is left of `iov` past its first `done` bytes, at `offset`, or
+// at the file position if `offset` is negative. Returns the bytes written
+// in all, stopping at an error.
+uint64_t write_rest(int fd, const iovec* iov, size_t count, uint64_t done, int64_t offset)
+{
+    std::vector<iovec> rest(iov, iov + count);
+    size_t index = 0;
+    auto skip = [&](uint64_t bytes) {
+        while (bytes > 0 && index < rest.size()) {
+            if (bytes >= rest[index].iov_len) {
+                bytes -= rest[index].iov_len;
+                ++index;
+            } else {
+                rest[index].iov_base = static_cast<uint8_t*>(rest[index].iov_base) + bytes;
+                rest[index].iov_len -= bytes;
+                bytes = 0;
+            }
+        }
+    };
+    skip(done);
+    while (index < rest.size()) {
+        const int pieces = static_cast<int>(std::min<size_t>(rest.size() - index, IOV_MAX));
+        const ssize_t written = offset < 0 ? ::writev(fd, &rest[index], pieces)
+                                           : ::pwritev(fd, &rest[index], pieces, offset + done);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            break;
+        done += written;
+        skip(written);
+    }
+    return done;
+}
+
+} // namespace
+
+// An io_uring instance driven through the raw system calls: the submission
+// and completion rings are mapped and advanced here, with no library.
+class CaptureWriter::Ring {
+public:
+    ~Ring()
+    {
+        if (sqes_)
+            munmap(sqes_, sqes_size_);
+        if (cq_ptr_ && cq_ptr_ != sq_ptr_)
+            munmap(cq_ptr_, cq_size_);
+        if (sq_ptr_)
+            munmap(sq_ptr_, sq_size_);
+        if (fd_ >= 0)
+            ::close(fd_);
+    }
+
+    // False if the kernel has no io_uring, or it is not allowed here.
+    bool setup(unsigned entries)
+    {
+        io_uring_params params{};
+        fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &params));
+        if (fd_ < 0)
+            return false;
+
+        sq_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+        cq_size_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+        const bool single = params.features & IORING_FEAT_SINGLE_MMAP;
+        if (single)
+            sq_size_ = cq_size_ = std::max(sq_size_, cq_size_);
+        sq_ptr_ = map(sq_size_, IORING_OFF_SQ_RING);
+        if (!sq_ptr_)
+            return false;
+        cq_ptr_ = single ? sq_ptr_ : map(cq_size_, IORING_OFF_CQ_RING);
+        if (!cq_ptr_)
+            return false;
+        sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+        sqes_ = static_cast<io_uring_sqe*>(map(sqes_size_, IORING_OFF_SQES));
+        if (!sqes_)
+            return false;
+
+        uint8_t* sq = static_cast<uint8_t*>(sq_ptr_);
+        sq_head_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+        sq_tail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+        sq_mask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+        sq_entries_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_entries);
+        sq_array_ = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+        uint8_t* cq = static_cast<uint8_t*>(cq_ptr_);
+        cq_head_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+        cq_tail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+        cq_mask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+        cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+        return true;
+    }
+
+    // Queues a positioned writev; false if the submission ring is full.
+    bool prepare_writev(int fd, const iovec* iov, size_t count, uint64_t offset, uint64_t user_data)
+    {
+        const unsigned tail = *sq_tail_;
+        if (tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) >= sq_entries_)
+            return false;
+        const unsigned index = tail & sq_mask_;
+        io_uring_sqe& sqe = sqes_[index];
+        std::memset(&sqe, 0, sizeof(sqe));
+        sqe.opcode = IORING_OP_WRITEV;
+        sqe.fd = fd;
+        sqe.addr = reinterpret_cast<uint64_t>(iov);
+        sqe.len = static_cast<uint32_t>(count);
+        sqe.off = offset;
+        sqe.user_data = user_data;
+        sq_array_[index] = index;
+        __atomic_store_n(sq_tail_, tail + 1, __ATOMIC_RELEASE);
+        ++unsubmitted_;
+        return true;
+    }
+
+    // Submits what was prepared and waits for `wait_for` completions; -errno
+    // on failure.
+    int enter(unsigned wait_for)
+    {
+        for (;;) {
+            const long result = syscall(__NR_io_uring_enter, fd_, unsubmitted_, wait_for,
+                                        wait_for ? IORING_ENTER_GETEVENTS : 0, nullptr, 0);
+            if (result >= 0) {
+                unsubmitted_ -= static_cast<unsigned>(result);
+                return 0;
+            }
+            if (errno != EINTR)
+                return -errno;
+        }
+    }
+
+    // Takes back everything prepared since the last successful enter(), so
+    // that a failed submission is not picked up by the next one.
+    void withdraw()
+    {
+        __atomic_store_n(sq_tail_, *sq_tail_ - unsubmitted_, __ATOMIC_RELEASE);
+        unsubmitted_ = 0;
+    }
+
+    // Hands every completion so far to `on_complete(user_data, result)`.
+    template<typename Callback>
+    size_t reap(Callback&& on_complete)
+    {
+        unsigned head = *cq_head_;
+        const unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        size_t count = 0;
+        for (; head != tail; ++head, ++count) {
+            const io_uring_cqe& cqe = cqes_[head & cq_mask_];
+            on_complete(cqe.user_data, cqe.res);
+        }
+        __atomic_store_n(cq_head_, head, __ATOMIC_RELEASE);
+        return count;
+    }
+
+private:
+    void* map(size_t size, uint64_t offset)
+    {
+        void* address = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_,
+                             static_cast<off_t>(offset));
+        return address == MAP_FAILED ? nullptr : address;
+    }
+
+    int fd_ = -1;
+    void* sq_ptr_ = nullptr;
+    void* cq_ptr_ = nullptr;
+    size_t sq_size_ = 0;
+    size_t cq_size_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_size_ = 0;
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_array_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+    unsigned unsubmitted_ = 0;
+};
+
+CaptureWriter::CaptureWriter() = default;
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+bool CaptureWriter::fail(const std::string& what)
+{
+    error_ = what + ": " + std::strerror(errno);
+    close();
+    return false;
+}
+
+bool CaptureWriter::open(const Config& config)
+{
+    close();
+    error_.clear();
+    config_ = config;
+    if (config_.interfaces.empty())
+        config_.interfaces.emplace_back();
+    if (config_.buffer_count == 0) {
+        error_ = "no write buffers";
+        return false;
+    }
+    const size_t page = static_cast<size_t>(sysconf(_SC_PAGESIZE));
+    buffer_size_ = std::max(page, (config_.buffer_size + page - 1) / page * page);
+    file_header_ = file_header(config_);
+    if (buffer_size_ < file_header_.size() + record_size(config_.format, config_.snaplen)) {
+        error_ = "write buffers are smaller than a snaplen record";
+        return false;
+    }
+
+    stats_ = Statistics();
+    for (size_t i = 0; i < config_.buffer_count; ++i) {
+        void* buffer = nullptr;
+        if (posix_memalign(&buffer, page, buffer_size_) != 0) {
+            errno = ENOMEM;
+            return fail("write buffers");
+        }
+        buffers_.push_back(static_cast<uint8_t*>(buffer));
+        free_.push_back(static_cast<int>(config_.buffer_count - 1 - i));
+    }
+    used_.assign(config_.buffer_count, 0);
+
+    file_index_ = 0;
+    if (!open_file())
+        return fail(file_name(0));
+
+    struct stat status;
+    backend_ = Backend::Writev;
+    if (config_.use_io_uring && fstat(fd_, &status) == 0 && S_ISREG(status.st_mode)) {
+        ring_ = std::make_unique<Ring>();
+        unsigned entries = 1;
+        while (entries < config_.buffer_count)
+            entries <<= 1;
+        if (ring_->setup(entries)) {
+            backend_ = Backend::IoUring;
+            requests_.resize(config_.buffer_count);
+            for (size_t i = config_.buffer_count; i-- > 0;)
+                idle_requests_.push_back(i);
+        } else {
+            ring_.reset();
+        }
+    }
+
+    // The first file gets its header even if no packet follows.
+    std::unique_lock<std::mutex> lock(mutex_);
+    take_buffer(lock);
+    std::memcpy(buffers_[current_], file_header_.data(), file_header_.size());
+    used_[current_] = static_cast<uint32_t>(file_header_.size());
+    file_bytes_ = file_header_.size();
+    file_has_packets_ = false;
+    header_pending_ = false;
+    stopping_ = false;
+    accepting_ = true;
+    lock.unlock();
+
+    thread_ = std::thread([this] { run(); });
+    return true;
+}
+
+void CaptureWriter::close()
+{
+    if (thread_.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            accepting_ = false;
+            stopping_ = true;
+            seal();
+        }
+        work_.notify_one();
+        space_.notify_all();
+        thread_.join();
+    }
+    close_file();
+    ring_.reset();
+    requests_.clear();
+    idle_requests_.clear();
+    in_flight_ = 0;
+    ring_names_.clear();
+    for (uint8_t* buffer : buffers_)
+        std::free(buffer);
+    buffers_.clear();
+    used_.clear();
+    free_.clear();
+    queue_.clear();
+    current_ = -1;
+    accepting_ = false;
+}
+
+bool CaptureWriter::write(uint64_t timestamp_ns, uint32_t length, uint32_t interface, const uint8_t* data,
+                          uint32_t captured_length)
+{
+    captured_length = std::min(captured_length, config_.snaplen);
+    const uint32_t record = record_size(config_.format, captured_length);
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!accepting_)
+        return false;
+
+    // Rotation happens between packets, so every file starts with its header.
+    if (file_has_packets_ &&
+        ((config_.rotate_bytes && file_bytes_ + record > config_.rotate_bytes) ||
+         (config_.rotate_seconds && timestamp_ns > file_start_ns_ &&
+          timestamp_ns - file_start_ns_ >= config_.rotate_seconds * 1000000000ull))) {
+        // A buffer left empty by seal() stays current for the next file.
+        seal();
+        queue_.push_back(END_OF_FILE);
+        work_.notify_one();
+        file_bytes_ = 0;
+        file_has_packets_ = false;
+        header_pending_ = true;
+    }
+
+    while (current_ < 0 || used_[current_] + (header_pending_ ? file_header_.size() : 0) + record > buffer_size_) {
+        seal();
+        if (!take_buffer(lock)) {
+            ++stats_.dropped_packets;
+            stats_.dropped_bytes += length;
+            return false;
+        }
+    }
+
+    const size_t header = header_pending_ ? file_header_.size() : 0;
+    uint8_t* out = buffers_[current_] + used_[current_];
+    if (header_pending_) {
+        std::memcpy(out, file_header_.data(), header);
+        out += header;
+        header_pending_ = false;
+    }
+    if (config_.format == Format::Pcap) {
+        put32(out, static_cast<uint32_t>(timestamp_ns / 1000000000ull));
+        put32(out, static_cast<uint32_t>(timestamp_ns % 1000000000ull));
+        put32(out, captured_length);
+        put32(out, length);
+        std::memcpy(out, data, captured_length);
+    } else {
+        put32(out, PCAPNG_ENHANCED_PACKET);
+        put32(out, record);
+        put32(out, interface < config_.interfaces.size() ? interface : 0);
+        put32(out, static_cast<uint32_t>(timestamp_ns >> 32));
+        put32(out, static_cast<uint32_t>(timestamp_ns));
+        put32(out, captured_length);
+        put32(out, length);
+        std::memcpy(out, data, captured_length);
+        out += captured_length;
+        std::memset(out, 0, pad4(captured_length) - captured_length);
+        out += pad4(captured_length) - captured_length;
+        put32(out, record);
+    }
+    used_[current_] += static_cast<uint32_t>(header + record);
+    file_bytes_ += header + record;
+    if (!file_has_packets_) {
+        file_has_packets_ = true;
+        file_start_ns_ = timestamp_ns;
+    }
+    ++stats_.packets;
+    return true;
+}
+
+CaptureWriter::Statistics CaptureWriter::get_statistics() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void CaptureWriter::seal()
+{
+    if (current_ < 0 || used_[current_] == 0)
+        return;
+    queue_.push_back(current_);
+    current_ = -1;
+    work_.notify_one();
+}
+
+bool CaptureWriter::take_buffer(std::unique_lock<std::mutex>& lock)
+{
+    if (free_.empty()) {
+        if (config_.drop_when_full)
+            return false;
+        // Another writer may take a buffer while this one waits.
+        space_.wait(lock, [this] { return !free_.empty() || current_ >= 0 || !accepting_; });
+        if (!accepting_)
+            return false;
+        if (current_ >= 0)
+            return true;
+    }
+    current_ = free_.back();
+    free_.pop_back();
+    used_[current_] = 0;
+    filled_at_ms_ = now_ms();
+    stats_.buffers_high_water = std::max<uint64_t>(stats_.buffers_high_water, buffers_.size() - free_.size());
+    return true;
+}
+
+void CaptureWriter::run()
+{
+    std::vector<int> work;
+    std::vector<int> batch;
+    for (;;) {
+        bool stopping;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            // With writes in flight, their completions wake us instead.
+            if (in_flight_ == 0)
+                work_.wait_for(lock, std::chrono::milliseconds(FLUSH_INTERVAL_MS),
+                               [this] { return stopping_ || !queue_.empty(); });
+            if (queue_.empty() && current_ >= 0 && used_[current_] > 0 &&
+                now_ms() - filled_at_ms_ >= static_cast<uint64_t>(FLUSH_INTERVAL_MS))
+                seal();
+            work.assign(queue_.begin(), queue_.end());
+            queue_.clear();
+            stopping = stopping_;
+        }
+
+        for (int buffer : work) {
+            if (buffer == END_OF_FILE) {
+                submit(batch);
+                drain(true);
+                close_file();
+                continue;
+            }
+            if (fd_ < 0 && !open_file()) {
+                release({buffer}, 0, true);
+                continue;
+            }
+            batch.push_back(buffer);
+            if (batch.size() == MAX_BATCH)
+                submit(batch);
+        }
+        submit(batch);
+
+        if (in_flight_ > 0)
+            drain(false);
+        else if (stopping && work.empty())
+            break;
+    }
+    close_file();
+}
+
+bool CaptureWriter::open_file()
+{
+    const std::string name = file_name(file_index_);
+    fd_ = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd_ < 0)
+        return false;
+    ++file_index_;
+    file_offset_ = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.files;
+    }
+    if (config_.ring_files > 0) {
+        ring_names_.push_back(name);
+        if (ring_names_.size() > config_.ring_files) {
+            unlink(ring_names_.front().c_str());
+            ring_names_.pop_front();
+        }
+    }
+    return true;
+}
+
+void CaptureWriter::close_file()
+{
+    if (fd_ < 0)
+        return;
+    if (::close(fd_) != 0) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.write_errors;
+    }
+    fd_ = -1;
+}
+
+std::string CaptureWriter::file_name(uint64_t index) const
+{
+    if (config_.rotate_bytes == 0 && config_.rotate_seconds == 0)
+        return config_.path;
+
+    // As dumpcap names ring buffer files: prefix_00001_20240101120000.pcap.
+    const size_t slash = config_.path.rfind('/');
+    size_t dot = config_.path.rfind('.');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        dot = config_.path.size();
+    const time_t now = std::time(nullptr);
+    tm local{};
+    localtime_r(&now, &local);
+    char middle[40];
+    const int length = std::snprintf(middle, sizeof(middle), "_%05llu_", static_cast<unsigned long long>(index + 1));
+    std::strftime(middle + length, sizeof(middle) - length, "%Y%m%d%H%M%S", &local);
+    return config_.path.substr(0, dot) + middle + config_.path.substr(dot);
+}
+
+void CaptureWriter::submit(std::vector<int>& buffers)
+{
+    if (buffers.empty())
+        return;
+    std::vector<iovec> iov(buffers.size());
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < buffers.size(); ++i) {
+        iov[i].iov_base = buffers_[buffers[i]];
+        iov[i].iov_len = used_[buffers[i]];
+        bytes += used_[buffers[i]];
+    }
+
+    if (ring_) {
+        const uint64_t id = idle_requests_.back();
+        idle_requests_.pop_back();
+        Request& request = requests_[id];
+        request.buffers.swap(buffers);
+        request.iov.swap(iov);
+        request.offset = file_offset_;
+        request.bytes = bytes;
+        file_offset_ += bytes;
+        buffers.clear();
+        // At most one request per buffer, so the rings never fill.
+        ring_->prepare_writev(fd_, request.iov.data(), request.iov.size(), request.offset, id);
+        ++in_flight_;
+        const int result = ring_->enter(0);
+        if (result < 0) {
+            // The request never reached the kernel; write it here.
+            ring_->withdraw();
+            --in_flight_;
+            complete(id, result);
+        }
+        return;
+    }
+
+    const uint64_t written = write_rest(fd_, iov.data(), iov.size(), 0, -1);
+    file_offset_ += written;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.writes;
+    }
+    release(buffers, written, written != bytes);
+    buffers.clear();
+}
+
+void CaptureWriter::complete(uint64_t id, int result)
+{
+    Request& request = requests_[id];
+    uint64_t written = result > 0 ? static_cast<uint64_t>(result) : 0;
+    if (written < request.bytes)
+        written = write_rest(fd_, request.iov.data(), request.iov.size(), written,
+                             static_cast<int64_t>(request.offset));
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.writes;
+    }
+    release(request.buffers, written, written != request.bytes);
+    request.buffers.clear();
+    idle_requests_.push_back(id);
+}
+
+void CaptureWriter::drain(bool wait_all)
+{
+    // Waits for one completion, or for all of them.
+    while (in_flight_ > 0) {
+        if (ring_->enter(1) < 0) {
+            abandon_ring();
+            return;
+        }
+        in_flight_ -= ring_->reap([this](uint64_t id, int result) { complete(id, result); });
+        if (!wait_all)
+            break;
+    }
+}
+
+// The ring can no longer be waited on, so its completions would never be
+// reaped. Closing it has the kernel cancel what it still holds; every request
+// not yet completed is written here, and the rest of the capture goes out
+// with writev.
+void CaptureWriter::abandon_ring()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        ++stats_.write_errors;
+    }
+    ring_->reap([this](uint64_t id, int result) { complete(id, result); });
+    ring_.reset();
+    for (size_t id = 0; id < requests_.size(); ++id) {
+        if (!requests_[id].buffers.empty())
+            complete(id, -ECANCELED);
+    }
+    in_flight_ = 0;
+}
+
+void CaptureWriter::release(const std::vector<int>& buffers, uint64_t bytes, bool failed)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stats_.bytes += bytes;
+        if (failed)
+            ++stats_.write_errors;
+        for (int buffer : buffers)
+            free_.push_back(buffer);
+    }
+    space_.notify_all();
+}
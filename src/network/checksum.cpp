@@ -0,0 +1,287 @@
+#include "netlyzer/network/checksum.h"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NETLYZER_CHECKSUM_AVX2 1
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+constexpr size_t TCP_CHECKSUM_OFFSET = 16;
+constexpr size_t UDP_CHECKSUM_OFFSET = 6;
+constexpr size_t ICMP_CHECKSUM_OFFSET = 2;
+constexpr size_t TCP_MIN_LENGTH = 20;
+constexpr size_t UDP_HEADER_LENGTH = 8;
+constexpr size_t ICMP_MIN_LENGTH = 4;
+
+inline uint16_t load_be16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint16_t load_native16(const uint8_t* p)
+{
+    uint16_t value;
+    std::memcpy(&value, p, 2);
+    return value;
+}
+
+// 32-bit words into a 64-bit accumulator; 2^16 == 1 modulo 0xffff, so this
+// folds to the same value as summing 16-bit words.
+uint64_t add_scalar(const uint8_t* data, size_t length, uint64_t sum)
+{
+    size_t i = 0;
+    for (; i + 4 <= length; i += 4) {
+        uint32_t word;
+        std::memcpy(&word, data + i, 4);
+        sum += word;
+    }
+    if (i + 2 <= length) {
+        sum += load_native16(data + i);
+        i += 2;
+    }
+    if (i < length) {
+        const uint8_t tail[2] = {data[i], 0};
+        sum += load_native16(tail);
+    }
+    return sum;
+}
+
+#if defined(__SSE2__)
+uint64_t add_sse2(const uint8_t* data, size_t length, uint64_t sum)
+{
+    // Widen 32-bit words to 64-bit lanes so the accumulators cannot overflow.
+    const __m128i zero = _mm_setzero_si128();
+    __m128i acc0 = zero;
+    __m128i acc1 = zero;
+    size_t i = 0;
+    for (; i + 16 <= length; i += 16) {
+        const __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i));
+        acc0 = _mm_add_epi64(acc0, _mm_unpacklo_epi32(v, zero));
+        acc1 = _mm_add_epi64(acc1, _mm_unpackhi_epi32(v, zero));
+    }
+    alignas(16) uint64_t lanes[2];
+    _mm_store_si128(reinterpret_cast<__m128i*>(lanes), _mm_add_epi64(acc0, acc1));
+    return add_scalar(data + i, length - i, sum + lanes[0] + lanes[1]);
+}
+#endif
+
+#ifdef NETLYZER_CHECKSUM_AVX2
+// Sums whole 32-byte blocks and leaves the tail to add_scalar. It returns
+// instead of tail-calling so the compiler's vzeroupper runs before any SSE
+// code; a dirty upper state made verify() four times slower.
+TARGET_AVX2 uint64_t add_avx2_blocks(const uint8_t* data, size_t length, size_t& consumed)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    __m256i acc0 = zero;
+    __m256i acc1 = zero;
+    __m256i acc2 = zero;
+    __m256i acc3 = zero;
+    size_t i = 0;
+    for (; i + 64 <= length; i += 64) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + 32));
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(a, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(a, zero));
+        acc2 = _mm256_add_epi64(acc2, _mm256_unpacklo_epi32(b, zero));
+        acc3 = _mm256_add_epi64(acc3, _mm256_unpackhi_epi32(b, zero));
+    }
+    for (; i + 32 <= length; i += 32) {
+        const __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i));
+        acc0 = _mm256_add_epi64(acc0, _mm256_unpacklo_epi32(a, zero));
+        acc1 = _mm256_add_epi64(acc1, _mm256_unpackhi_epi32(a, zero));
+    }
+    consumed = i;
+    const __m256i total = _mm256_add_epi64(_mm256_add_epi64(acc0, acc1), _mm256_add_epi64(acc2, acc3));
+    const __m128i half = _mm_add_epi64(_mm256_castsi256_si128(total), _mm256_extracti128_si256(total, 1));
+    return static_cast<uint64_t>(_mm_cvtsi128_si64(half))
+         + static_cast<uint64_t>(_mm_cvtsi128_si64(_mm_unpackhi_epi64(half, half)));
+}
+
+uint64_t add_avx2(const uint8_t* data, size_t length, uint64_t sum)
+{
+    size_t consumed = 0;
+    sum += add_avx2_blocks(data, length, consumed);
+    return add_scalar(data + consumed, length - consumed, sum);
+}
+
+bool cpu_has_avx2()
+{
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+}
+#endif
+
+bool header_ok(const uint8_t* header, size_t length)
+{
+    return ChecksumVerifier::fold(ChecksumVerifier::add(header, length)) == 0xffff;
+}
+
+// Sum of the IPv4 or IPv6 pseudo-header for an upper-layer segment.
+uint64_t pseudo_header_sum(const DecodedPacket& packet, size_t length)
+{
+    uint8_t pseudo[40] = {};
+    if (packet.has(DecodedPacket::IPV4)) {
+        std::memcpy(pseudo, packet.source_address, 4);
+        std::memcpy(pseudo + 4, packet.dest_address, 4);
+        pseudo[9] = packet.ip_protocol;
+        pseudo[10] = static_cast<uint8_t>(length >> 8);
+        pseudo[11] = static_cast<uint8_t>(length);
+        return ChecksumVerifier::add(pseudo, 12, 0, ChecksumVerifier::Path::Scalar);
+    }
+    std::memcpy(pseudo, packet.source_address, 16);
+    std::memcpy(pseudo + 16, packet.dest_address, 16);
+    pseudo[34] = static_cast<uint8_t>(length >> 8);
+    pseudo[35] = static_cast<uint8_t>(length);
+    pseudo[39] = packet.ip_protocol;
+    return ChecksumVerifier::add(pseudo, 40, 0, ChecksumVerifier::Path::Scalar);
+}
+
+} // namespace
+
+bool ChecksumVerifier::has_path(Path path)
+{
+    switch (path) {
+    case Path::Best:
+    case Path::Scalar:
+        return true;
+    case Path::Sse2:
+#if defined(__SSE2__)
+        return true;
+#else
+        return false;
+#endif
+    case Path::Avx2:
+#ifdef NETLYZER_CHECKSUM_AVX2
+        return cpu_has_avx2();
+#else
+        return false;
+#endif
+    }
+    return false;
+}
+
+uint64_t ChecksumVerifier::add(const uint8_t* data, size_t length, uint64_t sum, Path path)
+{
+    // Headers are too short for the vector loops to pay off.
+    if (length < 64 && path == Path::Best)
+        path = Path::Scalar;
+
+    switch (path) {
+    case Path::Best:
+#ifdef NETLYZER_CHECKSUM_AVX2
+        if (cpu_has_avx2())
+            return add_avx2(data, length, sum);
+#endif
+#if defined(__SSE2__)
+        return add_sse2(data, length, sum);
+#else
+        return add_scalar(data, length, sum);
+#endif
+    case Path::Sse2:
+#if defined(__SSE2__)
+        return add_sse2(data, length, sum);
+#else
+        break;
+#endif
+    case Path::Avx2:
+#ifdef NETLYZER_CHECKSUM_AVX2
+        if (cpu_has_avx2())
+            return add_avx2(data, length, sum);
+#endif
+        break;
+    case Path::Scalar:
+        break;
+    }
+    return add_scalar(data, length, sum);
+}
+
+uint16_t ChecksumVerifier::fold(uint64_t sum)
+{
+    while (sum >> 16)
+        sum = (sum & 0xffff) + (sum >> 16);
+    return static_cast<uint16_t>(sum);
+}
+
+void ChecksumVerifier::verify(const uint8_t* data, uint32_t caplen, DecodedPacket& packet,
+                              ChecksumCounters* counters)
+{
+    bool checked = false;
+    bool skipped = false;
+    uint32_t flags = 0;
+
+    // IPv4 headers: the packet's own, and the outer one of a tunnel. The
+    // decoder has already made sure the packet's header is captured.
+    if (packet.has(DecodedPacket::IPV4)) {
+        checked = true;
+        const uint8_t* header = data + packet.network_offset;
+        if (!header_ok(header, (header[0] & 0x0f) * 4u))
+            flags |= DecodedPacket::BAD_IP_CHECKSUM;
+    }
+    if (packet.outer_network_offset != 0) {
+        const uint8_t* header = data + packet.outer_network_offset;
+        const size_t length = (header[0] & 0x0f) * 4u;
+        if ((header[0] >> 4) == 4 && packet.outer_network_offset + length <= caplen) {
+            checked = true;
+            if (!header_ok(header, length))
+                flags |= DecodedPacket::BAD_IP_CHECKSUM;
+        }
+    }
+
+    const bool tcp = packet.has(DecodedPacket::TCP);
+    const bool udp = packet.has(DecodedPacket::UDP);
+    const bool icmp = packet.has(DecodedPacket::ICMP);
+    const bool icmpv6 = packet.has(DecodedPacket::ICMPV6);
+    if ((tcp || udp || icmp || icmpv6) && packet.has(DecodedPacket::FRAGMENT)) {
+        // The checksum covers the whole datagram, not this fragment.
+        skipped = true;
+    } else if (tcp || udp || icmp || icmpv6) {
+        const size_t start = packet.transport_offset;
+        const size_t length = udp ? load_be16(data + start + 4)
+                                  : static_cast<size_t>(packet.payload_offset) + packet.payload_length - start;
+        const size_t minimum = tcp ? TCP_MIN_LENGTH : (udp ? UDP_HEADER_LENGTH : ICMP_MIN_LENGTH);
+        const size_t field = tcp ? TCP_CHECKSUM_OFFSET : (udp ? UDP_CHECKSUM_OFFSET : ICMP_CHECKSUM_OFFSET);
+
+        if (length < minimum || start + length > caplen) {
+            skipped = true;
+        } else if (udp && load_native16(data + start + field) == 0) {
+            // Zero means "not computed" over IPv4 and is invalid over IPv6.
+            checked = true;
+            if (packet.has(DecodedPacket::IPV6))
+                flags |= DecodedPacket::BAD_L4_CHECKSUM;
+        } else {
+            checked = true;
+            const bool has_pseudo_header = !icmp;
+            const uint64_t pseudo = has_pseudo_header ? pseudo_header_sum(packet, length) : 0;
+            if (fold(add(data + start, length, pseudo)) != 0xffff) {
+                if (has_pseudo_header && load_native16(data + start + field) == fold(pseudo))
+                    flags |= DecodedPacket::CHECKSUM_OFFLOAD;
+                else
+                    flags |= DecodedPacket::BAD_L4_CHECKSUM;
+            }
+        }
+    }
+
+    if (checked && !skipped)
+        flags |= DecodedPacket::CHECKSUM_VERIFIED;
+    packet.flags |= flags;
+
+    if (counters) {
+        if (checked)
+            counters->verified.fetch_add(1, std::memory_order_relaxed);
+        if (skipped)
+            counters->unverifiable.fetch_add(1, std::memory_order_relaxed);
+        if (flags & DecodedPacket::BAD_IP_CHECKSUM)
+            counters->bad_ip.fetch_add(1, std::memory_order_relaxed);
+        if (flags & DecodedPacket::BAD_L4_CHECKSUM)
+            counters->bad_l4.fetch_add(1, std::memory_order_relaxed);
+        if (flags & DecodedPacket::CHECKSUM_OFFLOAD)
+            counters->offloaded.fetch_add(1, std::memory_order_relaxed);
+    }
+}
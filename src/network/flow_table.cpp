@@ -0,0 +1,515 @@
+#include "netlyzer/network/flow_table.h"
+#include <algorithm>
+#include <cstring>
+#include <new>
+#include <sys/mman.h>
+
+namespace {
+
+constexpr uint8_t PROTO_TCP = 6;
+
+constexpr uint8_t TCP_FIN = 0x01;
+constexpr uint8_t TCP_SYN = 0x02;
+constexpr uint8_t TCP_RST = 0x04;
+constexpr uint8_t TCP_ACK = 0x10;
+
+constexpr uint32_t NO_SLOT = 0xffffffffu;
+constexpr uint16_t NO_BUCKET = 0xffff;
+
+// Occupied slots looked at, from the home position, for a flow to evict.
+constexpr size_t EVICTION_WINDOW = 8;
+
+// Packets a batch update prefetches ahead of the one it is counting.
+constexpr size_t PREFETCH_DISTANCE = 8;
+
+inline uint64_t mix(uint64_t hash)
+{
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    hash *= 0xc4ceb9fe1a85ec53ull;
+    return hash ^ (hash >> 33);
+}
+
+// Keys are compared a word at a time; Key is padded to a whole number of them.
+inline bool same_key(const FlowTable::Key& a, const FlowTable::Key& b)
+{
+    const char* x = reinterpret_cast<const char*>(&a);
+    const char* y = reinterpret_cast<const char*>(&b);
+    uint64_t diff = 0;
+    for (size_t i = 0; i < sizeof(FlowTable::Key); i += 8) {
+        uint64_t u;
+        uint64_t v;
+        std::memcpy(&u, x + i, 8);
+        std::memcpy(&v, y + i, 8);
+        diff |= u ^ v;
+    }
+    return diff == 0;
+}
+
+inline void store_be32(uint8_t* p, uint32_t value)
+{
+    p[0] = static_cast<uint8_t>(value >> 24);
+    p[1] = static_cast<uint8_t>(value >> 16);
+    p[2] = static_cast<uint8_t>(value >> 8);
+    p[3] = static_cast<uint8_t>(value);
+}
+
+} // namespace
+
+void FlowTable::Statistics::accumulate(const Statistics& other)
+{
+    packets += other.packets;
+    flows += other.flows;
+    active += other.active;
+    idle_expired += other.idle_expired;
+    closed_expired += other.closed_expired;
+    active_reports += other.active_reports;
+    evicted += other.evicted;
+}
+
+FlowTable::FlowTable()
+    : FlowTable(Config())
+{
+}
+
+FlowTable::FlowTable(const Config& config)
+    : config_(config)
+{
+    size_t capacity = 16;
+    while (capacity * 2 <= config_.capacity && capacity * 2 <= NO_SLOT)
+        capacity *= 2;
+    if (config_.tick_ns == 0)
+        config_.tick_ns = 1;
+
+    // Anonymous pages come zeroed; transparent huge pages spare the TLB a
+    // miss on nearly every lookup into a large table.
+    mapped_bytes_ = capacity * sizeof(Slot);
+    void* map = mmap(nullptr, mapped_bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (map == MAP_FAILED)
+        throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+    madvise(map, mapped_bytes_, MADV_HUGEPAGE);
+#endif
+    slots_ = static_cast<Slot*>(map);
+    for (size_t i = 0; i < capacity; ++i) {
+        slots_[i].hash = 0;
+        slots_[i].timer_bucket = NO_BUCKET;
+        slots_[i].flow.key.family = 0;
+    }
+    mask_ = capacity - 1;
+    max_size_ = capacity - capacity / 8;
+    std::fill(std::begin(wheel_), std::end(wheel_), NO_SLOT);
+}
+
+FlowTable::~FlowTable()
+{
+    munmap(slots_, mapped_bytes_);
+}
+
+uint32_t FlowTable::hash_key(const uint64_t* words)
+{
+    // Independent multiplies, so the five words hash in parallel.
+    const uint64_t hash = words[0] * 0x9e3779b97f4a7c15ull ^ words[1] * 0xc2b2ae3d27d4eb4full
+                        ^ words[2] * 0x165667b19e3779f9ull ^ words[3] * 0x85ebca77c2b2ae63ull
+                        ^ words[4] * 0x27d4eb2f165667c5ull;
+    return static_cast<uint32_t>(mix(hash));
+}
+
+void FlowTable::make_probe(const uint8_t* source, const uint8_t* dest, uint16_t source_port, uint16_t dest_port,
+                           uint8_t protocol, uint8_t family, Probe& probe)
+{
+    // The key is built and written as whole words: byte stores followed by
+    // word loads would stall store forwarding on every lookup.
+    uint64_t from[2] = {0, 0};
+    uint64_t to[2] = {0, 0};
+    if (family == 4) {
+        std::memcpy(from, source, 4);
+        std::memcpy(to, dest, 4);
+    } else {
+        std::memcpy(from, source, 16);
+        std::memcpy(to, dest, 16);
+    }
+    bool swap;
+    if (from[0] != to[0])
+        swap = from[0] > to[0];
+    else if (from[1] != to[1])
+        swap = from[1] > to[1];
+    else
+        swap = source_port > dest_port;
+    probe.from = swap ? 1 : 0;
+
+    const uint16_t low_port = swap ? dest_port : source_port;
+    const uint16_t high_port = swap ? source_port : dest_port;
+    uint64_t words[5];
+    words[0] = swap ? to[0] : from[0];
+    words[1] = swap ? to[1] : from[1];
+    words[2] = swap ? from[0] : to[0];
+    words[3] = swap ? from[1] : to[1];
+    Key tail;
+    tail.port[0] = low_port;
+    tail.port[1] = high_port;
+    tail.protocol = protocol;
+    tail.family = family;
+    tail.reserved = 0;
+    std::memcpy(&words[4], tail.port, 8);
+    std::memcpy(&probe.key, words, sizeof(words));
+    probe.hash = hash_key(words);
+}
+
+void FlowTable::update(const DecodedPacket& packet, uint64_t timestamp_ns)
+{
+    if (!packet.is_ip())
+        return;
+    Probe probe;
+    make_probe(packet.source_address, packet.dest_address, packet.source_port, packet.dest_port,
+               packet.ip_protocol, packet.has(DecodedPacket::IPV4) ? 4 : 6, probe);
+    if (!started_ || timestamp_ns >= tick_ * config_.tick_ns)
+        run_timers(timestamp_ns);
+    touch(probe, timestamp_ns, packet.wire_length, packet.tcp_flags);
+    publish();
+}
+
+void FlowTable::update(const TupleBatch& batch)
+{
+    Probe probes[TupleBatch::CAPACITY];
+    uint16_t rows[TupleBatch::CAPACITY];
+    size_t count = 0;
+
+    for (size_t i = 0; i < batch.count; ++i) {
+        const uint8_t family = batch.family[i];
+        if (family == TupleBatch::OTHER)
+            continue;
+        if (family == TupleBatch::IPV4) {
+            uint8_t source[4];
+            uint8_t dest[4];
+            store_be32(source, batch.source_ipv4[i]);
+            store_be32(dest, batch.dest_ipv4[i]);
+            make_probe(source, dest, batch.source_port[i], batch.dest_port[i], batch.protocol[i], 4, probes[count]);
+        } else {
+            make_probe(batch.source_ipv6[i], batch.dest_ipv6[i], batch.source_port[i], batch.dest_port[i],
+                       batch.protocol[i], 6, probes[count]);
+        }
+        rows[count++] = static_cast<uint16_t>(i);
+    }
+
+    // Prefetch a few packets ahead: enough to keep the line fill buffers
+    // busy, not so many that the lines are evicted again before use.
+    for (size_t i = 0; i < std::min(count, PREFETCH_DISTANCE); ++i)
+        prefetch(probes[i].hash);
+    for (size_t i = 0; i < count; ++i) {
+        if (i + PREFETCH_DISTANCE < count)
+            prefetch(probes[i + PREFETCH_DISTANCE].hash);
+        const size_t row = rows[i];
+        const uint64_t timestamp_ns = batch.timestamp_ns[row];
+        if (!started_ || timestamp_ns >= tick_ * config_.tick_ns)
+            run_timers(timestamp_ns);
+        touch(probes[i], timestamp_ns, batch.wire_length[row], batch.tcp_flags[row]);
+    }
+    publish();
+}
+
+void FlowTable::prefetch(uint32_t hash) const
+{
+    const char* home = reinterpret_cast<const char*>(&slots_[hash & mask_]);
+    __builtin_prefetch(home, 1);
+    __builtin_prefetch(home + 64, 1);
+}
+
+void FlowTable::touch(const Probe& probe, uint64_t timestamp_ns, uint32_t length, uint8_t tcp_flags)
+{
+    ++stats_.packets;
+    bool created = false;
+    const size_t index = find_or_insert(probe, created);
+    Flow& flow = slots_[index].flow;
+    const uint8_t from = probe.from;
+    const bool tcp = probe.key.protocol == PROTO_TCP;
+    const bool syn = (tcp_flags & TCP_SYN) != 0;
+    const bool ack = (tcp_flags & TCP_ACK) != 0;
+
+    if (created) {
+        flow.key = probe.key;
+        // A SYN-ACK seen first was sent by the side that was called.
+        flow.initiator = (tcp && syn && ack) ? from ^ 1 : from;
+        restart(flow, timestamp_ns);
+        flow.tcp_state = tcp ? TcpState::Established : TcpState::None;
+        ++stats_.flows;
+    } else if (tcp && syn && !ack && flow.tcp_state == TcpState::Closed) {
+        // The port pair is being reused: close out the old connection.
+        ++stats_.closed_expired;
+        ++stats_.flows;
+        if (callback_)
+            callback_(flow, Expiry::Closed);
+        flow.initiator = from;
+        restart(flow, timestamp_ns);
+        created = true;
+    }
+
+    ++flow.packets[from];
+    flow.bytes[from] += length;
+    if (timestamp_ns > flow.last_seen_ns)
+        flow.last_seen_ns = timestamp_ns;
+
+    if (tcp) {
+        flow.tcp_flags[from] |= tcp_flags;
+        const TcpState before = flow.tcp_state;
+        if ((tcp_flags & TCP_RST) || (flow.tcp_flags[0] & flow.tcp_flags[1] & TCP_FIN))
+            flow.tcp_state = TcpState::Closed;
+        else if (tcp_flags & TCP_FIN)
+            flow.tcp_state = before == TcpState::Closed ? before : TcpState::Closing;
+        else if (syn && !ack && created)
+            flow.tcp_state = TcpState::SynSent;
+        else if (syn && ack && (created || before == TcpState::SynSent))
+            flow.tcp_state = TcpState::SynReceived;
+        else if (!syn && (before == TcpState::SynSent || before == TcpState::SynReceived))
+            flow.tcp_state = TcpState::Established;
+
+        // Closing shortens the timeout, so the timer may now be too late.
+        if (!created && flow.tcp_state == TcpState::Closed && before != TcpState::Closed) {
+            unlink(index);
+            schedule(index);
+        }
+    }
+
+    if (created && slots_[index].timer_bucket == NO_BUCKET)
+        schedule(index);
+}
+
+void FlowTable::restart(Flow& flow, uint64_t timestamp_ns)
+{
+    flow.tcp_state = TcpState::None;
+    flow.tcp_flags[0] = flow.tcp_flags[1] = 0;
+    flow.packets[0] = flow.packets[1] = 0;
+    flow.bytes[0] = flow.bytes[1] = 0;
+    flow.first_seen_ns = timestamp_ns;
+    flow.last_seen_ns = timestamp_ns;
+}
+
+size_t FlowTable::lookup(const Probe& probe) const
+{
+    for (size_t index = probe.hash & mask_;; index = (index + 1) & mask_) {
+        const Slot& slot = slots_[index];
+        if (slot.flow.key.family == 0)
+            return NO_SLOT;
+        if (slot.hash == probe.hash && same_key(slot.flow.key, probe.key))
+            return index;
+    }
+}
+
+size_t FlowTable::find_or_insert(const Probe& probe, bool& created)
+{
+    for (;;) {
+        size_t index = probe.hash & mask_;
+        for (;; index = (index + 1) & mask_) {
+            const Slot& slot = slots_[index];
+            if (slot.flow.key.family == 0)
+                break;
+            if (slot.hash == probe.hash && same_key(slot.flow.key, probe.key)) {
+                created = false;
+                return index;
+            }
+        }
+        if (size_ < max_size_) {
+            Slot& slot = slots_[index];
+            slot.hash = probe.hash;
+            slot.timer_bucket = NO_BUCKET;
+            slot.flow.key = probe.key;
+            ++size_;
+            created = true;
+            return index;
+        }
+        evict(probe.hash);
+    }
+}
+
+void FlowTable::evict(uint32_t hash)
+{
+    size_t victim = NO_SLOT;
+    size_t seen = 0;
+    for (size_t index = hash & mask_, steps = 0; seen < EVICTION_WINDOW && steps <= mask_;
+         index = (index + 1) & mask_, ++steps) {
+        const Slot& slot = slots_[index];
+        if (slot.flow.key.family == 0)
+            continue;
+        ++seen;
+        if (victim == NO_SLOT || slot.flow.last_seen_ns < slots_[victim].flow.last_seen_ns)
+            victim = index;
+    }
+    ++stats_.evicted;
+    if (callback_)
+        callback_(slots_[victim].flow, Expiry::Evicted);
+    remove(victim);
+}
+
+void FlowTable::remove(size_t index)
+{
+    if (slots_[index].timer_bucket != NO_BUCKET)
+        unlink(index);
+
+    // Shift back every entry after the hole that may live there, so lookups
+    // never need tombstones.
+    size_t hole = index;
+    for (size_t next = (index + 1) & mask_; slots_[next].flow.key.family != 0; next = (next + 1) & mask_) {
+        const size_t home = slots_[next].hash & mask_;
+        if (((next - home) & mask_) >= ((next - hole) & mask_)) {
+            move_slot(next, hole);
+            hole = next;
+        }
+    }
+    slots_[hole].flow.key.family = 0;
+    slots_[hole].timer_bucket = NO_BUCKET;
+    --size_;
+}
+
+void FlowTable::move_slot(size_t from, size_t to)
+{
+    Slot& slot = slots_[to];
+    slot = slots_[from];
+    if (slot.timer_bucket == NO_BUCKET)
+        return;
+    if (slot.timer_prev != NO_SLOT)
+        slots_[slot.timer_prev].timer_next = static_cast<uint32_t>(to);
+    else
+        wheel_[slot.timer_bucket] = static_cast<uint32_t>(to);
+    if (slot.timer_next != NO_SLOT)
+        slots_[slot.timer_next].timer_prev = static_cast<uint32_t>(to);
+}
+
+const FlowTable::Flow* FlowTable::find(const DecodedPacket& packet) const
+{
+    if (!packet.is_ip())
+        return nullptr;
+    Probe probe;
+    make_probe(packet.source_address, packet.dest_address, packet.source_port, packet.dest_port,
+               packet.ip_protocol, packet.has(DecodedPacket::IPV4) ? 4 : 6, probe);
+    const size_t index = lookup(probe);
+    return index == NO_SLOT ? nullptr : &slots_[index].flow;
+}
+
+uint64_t FlowTable::deadline(const Flow& flow) const
+{
+    const uint64_t idle = flow.last_seen_ns
+                        + (flow.tcp_state == TcpState::Closed ? config_.closed_timeout_ns : config_.idle_timeout_ns);
+    return std::min(idle, flow.first_seen_ns + config_.active_timeout_ns);
+}
+
+void FlowTable::schedule(size_t index)
+{
+    // The first tick that starts after the deadline, placed on the lowest
+    // level whose span reaches it; higher levels cascade down as time passes.
+    uint64_t due = deadline(slots_[index].flow) / config_.tick_ns + 1;
+    if (due < tick_)
+        due = tick_;
+    const uint64_t horizon = uint64_t(1) << (WHEEL_BITS * WHEEL_LEVELS);
+    if (due - tick_ >= horizon)
+        due = tick_ + horizon - 1;
+
+    unsigned level = 0;
+    while ((due - tick_) >> (WHEEL_BITS * (level + 1)) != 0)
+        ++level;
+    const size_t bucket = (due >> (WHEEL_BITS * level)) & (WHEEL_BUCKETS - 1);
+    link(index, level * WHEEL_BUCKETS + bucket);
+}
+
+void FlowTable::link(size_t index, size_t bucket)
+{
+    Slot& slot = slots_[index];
+    slot.timer_bucket = static_cast<uint16_t>(bucket);
+    slot.timer_prev = NO_SLOT;
+    slot.timer_next = wheel_[bucket];
+    if (slot.timer_next != NO_SLOT)
+        slots_[slot.timer_next].timer_prev = static_cast<uint32_t>(index);
+    wheel_[bucket] = static_cast<uint32_t>(index);
+}
+
+void FlowTable::unlink(size_t index)
+{
+    Slot& slot = slots_[index];
+    if (slot.timer_prev != NO_SLOT)
+        slots_[slot.timer_prev].timer_next = slot.timer_next;
+    else
+        wheel_[slot.timer_bucket] = slot.timer_next;
+    if (slot.timer_next != NO_SLOT)
+        slots_[slot.timer_next].timer_prev = slot.timer_prev;
+    slot.timer_bucket = NO_BUCKET;
+}
+
+void FlowTable::advance(uint64_t now_ns)
+{
+    run_timers(now_ns);
+    publish();
+}
+
+void FlowTable::run_timers(uint64_t now_ns)
+{
+    const uint64_t target = now_ns / config_.tick_ns;
+    if (!started_ || size_ == 0) {
+        if (!started_ || target > tick_)
+            tick_ = target;
+        started_ = true;
+        return;
+    }
+    for (; tick_ <= target; ++tick_) {
+        // Higher levels first, so their flows land in this tick's bucket
+        // before it runs.
+        for (unsigned level = WHEEL_LEVELS - 1; level > 0; --level) {
+            if ((tick_ & ((uint64_t(1) << (WHEEL_BITS * level)) - 1)) == 0)
+                run_bucket(level * WHEEL_BUCKETS + ((tick_ >> (WHEEL_BITS * level)) & (WHEEL_BUCKETS - 1)));
+        }
+        run_bucket(tick_ & (WHEEL_BUCKETS - 1));
+    }
+}
+
+void FlowTable::run_bucket(size_t bucket)
+{
+    const uint64_t now = tick_ * config_.tick_ns;
+    while (wheel_[bucket] != NO_SLOT) {
+        const size_t index = wheel_[bucket];
+        unlink(index);
+        Flow& flow = slots_[index].flow;
+
+        const bool closed = flow.tcp_state == TcpState::Closed;
+        const uint64_t idle = flow.last_seen_ns + (closed ? config_.closed_timeout_ns : config_.idle_timeout_ns);
+        if (idle <= now) {
+            ++(closed ? stats_.closed_expired : stats_.idle_expired);
+            if (callback_)
+                callback_(flow, closed ? Expiry::Closed : Expiry::Idle);
+            remove(index);
+            continue;
+        }
+        if (flow.first_seen_ns + config_.active_timeout_ns <= now) {
+            ++stats_.active_reports;
+            if (callback_)
+                callback_(flow, Expiry::Active);
+            flow.packets[0] = flow.packets[1] = 0;
+            flow.bytes[0] = flow.bytes[1] = 0;
+            flow.first_seen_ns = now;
+        }
+        // Not due yet: packets kept it alive since it was scheduled.
+        schedule(index);
+    }
+}
+
+void FlowTable::publish()
+{
+    packets_.store(stats_.packets, std::memory_order_relaxed);
+    flows_.store(stats_.flows, std::memory_order_relaxed);
+    active_.store(size_, std::memory_order_relaxed);
+    idle_expired_.store(stats_.idle_expired, std::memory_order_relaxed);
+    closed_expired_.store(stats_.closed_expired, std::memory_order_relaxed);
+    active_reports_.store(stats_.active_reports, std::memory_order_relaxed);
+    evicted_.store(stats_.evicted, std::memory_order_relaxed);
+}
+
+FlowTable::Statistics FlowTable::get_statistics() const
+{
+    Statistics stats;
+    stats.packets = packets_.load(std::memory_order_relaxed);
+    stats.flows = flows_.load(std::memory_order_relaxed);
+    stats.active = active_.load(std::memory_order_relaxed);
+    stats.idle_expired = idle_expired_.load(std::memory_order_relaxed);
+    stats.closed_expired = closed_expired_.load(std::memory_order_relaxed);
+    stats.active_reports = active_reports_.load(std::memory_order_relaxed);
+    stats.evicted = evicted_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -0,0 +1,387 @@
+#include "netlyzer/network/fragment_reassembler.h"
+#include "netlyzer/network/checksum.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t PROTO_HOP_BY_HOP = 0;
+constexpr uint8_t PROTO_UDP = 17;
+constexpr uint8_t PROTO_ROUTING = 43;
+constexpr uint8_t PROTO_FRAGMENT = 44;
+constexpr uint8_t PROTO_DEST_OPTIONS = 60;
+
+constexpr size_t IPV4_HEADER_MIN = 20;
+constexpr size_t IPV6_HEADER_LENGTH = 40;
+constexpr size_t IPV6_FRAGMENT_LENGTH = 8;
+constexpr size_t UDP_HEADER_LENGTH = 8;
+constexpr unsigned MAX_EXTENSION_HEADERS = 8;
+
+// IP length fields are 16 bits wide.
+constexpr uint32_t MAX_DATAGRAM = 65535;
+
+// Enough for 8K NFS blocks and most EDNS answers without growing; the pool
+// rounds it up to its 9 KiB class.
+constexpr uint32_t INITIAL_DATAGRAM = 8192;
+
+inline uint16_t load_be16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t load_be32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+         | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline void store_be16(uint8_t* p, uint32_t value)
+{
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+} // namespace
+
+bool FragmentReassembler::Key::operator==(const Key& other) const
+{
+    return id == other.id && protocol == other.protocol && family == other.family
+        && std::memcmp(source, other.source, sizeof(source)) == 0
+        && std::memcmp(dest, other.dest, sizeof(dest)) == 0;
+}
+
+size_t FragmentReassembler::KeyHash::operator()(const Key& key) const
+{
+    uint64_t words[4];
+    std::memcpy(words, key.source, 16);
+    std::memcpy(words + 2, key.dest, 16);
+    uint64_t hash = (static_cast<uint64_t>(key.id) << 16) ^ (key.protocol << 8) ^ key.family;
+    for (uint64_t word : words)
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+void FragmentReassembler::Statistics::accumulate(const Statistics& other)
+{
+    fragments += other.fragments;
+    reassembled += other.reassembled;
+    timeouts += other.timeouts;
+    evictions += other.evictions;
+    overlaps += other.overlaps;
+    invalid += other.invalid;
+    pending += other.pending;
+    pending_bytes += other.pending_bytes;
+}
+
+FragmentReassembler::FragmentReassembler()
+    : FragmentReassembler(Config())
+{
+}
+
+FragmentReassembler::FragmentReassembler(const Config& config)
+    : config_(config)
+{
+}
+
+bool FragmentReassembler::parse(const uint8_t* data, uint32_t caplen, const DecodedPacket& packet,
+                                Fragment& fragment) const
+{
+    if (!packet.has(DecodedPacket::FRAGMENT) || packet.tunnel_depth != 0)
+        return false;
+
+    const size_t network = packet.network_offset;
+    std::memset(&fragment, 0, sizeof(fragment));
+    fragment.network_offset = packet.network_offset;
+
+    if (packet.has(DecodedPacket::IPV4)) {
+        if (network + IPV4_HEADER_MIN > caplen)
+            return false;
+        const uint8_t* ip = data + network;
+        const size_t header_length = (ip[0] & 0x0f) * 4u;
+        const size_t total_length = load_be16(ip + 2);
+        if (header_length < IPV4_HEADER_MIN || total_length < header_length || network + total_length > caplen)
+            return false;
+
+        const uint16_t fragment_field = load_be16(ip + 6);
+        fragment.key.family = 4;
+        std::memcpy(fragment.key.source, ip + 12, 4);
+        std::memcpy(fragment.key.dest, ip + 16, 4);
+        fragment.key.id = load_be16(ip + 4);
+        fragment.key.protocol = ip[9];
+        fragment.offset = (fragment_field & 0x1fffu) * 8;
+        fragment.more = (fragment_field & 0x2000) != 0;
+        fragment.payload = ip + header_length;
+        fragment.length = static_cast<uint32_t>(total_length - header_length);
+        fragment.headroom = static_cast<uint16_t>(network + header_length);
+        if (header_length + fragment.offset + fragment.length > MAX_DATAGRAM)
+            return false;
+    } else if (packet.has(DecodedPacket::IPV6)) {
+        if (network + IPV6_HEADER_LENGTH > caplen)
+            return false;
+        const uint8_t* ip = data + network;
+        const size_t end = network + IPV6_HEADER_LENGTH + load_be16(ip + 4);
+        if (end > caplen)
+            return false;
+
+        // Walk the unfragmentable part up to the fragment header, remembering
+        // which next-header field names it.
+        uint8_t next = ip[6];
+        size_t next_field = network + 6;
+        size_t at = network + IPV6_HEADER_LENGTH;
+        for (unsigned i = 0; next != PROTO_FRAGMENT; ++i) {
+            if (i == MAX_EXTENSION_HEADERS || at + 2 > end
+                || (next != PROTO_HOP_BY_HOP && next != PROTO_ROUTING && next != PROTO_DEST_OPTIONS))
+                return false;
+            next_field = at;
+            next = data[at];
+            at += (data[at + 1] + 1u) * 8;
+        }
+        if (at + IPV6_FRAGMENT_LENGTH > end)
+            return false;
+
+        const uint8_t* header = data + at;
+        fragment.key.family = 6;
+        std::memcpy(fragment.key.source, ip + 8, 16);
+        std::memcpy(fragment.key.dest, ip + 24, 16);
+        fragment.key.id = load_be32(header + 4);
+        fragment.key.protocol = header[0];
+        fragment.offset = load_be16(header + 2) & 0xfff8u;
+        fragment.more = (header[3] & 0x1) != 0;
+        fragment.payload = header + IPV6_FRAGMENT_LENGTH;
+        fragment.length = static_cast<uint32_t>(end - at - IPV6_FRAGMENT_LENGTH);
+        // The fragment header itself is left out of the reassembled frame.
+        fragment.headroom = static_cast<uint16_t>(at);
+        fragment.next_header_at = static_cast<uint16_t>(next_field);
+        if (at - network - IPV6_HEADER_LENGTH + fragment.offset + fragment.length > MAX_DATAGRAM)
+            return false;
+    } else {
+        return false;
+    }
+
+    // All but the last fragment carry a multiple of eight bytes.
+    if (fragment.more && (fragment.length == 0 || fragment.length % 8 != 0))
+        return false;
+
+    if (fragment.offset == 0 && fragment.key.protocol == PROTO_UDP && fragment.length >= UDP_HEADER_LENGTH) {
+        const uint32_t udp_length = load_be16(fragment.payload + 4);
+        if (udp_length >= fragment.length)
+            fragment.size_hint = udp_length;
+    }
+    return true;
+}
+
+bool FragmentReassembler::reserve(Datagram& datagram, uint16_t headroom, uint32_t end, uint32_t hint)
+{
+    const uint32_t capacity = datagram.buffer ? datagram.buffer.capacity() : 0;
+    if (datagram.buffer && headroom == datagram.headroom && headroom + end <= capacity)
+        return true;
+
+    const uint32_t received = datagram.ranges.empty() ? 0 : datagram.ranges.back().second;
+    uint32_t want = std::max({end, received, datagram.total});
+    if (hint > want)
+        want = hint;
+    else if (datagram.total == 0 && !datagram.buffer)
+        want = std::max(want, INITIAL_DATAGRAM);
+    else if (datagram.total == 0)
+        want = std::max(want, std::min(2 * (capacity - datagram.headroom), MAX_DATAGRAM));
+
+    PacketBuffer grown = PacketBufferPool::instance().allocate(headroom + want);
+    if (!grown)
+        return false;
+    if (grown.capacity() > capacity && !make_room(grown.capacity() - capacity, &datagram))
+        return false;
+
+    // Only growing past the first guess, or headers of a different length
+    // arriving with the first fragment, moves data that is already in place.
+    if (datagram.buffer) {
+        std::memcpy(grown.data(), datagram.buffer.data(), std::min(headroom, datagram.headroom));
+        for (const Range& range : datagram.ranges)
+            std::memcpy(grown.data() + headroom + range.first,
+                        datagram.buffer.data() + datagram.headroom + range.first, range.second - range.first);
+    }
+    held_bytes_ = held_bytes_ + grown.capacity() - capacity;
+    datagram.buffer = std::move(grown);
+    datagram.headroom = headroom;
+    return true;
+}
+
+bool FragmentReassembler::make_room(size_t bytes, const Datagram* keep)
+{
+    while (held_bytes_ + bytes > config_.max_bytes && !arrival_.empty()) {
+        auto it = datagrams_.find(arrival_.front());
+        if (&it->second == keep)
+            return false;
+        drop(it);
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+    }
+    return held_bytes_ + bytes <= config_.max_bytes;
+}
+
+void FragmentReassembler::drop(Map::iterator it)
+{
+    held_bytes_ -= it->second.buffer.capacity();
+    arrival_.erase(it->second.arrival);
+    datagrams_.erase(it);
+}
+
+PacketBuffer FragmentReassembler::finish(Map::iterator it)
+{
+    Datagram& datagram = it->second;
+    const uint32_t capacity = datagram.buffer.capacity();
+    PacketBuffer frame = std::move(datagram.buffer);
+    frame.set_size(datagram.headroom + datagram.total);
+
+    uint8_t* ip = frame.data() + datagram.network_offset;
+    if (it->first.family == 4) {
+        const size_t header_length = (ip[0] & 0x0f) * 4u;
+        store_be16(ip + 2, static_cast<uint32_t>(header_length + datagram.total));
+        ip[6] &= 0xc0;                  // keep DF and the reserved bit
+        ip[7] = 0;
+        ip[10] = ip[11] = 0;
+        const uint16_t checksum = static_cast<uint16_t>(
+            ~ChecksumVerifier::fold(ChecksumVerifier::add(ip, header_length)));
+        std::memcpy(ip + 10, &checksum, 2);
+    } else {
+        frame.data()[datagram.next_header_at] = it->first.protocol;
+        store_be16(ip + 4, datagram.headroom - datagram.network_offset - IPV6_HEADER_LENGTH + datagram.total);
+    }
+
+    held_bytes_ -= capacity;
+    arrival_.erase(datagram.arrival);
+    datagrams_.erase(it);
+    reassembled_.fetch_add(1, std::memory_order_relaxed);
+    return frame;
+}
+
+PacketBuffer FragmentReassembler::add(const uint8_t* data, uint32_t caplen, const DecodedPacket& packet,
+                                      uint64_t timestamp_ns)
+{
+    fragments_.fetch_add(1, std::memory_order_relaxed);
+    expire(timestamp_ns);
+
+    Fragment fragment;
+    if (!parse(data, caplen, packet, fragment)) {
+        invalid_.fetch_add(1, std::memory_order_relaxed);
+        return PacketBuffer();
+    }
+
+    auto it = datagrams_.find(fragment.key);
+    if (it == datagrams_.end()) {
+        if (datagrams_.size() >= config_.max_datagrams && !arrival_.empty()) {
+            drop(datagrams_.find(arrival_.front()));
+            evictions_.fetch_add(1, std::memory_order_relaxed);
+        }
+        it = datagrams_.emplace(fragment.key, Datagram()).first;
+        it->second.arrival = arrival_.insert(arrival_.end(), fragment.key);
+        it->second.first_seen_ns = timestamp_ns;
+    }
+    Datagram& datagram = it->second;
+
+    // The last fragment fixes the length; nothing may reach past it.
+    const uint32_t end = fragment.offset + fragment.length;
+    const uint32_t received = datagram.ranges.empty() ? 0 : datagram.ranges.back().second;
+    if ((!fragment.more && (received > end || (datagram.total != 0 && datagram.total != end)))
+        || (fragment.more && datagram.total != 0 && end > datagram.total)) {
+        invalid_.fetch_add(1, std::memory_order_relaxed);
+        drop(it);
+        publish();
+        return PacketBuffer();
+    }
+
+    bool overlaps = false;
+    for (const Range& range : datagram.ranges)
+        overlaps |= range.first < end && fragment.offset < range.second;
+    if (overlaps) {
+        overlaps_.fetch_add(1, std::memory_order_relaxed);
+        if (fragment.key.family == 6) {
+            drop(it);
+            publish();
+            return PacketBuffer();
+        }
+    }
+    if (!fragment.more)
+        datagram.total = end;
+
+    // Headers come from the first fragment; until it shows up, from whichever
+    // arrived first.
+    const bool take_headers = !datagram.buffer || (fragment.offset == 0 && !datagram.have_first);
+    const uint16_t headroom = take_headers ? fragment.headroom : datagram.headroom;
+    if (!reserve(datagram, headroom, end, fragment.size_hint)) {
+        evictions_.fetch_add(1, std::memory_order_relaxed);
+        drop(it);
+        publish();
+        return PacketBuffer();
+    }
+    if (take_headers) {
+        std::memcpy(datagram.buffer.data(), data, headroom);
+        datagram.network_offset = fragment.network_offset;
+        datagram.next_header_at = fragment.next_header_at;
+        datagram.have_first = fragment.offset == 0;
+    }
+
+    // Copy only what is not held yet; data that arrived first wins.
+    uint8_t* base = datagram.buffer.data() + datagram.headroom;
+    uint32_t position = fragment.offset;
+    for (const Range& range : datagram.ranges) {
+        if (range.second <= position)
+            continue;
+        if (range.first >= end)
+            break;
+        if (range.first > position)
+            std::memcpy(base + position, fragment.payload + (position - fragment.offset), range.first - position);
+        position = std::max(position, range.second);
+    }
+    if (position < end)
+        std::memcpy(base + position, fragment.payload + (position - fragment.offset), end - position);
+
+    // Insert and merge the new range.
+    auto& ranges = datagram.ranges;
+    ranges.insert(std::upper_bound(ranges.begin(), ranges.end(), Range(fragment.offset, end)),
+                  Range(fragment.offset, end));
+    size_t merged = 0;
+    for (size_t i = 1; i < ranges.size(); ++i) {
+        if (ranges[i].first <= ranges[merged].second)
+            ranges[merged].second = std::max(ranges[merged].second, ranges[i].second);
+        else
+            ranges[++merged] = ranges[i];
+    }
+    ranges.resize(merged + 1);
+
+    PacketBuffer frame;
+    if (datagram.total != 0 && ranges.size() == 1 && ranges[0].first == 0 && ranges[0].second == datagram.total)
+        frame = finish(it);
+    publish();
+    return frame;
+}
+
+void FragmentReassembler::expire(uint64_t now_ns)
+{
+    while (!arrival_.empty()) {
+        auto it = datagrams_.find(arrival_.front());
+        if (now_ns - it->second.first_seen_ns < config_.timeout_ns || now_ns < it->second.first_seen_ns)
+            break;
+        drop(it);
+        timeouts_.fetch_add(1, std::memory_order_relaxed);
+    }
+    publish();
+}
+
+void FragmentReassembler::publish()
+{
+    pending_.store(datagrams_.size(), std::memory_order_relaxed);
+    pending_bytes_.store(held_bytes_, std::memory_order_relaxed);
+}
+
+FragmentReassembler::Statistics FragmentReassembler::get_statistics() const
+{
+    Statistics stats;
+    stats.fragments = fragments_.load(std::memory_order_relaxed);
+    stats.reassembled = reassembled_.load(std::memory_order_relaxed);
+    stats.timeouts = timeouts_.load(std::memory_order_relaxed);
+    stats.evictions = evictions_.load(std::memory_order_relaxed);
+    stats.overlaps = overlaps_.load(std::memory_order_relaxed);
+    stats.invalid = invalid_.load(std::memory_order_relaxed);
+    stats.pending = pending_.load(std::memory_order_relaxed);
+    stats.pending_bytes = pending_bytes_.load(std::memory_order_relaxed);
+    return stats;
+}
@@ -1,56 +1,182 @@
 #include "netlyzer/network/packet_capture.h"
-#include "netlyzer/network/packet_parser.h"
+#include "netlyzer/utils/format.h"
+#include "netlyzer/core/timestamp_formatter.h"
 #include <QDateTime>
 #include <QDebug>
-#include <arpa/inet.h>
-#include <net/ethernet.h>
-#include <netinet/ip.h>
+#include <algorithm>
+
+namespace {
+
+// Longest a packet waits in the merge for a quieter interface to catch up.
+constexpr quint64 MERGE_DELAY_NS = 50000000;
+constexpr size_t MERGE_QUEUE_CAPACITY = 65536;
+
+// The GUI drains the merge at most this often and takes at most this many
+// records per frame; anything beyond that waits in the per-interface queues.
+constexpr int MERGE_INTERVAL_MS = 33;
+constexpr size_t MAX_RECORDS_PER_FRAME = 20000;
+
+// Recording buffers; the profile's record_buffer_mb says how many.
+constexpr size_t RECORD_BUFFER_SIZE = 4u << 20;
+
+constexpr quint32 TRANSPORT_FLAGS = DecodedPacket::TCP | DecodedPacket::UDP
+                                 | DecodedPacket::ICMP | DecodedPacket::ICMPV6;
+
+QString formatAddress(const DecodedPacket &decoded,
+                      size_t (*format)(const DecodedPacket &, char *))
+{
+    char text[PacketDecoder::ADDRESS_STRING_MAX];
+    size_t length = format(decoded, text);
+    return length ? QString::fromLatin1(text, static_cast<int>(length)) : QString("Unknown");
+}
+
+QString tcpFlagNames(quint8 flags)
+{
+    static const char *const names[] = { "FIN", "SYN", "RST", "PSH", "ACK", "URG", "ECE", "CWR" };
+    QStringList set;
+    for (int bit = 0; bit < 8; ++bit) {
+        if (flags & (1u << bit)) {
+            set << names[bit];
+        }
+    }
+    return set.join(", ");
+}
+
+// Only set when the profile verifies checksums.
+QString checksumNote(const DecodedPacket &decoded)
+{
+    if (decoded.has(DecodedPacket::BAD_IP_CHECKSUM)) {
+        return " [bad IP checksum]";
+    }
+    if (decoded.has(DecodedPacket::BAD_L4_CHECKSUM)) {
+        return " [bad checksum]";
+    }
+    if (decoded.has(DecodedPacket::CHECKSUM_OFFLOAD)) {
+        return " [checksum offloaded]";
+    }
+    return QString();
+}
+
+} // namespace
 
 PacketCapture::PacketCapture(QObject *parent)
     : QObject(parent)
-    , m_handle(nullptr)
-    , m_captureThread(new QThread(this))
+    , m_mergeTimer(new QTimer(this))
     , m_isCapturing(false)
     , m_packetCount(0)
 {
+    qRegisterMetaType<PacketRecord>();
+    m_mergeTimer->setInterval(MERGE_INTERVAL_MS);
+    connect(m_mergeTimer, &QTimer::timeout, this, &PacketCapture::drainMergedPackets);
 }
 
 PacketCapture::~PacketCapture()
 {
     stopCapture();
-    if (m_captureThread->isRunning()) {
-        m_captureThread->quit();
-        m_captureThread->wait();
-    }
 }
 
 bool PacketCapture::startCapture(const QString &interface)
 {
-    if (m_isCapturing) {
+    return startCapture(QStringList{interface});
+}
+
+bool PacketCapture::startCapture(const QStringList &interfaces)
+{
+    if (m_isCapturing || interfaces.isEmpty()) {
         return false;
     }
 
-    char errbuf[PCAP_ERRBUF_SIZE];
-    m_handle = pcap_open_live(interface.toUtf8().constData(), BUFSIZ, 1, 1000, errbuf);
-    
-    if (!m_handle) {
-        qDebug() << "Error opening interface:" << errbuf;
-        return false;
+    for (const QString &interface : interfaces) {
+        std::string error;
+        pcap_t *handle = open_capture(interface.toStdString(), m_profile, error);
+
+        if (!handle) {
+            qDebug() << "Error opening interface" << interface << ":" << error.c_str();
+            closeSources();
+            return false;
+        }
+        if (!error.empty()) {
+            qDebug() << "Opening interface" << interface << ":" << error.c_str();
+        }
+
+        auto source = std::make_unique<CaptureSource>();
+        source->capture = this;
+        source->id = static_cast<int>(m_sources.size());
+        source->name = interface;
+        source->handle = handle;
+        source->nanosecondTimestamps = has_nanosecond_timestamps(handle);
+
+        m_sources.push_back(std::move(source));
     }
 
-    m_interface = interface;
+    // Each interface reassembles on its own thread; the profile's cap is shared.
+    if (m_profile.reassembly_mb > 0) {
+        FragmentReassembler::Config config;
+        config.max_bytes = (static_cast<size_t>(m_profile.reassembly_mb) << 20) / m_sources.size();
+        for (auto &source : m_sources) {
+            source->reassembler = std::make_unique<FragmentReassembler>(config);
+        }
+    }
+    if (m_profile.flow_table_mb > 0) {
+        FlowTable::Config config;
+        config.capacity = std::max<size_t>(1, (static_cast<size_t>(m_profile.flow_table_mb) << 20)
+                                                  / m_sources.size() / FlowTable::SLOT_SIZE);
+        for (auto &source : m_sources) {
+            source->flows = std::make_unique<FlowTable>(config);
+        }
+    }
+
+    m_interfaces.clear();
+    for (auto &source : m_sources) {
+        m_interfaces.push_back({source->name.toStdString(),
+                                static_cast<uint16_t>(pcap_datalink(source->handle))});
+    }
+
+    // Packets go to disk from the capture threads as they arrive, ahead of
+    // the merge; the writer drops rather than hold a thread up.
+    m_recorder.reset();
+    m_recordingError.clear();
+    if (!m_recordPath.isEmpty()) {
+        CaptureWriter::Config config;
+        config.path = m_recordPath.toStdString();
+        config.format = m_recordPath.endsWith(".pcapng", Qt::CaseInsensitive)
+            ? CaptureWriter::Format::PcapNg : CaptureWriter::Format::Pcap;
+        config.snaplen = static_cast<uint32_t>(m_profile.snaplen);
+        config.interfaces = m_interfaces;
+        config.buffer_size = std::max(RECORD_BUFFER_SIZE, 2 * config.snaplen + size_t(4096));
+        config.buffer_count = std::max<size_t>(2, (static_cast<size_t>(m_profile.record_buffer_mb) << 20)
+                                                      / config.buffer_size);
+        config.rotate_bytes = static_cast<uint64_t>(m_profile.ring_file_mb) << 20;
+        config.rotate_seconds = static_cast<uint64_t>(m_profile.ring_file_seconds);
+        config.ring_files = static_cast<size_t>(m_profile.ring_files);
+
+        m_recorder = std::make_unique<CaptureWriter>();
+        if (!m_recorder->open(config)) {
+            m_recordingError = QString::fromStdString(m_recorder->last_error());
+            qDebug() << "Cannot record to" << m_recordPath << ":" << m_recordingError;
+            closeSources();
+            return false;
+        }
+    }
+
+    m_mergeBuffer = std::make_unique<ReorderBuffer<PacketRecord>>(
+        m_sources.size(), MERGE_QUEUE_CAPACITY, MERGE_DELAY_NS);
     m_isCapturing = true;
     m_packetCount = 0;
 
-    // Start capture in separate thread
-    auto *worker = new CaptureWorker(m_handle, this);
-    worker->moveToThread(m_captureThread);
-    
-    connect(m_captureThread, &QThread::started, worker, &CaptureWorker::startLoop);
-    connect(m_captureThread, &QThread::finished, worker, &QObject::deleteLater);
-    
-    m_captureThread->start();
-    
+    // One capture thread per interface
+    for (auto &source : m_sources) {
+        source->thread = new QThread(this);
+        auto *worker = new CaptureWorker(source.get());
+        worker->moveToThread(source->thread);
+
+        connect(source->thread, &QThread::started, worker, &CaptureWorker::startLoop);
+        connect(source->thread, &QThread::finished, worker, &QObject::deleteLater);
+
+        source->thread->start();
+    }
+
+    m_mergeTimer->start();
     return true;
 }
 
@@ -62,102 +188,263 @@ void PacketCapture::stopCapture()
 
     m_isCapturing = false;
     
-    if (m_handle) {
-        pcap_breakloop(m_handle);
+    for (auto &source : m_sources) {
+        pcap_breakloop(source->handle);
     }
-    
-    if (m_captureThread->isRunning()) {
-        m_captureThread->quit();
-        m_captureThread->wait();
+
+    for (auto &source : m_sources) {
+        if (source->thread && source->thread->isRunning()) {
+            source->thread->quit();
+            source->thread->wait();
+        }
     }
-    
-    if (m_handle) {
-        pcap_close(m_handle);
-        m_handle = nullptr;
+
+    m_mergeTimer->stop();
+    drainMergedPackets();
+
+    if (m_recorder) {
+        m_recorder->close();
+    }
+    closeSources();
+}
+
+void PacketCapture::closeSources()
+{
+    for (auto &source : m_sources) {
+        delete source->thread;
+        if (source->handle) {
+            pcap_close(source->handle);
+        }
+    }
+    m_sources.clear();
+}
+
+QString PacketCapture::interfaceName(int interfaceId) const
+{
+    if (interfaceId >= 0 && interfaceId < interfaceCount()) {
+        return m_sources[interfaceId]->name;
     }
+    return QString();
+}
+
+QVector<PacketCapture::InterfaceStatistics> PacketCapture::interfaceStatistics() const
+{
+    QVector<InterfaceStatistics> result;
+    for (const auto &source : m_sources) {
+        InterfaceStatistics stats;
+        stats.name = source->name;
+
+        struct pcap_stat ps;
+        if (source->handle && pcap_stats(source->handle, &ps) == 0) {
+            stats.received = ps.ps_recv;
+            stats.dropped = ps.ps_drop;
+            stats.interfaceDropped = ps.ps_ifdrop;
+        }
+        if (m_mergeBuffer) {
+            stats.queueDropped = m_mergeBuffer->dropped(source->id);
+        }
+        result.append(stats);
+    }
+    return result;
+}
+
+CaptureWriter::Statistics PacketCapture::recordingStatistics() const
+{
+    return m_recorder ? m_recorder->get_statistics() : CaptureWriter::Statistics();
+}
+
+FragmentReassembler::Statistics PacketCapture::reassemblyStatistics() const
+{
+    FragmentReassembler::Statistics stats;
+    for (const auto &source : m_sources) {
+        if (source->reassembler) {
+            stats.accumulate(source->reassembler->get_statistics());
+        }
+    }
+    return stats;
+}
+
+FlowTable::Statistics PacketCapture::flowStatistics() const
+{
+    FlowTable::Statistics stats;
+    for (const auto &source : m_sources) {
+        if (source->flows) {
+            stats.accumulate(source->flows->get_statistics());
+        }
+    }
+    return stats;
 }
 
 void PacketCapture::packetHandler(u_char *userData, const struct pcap_pkthdr *pkthdr, const u_char *packet)
 {
-    auto *capture = reinterpret_cast<PacketCapture*>(userData);
-    capture->processPacket(pkthdr, packet);
+    auto *source = reinterpret_cast<CaptureSource*>(userData);
+    source->capture->processPacket(source, pkthdr, packet);
+}
+
+QByteArray PacketCapture::packetData(const PacketRecord &record)
+{
+    if (record.buffer.empty()) {
+        return QByteArray();
+    }
+    return QByteArray::fromRawData(reinterpret_cast<const char*>(record.buffer.data()),
+                                   static_cast<int>(record.buffer.size()));
+}
+
+void PacketCapture::drainMergedPackets()
+{
+    if (!m_mergeBuffer) {
+        return;
+    }
+
+    // Runs on the GUI thread. Records come out of the k-way merge in
+    // timestamp order across all interfaces and are numbered in that order.
+    m_batch.clear();
+    auto collect = [this](quint64, PacketRecord &&record) {
+        record.number = static_cast<quint32>(++m_packetCount);
+        m_batch.append(record);
+    };
+
+    if (m_isCapturing) {
+        quint64 now = static_cast<quint64>(QDateTime::currentMSecsSinceEpoch()) * 1000000;
+        m_mergeBuffer->drain(collect, now, false, MAX_RECORDS_PER_FRAME);
+    } else {
+        m_mergeBuffer->drain(collect, 0, true);
+    }
+
+    if (!m_batch.isEmpty()) {
+        emit packetsCaptured(m_batch);
+    }
 }
 
-void PacketCapture::processPacket(const struct pcap_pkthdr *pkthdr, const u_char *packet)
+void PacketCapture::processPacket(CaptureSource *captureSource, const struct pcap_pkthdr *pkthdr, const u_char *packet)
 {
     if (!m_isCapturing) {
         return;
     }
 
-    m_packetCount++;
-    
-    QString timestamp = formatTimestamp(pkthdr->ts);
-    QString source = "Unknown";
-    QString destination = "Unknown";
-    QString protocol = "Unknown";
-    QString info = "";
-    
-    // Parse Ethernet header
-    if (pkthdr->len >= sizeof(struct ether_header)) {
-        const struct ether_header *eth = reinterpret_cast<const struct ether_header*>(packet);
-        
-        if (ntohs(eth->ether_type) == ETHERTYPE_IP && pkthdr->len >= sizeof(struct ether_header) + sizeof(struct ip)) {
-            const struct ip *ip_hdr = reinterpret_cast<const struct ip*>(packet + sizeof(struct ether_header));
-            
-            source = QString(inet_ntoa(ip_hdr->ip_src));
-            destination = QString(inet_ntoa(ip_hdr->ip_dst));
-            
-            switch (ip_hdr->ip_p) {
-                case IPPROTO_TCP:
-                    protocol = "TCP";
-                    break;
-                case IPPROTO_UDP:
-                    protocol = "UDP";
-                    break;
-                case IPPROTO_ICMP:
-                    protocol = "ICMP";
-                    break;
-                default:
-                    protocol = QString("IP (%1)").arg(ip_hdr->ip_p);
-                    break;
-            }
-            
-            info = parsePacketInfo(packet, pkthdr->len);
-        }
+    // Runs on the interface's capture thread: copy the frame once into a
+    // pooled buffer and decode it in a single pass. Strings are only built
+    // on the GUI thread for rows that are shown.
+    PacketRecord record;
+    record.timestampNs = TimestampFormatter::from_timeval(pkthdr->ts.tv_sec, pkthdr->ts.tv_usec,
+                                                          captureSource->nanosecondTimestamps);
+    record.length = pkthdr->len;
+    record.interfaceId = static_cast<quint8>(captureSource->id);
+
+    // The frame as captured, before any reassembly
+    if (m_recorder) {
+        m_recorder->write(record.timestampNs, pkthdr->len, static_cast<uint32_t>(captureSource->id),
+                          packet, pkthdr->caplen);
     }
-    
-    QByteArray packetData(reinterpret_cast<const char*>(packet), pkthdr->len);
-    
-    emit packetCaptured(m_packetCount, timestamp, source, destination, 
-                       protocol, pkthdr->len, info, packetData);
+
+    PacketDecoder::decode(packet, pkthdr->caplen, pkthdr->len, record.decoded);
+
+    // The fragment that completes a datagram carries the reassembled frame,
+    // which already sits in a pooled buffer.
+    if (captureSource->reassembler && record.decoded.has(DecodedPacket::FRAGMENT)) {
+        record.buffer = captureSource->reassembler->add(packet, pkthdr->caplen, record.decoded, record.timestampNs);
+    }
+    const u_char *bytes = packet;
+    quint32 caplen = pkthdr->caplen;
+    if (record.buffer) {
+        bytes = record.buffer.data();
+        caplen = record.buffer.size();
+        PacketDecoder::decode(bytes, caplen, caplen, record.decoded);
+        record.decoded.flags |= DecodedPacket::REASSEMBLED;
+    } else {
+        record.buffer = PacketBuffer::copy_of(packet, pkthdr->caplen);
+    }
+    if (record.buffer) {
+        record.capturedLength = caplen;
+    }
+
+    if (m_profile.verify_checksums) {
+        ChecksumVerifier::verify(bytes, caplen, record.decoded, &m_checksumCounters);
+    }
+    if (captureSource->flows) {
+        captureSource->flows->update(record.decoded, record.timestampNs);
+    }
+
+    m_mergeBuffer->push(captureSource->id, record.timestampNs, std::move(record));
 }
 
-QString PacketCapture::formatTimestamp(const struct timeval &tv)
+QString PacketCapture::formatSource(const PacketRecord &record)
 {
-    QDateTime dateTime = QDateTime::fromSecsSinceEpoch(tv.tv_sec);
-    return dateTime.toString("hh:mm:ss.zzz");
+    return formatAddress(record.decoded, PacketDecoder::format_source);
 }
 
-QString PacketCapture::parsePacketInfo(const u_char *packet, int length)
+QString PacketCapture::formatDestination(const PacketRecord &record)
 {
-    Q_UNUSED(packet)
-    Q_UNUSED(length)
-    
-    // TODO: Implement detailed packet info parsing
-    return "Packet data";
+    return formatAddress(record.decoded, PacketDecoder::format_dest);
+}
+
+QString PacketCapture::protocolName(const PacketRecord &record)
+{
+    const DecodedPacket &decoded = record.decoded;
+    if (decoded.is_ip() && !(decoded.flags & TRANSPORT_FLAGS)) {
+        return QString("IP (%1)").arg(decoded.ip_protocol);
+    }
+    return QString::fromLatin1(PacketDecoder::protocol_name(decoded));
+}
+
+QString PacketCapture::packetInfo(const PacketRecord &record, const QByteArray &data)
+{
+    const DecodedPacket &decoded = record.decoded;
+    const QString note = checksumNote(decoded);
+
+    if (decoded.has(DecodedPacket::TCP)) {
+        return QString("%1 \u2192 %2 [%3] Seq=%4 Ack=%5 Win=%6 Len=%7")
+            .arg(decoded.source_port)
+            .arg(decoded.dest_port)
+            .arg(tcpFlagNames(decoded.tcp_flags))
+            .arg(decoded.tcp_sequence)
+            .arg(decoded.tcp_acknowledgment)
+            .arg(decoded.tcp_window)
+            .arg(decoded.payload_length) + note;
+    }
+    if (decoded.has(DecodedPacket::UDP)) {
+        return QString("%1 \u2192 %2 Len=%3")
+            .arg(decoded.source_port).arg(decoded.dest_port).arg(decoded.payload_length) + note;
+    }
+    if (decoded.has(DecodedPacket::ICMP) || decoded.has(DecodedPacket::ICMPV6)) {
+        return QString("Type=%1 Code=%2").arg(decoded.icmp_type).arg(decoded.icmp_code) + note;
+    }
+    if (decoded.has(DecodedPacket::ARP)) {
+        const QString target = formatDestination(record);
+        const QString sender = formatSource(record);
+        if (decoded.arp_operation == 1) {
+            return QString("Who has %1? Tell %2").arg(target, sender);
+        }
+        if (decoded.arp_operation == 2 && data.size() >= decoded.network_offset + 14) {
+            char mac[netlyzer::MAC_STRING_LENGTH];
+            const uint8_t *sha = reinterpret_cast<const uint8_t *>(data.constData()) + decoded.network_offset + 8;
+            return QString("%1 is at %2").arg(sender,
+                QString::fromLatin1(mac, static_cast<int>(netlyzer::format_mac(sha, mac))));
+        }
+        return QString("ARP operation %1").arg(decoded.arp_operation);
+    }
+    if (decoded.has(DecodedPacket::FRAGMENT)) {
+        return "Fragmented IP datagram";
+    }
+    if (decoded.has(DecodedPacket::TRUNCATED)) {
+        return "Truncated";
+    }
+    if (decoded.has(DecodedPacket::MALFORMED)) {
+        return "Malformed";
+    }
+    return "";
 }
 
 // CaptureWorker implementation
-CaptureWorker::CaptureWorker(pcap_t *handle, PacketCapture *capture)
-    : m_handle(handle)
-    , m_capture(capture)
+CaptureWorker::CaptureWorker(PacketCapture::CaptureSource *source)
+    : m_source(source)
 {
 }
 
 void CaptureWorker::startLoop()
 {
-    if (m_handle) {
-        pcap_loop(m_handle, -1, PacketCapture::packetHandler, 
-                 reinterpret_cast<u_char*>(m_capture));
+    if (m_source && m_source->handle) {
+        pcap_loop(m_source->handle, -1, PacketCapture::packetHandler, 
+                 reinterpret_cast<u_char*>(m_source));
     }
 }
@@ -0,0 +1,537 @@
+#include "netlyzer/network/packet_decoder.h"
+#include "netlyzer/network/packet_parser.h"
+#include "netlyzer/utils/format.h"
+#include <cstring>
+#include <initializer_list>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<DecodedPacket>::value, "DecodedPacket is copied as raw bytes");
+static_assert(sizeof(DecodedPacket) <= 96, "DecodedPacket should stay compact");
+
+namespace {
+
+constexpr uint16_t TYPE_IPV4 = 0x0800;
+constexpr uint16_t TYPE_ARP = 0x0806;
+constexpr uint16_t TYPE_VLAN = 0x8100;
+constexpr uint16_t TYPE_QINQ = 0x88a8;
+constexpr uint16_t TYPE_QINQ_LEGACY = 0x9100;
+constexpr uint16_t TYPE_IPV6 = 0x86dd;
+constexpr uint16_t TYPE_BRIDGED_ETHERNET = 0x6558;    // GRE carrying whole frames
+
+constexpr uint8_t PROTO_HOP_BY_HOP = 0;
+constexpr uint8_t PROTO_ICMP = 1;
+constexpr uint8_t PROTO_TCP = 6;
+constexpr uint8_t PROTO_UDP = 17;
+constexpr uint8_t PROTO_ROUTING = 43;
+constexpr uint8_t PROTO_FRAGMENT = 44;
+constexpr uint8_t PROTO_GRE = 47;
+constexpr uint8_t PROTO_AUTH = 51;
+constexpr uint8_t PROTO_ICMPV6 = 58;
+constexpr uint8_t PROTO_DEST_OPTIONS = 60;
+
+constexpr uint16_t PORT_VXLAN = 4789;
+constexpr uint16_t PORT_VXLAN_LINUX = 8472;             // pre-IANA default of the Linux driver
+
+constexpr size_t ETHERNET_HEADER_LENGTH = 14;
+constexpr size_t VLAN_TAG_LENGTH = 4;
+constexpr size_t IPV6_HEADER_LENGTH = 40;
+constexpr size_t IPV6_EXTENSION_MIN = 8;
+constexpr size_t ARP_IPV4_LENGTH = 28;
+constexpr size_t ICMP_HEADER_LENGTH = 4;
+constexpr size_t GRE_HEADER_LENGTH = 4;
+constexpr size_t VXLAN_HEADER_LENGTH = 8;
+
+// A frame is given up on as malformed after this many layers, so a crafted
+// chain of tags, extension headers or tunnels cannot run away.
+constexpr unsigned MAX_LAYERS = 16;
+constexpr uint8_t MAX_TUNNEL_DEPTH = 2;
+
+inline uint16_t load_be16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t load_be32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+         | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+inline uint16_t clamp_length(long length)
+{
+    return static_cast<uint16_t>(length < 0 ? 0 : (length > 0xffff ? 0xffff : length));
+}
+
+// State threaded through the dissector chain.
+struct Cursor {
+    const uint8_t* data;
+    uint32_t caplen;
+    long end;               // where the current IP datagram says its payload stops
+    unsigned layers;
+    DecodedPacket& packet;
+};
+
+// Decodes the header at `offset` and hands the rest to the next dissector.
+using Dissector = void (*)(Cursor& cursor, size_t offset);
+
+// Protocol number to dissector, built at compile time. Open addressing with
+// linear probing; Size is a power of two and at least twice the number of
+// entries, so a lookup is one or two probes.
+template<typename Key, size_t Size>
+class DispatchTable {
+public:
+    static_assert((Size & (Size - 1)) == 0, "Size must be a power of two");
+
+    struct Entry {
+        Key key = 0;
+        Dissector dissector = nullptr;
+    };
+
+    constexpr DispatchTable(std::initializer_list<Entry> entries) : slots_()
+    {
+        // Tracked separately: comparing a function pointer with null is not
+        // a constant expression under -fsanitize=undefined.
+        bool taken[Size] = {};
+        for (const Entry& entry : entries) {
+            size_t i = slot(entry.key);
+            while (taken[i])
+                i = (i + 1) & (Size - 1);
+            slots_[i] = entry;
+            taken[i] = true;
+        }
+    }
+
+    Dissector find(Key key) const
+    {
+        for (size_t i = slot(key);; i = (i + 1) & (Size - 1)) {
+            if (!slots_[i].dissector)
+                return nullptr;
+            if (slots_[i].key == key)
+                return slots_[i].dissector;
+        }
+    }
+
+private:
+    static constexpr size_t slot(Key key)
+    {
+        return (static_cast<size_t>(key) ^ (static_cast<size_t>(key) >> 8)) & (Size - 1);
+    }
+
+    Entry slots_[Size];
+};
+
+void dissect_ethernet(Cursor& cursor, size_t offset);
+void dissect_vlan(Cursor& cursor, size_t offset);
+void dissect_arp(Cursor& cursor, size_t offset);
+void dissect_ipv4(Cursor& cursor, size_t offset);
+void dissect_ipv6(Cursor& cursor, size_t offset);
+void dissect_ipv6_options(Cursor& cursor, size_t offset);
+void dissect_ipv6_fragment(Cursor& cursor, size_t offset);
+void dissect_authentication(Cursor& cursor, size_t offset);
+void dissect_tcp(Cursor& cursor, size_t offset);
+void dissect_udp(Cursor& cursor, size_t offset);
+void dissect_icmp(Cursor& cursor, size_t offset);
+void dissect_gre(Cursor& cursor, size_t offset);
+void dissect_vxlan(Cursor& cursor, size_t offset);
+
+// GRE protocol types are ethertypes, so GRE dispatches through this table too.
+constexpr DispatchTable<uint16_t, 16> ETHERTYPES({
+    {TYPE_IPV4, dissect_ipv4},
+    {TYPE_IPV6, dissect_ipv6},
+    {TYPE_ARP, dissect_arp},
+    {TYPE_VLAN, dissect_vlan},
+    {TYPE_QINQ, dissect_vlan},
+    {TYPE_QINQ_LEGACY, dissect_vlan},
+    {TYPE_BRIDGED_ETHERNET, dissect_ethernet},
+});
+
+constexpr DispatchTable<uint8_t, 32> IP_PROTOCOLS({
+    {PROTO_HOP_BY_HOP, dissect_ipv6_options},
+    {PROTO_ROUTING, dissect_ipv6_options},
+    {PROTO_DEST_OPTIONS, dissect_ipv6_options},
+    {PROTO_FRAGMENT, dissect_ipv6_fragment},
+    {PROTO_AUTH, dissect_authentication},
+    {PROTO_TCP, dissect_tcp},
+    {PROTO_UDP, dissect_udp},
+    {PROTO_ICMP, dissect_icmp},
+    {PROTO_ICMPV6, dissect_icmp},
+    {PROTO_GRE, dissect_gre},
+});
+
+// Keyed by UDP destination port.
+constexpr DispatchTable<uint16_t, 8> UDP_PORTS({
+    {PORT_VXLAN, dissect_vxlan},
+    {PORT_VXLAN_LINUX, dissect_vxlan},
+});
+
+bool enter_layer(Cursor& cursor)
+{
+    if (++cursor.layers <= MAX_LAYERS)
+        return true;
+    cursor.packet.flags |= DecodedPacket::MALFORMED;
+    return false;
+}
+
+// Anything nobody claims is payload up to the end of the datagram.
+void set_payload(Cursor& cursor, size_t offset)
+{
+    cursor.packet.payload_offset = static_cast<uint16_t>(offset);
+    cursor.packet.payload_length = clamp_length(cursor.end - static_cast<long>(offset));
+}
+
+void dispatch_ethertype(Cursor& cursor, uint16_t ethertype, size_t offset)
+{
+    cursor.packet.ethertype = ethertype;
+    if (!enter_layer(cursor))
+        return;
+    if (Dissector dissector = ETHERTYPES.find(ethertype))
+        dissector(cursor, offset);
+    else
+        set_payload(cursor, offset);
+}
+
+void dispatch_ip_protocol(Cursor& cursor, uint8_t protocol, size_t offset)
+{
+    cursor.packet.ip_protocol = protocol;
+    cursor.packet.transport_offset = static_cast<uint16_t>(offset);
+    if (!enter_layer(cursor))
+        return;
+    if (Dissector dissector = IP_PROTOCOLS.find(protocol))
+        dissector(cursor, offset);
+    else
+        set_payload(cursor, offset);
+}
+
+// Starts over for the packet inside a tunnel, keeping only what describes
+// the capture and the outer frame. Returns false when nested too deep, in
+// which case the tunnel payload is left undecoded.
+bool enter_tunnel(Cursor& cursor, DecodedPacket::Flag tunnel, uint32_t tunnel_id)
+{
+    DecodedPacket& packet = cursor.packet;
+    if (packet.tunnel_depth >= MAX_TUNNEL_DEPTH)
+        return false;
+
+    const DecodedPacket outer = packet;
+    std::memset(&packet, 0, sizeof(packet));
+    packet.flags = (outer.flags & (DecodedPacket::VLAN | DecodedPacket::GRE | DecodedPacket::VXLAN
+                                   | DecodedPacket::TRUNCATED | DecodedPacket::MALFORMED))
+                 | tunnel;
+    packet.wire_length = outer.wire_length;
+    packet.captured_length = outer.captured_length;
+    packet.vlan_id = outer.vlan_id;
+    packet.vlan_count = outer.vlan_count;
+    packet.outer_network_offset = outer.outer_network_offset ? outer.outer_network_offset
+                                                             : outer.network_offset;
+    packet.tunnel_id = tunnel_id;
+    packet.tunnel_depth = static_cast<uint8_t>(outer.tunnel_depth + 1);
+    cursor.end = cursor.caplen;
+    return true;
+}
+
+void dissect_ethernet(Cursor& cursor, size_t offset)
+{
+    if (offset + ETHERNET_HEADER_LENGTH > cursor.caplen) {
+        cursor.packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    dispatch_ethertype(cursor, load_be16(cursor.data + offset + 12), offset + ETHERNET_HEADER_LENGTH);
+}
+
+void dissect_vlan(Cursor& cursor, size_t offset)
+{
+    DecodedPacket& packet = cursor.packet;
+    if (offset + VLAN_TAG_LENGTH > cursor.caplen) {
+        packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    if (!packet.has(DecodedPacket::VLAN))
+        packet.vlan_id = load_be16(cursor.data + offset) & 0x0fff;
+    packet.flags |= DecodedPacket::VLAN;
+    ++packet.vlan_count;
+    dispatch_ethertype(cursor, load_be16(cursor.data + offset + 2), offset + VLAN_TAG_LENGTH);
+}
+
+void dissect_arp(Cursor& cursor, size_t offset)
+{
+    // Ethernet/IPv4 ARP only, which is all that appears on these links.
+    DecodedPacket& packet = cursor.packet;
+    packet.network_offset = static_cast<uint16_t>(offset);
+    if (offset + ARP_IPV4_LENGTH > cursor.caplen) {
+        packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    const uint8_t* p = cursor.data + offset;
+    if (load_be16(p) != 1 || load_be16(p + 2) != TYPE_IPV4 || p[4] != 6 || p[5] != 4) {
+        packet.flags |= DecodedPacket::MALFORMED;
+        return;
+    }
+    packet.flags |= DecodedPacket::ARP;
+    packet.arp_operation = load_be16(p + 6);
+    std::memcpy(packet.source_address, p + 14, 4);
+    std::memcpy(packet.dest_address, p + 24, 4);
+}
+
+void dissect_ipv4(Cursor& cursor, size_t offset)
+{
+    DecodedPacket& packet = cursor.packet;
+    const uint8_t* data = cursor.data;
+    packet.network_offset = static_cast<uint16_t>(offset);
+
+    PacketParser::IPv4View ip;
+    if (!PacketParser::view_ipv4(data, cursor.caplen, offset, ip)) {
+        // Either the fixed header or its options are cut off, or the
+        // version/header length fields are nonsense.
+        const bool bad_fields = offset + 20 <= cursor.caplen
+                             && ((data[offset] >> 4) != 4 || (data[offset] & 0x0f) < 5);
+        packet.flags |= bad_fields ? DecodedPacket::MALFORMED : DecodedPacket::TRUNCATED;
+        return;
+    }
+
+    packet.flags |= DecodedPacket::IPV4;
+    packet.ttl = ip.ttl;
+    std::memcpy(packet.source_address, data + offset + 12, 4);
+    std::memcpy(packet.dest_address, data + offset + 16, 4);
+
+    if (ip.total_length < ip.header_length)
+        packet.flags |= DecodedPacket::MALFORMED;
+    cursor.end = static_cast<long>(offset) + ip.total_length;
+
+    // Only the first fragment carries the transport header.
+    if ((ip.flags & 0x1) || ip.fragment_offset != 0) {
+        packet.flags |= DecodedPacket::FRAGMENT;
+        if (ip.fragment_offset != 0) {
+            packet.ip_protocol = ip.protocol;
+            set_payload(cursor, ip.payload_offset);
+            return;
+        }
+    }
+    dispatch_ip_protocol(cursor, ip.protocol, ip.payload_offset);
+}
+
+void dissect_ipv6(Cursor& cursor, size_t offset)
+{
+    DecodedPacket& packet = cursor.packet;
+    packet.network_offset = static_cast<uint16_t>(offset);
+    if (offset + IPV6_HEADER_LENGTH > cursor.caplen) {
+        packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    const uint8_t* p = cursor.data + offset;
+    if ((p[0] >> 4) != 6) {
+        packet.flags |= DecodedPacket::MALFORMED;
+        return;
+    }
+
+    packet.flags |= DecodedPacket::IPV6;
+    packet.ttl = p[7];
+    std::memcpy(packet.source_address, p + 8, 16);
+    std::memcpy(packet.dest_address, p + 24, 16);
+
+    const size_t payload = offset + IPV6_HEADER_LENGTH;
+    cursor.end = static_cast<long>(payload) + load_be16(p + 4);
+    dispatch_ip_protocol(cursor, p[6], payload);
+}
+
+// Hop-by-hop, routing and destination options share one layout: next
+// header, length in 8-byte units not counting the first.
+void dissect_ipv6_options(Cursor& cursor, size_t offset)
+{
+    if (!cursor.packet.has(DecodedPacket::IPV6)) {
+        set_payload(cursor, offset);
+        return;
+    }
+    if (offset + IPV6_EXTENSION_MIN > cursor.caplen) {
+        cursor.packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    const uint8_t* p = cursor.data + offset;
+    const size_t length = (static_cast<size_t>(p[1]) + 1) * 8;
+    dispatch_ip_protocol(cursor, p[0], offset + length);
+}
+
+void dissect_ipv6_fragment(Cursor& cursor, size_t offset)
+{
+    DecodedPacket& packet = cursor.packet;
+    if (!packet.has(DecodedPacket::IPV6)) {
+        set_payload(cursor, offset);
+        return;
+    }
+    if (offset + IPV6_EXTENSION_MIN > cursor.caplen) {
+        packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    const uint8_t* p = cursor.data + offset;
+    const uint16_t fragment_offset = load_be16(p + 2) & 0xfff8;
+    if (fragment_offset != 0 || (p[3] & 0x1))
+        packet.flags |= DecodedPacket::FRAGMENT;
+    if (fragment_offset != 0) {
+        packet.ip_protocol = p[0];
+        set_payload(cursor, offset + IPV6_EXTENSION_MIN);
+        return;
+    }
+    dispatch_ip_protocol(cursor, p[0], offset + IPV6_EXTENSION_MIN);
+}
+
+// AH (RFC 4302) can follow IPv4 or IPv6; its length is in 4-byte units
+// minus two. ESP is opaque and stays payload.
+void dissect_authentication(Cursor& cursor, size_t offset)
+{
+    if (offset + IPV6_EXTENSION_MIN > cursor.caplen) {
+        cursor.packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    const uint8_t* p = cursor.data + offset;
+    const size_t length = (static_cast<size_t>(p[1]) + 2) * 4;
+    dispatch_ip_protocol(cursor, p[0], offset + length);
+}
+
+void dissect_tcp(Cursor& cursor, size_t offset)
+{
+    DecodedPacket& packet = cursor.packet;
+    PacketParser::TCPView tcp;
+    if (!PacketParser::view_tcp(cursor.data, cursor.caplen, offset, tcp)) {
+        packet.flags |= offset + 20 > cursor.caplen ? DecodedPacket::TRUNCATED : DecodedPacket::MALFORMED;
+        return;
+    }
+    packet.flags |= DecodedPacket::TCP;
+    packet.source_port = tcp.source_port;
+    packet.dest_port = tcp.dest_port;
+    packet.tcp_sequence = tcp.sequence_number;
+    packet.tcp_acknowledgment = tcp.acknowledgment_number;
+    packet.tcp_flags = tcp.flags;
+    packet.tcp_window = tcp.window_size;
+    set_payload(cursor, tcp.payload_offset);
+}
+
+void dissect_udp(Cursor& cursor, size_t offset)
+{
+    DecodedPacket& packet = cursor.packet;
+    PacketParser::UDPView udp;
+    if (!PacketParser::view_udp(cursor.data, cursor.caplen, offset, udp)) {
+        packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    packet.flags |= DecodedPacket::UDP;
+    packet.source_port = udp.source_port;
+    packet.dest_port = udp.dest_port;
+    packet.payload_offset = udp.payload_offset;
+    packet.payload_length = clamp_length(static_cast<long>(udp.length) - 8);
+
+    if (Dissector dissector = UDP_PORTS.find(udp.dest_port)) {
+        if (enter_layer(cursor))
+            dissector(cursor, udp.payload_offset);
+    }
+}
+
+void dissect_icmp(Cursor& cursor, size_t offset)
+{
+    DecodedPacket& packet = cursor.packet;
+    if (offset + ICMP_HEADER_LENGTH > cursor.caplen) {
+        packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    packet.flags |= packet.ip_protocol == PROTO_ICMP ? DecodedPacket::ICMP : DecodedPacket::ICMPV6;
+    packet.icmp_type = cursor.data[offset];
+    packet.icmp_code = cursor.data[offset + 1];
+    set_payload(cursor, offset + ICMP_HEADER_LENGTH);
+}
+
+// RFC 2784/2890 GRE. Version 1 (PPTP), source-routed GRE and protocol
+// types without a dissector are left as payload.
+void dissect_gre(Cursor& cursor, size_t offset)
+{
+    if (offset + GRE_HEADER_LENGTH > cursor.caplen) {
+        cursor.packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    const uint8_t* p = cursor.data + offset;
+    const uint16_t flags = load_be16(p);
+    if ((flags & 0x7) != 0 || (flags & 0x4000)) {
+        set_payload(cursor, offset);
+        return;
+    }
+
+    const bool has_checksum = flags & 0x8000;
+    const bool has_key = flags & 0x2000;
+    const bool has_sequence = flags & 0x1000;
+    const size_t length = GRE_HEADER_LENGTH + (has_checksum ? 4 : 0) + (has_key ? 4 : 0)
+                        + (has_sequence ? 4 : 0);
+    if (offset + length > cursor.caplen) {
+        cursor.packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    set_payload(cursor, offset + length);
+
+    // A protocol type nothing here decodes (ERSPAN, PPP, ...) keeps the
+    // outer decode rather than an empty tunnel.
+    const uint16_t protocol = load_be16(p + 2);
+    if (!ETHERTYPES.find(protocol))
+        return;
+    const uint32_t key = has_key ? load_be32(p + GRE_HEADER_LENGTH + (has_checksum ? 4 : 0)) : 0;
+    if (enter_tunnel(cursor, DecodedPacket::GRE, key))
+        dispatch_ethertype(cursor, protocol, offset + length);
+}
+
+// RFC 7348. Frames without the valid-VNI flag stay UDP payload.
+void dissect_vxlan(Cursor& cursor, size_t offset)
+{
+    if (offset + VXLAN_HEADER_LENGTH > cursor.caplen) {
+        cursor.packet.flags |= DecodedPacket::TRUNCATED;
+        return;
+    }
+    const uint8_t* p = cursor.data + offset;
+    if (!(p[0] & 0x08))
+        return;
+    const uint32_t vni = load_be32(p + 4) >> 8;
+    if (enter_tunnel(cursor, DecodedPacket::VXLAN, vni))
+        dissect_ethernet(cursor, offset + VXLAN_HEADER_LENGTH);
+}
+
+size_t format_address(const DecodedPacket& packet, const uint8_t* address, char* out)
+{
+    if (packet.has(DecodedPacket::IPV6))
+        return netlyzer::format_ipv6(address, out);
+    if (packet.has(DecodedPacket::IPV4) || packet.has(DecodedPacket::ARP))
+        return netlyzer::format_ipv4(load_be32(address), out);
+    return 0;
+}
+
+} // namespace
+
+void PacketDecoder::decode(const uint8_t* data, uint32_t captured_length, uint32_t wire_length,
+                           DecodedPacket& packet)
+{
+    std::memset(&packet, 0, sizeof(packet));
+    packet.wire_length = wire_length;
+    packet.captured_length = captured_length;
+
+    Cursor cursor{data, captured_length, static_cast<long>(captured_length), 0, packet};
+    dissect_ethernet(cursor, 0);
+}
+
+bool PacketDecoder::is_tunnel_port(uint16_t port)
+{
+    return UDP_PORTS.find(port) != nullptr;
+}
+
+const char* PacketDecoder::protocol_name(const DecodedPacket& packet)
+{
+    if (packet.has(DecodedPacket::TCP)) return "TCP";
+    if (packet.has(DecodedPacket::UDP)) return "UDP";
+    if (packet.has(DecodedPacket::ICMP)) return "ICMP";
+    if (packet.has(DecodedPacket::ICMPV6)) return "ICMPv6";
+    if (packet.has(DecodedPacket::ARP)) return "ARP";
+    if (packet.has(DecodedPacket::IPV4)) return "IPv4";
+    if (packet.has(DecodedPacket::IPV6)) return "IPv6";
+    return "Ethernet";
+}
+
+size_t PacketDecoder::format_source(const DecodedPacket& packet, char* out)
+{
+    return format_address(packet, packet.source_address, out);
+}
+
+size_t PacketDecoder::format_dest(const DecodedPacket& packet, char* out)
+{
+    return format_address(packet, packet.dest_address, out);
+}
@@ -1,78 +1,214 @@
-
 #include "netlyzer/network/packet_parser.h"
+#include "netlyzer/utils/format.h"
+#include <cstring>
+#include <type_traits>
+
+static_assert(std::is_trivially_copyable<PacketParser::EthernetView>::value, "views must stay trivially copyable");
+static_assert(std::is_trivially_copyable<PacketParser::IPv4View>::value, "views must stay trivially copyable");
+static_assert(std::is_trivially_copyable<PacketParser::TCPView>::value, "views must stay trivially copyable");
+static_assert(std::is_trivially_copyable<PacketParser::UDPView>::value, "views must stay trivially copyable");
+
+namespace {
+
+constexpr size_t ETHERNET_HEADER_LENGTH = 14;
+constexpr size_t IPV4_MIN_HEADER_LENGTH = 20;
+constexpr size_t TCP_MIN_HEADER_LENGTH = 20;
+constexpr size_t UDP_HEADER_LENGTH = 8;
+
+// Packet bytes have no alignment guarantee, so fields are assembled bytewise.
+inline uint16_t load_be16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint32_t load_be32(const uint8_t* p)
+{
+    return (static_cast<uint32_t>(p[0]) << 24) | (static_cast<uint32_t>(p[1]) << 16)
+         | (static_cast<uint32_t>(p[2]) << 8) | p[3];
+}
+
+// The fixed part of each header, unchecked; the views check the lengths
+// first, the original API trusts its caller.
+void read_ipv4_fields(const uint8_t* p, PacketParser::IPv4View& view)
+{
+    const uint16_t fragment = load_be16(p + 6);
+    view.version = static_cast<uint8_t>(p[0] >> 4);
+    view.header_length = static_cast<uint8_t>((p[0] & 0x0f) * 4);
+    view.type_of_service = p[1];
+    view.total_length = load_be16(p + 2);
+    view.identification = load_be16(p + 4);
+    view.flags = static_cast<uint8_t>(fragment >> 13);
+    view.fragment_offset = static_cast<uint16_t>((fragment & 0x1fff) * 8);
+    view.ttl = p[8];
+    view.protocol = p[9];
+    view.checksum = load_be16(p + 10);
+    view.source = load_be32(p + 12);
+    view.dest = load_be32(p + 16);
+}
+
+void read_tcp_fields(const uint8_t* p, PacketParser::TCPView& view)
+{
+    view.source_port = load_be16(p);
+    view.dest_port = load_be16(p + 2);
+    view.sequence_number = load_be32(p + 4);
+    view.acknowledgment_number = load_be32(p + 8);
+    view.header_length = static_cast<uint8_t>((p[12] >> 4) * 4);
+    view.flags = p[13];
+    view.window_size = load_be16(p + 14);
+    view.checksum = load_be16(p + 16);
+    view.urgent_pointer = load_be16(p + 18);
+}
+
+} // namespace
+
+bool PacketParser::view_ethernet(const uint8_t* data, size_t caplen, EthernetView& view)
+{
+    if (caplen < ETHERNET_HEADER_LENGTH)
+        return false;
+
+    std::memcpy(view.dest.bytes, data, 6);
+    std::memcpy(view.source.bytes, data + 6, 6);
+    view.ethertype = load_be16(data + 12);
+    view.payload_offset = ETHERNET_HEADER_LENGTH;
+    return true;
+}
+
+bool PacketParser::view_ipv4(const uint8_t* data, size_t caplen, size_t offset, IPv4View& view)
+{
+    if (offset + IPV4_MIN_HEADER_LENGTH > caplen || offset > UINT16_MAX)
+        return false;
+
+    const uint8_t* p = data + offset;
+    const uint8_t header_length = static_cast<uint8_t>((p[0] & 0x0f) * 4);
+    if (header_length < IPV4_MIN_HEADER_LENGTH || offset + header_length > caplen)
+        return false;
+
+    read_ipv4_fields(p, view);
+    view.offset = static_cast<uint16_t>(offset);
+    view.payload_offset = static_cast<uint16_t>(offset + header_length);
+    return true;
+}
+
+bool PacketParser::view_tcp(const uint8_t* data, size_t caplen, size_t offset, TCPView& view)
+{
+    if (offset + TCP_MIN_HEADER_LENGTH > caplen || offset > UINT16_MAX)
+        return false;
+
+    const uint8_t* p = data + offset;
+    const uint8_t header_length = static_cast<uint8_t>((p[12] >> 4) * 4);
+    if (header_length < TCP_MIN_HEADER_LENGTH || offset + header_length > caplen)
+        return false;
+
+    read_tcp_fields(p, view);
+    view.offset = static_cast<uint16_t>(offset);
+    view.payload_offset = static_cast<uint16_t>(offset + header_length);
+    return true;
+}
+
+bool PacketParser::view_udp(const uint8_t* data, size_t caplen, size_t offset, UDPView& view)
+{
+    if (offset + UDP_HEADER_LENGTH > caplen || offset > UINT16_MAX)
+        return false;
+
+    const uint8_t* p = data + offset;
+    view.source_port = load_be16(p);
+    view.dest_port = load_be16(p + 2);
+    view.length = load_be16(p + 4);
+    view.checksum = load_be16(p + 6);
+    view.offset = static_cast<uint16_t>(offset);
+    view.payload_offset = static_cast<uint16_t>(offset + UDP_HEADER_LENGTH);
+    return true;
+}
+
+size_t PacketParser::format_mac(const MacAddress& mac, char* out)
+{
+    return netlyzer::format_mac(mac.bytes, out);
+}
+
+size_t PacketParser::format_ipv4(uint32_t address, char* out)
+{
+    return netlyzer::format_ipv4(address, out);
+}
+
+std::string PacketParser::mac_to_string(const MacAddress& mac)
+{
+    char text[MAC_STRING_LENGTH];
+    return std::string(text, format_mac(mac, text));
+}
+
+std::string PacketParser::ipv4_to_string(uint32_t address)
+{
+    char text[IPV4_STRING_MAX];
+    return std::string(text, format_ipv4(address, text));
+}
 
 PacketParser::EthernetHeader PacketParser::parse_ethernet(const uint8_t* data) {
+    EthernetView view;
+    view_ethernet(data, ETHERNET_HEADER_LENGTH, view);
+
     EthernetHeader header;
-    const struct ether_header* eth = reinterpret_cast<const struct ether_header*>(data);
-    
-    header.source_mac = mac_to_string(eth->ether_shost);
-    header.dest_mac = mac_to_string(eth->ether_dhost);
-    header.ethertype = ntohs(eth->ether_type);
-    
+    header.source_mac = mac_to_string(view.source);
+    header.dest_mac = mac_to_string(view.dest);
+    header.ethertype = view.ethertype;
     return header;
 }
 
 PacketParser::IPHeader PacketParser::parse_ip(const uint8_t* data) {
+    // The old API never knew the buffer length and returned the raw fields
+    // whatever the IHL said; a header length below the minimum is flagged.
+    IPv4View view = IPv4View();
+    read_ipv4_fields(data, view);
+
     IPHeader header;
-    const struct ip* ip_hdr = reinterpret_cast<const struct ip*>(data);
-    
-    header.version = ip_hdr->ip_v;
-    header.header_length = ip_hdr->ip_hl * 4;
-    header.type_of_service = ip_hdr->ip_tos;
-    header.total_length = ntohs(ip_hdr->ip_len);
-    header.identification = ntohs(ip_hdr->ip_id);
-    header.flags = ntohs(ip_hdr->ip_off) >> 13;
-    header.ttl = ip_hdr->ip_ttl;
-    header.protocol = ip_hdr->ip_p;
-    header.checksum = ntohs(ip_hdr->ip_sum);
-    
-    char src_ip[INET_ADDRSTRLEN], dst_ip[INET_ADDRSTRLEN];
-    inet_ntop(AF_INET, &(ip_hdr->ip_src), src_ip, INET_ADDRSTRLEN);
-    inet_ntop(AF_INET, &(ip_hdr->ip_dst), dst_ip, INET_ADDRSTRLEN);
-    
-    header.source_ip = src_ip;
-    header.dest_ip = dst_ip;
-    
+    header.version = view.version;
+    header.header_length = view.header_length;
+    header.type_of_service = view.type_of_service;
+    header.total_length = view.total_length;
+    header.identification = view.identification;
+    header.flags = view.flags;
+    header.ttl = view.ttl;
+    header.protocol = view.protocol;
+    header.checksum = view.checksum;
+    header.source_ip = ipv4_to_string(view.source);
+    header.dest_ip = ipv4_to_string(view.dest);
+    header.malformed = view.header_length < IPV4_MIN_HEADER_LENGTH;
     return header;
 }
 
 PacketParser::TCPHeader PacketParser::parse_tcp(const uint8_t* data) {
+    TCPView view = TCPView();
+    read_tcp_fields(data, view);
+
     TCPHeader header;
-    const struct tcphdr* tcp_hdr = reinterpret_cast<const struct tcphdr*>(data);
-    
-    header.source_port = ntohs(tcp_hdr->th_sport);
-    header.dest_port = ntohs(tcp_hdr->th_dport);
-    header.sequence_number = ntohl(tcp_hdr->th_seq);
-    header.acknowledgment_number = ntohl(tcp_hdr->th_ack);
-    header.header_length = tcp_hdr->th_off * 4;
-    header.flags = tcp_hdr->th_flags;
-    header.window_size = ntohs(tcp_hdr->th_win);
-    header.checksum = ntohs(tcp_hdr->th_sum);
-    header.urgent_pointer = ntohs(tcp_hdr->th_urp);
-    
+    header.source_port = view.source_port;
+    header.dest_port = view.dest_port;
+    header.sequence_number = view.sequence_number;
+    header.acknowledgment_number = view.acknowledgment_number;
+    header.header_length = view.header_length;
+    header.flags = view.flags;
+    header.window_size = view.window_size;
+    header.checksum = view.checksum;
+    header.urgent_pointer = view.urgent_pointer;
+    header.malformed = view.header_length < TCP_MIN_HEADER_LENGTH;
     return header;
 }
 
 PacketParser::UDPHeader PacketParser::parse_udp(const uint8_t* data) {
+    UDPView view;
+    view_udp(data, UDP_HEADER_LENGTH, 0, view);
+
     UDPHeader header;
-    const struct udphdr* udp_hdr = reinterpret_cast<const struct udphdr*>(data);
-    
-    header.source_port = ntohs(udp_hdr->uh_sport);
-    header.dest_port = ntohs(udp_hdr->uh_dport);
-    header.length = ntohs(udp_hdr->uh_ulen);
-    header.checksum = ntohs(udp_hdr->uh_sum);
-    
+    header.source_port = view.source_port;
+    header.dest_port = view.dest_port;
+    header.length = view.length;
+    header.checksum = view.checksum;
     return header;
 }
 
 std::string PacketParser::mac_to_string(const uint8_t* mac) {
-    std::stringstream ss;
-    ss << std::hex << std::setfill('0');
-    for (int i = 0; i < 6; ++i) {
-        if (i > 0) ss << ":";
-        ss << std::setw(2) << static_cast<unsigned>(mac[i]);
-    }
-    return ss.str();
+    MacAddress address;
+    std::memcpy(address.bytes, mac, sizeof(address.bytes));
+    return mac_to_string(address);
 }
 
 std::string PacketParser::protocol_to_string(uint8_t protocol) {
@@ -1,18 +1,59 @@
 
 #include "packet_sniffer.h"
+#include "netlyzer/network/packet_decoder.h"
 #include <net/ethernet.h>
 #include <netinet/ip.h>
-#include <netinet/tcp.h>
-#include <netinet/udp.h>
-#include <arpa/inet.h>
-#include <ctime>
-#include <sstream>
-#include <iomanip>
+#include <cstring>
 #include <iostream>
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <unistd.h>
+
+namespace {
+
+// Tries at other group ids when the one picked for a sniffer is taken.
+constexpr unsigned FANOUT_GROUP_ATTEMPTS = 8;
+
+// Fanout group ids are shared by every packet socket on the host. Each
+// sniffer without a configured id takes the next one after a base spread
+// from the process id, so sniffers in one process never share a group.
+std::atomic<uint32_t> next_fanout_offset{0};
+
+uint16_t next_fanout_group()
+{
+    const uint32_t base = static_cast<uint32_t>(getpid()) * 2654435761u >> 16;
+    for (;;) {
+        const uint16_t group = static_cast<uint16_t>(
+            base + next_fanout_offset.fetch_add(1, std::memory_order_relaxed));
+        if (group != 0)
+            return group;
+    }
+}
+
+// The kernel refuses to add a socket to a group of another mode,
+// protocol or device; such a group belongs to someone else.
+bool fanout_group_taken(int error_number)
+{
+    return error_number == EEXIST || error_number == EINVAL;
+}
+
+uint64_t realtime_ns()
+{
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+}
+
+} // namespace
 
 PacketSniffer::PacketSniffer() : handle_(nullptr),
+                                 ts_nanoseconds_(false),
+                                 backend_(Backend::Pcap),
+                                 started_(false),
                                  is_running_(false),
-                                 error_buffer_(PCAP_ERRBUF_SIZE, '\0')
+                                 workers_running_(false),
+                                 error_buffer_(PCAP_ERRBUF_SIZE, '\0'),
+                                 pcap_tuples_(make_unique<TupleBatch>())
 {
     statistics_ = {0, 0, 0};
 }
@@ -26,13 +67,62 @@ PacketSniffer::~PacketSniffer()
     }
 }
 
-bool PacketSniffer::init(const string &interface_name)
+bool PacketSniffer::init(const string &interface_name, Backend backend)
 {
-    handle_ = pcap_open_live(interface_name.c_str(), BUFSIZ, 1, 1000, error_buffer_.data());
+    backend_ = backend;
+    if (backend_ == Backend::TPacketV3) {
+        ring_workers_.clear();
+        TPacketRing::Config config = ring_config_;
+        config.promiscuous = capture_profile_.promiscuous;
+        if (capture_profile_.buffer_size_mb > 0)
+            config.block_count = std::max<uint32_t>(1,
+                (static_cast<uint32_t>(capture_profile_.buffer_size_mb) << 20) / config.block_size);
+        if (capture_profile_.immediate_mode)
+            config.block_timeout_ms = 1;
+        ts_nanoseconds_ = capture_profile_.nanosecond_timestamps;
+        const unsigned workers = fanout_config_.workers > 0 ? fanout_config_.workers : 1;
+        if (workers > 1) {
+            config.fanout_group = fanout_config_.group_id != 0
+                ? fanout_config_.group_id
+                : next_fanout_group();
+            config.fanout_mode = TPacketRing::FanoutMode::Hash;
+        }
+        for (unsigned i = 0; i < workers; ++i) {
+            auto worker = make_unique<RingWorker>();
+            worker->reassembler = make_reassembler(workers);
+            worker->flows = make_flow_table(workers);
+            bool opened = worker->ring.open(interface_name, config);
+            // The first socket creates the group; if a picked id is in use
+            // elsewhere, it moves on and the other workers follow it.
+            for (unsigned attempt = 1;
+                 !opened && i == 0 && workers > 1 && fanout_config_.group_id == 0
+                     && attempt < FANOUT_GROUP_ATTEMPTS
+                     && fanout_group_taken(worker->ring.last_error_number());
+                 ++attempt) {
+                config.fanout_group = next_fanout_group();
+                opened = worker->ring.open(interface_name, config);
+            }
+            if (!opened) {
+                std::cerr << "Error opening packet ring: " << worker->ring.last_error() << std::endl;
+                ring_workers_.clear();
+                return false;
+            }
+            ring_workers_.push_back(move(worker));
+        }
+        return true;
+    }
+
+    string error;
+    handle_ = open_capture(interface_name, capture_profile_, error);
     if (!handle_) {
-        std::cerr << "Error opening interface: " << error_buffer_ << std::endl;
+        std::cerr << "Error opening interface: " << error << std::endl;
         return false;
     }
+    if (!error.empty())
+        std::cerr << "Opening interface: " << error << std::endl;
+    ts_nanoseconds_ = has_nanosecond_timestamps(handle_);
+    pcap_reassembler_ = make_reassembler(1);
+    pcap_flows_ = make_flow_table(1);
 
     if (pcap_setnonblock(handle_, 1, error_buffer_.data()) != 0)
     {
@@ -47,9 +137,48 @@ bool PacketSniffer::init(const string &interface_name)
 
 bool PacketSniffer::start_capture(const string &filter)
 {
-    if (!handle_ || is_running_)
+    // A capture thread that stopped on an error is still to be joined.
+    if (started_ && !is_running_)
+        stop_capture();
+    if (started_)
         return false;
 
+    if (backend_ == Backend::TPacketV3)
+    {
+        if (ring_workers_.empty())
+            return false;
+        const string &ring_filter = filter.empty() ? capture_profile_.filter : filter;
+        for (auto &worker : ring_workers_) {
+            if (!ring_filter.empty() && !worker->ring.set_filter(ring_filter)) {
+                std::cerr << "Error setting filter: " << worker->ring.last_error() << std::endl;
+                return false;
+            }
+            if (!worker->loop.open(worker->ring.fd(), loop_config_)) {
+                std::cerr << "Error setting up capture loop: " << worker->loop.last_error() << std::endl;
+                return false;
+            }
+        }
+
+        reorder_buffer_.reset();
+        if (fanout_config_.ordered)
+            reorder_buffer_ = make_unique<ReorderBuffer<PacketData>>(
+                ring_workers_.size(), fanout_config_.reorder_capacity, fanout_config_.reorder_delay_ns);
+
+        started_ = true;
+        is_running_ = true;
+        workers_running_ = true;
+        if (reorder_buffer_)
+            reorder_thread_ = thread(&PacketSniffer::reorder_loop, this);
+        for (size_t i = 0; i < ring_workers_.size(); ++i)
+            ring_workers_[i]->capture_thread = thread(&PacketSniffer::ring_capture_loop, this, i);
+        return true;
+    }
+
+    if (!handle_)
+        return false;
+
+    // The profile's filter is already installed by open_capture; an explicit
+    // one replaces it.
     if (!filter.empty())
     {
         bpf_program fp;
@@ -66,6 +195,12 @@ bool PacketSniffer::start_capture(const string &filter)
         pcap_freecode(&fp);
     }
 
+    if (!event_loop_.open(pcap_get_selectable_fd(handle_), loop_config_)) {
+        std::cerr << "Error setting up capture loop: " << event_loop_.last_error() << std::endl;
+        return false;
+    }
+
+    started_ = true;
     is_running_ = true;
     capture_thread_ = thread(&PacketSniffer::capture_loop, this);
     return true;
@@ -73,13 +208,32 @@ bool PacketSniffer::start_capture(const string &filter)
 
 void PacketSniffer::stop_capture()
 {
-    if (is_running_)
+    // Keyed on started_, not is_running_, which a capture thread clears
+    // itself when pcap fails: its threads and loops still need tearing down.
+    if (started_)
     {
+        started_ = false;
         is_running_ = false;
+        event_loop_.wakeup();
+        for (auto &worker : ring_workers_)
+            worker->loop.wakeup();
         if (handle_)
             pcap_breakloop(handle_);
         if (capture_thread_.joinable())
             capture_thread_.join();
+        for (auto &worker : ring_workers_) {
+            if (worker->capture_thread.joinable())
+                worker->capture_thread.join();
+        }
+
+        // Workers are gone, so the reorder thread can flush what is left.
+        workers_running_ = false;
+        if (reorder_thread_.joinable())
+            reorder_thread_.join();
+
+        event_loop_.close();
+        for (auto &worker : ring_workers_)
+            worker->loop.close();
     }
 }
 
@@ -88,6 +242,16 @@ void PacketSniffer::set_packet_callback(PacketCallback callback)
     packet_callback_ = move(callback);
 }
 
+void PacketSniffer::set_frame_callback(FrameCallback callback)
+{
+    frame_callback_ = move(callback);
+}
+
+void PacketSniffer::set_tuple_batch_callback(TupleBatchCallback callback)
+{
+    tuple_batch_callback_ = move(callback);
+}
+
 vector<string> PacketSniffer::get_available_interfaces()
 {
     vector<string> interfaces;
@@ -116,7 +280,22 @@ vector<string> PacketSniffer::get_available_interfaces()
 
 PacketSniffer::Statistics PacketSniffer::get_statistics()
 {
-    if (handle_)
+    if (backend_ == Backend::TPacketV3 && !ring_workers_.empty())
+    {
+        uint64_t packets = 0;
+        uint64_t drops = 0;
+        for (auto &worker : ring_workers_) {
+            TPacketRing::Statistics stats = worker->ring.get_statistics();
+            packets += stats.packets;
+            drops += stats.drops;
+        }
+        if (reorder_buffer_)
+            drops += reorder_buffer_->get_statistics().dropped;
+        statistics_.packets_captured = static_cast<uint32_t>(packets);
+        statistics_.packets_dropped = static_cast<uint32_t>(drops);
+        statistics_.packets_dropped_by_interface = 0;
+    }
+    else if (handle_)
     {
         struct pcap_stat stats;
         if (pcap_stats(handle_, &stats) == 0)
@@ -129,27 +308,228 @@ PacketSniffer::Statistics PacketSniffer::get_statistics()
     return statistics_;
 }
 
+CaptureEventLoop::Statistics PacketSniffer::get_loop_statistics() const
+{
+    CaptureEventLoop::Statistics stats = event_loop_.get_statistics();
+    for (auto &worker : ring_workers_)
+        stats.accumulate(worker->loop.get_statistics());
+    return stats;
+}
+
+ReorderBuffer<PacketSniffer::PacketData>::Statistics PacketSniffer::get_reorder_statistics() const
+{
+    if (reorder_buffer_)
+        return reorder_buffer_->get_statistics();
+    return {};
+}
+
+FragmentReassembler::Statistics PacketSniffer::get_reassembly_statistics() const
+{
+    FragmentReassembler::Statistics stats;
+    if (pcap_reassembler_)
+        stats.accumulate(pcap_reassembler_->get_statistics());
+    for (auto &worker : ring_workers_) {
+        if (worker->reassembler)
+            stats.accumulate(worker->reassembler->get_statistics());
+    }
+    return stats;
+}
+
+unique_ptr<FragmentReassembler> PacketSniffer::make_reassembler(unsigned threads) const
+{
+    if (capture_profile_.reassembly_mb <= 0)
+        return nullptr;
+    // Each capture thread reassembles on its own; the profile's cap is shared.
+    FragmentReassembler::Config config;
+    config.max_bytes = (static_cast<size_t>(capture_profile_.reassembly_mb) << 20) / threads;
+    return make_unique<FragmentReassembler>(config);
+}
+
+FlowTable::Statistics PacketSniffer::get_flow_statistics() const
+{
+    FlowTable::Statistics stats;
+    if (pcap_flows_)
+        stats.accumulate(pcap_flows_->get_statistics());
+    for (auto &worker : ring_workers_) {
+        if (worker->flows)
+            stats.accumulate(worker->flows->get_statistics());
+    }
+    return stats;
+}
+
+unique_ptr<FlowTable> PacketSniffer::make_flow_table(unsigned threads) const
+{
+    if (capture_profile_.flow_table_mb <= 0)
+        return nullptr;
+    // Fanout hashes by flow, so every flow lives in one worker's table.
+    FlowTable::Config config;
+    config.capacity = std::max<size_t>(1, (static_cast<size_t>(capture_profile_.flow_table_mb) << 20)
+                                              / threads / FlowTable::SLOT_SIZE);
+    auto flows = make_unique<FlowTable>(config);
+    flows->set_expiry_callback(flow_expiry_callback_);
+    return flows;
+}
+
 void PacketSniffer::capture_loop()
 {
+    const size_t max_batch = loop_config_.max_batch;
     while (is_running_)
     {
-        int result = pcap_dispatch(handle_, 10, packet_handler, reinterpret_cast<u_char *>(this));
-        if (result < 0) {
-            std::cerr << "Error in packet capture: " << pcap_geterr(handle_) << std::endl;
+        // Drain everything libpcap has buffered before going back to sleep.
+        size_t batch = 0;
+        while (is_running_ && batch < max_batch)
+        {
+            int result = pcap_dispatch(handle_, -1, packet_handler, reinterpret_cast<u_char *>(this));
+            if (result == PCAP_ERROR_BREAK || result == 0)
+                break;
+            if (result < 0) {
+                std::cerr << "Error in packet capture: " << pcap_geterr(handle_) << std::endl;
+                is_running_ = false;
+                break;
+            }
+            batch += static_cast<size_t>(result);
+        }
+        flush_tuples(*pcap_tuples_, pcap_flows_.get());
+        event_loop_.record_batch(batch);
+        if (batch == 0 && pcap_flows_)
+            pcap_flows_->advance(realtime_ns());
+
+        if (batch == 0 && is_running_ && event_loop_.wait() == CaptureEventLoop::Event::Error) {
+            std::cerr << "Error waiting for packets: " << event_loop_.last_error() << std::endl;
             break;
         }
-        // Small delay to prevent CPU spinning
-        std::this_thread::sleep_for(std::chrono::milliseconds(10));
     }
 }
 
+void PacketSniffer::ring_capture_loop(size_t index)
+{
+    RingWorker &worker = *ring_workers_[index];
+    // The timeout the ring was opened with: 1 ms in immediate mode.
+    const uint64_t block_timeout_ns = static_cast<uint64_t>(worker.ring.config().block_timeout_ms) * 1000000;
+    const uint32_t snaplen = static_cast<uint32_t>(capture_profile_.snaplen);
+    auto on_block = [this, index, &worker, snaplen](const Frame *frames, size_t count) {
+        worker.frames.assign(frames, frames + count);
+        for (Frame &frame : worker.frames) {
+            if (frame.caplen > snaplen)
+                frame.caplen = snaplen;
+            handle_frame(frame, index);
+        }
+        if (tuple_batch_callback_ || worker.flows) {
+            deliver_tuples(worker.frames.data(), count, *worker.tuples, worker.flows.get());
+            flush_tuples(*worker.tuples, worker.flows.get());
+        }
+    };
+    while (is_running_)
+    {
+        // Drain the retired blocks, then sleep until the kernel retires
+        // another one or stop_capture wakes us up.
+        size_t batch = worker.ring.read_block_batches(on_block, loop_config_.max_batch);
+        worker.loop.record_batch(batch);
+        if (batch == 0 && worker.flows)
+            worker.flows->advance(realtime_ns());
+
+        if (batch == 0 && reorder_buffer_) {
+            // Anything still in a partially filled block is at most one
+            // retire timeout old, so the other workers need not wait for it.
+            uint64_t now = realtime_ns();
+            if (now > block_timeout_ns)
+                reorder_buffer_->advance(index, now - block_timeout_ns);
+        }
+
+        if (batch == 0 && is_running_ && worker.loop.wait() == CaptureEventLoop::Event::Error) {
+            std::cerr << "Error waiting for packets: " << worker.loop.last_error() << std::endl;
+            break;
+        }
+    }
+}
+
+void PacketSniffer::reorder_loop()
+{
+    auto deliver = [this](uint64_t, PacketData &&packet) {
+        if (packet_callback_)
+            packet_callback_(packet);
+    };
+    const auto idle_sleep = std::chrono::nanoseconds(
+        std::min<uint64_t>(fanout_config_.reorder_delay_ns / 4 + 1, 1000000));
+
+    while (workers_running_)
+    {
+        if (reorder_buffer_->drain(deliver, realtime_ns()) == 0)
+            std::this_thread::sleep_for(idle_sleep);
+    }
+    reorder_buffer_->drain(deliver, 0, true);
+}
+
+void PacketSniffer::handle_frame(const Frame &frame, size_t worker)
+{
+    if (frame_callback_)
+        frame_callback_(frame);
+
+    if (packet_callback_)
+    {
+        struct pcap_pkthdr header;
+        header.ts.tv_sec = frame.ts_sec;
+        header.ts.tv_usec = ts_nanoseconds_ ? frame.ts_nsec : frame.ts_nsec / 1000;
+        header.caplen = frame.caplen;
+        header.len = frame.len;
+        try {
+            PacketData packet = parse_packet(&header, frame.data, ring_workers_[worker]->reassembler.get());
+            if (reorder_buffer_) {
+                uint64_t timestamp = static_cast<uint64_t>(frame.ts_sec) * 1000000000 + frame.ts_nsec;
+                reorder_buffer_->push(worker, timestamp, move(packet));
+            } else {
+                packet_callback_(packet);
+            }
+        } catch (const std::exception& e) {
+            std::cerr << "Error parsing packet: " << e.what() << std::endl;
+        }
+    }
+}
+
+void PacketSniffer::deliver_tuples(const Frame *frames, size_t count, TupleBatch &batch, FlowTable *flows)
+{
+    while (count > 0) {
+        size_t taken = TupleExtractor::extract(frames, count, batch);
+        frames += taken;
+        count -= taken;
+        if (batch.full())
+            flush_tuples(batch, flows);
+    }
+}
+
+void PacketSniffer::flush_tuples(TupleBatch &batch, FlowTable *flows)
+{
+    if (batch.count == 0)
+        return;
+    if (flows)
+        flows->update(batch);
+    if (tuple_batch_callback_)
+        tuple_batch_callback_(batch);
+    batch.clear();
+}
+
 void PacketSniffer::packet_handler(u_char *user, const struct pcap_pkthdr *header, const u_char *packet)
 {
     auto *sniffer = reinterpret_cast<PacketSniffer *>(user);
+    if (sniffer->frame_callback_ || sniffer->tuple_batch_callback_ || sniffer->pcap_flows_)
+    {
+        Frame frame;
+        frame.data = packet;
+        frame.caplen = header->caplen;
+        frame.len = header->len;
+        frame.ts_sec = static_cast<uint32_t>(header->ts.tv_sec);
+        frame.ts_nsec = static_cast<uint32_t>(header->ts.tv_usec) * (sniffer->ts_nanoseconds_ ? 1 : 1000);
+        if (sniffer->frame_callback_)
+            sniffer->frame_callback_(frame);
+        // Tuples are copied out of the frame, so they can wait for the end
+        // of the pcap_dispatch round even though the bytes cannot.
+        if (sniffer->tuple_batch_callback_ || sniffer->pcap_flows_)
+            sniffer->deliver_tuples(&frame, 1, *sniffer->pcap_tuples_, sniffer->pcap_flows_.get());
+    }
     if (sniffer->packet_callback_)
     {
         try {
-            auto packet_data = sniffer->parse_packet(header, packet);
+            auto packet_data = sniffer->parse_packet(header, packet, sniffer->pcap_reassembler_.get());
             sniffer->packet_callback_(packet_data);
         } catch (const std::exception& e) {
             std::cerr << "Error parsing packet: " << e.what() << std::endl;
@@ -157,89 +537,71 @@ void PacketSniffer::packet_handler(u_char *user, const struct pcap_pkthdr *heade
     }
 }
 
-PacketSniffer::PacketData PacketSniffer::parse_packet(const struct pcap_pkthdr *header, const u_char *packet)
+PacketSniffer::PacketData PacketSniffer::parse_packet(const struct pcap_pkthdr *header, const u_char *packet,
+                                                      FragmentReassembler *reassembler)
 {
     PacketData data;
-    data.raw_data.assign(packet, packet + header->len);
     data.length = header->len;
+    data.timestamp_ns = TimestampFormatter::from_timeval(header->ts.tv_sec, header->ts.tv_usec, ts_nanoseconds_);
 
-    // Format timestamp
-    stringstream ss;
-    struct tm* timeinfo = localtime(&header->ts.tv_sec);
-    ss << put_time(timeinfo, "%H:%M:%S");
-    ss << "." << setfill('0') << setw(6) << header->ts.tv_usec;
-    data.timestamp = ss.str();
+    DecodedPacket& decoded = data.decoded;
+    PacketDecoder::decode(packet, header->caplen, header->len, decoded);
 
-    // Check if we have enough data for ethernet header
-    if (header->len < sizeof(struct ether_header)) {
-        data.protocol = "Invalid";
-        return data;
+    // The fragment that completes a datagram is reported as the whole
+    // datagram; length stays what was on the wire for this frame.
+    if (reassembler && decoded.has(DecodedPacket::FRAGMENT))
+        data.raw_data = reassembler->add(packet, header->caplen, decoded, data.timestamp_ns);
+    const u_char *bytes = packet;
+    uint32_t caplen = header->caplen;
+    if (data.raw_data) {
+        bytes = data.raw_data.data();
+        caplen = data.raw_data.size();
+        PacketDecoder::decode(bytes, caplen, caplen, decoded);
+        decoded.flags |= DecodedPacket::REASSEMBLED;
+    } else {
+        data.raw_data = PacketBuffer::copy_of(packet, header->caplen);
     }
+    if (capture_profile_.verify_checksums)
+        ChecksumVerifier::verify(bytes, caplen, decoded, &checksum_counters_);
 
-    const struct ether_header *eth_header = reinterpret_cast<const struct ether_header *>(packet);
-
-    if (ntohs(eth_header->ether_type) == ETHERTYPE_IP)
-    {
-        // Check if we have enough data for IP header
-        if (header->len < sizeof(struct ether_header) + sizeof(struct ip)) {
-            data.protocol = "Truncated IP";
-            return data;
-        }
-
-        const struct ip *ip_header = reinterpret_cast<const struct ip *>(packet + sizeof(struct ether_header));
-
-        // Validate IP header length
-        if (ip_header->ip_hl < 5) {
-            data.protocol = "Invalid IP";
-            return data;
+    const bool truncated = decoded.has(DecodedPacket::TRUNCATED);
+    if (!decoded.is_ip() && !decoded.has(DecodedPacket::ARP)) {
+        if (decoded.network_offset == 0) {
+            data.protocol = truncated ? "Invalid" : "Non-IP (" + to_string(decoded.ethertype) + ")";
+        } else {
+            data.protocol = string(truncated ? "Truncated " : "Invalid ")
+                          + (decoded.ethertype == ETHERTYPE_ARP ? "ARP" : "IP");
         }
+        return data;
+    }
 
-        char src_ip[INET_ADDRSTRLEN], dst_ip[INET_ADDRSTRLEN];
-        inet_ntop(AF_INET, &(ip_header->ip_src), src_ip, INET_ADDRSTRLEN);
-        inet_ntop(AF_INET, &(ip_header->ip_dst), dst_ip, INET_ADDRSTRLEN);
-
-        data.source_ip = src_ip;
-        data.dest_ip = dst_ip;
-
-        int ip_header_len = ip_header->ip_hl << 2;
+    char address[PacketDecoder::ADDRESS_STRING_MAX];
+    data.source_ip.assign(address, PacketDecoder::format_source(decoded, address));
+    data.dest_ip.assign(address, PacketDecoder::format_dest(decoded, address));
+    data.source_port = decoded.source_port;
+    data.dest_port = decoded.dest_port;
 
-        switch (ip_header->ip_p)
-        {
-        case IPPROTO_TCP:
-        {
-            if (header->len >= sizeof(struct ether_header) + ip_header_len + sizeof(struct tcphdr)) {
-                const struct tcphdr *tcp_header = reinterpret_cast<const struct tcphdr *>(
-                    packet + sizeof(struct ether_header) + ip_header_len);
-                data.protocol = "TCP";
-                data.source_port = ntohs(tcp_header->th_sport);
-                data.dest_port = ntohs(tcp_header->th_dport);
-            } else {
-                data.protocol = "TCP (truncated)";
-            }
-            break;
-        }
-        case IPPROTO_UDP:
-        {
-            if (header->len >= sizeof(struct ether_header) + ip_header_len + sizeof(struct udphdr)) {
-                const struct udphdr *udp_header = reinterpret_cast<const struct udphdr *>(
-                    packet + sizeof(struct ether_header) + ip_header_len);
-                data.protocol = "UDP";
-                data.source_port = ntohs(udp_header->uh_sport);
-                data.dest_port = ntohs(udp_header->uh_dport);
-            } else {
-                data.protocol = "UDP (truncated)";
-            }
-            break;
-        }
-        case IPPROTO_ICMP:
-            data.protocol = "ICMP";
-            break;
-        default:
-            data.protocol = "IP (" + to_string(ip_header->ip_p) + ")";
-        }
+    if (decoded.has(DecodedPacket::ARP)) {
+        data.protocol = "ARP";
+        return data;
     }
-    else {
-        data.protocol = "Non-IP (" + to_string(ntohs(eth_header->ether_type)) + ")";
+
+    switch (decoded.ip_protocol)
+    {
+    case IPPROTO_TCP:
+        data.protocol = decoded.has(DecodedPacket::TCP) ? "TCP" : "TCP (truncated)";
+        break;
+    case IPPROTO_UDP:
+        data.protocol = decoded.has(DecodedPacket::UDP) ? "UDP" : "UDP (truncated)";
+        break;
+    case IPPROTO_ICMP:
+        data.protocol = "ICMP";
+        break;
+    case IPPROTO_ICMPV6:
+        data.protocol = "ICMPv6";
+        break;
+    default:
+        data.protocol = "IP (" + to_string(decoded.ip_protocol) + ")";
     }
 
     return data;
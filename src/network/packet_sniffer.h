@@ -5,21 +5,42 @@
 #include <vector>
 #include <thread>
 #include <functional>
+#include <atomic>
+#include <memory>
 #include <pcap.h>
+#include "netlyzer/network/tpacket_ring.h"
+#include "netlyzer/network/capture_event_loop.h"
+#include "netlyzer/network/capture_profile.h"
+#include "netlyzer/core/reorder_buffer.h"
+#include "netlyzer/core/packet_buffer.h"
+#include "netlyzer/core/timestamp_formatter.h"
+#include "netlyzer/network/packet_decoder.h"
+#include "netlyzer/network/tuple_batch.h"
+#include "netlyzer/network/checksum.h"
+#include "netlyzer/network/fragment_reassembler.h"
+#include "netlyzer/network/flow_table.h"
 
 using namespace std;
 
 class PacketSniffer {
 public:
+    enum class Backend {
+        Pcap,       // libpcap handle, portable
+        TPacketV3   // memory-mapped AF_PACKET block ring, Linux only
+    };
+
+    using Frame = TPacketRing::Frame;
+
     struct PacketData {
-        string timestamp;
+        uint64_t timestamp_ns = 0;  // since the epoch; see TimestampFormatter
         string source_ip;
         string dest_ip;
         string protocol;
         uint16_t source_port = 0;
         uint16_t dest_port = 0;
         uint32_t length = 0;
-        vector<uint8_t> raw_data;
+        PacketBuffer raw_data;      // shared, pooled; copying PacketData does not copy bytes
+        DecodedPacket decoded;      // the fields above are rendered from this
     };
 
     struct Statistics {
@@ -28,29 +49,109 @@ public:
         uint32_t packets_dropped_by_interface = 0;
     };
 
+    // Ring backend only. With more than one worker, each worker owns a socket
+    // in a PACKET_FANOUT group that hashes by flow, and runs parse_packet and
+    // the callbacks on its own thread, so callbacks run concurrently. With
+    // ordered set, parsed packets instead go through a reorder buffer and
+    // the packet callback sees one timestamp-ordered stream on a single thread.
+    struct FanoutConfig {
+        unsigned workers = 1;
+        uint16_t group_id = 0;                      // 0 picks one unique to this sniffer
+        bool ordered = false;
+        size_t reorder_capacity = 4096;             // packets buffered per worker
+        uint64_t reorder_delay_ns = 20000000;       // longest wait for a slow worker
+    };
+
     using PacketCallback = function<void(const PacketData&)>;
+    // Receives frames without parsing or copying; see TPacketRing::Frame.
+    using FrameCallback = function<void(const Frame&)>;
+    // Receives flow fields in columns, up to TupleBatch::CAPACITY frames at a
+    // time: per ring block, or per pcap_dispatch round. Cheaper than the
+    // packet callback when only the 5-tuple, lengths and flags are needed.
+    using TupleBatchCallback = function<void(const TupleBatch&)>;
 
     PacketSniffer();
     ~PacketSniffer();
 
-    bool init(const string& interface_name);
+    bool init(const string& interface_name, Backend backend = Backend::Pcap);
     bool start_capture(const string& filter = "");
     void stop_capture();
     void set_packet_callback(PacketCallback callback);
+    void set_frame_callback(FrameCallback callback);
+    void set_tuple_batch_callback(TupleBatchCallback callback);
+    // Called on the capture threads as flows expire or are reported; takes
+    // effect at the next init(). Flows are only tracked when the profile sets
+    // flow_table_mb.
+    void set_flow_expiry_callback(FlowTable::ExpiryCallback callback) { flow_expiry_callback_ = move(callback); }
+    void set_ring_config(const TPacketRing::Config& config) { ring_config_ = config; }
+    void set_loop_config(const CaptureEventLoop::Config& config) { loop_config_ = config; }
+    void set_fanout_config(const FanoutConfig& config) { fanout_config_ = config; }
+    // Takes effect at the next init(). The ring backend maps what it can:
+    // buffer size onto the block count, immediate mode onto a 1 ms block
+    // timeout, and snaplen by truncating frames before they are parsed.
+    void set_capture_profile(const CaptureProfile& profile) { capture_profile_ = profile; }
+    Backend backend() const { return backend_; }
 
     static vector<string> get_available_interfaces();
     Statistics get_statistics();
+    CaptureEventLoop::Statistics get_loop_statistics() const;
+    ReorderBuffer<PacketData>::Statistics get_reorder_statistics() const;
+    // Totals from the checksum stage; all zero unless the profile enables it.
+    const ChecksumCounters& get_checksum_counters() const { return checksum_counters_; }
+    // Summed over the capture threads; all zero unless the profile sets
+    // reassembly_mb.
+    FragmentReassembler::Statistics get_reassembly_statistics() const;
+    // Summed over the capture threads; all zero unless the profile sets
+    // flow_table_mb.
+    FlowTable::Statistics get_flow_statistics() const;
 
 private:
     void capture_loop();
+    void ring_capture_loop(size_t worker);
+    void reorder_loop();
+    void handle_frame(const Frame& frame, size_t worker);
+    void deliver_tuples(const Frame* frames, size_t count, TupleBatch& batch, FlowTable* flows);
+    void flush_tuples(TupleBatch& batch, FlowTable* flows);
     static void packet_handler(u_char* user, const struct pcap_pkthdr* header, const u_char* packet);
-    PacketData parse_packet(const struct pcap_pkthdr* header, const u_char* packet);
+    PacketData parse_packet(const struct pcap_pkthdr* header, const u_char* packet,
+                            FragmentReassembler* reassembler);
+    unique_ptr<FragmentReassembler> make_reassembler(unsigned threads) const;
+    unique_ptr<FlowTable> make_flow_table(unsigned threads) const;
+
+    struct RingWorker {
+        TPacketRing ring;
+        CaptureEventLoop loop;
+        thread capture_thread;
+        vector<Frame> frames;                       // current block, cut to snaplen
+        unique_ptr<TupleBatch> tuples = make_unique<TupleBatch>();
+        unique_ptr<FragmentReassembler> reassembler;    // null unless enabled
+        unique_ptr<FlowTable> flows;                    // null unless enabled
+    };
 
     pcap_t* handle_;
-    bool is_running_;
+    vector<unique_ptr<RingWorker>> ring_workers_;
+    TPacketRing::Config ring_config_;
+    FanoutConfig fanout_config_;
+    unique_ptr<ReorderBuffer<PacketData>> reorder_buffer_;
+    thread reorder_thread_;
+    CaptureEventLoop event_loop_;
+    CaptureEventLoop::Config loop_config_;
+    CaptureProfile capture_profile_;
+    bool ts_nanoseconds_;           // ts.tv_usec in pcap headers carries nanoseconds
+    Backend backend_;
+    bool started_;                  // threads to join; only start and stop change it
+    atomic<bool> is_running_;       // capture threads loop while set
+    atomic<bool> workers_running_;
     string error_buffer_;
     thread capture_thread_;
     PacketCallback packet_callback_;
+    FrameCallback frame_callback_;
+    TupleBatchCallback tuple_batch_callback_;
+    unique_ptr<TupleBatch> pcap_tuples_;
+    unique_ptr<FragmentReassembler> pcap_reassembler_;
+    unique_ptr<FlowTable> pcap_flows_;
+    FlowTable::ExpiryCallback flow_expiry_callback_;
+    ChecksumCounters checksum_counters_;
     Statistics statistics_;
 };
 
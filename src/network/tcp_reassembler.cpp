@@ -0,0 +1,372 @@
+#include "netlyzer/network/tcp_reassembler.h"
+#include <algorithm>
+#include <cstring>
+
+namespace {
+
+constexpr uint8_t TCP_FIN = 0x01;
+constexpr uint8_t TCP_SYN = 0x02;
+constexpr uint8_t TCP_RST = 0x04;
+constexpr uint8_t TCP_ACK = 0x10;
+
+} // namespace
+
+bool TcpReassembler::Key::operator==(const Key& other) const
+{
+    return family == other.family && low.port == other.low.port && high.port == other.high.port
+        && std::memcmp(low.address, other.low.address, sizeof(low.address)) == 0
+        && std::memcmp(high.address, other.high.address, sizeof(high.address)) == 0;
+}
+
+size_t TcpReassembler::KeyHash::operator()(const Key& key) const
+{
+    uint64_t words[4];
+    std::memcpy(words, key.low.address, 16);
+    std::memcpy(words + 2, key.high.address, 16);
+    uint64_t hash = (static_cast<uint64_t>(key.low.port) << 24) ^ (static_cast<uint64_t>(key.high.port) << 8)
+                  ^ key.family;
+    for (uint64_t word : words)
+        hash = (hash ^ word) * 0x9e3779b97f4a7c15ull;
+    return static_cast<size_t>(hash ^ (hash >> 29));
+}
+
+void TcpReassembler::Statistics::accumulate(const Statistics& other)
+{
+    segments += other.segments;
+    delivered_bytes += other.delivered_bytes;
+    retransmitted_bytes += other.retransmitted_bytes;
+    out_of_order += other.out_of_order;
+    gaps += other.gaps;
+    dropped_bytes += other.dropped_bytes;
+    streams += other.streams;
+    active_streams += other.active_streams;
+    held_bytes += other.held_bytes;
+}
+
+TcpReassembler::TcpReassembler(ChunkCallback callback)
+    : TcpReassembler(Config(), std::move(callback))
+{
+}
+
+TcpReassembler::TcpReassembler(const Config& config, ChunkCallback callback)
+    : config_(config)
+    , callback_(std::move(callback))
+{
+}
+
+uint64_t TcpReassembler::add(const PacketBuffer& frame, const DecodedPacket& packet, uint64_t packet_id,
+                             uint64_t timestamp_ns)
+{
+    return add_frame(&frame, frame.data(), frame.size(), packet, packet_id, timestamp_ns);
+}
+
+uint64_t TcpReassembler::add(const uint8_t* data, uint32_t size, const DecodedPacket& packet, uint64_t packet_id,
+                             uint64_t timestamp_ns)
+{
+    return add_frame(nullptr, data, size, packet, packet_id, timestamp_ns);
+}
+
+uint64_t TcpReassembler::add_frame(const PacketBuffer* frame, const uint8_t* data, uint32_t size,
+                                   const DecodedPacket& packet, uint64_t packet_id, uint64_t timestamp_ns)
+{
+    ++stats_.segments;
+
+    Key key;
+    std::memset(&key, 0, sizeof(key));
+    Endpoint source;
+    Endpoint dest;
+    std::memset(&source, 0, sizeof(source));
+    std::memset(&dest, 0, sizeof(dest));
+    const size_t address_length = packet.has(DecodedPacket::IPV4) ? 4 : 16;
+    std::memcpy(source.address, packet.source_address, address_length);
+    std::memcpy(dest.address, packet.dest_address, address_length);
+    source.port = packet.source_port;
+    dest.port = packet.dest_port;
+
+    int order = std::memcmp(source.address, dest.address, sizeof(source.address));
+    if (order == 0)
+        order = source.port < dest.port ? -1 : (source.port > dest.port ? 1 : 0);
+    const uint8_t from = order <= 0 ? 0 : 1;
+    key.low = from == 0 ? source : dest;
+    key.high = from == 0 ? dest : source;
+    key.family = static_cast<uint8_t>(address_length == 4 ? 4 : 6);
+
+    const uint8_t flags = packet.tcp_flags;
+    const bool syn = (flags & TCP_SYN) != 0;
+    const bool opening = syn && !(flags & TCP_ACK);
+
+    auto it = streams_.find(key);
+    if (it != streams_.end() && opening && it->second.half[0].closed && it->second.half[1].closed) {
+        erase(it);
+        it = streams_.end();
+    }
+    if (it == streams_.end()) {
+        if (streams_.size() >= config_.max_streams && !lru_.empty())
+            erase(streams_.find(lru_.front()));
+        it = streams_.emplace(key, Stream()).first;
+        Stream& created = it->second;
+        created.id = stats_.streams++;
+        // The SYN sender opened the connection; a SYN-ACK seen first names
+        // the other side. Without either, whoever spoke first opened it.
+        created.initiator = (syn && !opening) ? from ^ 1 : from;
+        created.lru = lru_.insert(lru_.end(), key);
+    } else {
+        lru_.splice(lru_.end(), lru_, it->second.lru);
+    }
+
+    Stream& stream = it->second;
+    stream.last_seen_ns = timestamp_ns;
+    const uint64_t id = stream.id;
+    const uint8_t direction = from ^ stream.initiator;
+    Half& half = stream.half[direction];
+
+    uint32_t sequence = packet.tcp_sequence;
+    if (!half.started) {
+        half.started = true;
+        half.base = syn ? sequence + 1 : sequence;
+    }
+    if (syn)
+        ++sequence;
+
+    uint32_t length = 0;
+    if (packet.payload_offset < size)
+        length = std::min<uint32_t>(packet.payload_length, size - packet.payload_offset);
+
+    if (length != 0) {
+        // Read the 32-bit sequence number relative to the next expected byte,
+        // which carries offsets across wraparound.
+        const uint32_t expected = half.base + static_cast<uint32_t>(half.next);
+        const int64_t offset = static_cast<int64_t>(half.next) + static_cast<int32_t>(sequence - expected);
+        uint32_t skip = 0;
+        if (offset < 0)
+            skip = static_cast<uint32_t>(std::min<int64_t>(-offset, length));
+        if (skip == length) {
+            stats_.retransmitted_bytes += length;
+        } else {
+            stats_.retransmitted_bytes += skip;
+            Segment segment{frame ? *frame : PacketBuffer(), data, packet_id,
+                            static_cast<uint32_t>(packet.payload_offset + skip), length - skip};
+            insert(stream, direction, std::move(segment), static_cast<uint64_t>(offset + skip));
+        }
+    }
+
+    if (flags & TCP_RST) {
+        // Nothing more will fill the holes.
+        spill(stream);
+        stream.half[0].closed = true;
+        stream.half[1].closed = true;
+    } else if (flags & TCP_FIN) {
+        half.closed = true;
+    }
+    return id;
+}
+
+void TcpReassembler::insert(Stream& stream, uint8_t direction, Segment&& segment, uint64_t offset)
+{
+    Half& half = stream.half[direction];
+    if (offset + segment.length <= half.next) {
+        stats_.retransmitted_bytes += segment.length;
+        return;
+    }
+    if (offset <= half.next) {
+        deliver(stream, direction, segment, offset);
+        drain(stream, direction);
+        return;
+    }
+
+    auto found = half.waiting.find(offset);
+    if (found != half.waiting.end()) {
+        if (found->second.length >= segment.length) {
+            stats_.retransmitted_bytes += segment.length;
+            return;
+        }
+        release(half, found->second);
+        half.waiting.erase(found);
+    }
+
+    if (!segment.frame) {
+        segment.frame = PacketBuffer::copy_of(segment.bytes, segment.data_offset + segment.length);
+        segment.bytes = segment.frame.data();
+    }
+
+    // Queued even over the budget, so that relieving the direction hands it
+    // on in order with what was already waiting.
+    const size_t cost = segment.frame.capacity();
+    const bool over = half.held + cost > config_.max_flow_bytes;
+    if (!over)
+        ++stats_.out_of_order;
+    half.held += cost;
+    held_bytes_ += cost;
+    half.waiting.emplace(offset, std::move(segment));
+    if (over)
+        relieve(stream, direction, config_.policy);
+    else if (held_bytes_ > config_.max_bytes)
+        make_room();
+}
+
+void TcpReassembler::deliver(Stream& stream, uint8_t direction, const Segment& segment, uint64_t offset)
+{
+    Half& half = stream.half[direction];
+    const uint64_t skip = half.next - offset;
+    if (skip >= segment.length) {
+        stats_.retransmitted_bytes += segment.length;
+        return;
+    }
+    stats_.retransmitted_bytes += skip;
+
+    Chunk chunk;
+    chunk.stream = stream.id;
+    chunk.direction = direction;
+    chunk.gap = half.gap;
+    chunk.offset = half.next;
+    chunk.data_offset = segment.data_offset + static_cast<uint32_t>(skip);
+    chunk.data = segment.bytes + chunk.data_offset;
+    chunk.length = segment.length - static_cast<uint32_t>(skip);
+    chunk.frame = segment.frame ? &segment.frame : nullptr;
+    chunk.packet_id = segment.packet_id;
+
+    half.gap = false;
+    half.next += chunk.length;
+    stats_.delivered_bytes += chunk.length;
+    if (callback_)
+        callback_(chunk);
+}
+
+void TcpReassembler::drain(Stream& stream, uint8_t direction)
+{
+    Half& half = stream.half[direction];
+    while (!half.waiting.empty() && half.waiting.begin()->first <= half.next) {
+        auto first = half.waiting.begin();
+        const uint64_t offset = first->first;
+        Segment segment = std::move(first->second);
+        half.waiting.erase(first);
+        release(half, segment);
+        deliver(stream, direction, segment, offset);
+    }
+}
+
+void TcpReassembler::relieve(Stream& stream, uint8_t direction, Policy policy)
+{
+    Half& half = stream.half[direction];
+    while (!half.waiting.empty()) {
+        auto first = half.waiting.begin();
+        const uint64_t offset = first->first;
+        Segment segment = std::move(first->second);
+        half.waiting.erase(first);
+        release(half, segment);
+
+        if (policy == Policy::Drop) {
+            const uint64_t end = offset + segment.length;
+            if (end > half.next) {
+                stats_.dropped_bytes += std::min<uint64_t>(segment.length, end - half.next);
+                half.next = end;
+                if (!half.gap)
+                    ++stats_.gaps;
+                half.gap = true;
+            }
+            continue;
+        }
+        if (offset > half.next) {
+            half.next = offset;
+            half.gap = true;
+            ++stats_.gaps;
+        }
+        deliver(stream, direction, segment, offset);
+    }
+}
+
+void TcpReassembler::spill(Stream& stream)
+{
+    relieve(stream, 0, Policy::Spill);
+    relieve(stream, 1, Policy::Spill);
+}
+
+void TcpReassembler::release(Half& half, const Segment& segment)
+{
+    const size_t cost = segment.frame.capacity();
+    half.held -= cost;
+    held_bytes_ -= cost;
+}
+
+void TcpReassembler::make_room()
+{
+    // Least recently active streams give way first.
+    for (auto key = lru_.begin(); key != lru_.end() && held_bytes_ > config_.max_bytes; ++key) {
+        Stream& stream = streams_.find(*key)->second;
+        relieve(stream, 0, config_.policy);
+        relieve(stream, 1, config_.policy);
+    }
+}
+
+void TcpReassembler::erase(Map::iterator it)
+{
+    spill(it->second);
+    lru_.erase(it->second.lru);
+    streams_.erase(it);
+}
+
+void TcpReassembler::expire(uint64_t now_ns)
+{
+    while (!lru_.empty()) {
+        auto it = streams_.find(lru_.front());
+        if (it->second.last_seen_ns + config_.idle_timeout_ns >= now_ns)
+            break;
+        erase(it);
+    }
+}
+
+void TcpReassembler::flush()
+{
+    while (!lru_.empty())
+        erase(streams_.find(lru_.front()));
+}
+
+TcpReassembler::Statistics TcpReassembler::get_statistics() const
+{
+    Statistics stats = stats_;
+    stats.active_streams = streams_.size();
+    stats.held_bytes = held_bytes_;
+    return stats;
+}
+
+void TcpStreamIndex::append(const TcpReassembler::Chunk& chunk)
+{
+    entries_.push_back(Entry{size_, chunk.packet_id, chunk.data_offset, chunk.length, chunk.direction, chunk.gap});
+    size_ += chunk.length;
+    bytes_[chunk.direction & 1] += chunk.length;
+    if (chunk.gap)
+        ++gaps_;
+}
+
+void TcpStreamIndex::clear()
+{
+    entries_.clear();
+    size_ = 0;
+    bytes_[0] = bytes_[1] = 0;
+    gaps_ = 0;
+}
+
+size_t TcpStreamIndex::find(uint64_t position) const
+{
+    if (position >= size_)
+        return entries_.size();
+    auto after = std::upper_bound(entries_.begin(), entries_.end(), position,
+                                  [](uint64_t value, const Entry& entry) { return value < entry.position; });
+    return static_cast<size_t>(after - entries_.begin()) - 1;
+}
+
+size_t TcpStreamIndex::read(uint64_t position, uint8_t* out, size_t length, const FrameSource& frames) const
+{
+    size_t copied = 0;
+    for (size_t i = find(position); i < entries_.size() && copied < length; ++i) {
+        const Entry& entry = entries_[i];
+        const uint8_t* frame = frames(entry.packet_id);
+        if (!frame)
+            break;
+        const uint64_t within = position + copied - entry.position;
+        const size_t count = std::min<size_t>(entry.length - within, length - copied);
+        std::memcpy(out + copied, frame + entry.data_offset + within, count);
+        copied += count;
+    }
+    return copied;
+}
@@ -0,0 +1,247 @@
+#include "netlyzer/network/tpacket_ring.h"
+#include <pcap.h>
+#include <linux/if_packet.h>
+#include <linux/filter.h>
+#include <net/ethernet.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+static_assert(static_cast<uint16_t>(TPacketRing::FanoutMode::Hash) == PACKET_FANOUT_HASH, "fanout mode");
+static_assert(static_cast<uint16_t>(TPacketRing::FanoutMode::LoadBalance) == PACKET_FANOUT_LB, "fanout mode");
+static_assert(static_cast<uint16_t>(TPacketRing::FanoutMode::Cpu) == PACKET_FANOUT_CPU, "fanout mode");
+
+TPacketRing::TPacketRing()
+    : fd_(-1)
+    , map_(nullptr)
+    , map_size_(0)
+    , current_block_(0)
+    , error_number_(0)
+    , blocks_(0)
+{
+}
+
+TPacketRing::~TPacketRing()
+{
+    close();
+}
+
+bool TPacketRing::fail(const std::string& what)
+{
+    error_number_ = errno;
+    error_ = what + ": " + std::strerror(error_number_);
+    close();
+    return false;
+}
+
+bool TPacketRing::open(const std::string& interface_name, const Config& config)
+{
+    close();
+    config_ = config;
+    error_number_ = 0;
+    statistics_ = {};
+    blocks_.store(0, std::memory_order_relaxed);
+    current_block_ = 0;
+
+    const uint32_t page_size = static_cast<uint32_t>(sysconf(_SC_PAGESIZE));
+    if (config.block_count == 0 || config.block_size == 0 || config.block_size % page_size != 0) {
+        error_ = "block size must be a non-zero multiple of the page size";
+        return false;
+    }
+    if (config.frame_size < TPACKET_ALIGNMENT || config.frame_size % TPACKET_ALIGNMENT != 0 ||
+        config.block_size % config.frame_size != 0) {
+        error_ = "frame size must be TPACKET-aligned and divide the block size";
+        return false;
+    }
+
+    unsigned int ifindex = if_nametoindex(interface_name.c_str());
+    if (ifindex == 0) {
+        error_ = "unknown interface " + interface_name;
+        return false;
+    }
+
+    fd_ = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (fd_ < 0)
+        return fail("socket(AF_PACKET)");
+
+    int version = TPACKET_V3;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0)
+        return fail("PACKET_VERSION");
+
+    tpacket_req3 req{};
+    req.tp_block_size = config.block_size;
+    req.tp_block_nr = config.block_count;
+    req.tp_frame_size = config.frame_size;
+    req.tp_frame_nr = (config.block_size / config.frame_size) * config.block_count;
+    req.tp_retire_blk_tov = config.block_timeout_ms;
+    req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+    if (setsockopt(fd_, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0)
+        return fail("PACKET_RX_RING");
+
+    map_size_ = static_cast<size_t>(config.block_size) * config.block_count;
+    void* map = mmap(nullptr, map_size_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, 0);
+    if (map == MAP_FAILED) {
+        map_size_ = 0;
+        return fail("mmap");
+    }
+    map_ = static_cast<uint8_t*>(map);
+
+    sockaddr_ll addr{};
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = static_cast<int>(ifindex);
+    if (bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) != 0)
+        return fail("bind");
+
+    if (config.promiscuous) {
+        packet_mreq mreq{};
+        mreq.mr_ifindex = static_cast<int>(ifindex);
+        mreq.mr_type = PACKET_MR_PROMISC;
+        if (setsockopt(fd_, SOL_PACKET, PACKET_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) != 0)
+            return fail("PACKET_ADD_MEMBERSHIP");
+    }
+
+    if (config.fanout_group != 0) {
+        // Defragment before hashing so every fragment of a datagram reaches
+        // the same socket as the rest of its flow.
+        uint32_t mode = static_cast<uint16_t>(config.fanout_mode);
+        if (config.fanout_mode == FanoutMode::Hash)
+            mode |= PACKET_FANOUT_FLAG_DEFRAG;
+        int fanout = static_cast<int>(config.fanout_group | (mode << 16));
+        if (setsockopt(fd_, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) != 0)
+            return fail("PACKET_FANOUT");
+    }
+
+    return true;
+}
+
+void TPacketRing::close()
+{
+    if (map_) {
+        munmap(map_, map_size_);
+        map_ = nullptr;
+        map_size_ = 0;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool TPacketRing::set_filter(const std::string& expression)
+{
+    if (fd_ < 0)
+        return false;
+
+    // The kernel socket filter uses the same instruction layout as classic BPF,
+    // so a program compiled by libpcap can be attached as-is.
+    pcap_t* dead = pcap_open_dead(DLT_EN10MB, 65535);
+    if (!dead) {
+        error_ = "pcap_open_dead failed";
+        return false;
+    }
+
+    bpf_program program;
+    if (pcap_compile(dead, &program, expression.c_str(), 1, PCAP_NETMASK_UNKNOWN) != 0) {
+        error_ = std::string("filter: ") + pcap_geterr(dead);
+        pcap_close(dead);
+        return false;
+    }
+
+    sock_fprog fprog{};
+    fprog.len = static_cast<unsigned short>(program.bf_len);
+    fprog.filter = reinterpret_cast<sock_filter*>(program.bf_insns);
+    int result = setsockopt(fd_, SOL_SOCKET, SO_ATTACH_FILTER, &fprog, sizeof(fprog));
+    if (result != 0)
+        error_ = std::string("SO_ATTACH_FILTER: ") + std::strerror(errno);
+
+    pcap_freecode(&program);
+    pcap_close(dead);
+    return result == 0;
+}
+
+size_t TPacketRing::read_blocks(const FrameCallback& callback, size_t max_frames)
+{
+    return read_block_batches([&callback](const Frame* frames, size_t count) {
+        if (!callback)
+            return;
+        for (size_t i = 0; i < count; ++i)
+            callback(frames[i]);
+    }, max_frames);
+}
+
+size_t TPacketRing::read_block_batches(const BlockCallback& callback, size_t max_frames)
+{
+    if (!map_)
+        return 0;
+
+    size_t frames = 0;
+    while (frames < max_frames) {
+        auto* block = reinterpret_cast<tpacket_block_desc*>(
+            map_ + static_cast<size_t>(current_block_) * config_.block_size);
+
+        // Pairs with the kernel's release when it retires the block.
+        if (!(__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER))
+            break;
+
+        const uint32_t count = block->hdr.bh1.num_pkts;
+        const uint8_t* cursor = reinterpret_cast<const uint8_t*>(block) + block->hdr.bh1.offset_to_first_pkt;
+
+        block_frames_.resize(count);
+        for (uint32_t i = 0; i < count; ++i) {
+            auto* header = reinterpret_cast<const tpacket3_hdr*>(cursor);
+            Frame& frame = block_frames_[i];
+            frame.data = cursor + header->tp_mac;
+            frame.caplen = header->tp_snaplen;
+            frame.len = header->tp_len;
+            frame.ts_sec = header->tp_sec;
+            frame.ts_nsec = header->tp_nsec;
+            frame.rxhash = header->hv1.tp_rxhash;
+            cursor += header->tp_next_offset;
+        }
+        if (callback)
+            callback(block_frames_.data(), count);
+
+        frames += count;
+        blocks_.fetch_add(1, std::memory_order_relaxed);
+
+        // Hand the whole block back to the kernel in one store.
+        __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+        current_block_ = (current_block_ + 1) % config_.block_count;
+    }
+
+    return frames;
+}
+
+bool TPacketRing::wait(int timeout_ms)
+{
+    if (fd_ < 0)
+        return false;
+
+    pollfd pfd{};
+    pfd.fd = fd_;
+    pfd.events = POLLIN | POLLERR;
+    return poll(&pfd, 1, timeout_ms) > 0;
+}
+
+TPacketRing::Statistics TPacketRing::get_statistics()
+{
+    if (fd_ >= 0) {
+        // The kernel resets its counters on every read, so accumulate them.
+        tpacket_stats_v3 stats{};
+        socklen_t len = sizeof(stats);
+        if (getsockopt(fd_, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0) {
+            statistics_.packets += stats.tp_packets;
+            statistics_.drops += stats.tp_drops;
+            statistics_.queue_freezes += stats.tp_freeze_q_cnt;
+        }
+    }
+    Statistics result = statistics_;
+    result.blocks = blocks_.load(std::memory_order_relaxed);
+    return result;
+}
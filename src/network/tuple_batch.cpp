@@ -0,0 +1,194 @@
+#include "netlyzer/network/tuple_batch.h"
+#include "netlyzer/network/packet_decoder.h"
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define NETLYZER_TUPLE_AVX2 1
+#include <immintrin.h>
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#endif
+
+namespace {
+
+constexpr uint8_t PROTO_ICMP = 1;
+constexpr uint8_t PROTO_TCP = 6;
+constexpr uint8_t PROTO_UDP = 17;
+
+inline uint16_t load_be16(const uint8_t* p)
+{
+    return static_cast<uint16_t>((p[0] << 8) | p[1]);
+}
+
+inline uint64_t timestamp_of(const TupleExtractor::Frame& frame)
+{
+    return static_cast<uint64_t>(frame.ts_sec) * 1000000000 + frame.ts_nsec;
+}
+
+void extract_scalar(const TupleExtractor::Frame& frame, TupleBatch& batch, size_t n)
+{
+    DecodedPacket packet;
+    PacketDecoder::decode(frame.data, frame.caplen, frame.len, packet);
+
+    batch.timestamp_ns[n] = timestamp_of(frame);
+    batch.wire_length[n] = frame.len;
+    batch.source_port[n] = packet.source_port;
+    batch.dest_port[n] = packet.dest_port;
+    batch.tcp_flags[n] = packet.tcp_flags;
+    batch.protocol[n] = packet.ip_protocol;
+
+    const size_t network = packet.network_offset;
+    if (packet.has(DecodedPacket::IPV4)) {
+        batch.family[n] = TupleBatch::IPV4;
+        batch.source_ipv4[n] = packet.ipv4_source();
+        batch.dest_ipv4[n] = packet.ipv4_dest();
+        batch.ip_length[n] = load_be16(frame.data + network + 2);
+    } else if (packet.has(DecodedPacket::IPV6)) {
+        batch.family[n] = TupleBatch::IPV6;
+        std::memcpy(batch.source_ipv6[n], packet.source_address, 16);
+        std::memcpy(batch.dest_ipv6[n], packet.dest_address, 16);
+        batch.ip_length[n] = static_cast<uint16_t>(40 + load_be16(frame.data + network + 4));
+    } else {
+        batch.family[n] = TupleBatch::OTHER;
+        batch.protocol[n] = 0;
+        batch.ip_length[n] = 0;
+    }
+}
+
+#ifdef NETLYZER_TUPLE_AVX2
+
+// Loads one little-endian dword from each frame at its own offset. Lanes
+// outside `mask` read nothing and come back zero, so a lane is only ever
+// loaded from once its capture length has been checked.
+TARGET_AVX2 inline __m128i gather(__m256i base, __m128i offset, __m128i mask)
+{
+    const __m256i address = _mm256_add_epi64(base, _mm256_cvtepu32_epi64(offset));
+    return _mm256_mask_i64gather_epi32(_mm_setzero_si128(), nullptr, address, mask, 1);
+}
+
+// caplen >= offset + length, on 32-bit lanes (both stay far below 2^31).
+TARGET_AVX2 inline __m128i fits(__m128i caplen, __m128i offset, int length)
+{
+    return _mm_cmpgt_epi32(caplen, _mm_add_epi32(offset, _mm_set1_epi32(length - 1)));
+}
+
+TARGET_AVX2 size_t extract_avx2(const TupleExtractor::Frame* frames, size_t count, TupleBatch& batch)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi32(-1);
+    const __m128i swap32 = _mm_setr_epi8(3, 2, 1, 0, 7, 6, 5, 4, 11, 10, 9, 8, 15, 14, 13, 12);
+
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4) {
+        const TupleExtractor::Frame* f = frames + i;
+        const __m256i base = _mm256_setr_epi64x(reinterpret_cast<long long>(f[0].data),
+                                                reinterpret_cast<long long>(f[1].data),
+                                                reinterpret_cast<long long>(f[2].data),
+                                                reinterpret_cast<long long>(f[3].data));
+        const __m128i caplen = _mm_setr_epi32(static_cast<int>(f[0].caplen), static_cast<int>(f[1].caplen),
+                                              static_cast<int>(f[2].caplen), static_cast<int>(f[3].caplen));
+
+        // Outer ethertype; one 802.1Q tag moves the IP header by four bytes.
+        const __m128i link = gather(base, _mm_set1_epi32(12), fits(caplen, zero, 16));
+        const __m128i tagged = _mm_cmpeq_epi32(_mm_and_si128(link, _mm_set1_epi32(0xffff)),
+                                               _mm_set1_epi32(0x0081));
+        const __m128i l3 = _mm_add_epi32(_mm_set1_epi32(14), _mm_and_si128(tagged, _mm_set1_epi32(4)));
+        __m128i ok = fits(caplen, l3, 20);
+
+        // Ethertype 0x0800, version 4, header length of at least 20.
+        const __m128i type = gather(base, _mm_sub_epi32(l3, _mm_set1_epi32(2)), ok);
+        ok = _mm_and_si128(ok, _mm_cmpeq_epi32(_mm_and_si128(type, _mm_set1_epi32(0x00f0ffff)),
+                                               _mm_set1_epi32(0x00400008)));
+        const __m128i ihl = _mm_and_si128(_mm_srli_epi32(type, 16), _mm_set1_epi32(0x0f));
+        ok = _mm_and_si128(ok, _mm_cmpgt_epi32(ihl, _mm_set1_epi32(4)));
+        const __m128i l4 = _mm_add_epi32(l3, _mm_slli_epi32(ihl, 2));
+        ok = _mm_and_si128(ok, fits(caplen, l4, 8));
+
+        // Not a fragment, and TCP, UDP or ICMP.
+        const __m128i lengths = gather(base, _mm_add_epi32(l3, _mm_set1_epi32(2)), ok);
+        const __m128i fragment = gather(base, _mm_add_epi32(l3, _mm_set1_epi32(6)), ok);
+        ok = _mm_and_si128(ok, _mm_cmpeq_epi32(_mm_and_si128(fragment, _mm_set1_epi32(0xff3f)), zero));
+        const __m128i protocol = _mm_srli_epi32(fragment, 24);
+        const __m128i is_tcp = _mm_cmpeq_epi32(protocol, _mm_set1_epi32(PROTO_TCP));
+        const __m128i is_udp = _mm_cmpeq_epi32(protocol, _mm_set1_epi32(PROTO_UDP));
+        const __m128i is_icmp = _mm_cmpeq_epi32(protocol, _mm_set1_epi32(PROTO_ICMP));
+        ok = _mm_and_si128(ok, _mm_or_si128(_mm_or_si128(is_tcp, is_udp), is_icmp));
+
+        // TCP needs its whole header, options included, in the capture.
+        __m128i tcp_ok = _mm_and_si128(_mm_and_si128(ok, is_tcp), fits(caplen, l4, 20));
+        const __m128i tcp = gather(base, _mm_add_epi32(l4, _mm_set1_epi32(12)), tcp_ok);
+        const __m128i data_offset = _mm_and_si128(_mm_srli_epi32(tcp, 4), _mm_set1_epi32(0x0f));
+        tcp_ok = _mm_and_si128(tcp_ok, _mm_cmpgt_epi32(data_offset, _mm_set1_epi32(4)));
+        tcp_ok = _mm_and_si128(tcp_ok, _mm_cmpgt_epi32(_mm_add_epi32(caplen, _mm_set1_epi32(1)),
+                                                       _mm_add_epi32(l4, _mm_slli_epi32(data_offset, 2))));
+        ok = _mm_or_si128(_mm_andnot_si128(is_tcp, ok), tcp_ok);
+
+        const __m128i ports = gather(base, l4, _mm_and_si128(ok, _mm_xor_si128(is_icmp, ones)));
+        const __m128i source = gather(base, _mm_add_epi32(l3, _mm_set1_epi32(12)), ok);
+        const __m128i dest = gather(base, _mm_add_epi32(l3, _mm_set1_epi32(16)), ok);
+
+        const size_t n = batch.count;
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(batch.source_ipv4 + n), _mm_shuffle_epi8(source, swap32));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(batch.dest_ipv4 + n), _mm_shuffle_epi8(dest, swap32));
+
+        alignas(16) uint32_t lane_ports[4], lane_lengths[4], lane_protocol[4], lane_tcp[4];
+        _mm_store_si128(reinterpret_cast<__m128i*>(lane_ports), ports);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lane_lengths), lengths);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lane_protocol), protocol);
+        _mm_store_si128(reinterpret_cast<__m128i*>(lane_tcp), _mm_and_si128(tcp, tcp_ok));
+
+        const int fast = _mm_movemask_ps(_mm_castsi128_ps(ok));
+        for (int lane = 0; lane < 4; ++lane) {
+            const size_t row = n + static_cast<size_t>(lane);
+            const uint16_t dest_port = static_cast<uint16_t>(__builtin_bswap16(static_cast<uint16_t>(lane_ports[lane] >> 16)));
+            if (!(fast & (1 << lane))
+                || (lane_protocol[lane] == PROTO_UDP && PacketDecoder::is_tunnel_port(dest_port))) {
+                extract_scalar(f[lane], batch, row);
+                continue;
+            }
+            batch.timestamp_ns[row] = timestamp_of(f[lane]);
+            batch.wire_length[row] = f[lane].len;
+            batch.family[row] = TupleBatch::IPV4;
+            batch.protocol[row] = static_cast<uint8_t>(lane_protocol[lane]);
+            batch.source_port[row] = __builtin_bswap16(static_cast<uint16_t>(lane_ports[lane]));
+            batch.dest_port[row] = dest_port;
+            batch.ip_length[row] = __builtin_bswap16(static_cast<uint16_t>(lane_lengths[lane]));
+            batch.tcp_flags[row] = static_cast<uint8_t>(lane_tcp[lane] >> 8);
+        }
+        batch.count += 4;
+    }
+
+    for (; i < count; ++i)
+        extract_scalar(frames[i], batch, batch.count++);
+    return count;
+}
+
+#endif // NETLYZER_TUPLE_AVX2
+
+} // namespace
+
+size_t TupleExtractor::extract(const Frame* frames, size_t count, TupleBatch& batch, Path path)
+{
+    if (count > TupleBatch::CAPACITY - batch.count)
+        count = TupleBatch::CAPACITY - batch.count;
+
+#ifdef NETLYZER_TUPLE_AVX2
+    if (path == Path::Best && has_vector_path())
+        return extract_avx2(frames, count, batch);
+#else
+    (void)path;
+#endif
+
+    for (size_t i = 0; i < count; ++i)
+        extract_scalar(frames[i], batch, batch.count++);
+    return count;
+}
+
+bool TupleExtractor::has_vector_path()
+{
+#ifdef NETLYZER_TUPLE_AVX2
+    static const bool avx2 = __builtin_cpu_supports("avx2");
+    return avx2;
+#else
+    return false;
+#endif
+}
@@ -0,0 +1,246 @@
+#include "netlyzer/utils/format.h"
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+namespace netlyzer {
+
+namespace {
+
+struct HexTable {
+    char lower[512];
+    char upper[512];
+
+    constexpr HexTable() : lower(), upper()
+    {
+        const char* digits_lower = "0123456789abcdef";
+        const char* digits_upper = "0123456789ABCDEF";
+        for (int i = 0; i < 256; ++i) {
+            lower[i * 2] = digits_lower[i >> 4];
+            lower[i * 2 + 1] = digits_lower[i & 0x0f];
+            upper[i * 2] = digits_upper[i >> 4];
+            upper[i * 2 + 1] = digits_upper[i & 0x0f];
+        }
+    }
+};
+
+// Decimal text of 0-255 in the first three bytes and its length in the
+// fourth, so a dotted quad is four 4-byte copies and four adds.
+struct OctetTable {
+    char entries[256][4];
+
+    constexpr OctetTable() : entries()
+    {
+        for (int i = 0; i < 256; ++i) {
+            int length = 0;
+            if (i >= 100)
+                entries[i][length++] = static_cast<char>('0' + i / 100);
+            if (i >= 10)
+                entries[i][length++] = static_cast<char>('0' + i / 10 % 10);
+            entries[i][length++] = static_cast<char>('0' + i % 10);
+            entries[i][3] = static_cast<char>(length);
+        }
+    }
+};
+
+constexpr HexTable HEX;
+constexpr OctetTable OCTETS;
+
+inline const char* hex_pair(uint8_t byte, bool uppercase)
+{
+    return (uppercase ? HEX.upper : HEX.lower) + byte * 2;
+}
+
+inline size_t append_octet(unsigned octet, char* out)
+{
+    // Writes up to one byte past the digits, which the next separator or
+    // octet overwrites; every caller leaves room for it.
+    std::memcpy(out, OCTETS.entries[octet], 4);
+    return static_cast<size_t>(OCTETS.entries[octet][3]);
+}
+
+// Lowercase hex of a 16-bit group without leading zeros.
+inline size_t append_group(unsigned group, char* out)
+{
+    static const char digits[] = "0123456789abcdef";
+    size_t length = 0;
+    if (group >= 0x1000)
+        out[length++] = digits[group >> 12];
+    if (group >= 0x100)
+        out[length++] = digits[(group >> 8) & 0x0f];
+    if (group >= 0x10)
+        out[length++] = digits[(group >> 4) & 0x0f];
+    out[length++] = digits[group & 0x0f];
+    return length;
+}
+
+#if defined(__SSE2__)
+// 16 bytes to 32 hex characters: split into nibbles, add '0', and add the
+// gap up to 'a' (or 'A') for nibbles above 9.
+inline void hex16_sse2(const uint8_t* data, char* out, bool uppercase)
+{
+    const __m128i input = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data));
+    const __m128i mask = _mm_set1_epi8(0x0f);
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(input, 4), mask);
+    const __m128i low = _mm_and_si128(input, mask);
+
+    const __m128i nine = _mm_set1_epi8(9);
+    const __m128i zero = _mm_set1_epi8('0');
+    const __m128i gap = _mm_set1_epi8(uppercase ? 'A' - '0' - 10 : 'a' - '0' - 10);
+
+    auto to_ascii = [&](__m128i nibbles) {
+        __m128i letters = _mm_and_si128(_mm_cmpgt_epi8(nibbles, nine), gap);
+        return _mm_add_epi8(_mm_add_epi8(nibbles, zero), letters);
+    };
+    const __m128i high_ascii = to_ascii(high);
+    const __m128i low_ascii = to_ascii(low);
+
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_unpacklo_epi8(high_ascii, low_ascii));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 16), _mm_unpackhi_epi8(high_ascii, low_ascii));
+}
+#endif
+
+} // namespace
+
+size_t format_hex(const uint8_t* data, size_t length, char* out, bool uppercase)
+{
+    size_t i = 0;
+#if defined(__SSE2__)
+    for (; i + 16 <= length; i += 16)
+        hex16_sse2(data + i, out + i * 2, uppercase);
+#endif
+    for (; i < length; ++i)
+        std::memcpy(out + i * 2, hex_pair(data[i], uppercase), 2);
+    return length * 2;
+}
+
+size_t format_hex_separated(const uint8_t* data, size_t length, char separator, char* out,
+                            bool uppercase)
+{
+    if (length == 0)
+        return 0;
+    for (size_t i = 0; i < length; ++i) {
+        std::memcpy(out + i * 3, hex_pair(data[i], uppercase), 2);
+        if (i + 1 < length)
+            out[i * 3 + 2] = separator;
+    }
+    return length * 3 - 1;
+}
+
+size_t format_mac(const uint8_t* mac, char* out)
+{
+    return format_hex_separated(mac, 6, ':', out);
+}
+
+size_t format_ipv4(uint32_t address, char* out)
+{
+    // append_octet may write one byte past the digits, so the last octet
+    // goes through a scratch buffer to stay inside IPV4_STRING_MAX.
+    size_t length = append_octet(address >> 24, out);
+    out[length++] = '.';
+    length += append_octet((address >> 16) & 0xff, out + length);
+    out[length++] = '.';
+    length += append_octet((address >> 8) & 0xff, out + length);
+    out[length++] = '.';
+    char last[4];
+    size_t last_length = append_octet(address & 0xff, last);
+    std::memcpy(out + length, last, last_length);
+    return length + last_length;
+}
+
+size_t format_ipv6(const uint8_t* address, char* out)
+{
+    unsigned groups[8];
+    for (int i = 0; i < 8; ++i)
+        groups[i] = (static_cast<unsigned>(address[i * 2]) << 8) | address[i * 2 + 1];
+
+    // ::ffff:a.b.c.d (RFC 5952 section 5)
+    if (groups[0] == 0 && groups[1] == 0 && groups[2] == 0 && groups[3] == 0
+        && groups[4] == 0 && groups[5] == 0xffff) {
+        std::memcpy(out, "::ffff:", 7);
+        uint32_t ipv4 = (static_cast<uint32_t>(groups[6]) << 16) | groups[7];
+        return 7 + format_ipv4(ipv4, out + 7);
+    }
+
+    // Longest run of zero groups; a single zero group is not compressed.
+    int best_start = -1;
+    int best_length = 1;
+    for (int i = 0; i < 8;) {
+        if (groups[i] != 0) {
+            ++i;
+            continue;
+        }
+        int start = i;
+        while (i < 8 && groups[i] == 0)
+            ++i;
+        if (i - start > best_length) {
+            best_start = start;
+            best_length = i - start;
+        }
+    }
+
+    size_t length = 0;
+    for (int i = 0; i < 8; ++i) {
+        if (i == best_start) {
+            out[length++] = ':';
+            out[length++] = ':';
+            i += best_length - 1;
+            continue;
+        }
+        if (i > 0 && i != best_start + best_length)
+            out[length++] = ':';
+        length += append_group(groups[i], out + length);
+    }
+    return length;
+}
+
+size_t format_hex_dump_line(const uint8_t* data, size_t length, size_t offset, char* out,
+                            bool uppercase)
+{
+    if (length > HEX_DUMP_BYTES_PER_LINE)
+        length = HEX_DUMP_BYTES_PER_LINE;
+
+    // Offset: at least four digits, at most eight.
+    size_t pos = 0;
+    int digits = 4;
+    while (digits < 8 && (offset >> (digits * 4)) != 0)
+        ++digits;
+    const char* table = uppercase ? "0123456789ABCDEF" : "0123456789abcdef";
+    for (int d = digits - 1; d >= 0; --d)
+        out[pos++] = table[(offset >> (d * 4)) & 0x0f];
+    out[pos++] = ' ';
+    out[pos++] = ' ';
+
+    // Hex column, converted in one go and then spread out with spaces.
+    char hex[HEX_DUMP_BYTES_PER_LINE * 2];
+    format_hex(data, length, hex, uppercase);
+    for (size_t i = 0; i < HEX_DUMP_BYTES_PER_LINE; ++i) {
+        if (i < length) {
+            out[pos] = hex[i * 2];
+            out[pos + 1] = hex[i * 2 + 1];
+        } else {
+            out[pos] = ' ';
+            out[pos + 1] = ' ';
+        }
+        out[pos + 2] = ' ';
+        pos += 3;
+        if (i == 7)
+            out[pos++] = ' ';
+    }
+
+    out[pos++] = ' ';
+    out[pos++] = '|';
+    for (size_t i = 0; i < HEX_DUMP_BYTES_PER_LINE; ++i) {
+        if (i < length)
+            out[pos++] = (data[i] >= 32 && data[i] <= 126) ? static_cast<char>(data[i]) : '.';
+        else
+            out[pos++] = ' ';
+    }
+    out[pos++] = '|';
+    out[pos++] = '\n';
+    return pos;
+}
+
+} // namespace netlyzer
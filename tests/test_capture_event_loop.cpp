@@ -0,0 +1,169 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/capture_event_loop.h"
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace {
+
+// A pipe stands in for the capture descriptor: readable once written to.
+struct Pipe {
+    Pipe() { EXPECT_EQ(0, pipe(fds)); }
+    ~Pipe()
+    {
+        close(fds[0]);
+        close(fds[1]);
+    }
+    void write_byte()
+    {
+        const char byte = 1;
+        EXPECT_EQ(1, write(fds[1], &byte, 1));
+    }
+    void read_byte()
+    {
+        char byte;
+        EXPECT_EQ(1, read(fds[0], &byte, 1));
+    }
+
+    int fds[2];
+};
+
+CaptureEventLoop::Config short_timeout()
+{
+    CaptureEventLoop::Config config;
+    config.idle_timeout_ms = 20;
+    return config;
+}
+
+double ms_since(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+} // namespace
+
+TEST(CaptureEventLoopTest, ReportsAReadableDescriptor) {
+    Pipe pipe;
+    CaptureEventLoop loop;
+    ASSERT_TRUE(loop.open(pipe.fds[0], short_timeout())) << loop.last_error();
+
+    pipe.write_byte();
+    EXPECT_EQ(CaptureEventLoop::Event::Readable, loop.wait());
+    // Level-triggered: still readable until drained.
+    EXPECT_EQ(CaptureEventLoop::Event::Readable, loop.wait());
+    pipe.read_byte();
+    loop.record_batch(1);
+
+    const CaptureEventLoop::Statistics stats = loop.get_statistics();
+    EXPECT_EQ(2u, stats.wakeups);
+    EXPECT_EQ(0u, stats.timeouts);
+    EXPECT_EQ(1u, stats.batches);
+    EXPECT_EQ(1u, stats.packets);
+}
+
+TEST(CaptureEventLoopTest, TimesOutWhenIdle) {
+    Pipe pipe;
+    CaptureEventLoop loop;
+    ASSERT_TRUE(loop.open(pipe.fds[0], short_timeout()));
+
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(CaptureEventLoop::Event::Timeout, loop.wait());
+    EXPECT_GE(ms_since(start), 15.0);
+    loop.record_batch(0);
+
+    const CaptureEventLoop::Statistics stats = loop.get_statistics();
+    EXPECT_EQ(1u, stats.timeouts);
+    EXPECT_EQ(0u, stats.wakeups);
+    EXPECT_EQ(1u, stats.empty_batches);
+    EXPECT_GT(stats.idle_ns, 0u);
+}
+
+TEST(CaptureEventLoopTest, WakeupInterruptsAWaitFromAnotherThread) {
+    const int fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ASSERT_GE(fd, 0);
+    CaptureEventLoop::Config config;
+    config.idle_timeout_ms = 10000;
+    CaptureEventLoop loop;
+    ASSERT_TRUE(loop.open(fd, config));
+
+    // As stop_capture does: flag the thread to stop, then wake it.
+    std::atomic<bool> running{true};
+    std::atomic<int> waits{0};
+    std::thread capture([&] {
+        while (running.load()) {
+            if (loop.wait() == CaptureEventLoop::Event::Wakeup)
+                waits.fetch_add(1);
+        }
+    });
+    const auto start = std::chrono::steady_clock::now();
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    running.store(false);
+    loop.wakeup();
+    capture.join();
+    EXPECT_LT(ms_since(start), 5000.0);
+    EXPECT_EQ(1, waits.load());
+
+    // The wakeup was consumed; the next wait sleeps again.
+    loop.close();
+    config.idle_timeout_ms = 10;
+    ASSERT_TRUE(loop.open(fd, config));
+    EXPECT_EQ(CaptureEventLoop::Event::Timeout, loop.wait());
+    close(fd);
+}
+
+TEST(CaptureEventLoopTest, StopsWaitingOnceClosed) {
+    Pipe pipe;
+    CaptureEventLoop loop;
+    EXPECT_FALSE(loop.open(-1, short_timeout()));
+    EXPECT_FALSE(loop.last_error().empty());
+    EXPECT_EQ(CaptureEventLoop::Event::Error, loop.wait());
+
+    ASSERT_TRUE(loop.open(pipe.fds[0], short_timeout()));
+    EXPECT_TRUE(loop.is_open());
+    loop.close();
+    EXPECT_FALSE(loop.is_open());
+    EXPECT_EQ(CaptureEventLoop::Event::Error, loop.wait());
+    loop.wakeup();      // harmless once closed
+}
+
+TEST(CaptureEventLoopTest, BusyPollNeverSleeps) {
+    Pipe pipe;
+    CaptureEventLoop::Config config;
+    config.busy_poll = true;
+    config.idle_timeout_ms = 10000;
+    CaptureEventLoop loop;
+    ASSERT_TRUE(loop.open(pipe.fds[0], config));
+    const auto start = std::chrono::steady_clock::now();
+    EXPECT_EQ(CaptureEventLoop::Event::Readable, loop.wait());
+    EXPECT_LT(ms_since(start), 1000.0);
+}
+
+TEST(CaptureEventLoopTest, BucketsBatchSizes) {
+    Pipe pipe;
+    CaptureEventLoop loop;
+    ASSERT_TRUE(loop.open(pipe.fds[0], short_timeout()));
+    for (size_t packets : {1u, 3u, 4u, 1000u})
+        loop.record_batch(packets);
+
+    CaptureEventLoop::Statistics stats = loop.get_statistics();
+    EXPECT_EQ(4u, stats.batches);
+    EXPECT_EQ(1008u, stats.packets);
+    EXPECT_EQ(1000u, stats.max_batch);
+    EXPECT_EQ(1u, stats.batch_histogram[0]);
+    EXPECT_EQ(1u, stats.batch_histogram[1]);
+    EXPECT_EQ(1u, stats.batch_histogram[2]);
+    EXPECT_EQ(1u, stats.batch_histogram[9]);
+
+    CaptureEventLoop::Statistics total;
+    total.accumulate(stats);
+    total.accumulate(stats);
+    EXPECT_EQ(2016u, total.packets);
+    EXPECT_EQ(1000u, total.max_batch);
+
+    loop.reset_statistics();
+    stats = loop.get_statistics();
+    EXPECT_EQ(0u, stats.batches);
+    EXPECT_EQ(0u, stats.batch_histogram[9]);
+}
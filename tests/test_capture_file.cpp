@@ -0,0 +1,369 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/capture_file.h"
+#include "netlyzer/core/parallel_dissector.h"
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <unistd.h>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+// Builds a file in either byte order.
+struct Writer {
+    explicit Writer(bool big_endian = false) : big_endian(big_endian) {}
+
+    void u8(uint8_t value) { bytes.push_back(value); }
+    void u16(uint16_t value) { put(value, 2); }
+    void u32(uint32_t value) { put(value, 4); }
+    void u64(uint64_t value) { put(value, 8); }
+    void data(const Bytes& data) { bytes.insert(bytes.end(), data.begin(), data.end()); }
+    void pad() { bytes.resize((bytes.size() + 3) & ~size_t(3)); }
+
+    void put(uint64_t value, int size)
+    {
+        for (int i = 0; i < size; ++i)
+            bytes.push_back(static_cast<uint8_t>(value >> 8 * (big_endian ? size - 1 - i : i)));
+    }
+
+    // A pcapng block around whatever `body` writes.
+    template <typename Body>
+    void block(uint32_t type, Body body)
+    {
+        const size_t start = bytes.size();
+        u32(type);
+        u32(0);
+        body();
+        pad();
+        const uint32_t length = static_cast<uint32_t>(bytes.size() - start + 4);
+        u32(length);
+        Writer patch(big_endian);
+        patch.u32(length);
+        std::memcpy(&bytes[start + 4], patch.bytes.data(), 4);
+    }
+
+    void section()
+    {
+        block(0x0a0d0d0a, [this] {
+            u32(0x1a2b3c4d);
+            u16(1);
+            u16(0);
+            u64(~uint64_t(0));
+        });
+    }
+
+    void interface(uint16_t link_type, const std::string& name, int tsresol = -1)
+    {
+        block(1, [&] {
+            u16(link_type);
+            u16(0);
+            u32(65535);
+            if (!name.empty()) {
+                u16(2);
+                u16(static_cast<uint16_t>(name.size()));
+                data(Bytes(name.begin(), name.end()));
+                pad();
+            }
+            if (tsresol >= 0) {
+                u16(9);
+                u16(1);
+                u8(static_cast<uint8_t>(tsresol));
+                pad();
+            }
+            u16(0);
+            u16(0);
+        });
+    }
+
+    void enhanced_packet(uint32_t interface, uint64_t units, const Bytes& packet, uint32_t length)
+    {
+        block(6, [&] {
+            u32(interface);
+            u32(static_cast<uint32_t>(units >> 32));
+            u32(static_cast<uint32_t>(units));
+            u32(static_cast<uint32_t>(packet.size()));
+            u32(length);
+            data(packet);
+        });
+    }
+
+    bool big_endian;
+    Bytes bytes;
+};
+
+struct TempFile {
+    explicit TempFile(const Bytes& bytes)
+    {
+        char path[] = "/tmp/netlyzer-capture-XXXXXX";
+        const int fd = mkstemp(path);
+        name = path;
+        EXPECT_EQ(static_cast<ssize_t>(bytes.size()), write(fd, bytes.data(), bytes.size()));
+        close(fd);
+    }
+    ~TempFile() { unlink(name.c_str()); }
+
+    std::string name;
+};
+
+Bytes packet(uint8_t fill, size_t size)
+{
+    Bytes bytes(size, fill);
+    bytes[12] = 0x08;
+    bytes[13] = 0x06;
+    return bytes;
+}
+
+Bytes pcap(bool big_endian, bool nanoseconds, const std::vector<Bytes>& packets)
+{
+    Writer writer(big_endian);
+    writer.u32(nanoseconds ? 0xa1b23c4d : 0xa1b2c3d4);
+    writer.u16(2);
+    writer.u16(4);
+    writer.u32(0);
+    writer.u32(0);
+    writer.u32(262144);
+    writer.u32(1);
+    for (size_t i = 0; i < packets.size(); ++i) {
+        writer.u32(static_cast<uint32_t>(1700000000 + i));
+        writer.u32(static_cast<uint32_t>(123 + i));
+        writer.u32(static_cast<uint32_t>(packets[i].size()));
+        writer.u32(static_cast<uint32_t>(packets[i].size() + 100));
+        writer.data(packets[i]);
+    }
+    return writer.bytes;
+}
+
+// Ethernet/IPv4/UDP from 10.<flow>.<flow>.1 to 192.168.0.<flow>, or ARP.
+Bytes flow_frame(uint32_t flow)
+{
+    if (flow % 7 == 0)
+        return packet(1, 42);
+    const uint8_t a = static_cast<uint8_t>(flow >> 8);
+    const uint8_t b = static_cast<uint8_t>(flow);
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                   0x45, 0, 0, 28, 0, 1, 0x40, 0, 64, 17, 0, 0, 10, a, b, 1, 192, 168, 0, b,
+                   a, b, 0, 53, 0, 8, 0, 0};
+    frame.resize(42 + flow % 100, 0x5a);
+    return frame;
+}
+
+std::vector<CaptureFile::Frame> read_all(CaptureFile& file, size_t batch = 3)
+{
+    std::vector<CaptureFile::Frame> frames;
+    std::vector<CaptureFile::Frame> chunk(batch);
+    while (size_t count = file.read(chunk.data(), batch))
+        frames.insert(frames.end(), chunk.begin(), chunk.begin() + count);
+    return frames;
+}
+
+} // namespace
+
+TEST(CaptureFileTest, ReadsPcapInEitherByteOrderAndPrecision) {
+    const std::vector<Bytes> packets = {packet(1, 60), packet(2, 1514), packet(3, 42)};
+    for (bool big_endian : {false, true}) {
+        for (bool nanoseconds : {false, true}) {
+            TempFile temp(pcap(big_endian, nanoseconds, packets));
+            CaptureFile file;
+            ASSERT_TRUE(file.open(temp.name)) << file.last_error();
+            EXPECT_EQ(CaptureFile::Format::Pcap, file.format());
+
+            const std::vector<CaptureFile::Frame> frames = read_all(file, 2);
+            ASSERT_EQ(3u, frames.size());
+            EXPECT_TRUE(file.done());
+            EXPECT_FALSE(file.truncated());
+            EXPECT_EQ(file.size(), file.position());
+            for (size_t i = 0; i < frames.size(); ++i) {
+                const uint64_t fraction = 123 + i;
+                EXPECT_EQ((1700000000 + i) * 1000000000ull + (nanoseconds ? fraction : fraction * 1000),
+                          frames[i].timestamp_ns);
+                EXPECT_EQ(packets[i].size(), frames[i].captured_length);
+                EXPECT_EQ(packets[i].size() + 100, frames[i].length);
+                EXPECT_EQ(CaptureFile::LINKTYPE_ETHERNET, frames[i].link_type);
+                EXPECT_EQ(0, std::memcmp(file.data(frames[i]), packets[i].data(), packets[i].size()));
+            }
+        }
+    }
+}
+
+TEST(CaptureFileTest, ReadsPcapngSectionsAndInterfaces) {
+    const Bytes first = packet(1, 60);
+    const Bytes second = packet(2, 99);
+    const Bytes third = packet(3, 64);
+
+    Writer writer;
+    writer.section();
+    writer.interface(1, "eth0");
+    writer.interface(1, "eth1", 9);
+    writer.enhanced_packet(0, 1700000000000001ull, first, 60);
+    writer.block(4, [&] { writer.u32(0); });        // name resolution, skipped
+    writer.enhanced_packet(1, 1700000000000000002ull, second, 1500);
+    // A second section, big-endian, with its own interface 0 in 2^-10 s.
+    Writer big(true);
+    big.section();
+    big.interface(1, "", 0x80 | 10);
+    big.enhanced_packet(0, 1024 * 5 + 512, third, 64);
+    big.block(3, [&] {
+        big.u32(60);
+        big.data(first);
+    });
+    writer.data(big.bytes);
+
+    TempFile temp(writer.bytes);
+    CaptureFile file;
+    ASSERT_TRUE(file.open(temp.name)) << file.last_error();
+    EXPECT_EQ(CaptureFile::Format::PcapNg, file.format());
+    const std::vector<CaptureFile::Frame> frames = read_all(file);
+    EXPECT_FALSE(file.truncated()) << file.last_error();
+    ASSERT_EQ(4u, frames.size());
+
+    ASSERT_EQ(3u, file.interface_count());
+    EXPECT_EQ("eth0", file.interface_name(0));
+    EXPECT_EQ("eth1", file.interface_name(1));
+    EXPECT_EQ("", file.interface_name(2));
+
+    EXPECT_EQ(0u, frames[0].interface);
+    EXPECT_EQ(1700000000000001000ull, frames[0].timestamp_ns);
+    EXPECT_EQ(0, std::memcmp(file.data(frames[0]), first.data(), first.size()));
+
+    EXPECT_EQ(1u, frames[1].interface);
+    EXPECT_EQ(1700000000000000002ull, frames[1].timestamp_ns);
+    EXPECT_EQ(99u, frames[1].captured_length);
+    EXPECT_EQ(1500u, frames[1].length);
+    EXPECT_EQ(0, std::memcmp(file.data(frames[1]), second.data(), second.size()));
+
+    EXPECT_EQ(2u, frames[2].interface);
+    EXPECT_EQ(5500000000ull, frames[2].timestamp_ns);
+    EXPECT_EQ(0, std::memcmp(file.data(frames[2]), third.data(), third.size()));
+
+    // Simple packet blocks belong to the section's first interface.
+    EXPECT_EQ(2u, frames[3].interface);
+    EXPECT_EQ(60u, frames[3].captured_length);
+    EXPECT_EQ(0, std::memcmp(file.data(frames[3]), first.data(), first.size()));
+}
+
+TEST(CaptureFileTest, StopsAtATruncatedRecord) {
+    Bytes bytes = pcap(false, false, {packet(1, 60), packet(2, 60)});
+    bytes.resize(bytes.size() - 10);
+    TempFile temp(bytes);
+    CaptureFile file;
+    ASSERT_TRUE(file.open(temp.name));
+    EXPECT_EQ(1u, read_all(file).size());
+    EXPECT_TRUE(file.done());
+    EXPECT_TRUE(file.truncated());
+    EXPECT_NE(std::string::npos, file.last_error().find("past the end"));
+
+    Writer writer;
+    writer.section();
+    writer.enhanced_packet(0, 0, packet(1, 60), 60);
+    TempFile undescribed(writer.bytes);
+    ASSERT_TRUE(file.open(undescribed.name));
+    EXPECT_EQ(0u, read_all(file).size());
+    EXPECT_TRUE(file.truncated());
+}
+
+TEST(CaptureFileTest, RejectsOtherFiles) {
+    TempFile text(Bytes(100, 'x'));
+    CaptureFile file;
+    EXPECT_FALSE(file.open(text.name));
+    EXPECT_FALSE(file.is_open());
+    EXPECT_NE(std::string::npos, file.last_error().find("not a pcap"));
+    EXPECT_FALSE(file.open("/nonexistent/netlyzer.pcap"));
+}
+
+TEST(CaptureFileTest, StoreRowsReadTheMappingAfterTheFileCloses) {
+    const std::vector<Bytes> packets = {packet(1, 60), packet(2, 1514)};
+    TempFile temp(pcap(false, true, packets));
+    CaptureFile file;
+    ASSERT_TRUE(file.open(temp.name));
+    PacketStore::Config config;
+    config.mapped_file = file.mapping();
+    PacketStore store(config);
+
+    for (const CaptureFile::Frame& frame : read_all(file)) {
+        DecodedPacket decoded;
+        PacketDecoder::decode(file.data(frame), frame.captured_length, frame.length, decoded);
+        store.append_mapped(frame.timestamp_ns, frame.length, 0, frame.offset, frame.captured_length, decoded);
+    }
+    file.close();
+
+    ASSERT_EQ(2u, store.size());
+    EXPECT_EQ(0u, store.contents().data_bytes());
+    for (size_t i = 0; i < packets.size(); ++i) {
+        EXPECT_EQ(packets[i].size(), store[i].captured_length());
+        EXPECT_EQ(0, std::memcmp(store[i].data(), packets[i].data(), packets[i].size()));
+    }
+}
+
+TEST(CaptureFileTest, ParallelDissectionMatchesAppendingOneByOne) {
+    std::vector<Bytes> packets;
+    for (uint32_t i = 0; i < 30000; ++i)
+        packets.push_back(flow_frame(i * 2654435761u % 3000));
+    TempFile temp(pcap(false, true, packets));
+    CaptureFile file;
+    ASSERT_TRUE(file.open(temp.name));
+    const std::vector<CaptureFile::Frame> frames = read_all(file, packets.size());
+    ASSERT_EQ(packets.size(), frames.size());
+
+    PacketStore::Config config;
+    config.mapped_file = file.mapping();
+    PacketStore serial(config);
+    PacketStore parallel(config);
+    std::vector<DecodedPacket> decoded(frames.size());
+    for (const CaptureFile::Frame& frame : frames) {
+        DecodedPacket packet;
+        PacketDecoder::decode(file.data(frame), frame.captured_length, frame.length, packet);
+        serial.append_mapped(frame.timestamp_ns, frame.length, 0, frame.offset, frame.captured_length, packet);
+    }
+
+    // Readers see whole rows, in order, while the batches land.
+    std::atomic<bool> stop{false};
+    std::atomic<size_t> bad{0};
+    std::thread reader([&] {
+        while (!stop.load()) {
+            PacketStore::Snapshot snapshot = parallel.snapshot();
+            const size_t rows = snapshot->size();
+            for (size_t i = 0; i < rows; i += 97) {
+                if ((*snapshot)[i].timestamp_ns() != frames[i].timestamp_ns || !(*snapshot)[i].protocol_name())
+                    ++bad;
+            }
+        }
+    });
+    // A few rows first, so that the chunks start off their boundaries.
+    for (size_t i = 0; i < 100; ++i) {
+        PacketDecoder::decode(file.data(frames[i]), frames[i].captured_length, frames[i].length, decoded[i]);
+        parallel.append_mapped(frames[i].timestamp_ns, frames[i].length, 0, frames[i].offset,
+                               frames[i].captured_length, decoded[i]);
+    }
+    ParallelDissector dissector(4);
+    EXPECT_EQ(4u, dissector.threads());
+    for (size_t first = 100; first < frames.size(); first += 7001) {
+        const size_t count = std::min<size_t>(7001, frames.size() - first);
+        EXPECT_EQ(first, dissector.append(parallel, file, &frames[first], count, &decoded[first]));
+    }
+    stop = true;
+    reader.join();
+    EXPECT_EQ(0u, bad.load());
+
+    ASSERT_EQ(serial.size(), parallel.size());
+    EXPECT_EQ(serial.contents().address_count(), parallel.contents().address_count());
+    size_t mismatches = 0;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        const PacketStore::Row expected = serial[i];
+        const PacketStore::Row row = parallel[i];
+        DecodedPacket packet;
+        expected.decode(packet);
+        mismatches += row.timestamp_ns() != expected.timestamp_ns() || row.length() != expected.length()
+            || row.captured_length() != expected.captured_length() || row.flags() != expected.flags()
+            || row.source_port() != expected.source_port() || row.dest_port() != expected.dest_port()
+            || row.ip_protocol() != expected.ip_protocol() || row.data() != expected.data()
+            || std::strcmp(row.protocol_name(), expected.protocol_name()) != 0
+            || std::memcmp(row.source_address(), expected.source_address(), 16) != 0
+            || std::memcmp(row.dest_address(), expected.dest_address(), 16) != 0
+            || std::memcmp(&decoded[i], &packet, sizeof(packet)) != 0;
+    }
+    EXPECT_EQ(0u, mismatches);
+}
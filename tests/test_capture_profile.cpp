@@ -0,0 +1,84 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/capture_profile.h"
+
+TEST(CaptureProfilesTest, EmptyConfigKeepsDefault) {
+    CaptureProfiles profiles;
+    EXPECT_TRUE(profiles.load(""));
+    ASSERT_EQ(profiles.names().size(), 1u);
+    EXPECT_EQ(profiles.default_profile().name, "default");
+    EXPECT_EQ(profiles.default_profile().snaplen, 262144);
+    EXPECT_TRUE(profiles.default_profile().promiscuous);
+}
+
+TEST(CaptureProfilesTest, LoadsNamedProfiles) {
+    CaptureProfiles profiles;
+    ASSERT_TRUE(profiles.load(R"({
+        "capture": {
+            "default_profile": "headers-only",
+            "profiles": {
+                "headers-only": { "snaplen": 128, "buffer_mb": 64, "nanosecond_timestamps": true,
+                                  "reassembly_mb": 32, "flow_table_mb": 256,
+                                  "packet_memory_mb": 512, "spill_directory": "/var/tmp",
+                                  "packet_compression": "zlib", "record_buffer_mb": 128,
+                                  "ring_file_mb": 100, "ring_file_seconds": 60, "ring_files": 5 },
+                "web": { "immediate": true, "promiscuous": false, "filter": "tcp port 443",
+                         "timestamp_type": "adapter", "verify_checksums": true }
+            }
+        }
+    })")) << profiles.last_error();
+
+    EXPECT_EQ(profiles.names().size(), 3u);
+    const CaptureProfile &headers = profiles.default_profile();
+    EXPECT_EQ(headers.name, "headers-only");
+    EXPECT_EQ(headers.snaplen, 128);
+    EXPECT_EQ(headers.buffer_size_mb, 64);
+    EXPECT_TRUE(headers.nanosecond_timestamps);
+    EXPECT_FALSE(headers.immediate_mode);
+    EXPECT_EQ(headers.timeout_ms, 1000);
+    EXPECT_FALSE(headers.verify_checksums);
+    EXPECT_EQ(headers.reassembly_mb, 32);
+    EXPECT_EQ(headers.flow_table_mb, 256);
+    EXPECT_EQ(headers.packet_memory_mb, 512);
+    EXPECT_EQ(headers.spill_directory, "/var/tmp");
+    EXPECT_EQ(headers.packet_compression, "zlib");
+    EXPECT_EQ(headers.record_buffer_mb, 128);
+    EXPECT_EQ(headers.ring_file_mb, 100);
+    EXPECT_EQ(headers.ring_file_seconds, 60);
+    EXPECT_EQ(headers.ring_files, 5);
+
+    const CaptureProfile *web = profiles.find("web");
+    ASSERT_NE(web, nullptr);
+    EXPECT_TRUE(web->immediate_mode);
+    EXPECT_FALSE(web->promiscuous);
+    EXPECT_EQ(web->filter, "tcp port 443");
+    EXPECT_EQ(web->timestamp_type, "adapter");
+    EXPECT_TRUE(web->verify_checksums);
+    EXPECT_EQ(web->reassembly_mb, 0);
+    EXPECT_EQ(web->flow_table_mb, 0);
+    EXPECT_EQ(web->packet_memory_mb, 0);
+    EXPECT_TRUE(web->spill_directory.empty());
+    EXPECT_EQ(web->packet_compression, "none");
+    EXPECT_EQ(web->record_buffer_mb, 64);
+    EXPECT_EQ(web->ring_file_mb, 0);
+    EXPECT_EQ(web->ring_files, 0);
+    EXPECT_EQ(profiles.find("missing"), nullptr);
+}
+
+TEST(CaptureProfilesTest, RejectsBadConfigWithoutLosingProfiles) {
+    CaptureProfiles profiles;
+    ASSERT_TRUE(profiles.load(R"({"capture": {"profiles": {"small": {"snaplen": 96}}}})"));
+
+    EXPECT_FALSE(profiles.load(R"({"capture": {"profiles": {"x": {"snaplen": 0}}}})"));
+    EXPECT_NE(profiles.last_error().find("snaplen"), std::string::npos);
+    EXPECT_FALSE(profiles.load(R"({"capture": {"profiles": {"x": {"snaplenn": 64}}}})"));
+    EXPECT_NE(profiles.last_error().find("unknown key"), std::string::npos);
+    EXPECT_FALSE(profiles.load(R"({"capture": {"profiles": {"x": {"packet_compression": "gzip"}}}})"));
+    EXPECT_NE(profiles.last_error().find("packet_compression"), std::string::npos);
+    EXPECT_FALSE(profiles.load(R"({"capture": {"profiles": {"x": {"record_buffer_mb": 0}}}})"));
+    EXPECT_NE(profiles.last_error().find("record_buffer_mb"), std::string::npos);
+    EXPECT_FALSE(profiles.load(R"({"capture": {"profiles": {"x": {"filter": "tcp"}})"));
+    EXPECT_FALSE(profiles.load(R"({"capture": {"default_profile": "nope"}})"));
+
+    ASSERT_NE(profiles.find("small"), nullptr);
+    EXPECT_EQ(profiles.find("small")->snaplen, 96);
+}
@@ -0,0 +1,329 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/capture_writer.h"
+#include "netlyzer/network/capture_file.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+struct TempDir {
+    TempDir()
+    {
+        char path[] = "/tmp/netlyzer-writer-XXXXXX";
+        name = mkdtemp(path);
+    }
+    ~TempDir()
+    {
+        for (const std::string& file : files())
+            unlink((name + "/" + file).c_str());
+        rmdir(name.c_str());
+    }
+
+    std::vector<std::string> files() const
+    {
+        std::vector<std::string> names;
+        if (DIR* dir = opendir(name.c_str())) {
+            while (dirent* entry = readdir(dir)) {
+                if (entry->d_name[0] != '.')
+                    names.push_back(entry->d_name);
+            }
+            closedir(dir);
+        }
+        std::sort(names.begin(), names.end());
+        return names;
+    }
+
+    std::string name;
+};
+
+Bytes frame(uint8_t fill, size_t size)
+{
+    Bytes bytes(size, fill);
+    bytes[12] = 0x08;
+    bytes[13] = 0x06;
+    return bytes;
+}
+
+struct Read {
+    std::vector<CaptureFile::Frame> frames;
+    std::vector<Bytes> data;
+    std::vector<std::string> interfaces;
+    bool ok = false;
+};
+
+Read read_file(const std::string& path)
+{
+    Read result;
+    CaptureFile file;
+    if (!file.open(path))
+        return result;
+    std::vector<CaptureFile::Frame> chunk(64);
+    while (size_t count = file.read(chunk.data(), chunk.size())) {
+        for (size_t i = 0; i < count; ++i) {
+            result.frames.push_back(chunk[i]);
+            result.data.emplace_back(file.data(chunk[i]), file.data(chunk[i]) + chunk[i].captured_length);
+        }
+    }
+    for (size_t i = 0; i < file.interface_count(); ++i)
+        result.interfaces.push_back(file.interface_name(i));
+    result.ok = !file.truncated();
+    return result;
+}
+
+} // namespace
+
+TEST(CaptureWriterTest, RoundTripsPcapAndPcapng) {
+    for (CaptureWriter::Format format : {CaptureWriter::Format::Pcap, CaptureWriter::Format::PcapNg}) {
+        for (bool io_uring : {false, true}) {
+            TempDir dir;
+            CaptureWriter::Config config;
+            config.path = dir.name + "/out";
+            config.format = format;
+            config.snaplen = 1000;
+            config.interfaces = {{"eth0", CaptureWriter::LINKTYPE_ETHERNET}, {"wlan0", CaptureWriter::LINKTYPE_ETHERNET}};
+            config.buffer_size = 8192;
+            config.buffer_count = 4;
+            config.use_io_uring = io_uring;
+            config.drop_when_full = false;
+            CaptureWriter writer;
+            ASSERT_TRUE(writer.open(config)) << writer.last_error();
+            if (!io_uring) {
+                EXPECT_EQ(CaptureWriter::Backend::Writev, writer.backend());
+            }
+
+            std::vector<Bytes> written;
+            for (size_t i = 0; i < 500; ++i) {
+                written.push_back(frame(static_cast<uint8_t>(i), 42 + i * 7 % 1400));
+                ASSERT_TRUE(writer.write(1700000000123456789ull + i * 1000, static_cast<uint32_t>(written[i].size() + 4),
+                                         static_cast<uint32_t>(i % 2), written[i].data(),
+                                         static_cast<uint32_t>(written[i].size())));
+            }
+            writer.close();
+            const CaptureWriter::Statistics stats = writer.get_statistics();
+            EXPECT_EQ(500u, stats.packets);
+            EXPECT_EQ(0u, stats.dropped_packets);
+            EXPECT_EQ(0u, stats.write_errors);
+            EXPECT_EQ(1u, stats.files);
+            EXPECT_LE(stats.buffers_high_water, 4u);
+
+            struct stat status;
+            ASSERT_EQ(0, stat(config.path.c_str(), &status));
+            EXPECT_EQ(static_cast<uint64_t>(status.st_size), stats.bytes);
+
+            const Read read = read_file(config.path);
+            ASSERT_TRUE(read.ok);
+            ASSERT_EQ(500u, read.frames.size());
+            for (size_t i = 0; i < read.frames.size(); ++i) {
+                const size_t kept = std::min<size_t>(written[i].size(), 1000);
+                EXPECT_EQ(1700000000123456789ull + i * 1000, read.frames[i].timestamp_ns);
+                EXPECT_EQ(written[i].size() + 4, read.frames[i].length);
+                ASSERT_EQ(kept, read.data[i].size());
+                EXPECT_TRUE(std::equal(read.data[i].begin(), read.data[i].end(), written[i].begin()));
+                if (format == CaptureWriter::Format::PcapNg) {
+                    EXPECT_EQ(i % 2, read.frames[i].interface);
+                }
+            }
+            if (format == CaptureWriter::Format::PcapNg) {
+                EXPECT_EQ((std::vector<std::string>{"eth0", "wlan0"}), read.interfaces);
+            }
+        }
+    }
+}
+
+TEST(CaptureWriterTest, EmptyCaptureStillGetsAHeader) {
+    TempDir dir;
+    CaptureWriter::Config config;
+    config.path = dir.name + "/empty.pcapng";
+    config.format = CaptureWriter::Format::PcapNg;
+    CaptureWriter writer;
+    ASSERT_TRUE(writer.open(config)) << writer.last_error();
+    writer.close();
+    EXPECT_FALSE(writer.write(0, 60, 0, frame(1, 60).data(), 60));
+
+    const Read read = read_file(config.path);
+    EXPECT_TRUE(read.ok);
+    EXPECT_TRUE(read.frames.empty());
+    EXPECT_EQ(1u, read.interfaces.size());
+}
+
+TEST(CaptureWriterTest, RejectsUnusableConfigs) {
+    CaptureWriter writer;
+    CaptureWriter::Config config;
+    config.path = "/nonexistent/directory/out.pcap";
+    EXPECT_FALSE(writer.open(config));
+    EXPECT_NE(std::string::npos, writer.last_error().find("/nonexistent/directory/out.pcap"));
+
+    TempDir dir;
+    config.path = dir.name + "/out.pcap";
+    config.buffer_size = 4096;
+    config.snaplen = 65535;
+    EXPECT_FALSE(writer.open(config));
+    EXPECT_FALSE(writer.is_open());
+}
+
+TEST(CaptureWriterTest, RotatesBySizeKeepingTheLastFiles) {
+    TempDir dir;
+    CaptureWriter::Config config;
+    config.path = dir.name + "/ring.pcap";
+    config.snaplen = 1500;
+    config.rotate_bytes = 20000;
+    config.ring_files = 3;
+    config.buffer_size = 8192;
+    config.buffer_count = 4;
+    config.drop_when_full = false;
+    CaptureWriter writer;
+    ASSERT_TRUE(writer.open(config)) << writer.last_error();
+    for (uint32_t i = 0; i < 200; ++i) {
+        const Bytes bytes = frame(static_cast<uint8_t>(i), 1000);
+        ASSERT_TRUE(writer.write(i * 1000000ull, 1000, 0, bytes.data(), 1000));
+    }
+    writer.close();
+
+    // 19 records of 1016 bytes after the 24-byte header fill a file.
+    const CaptureWriter::Statistics stats = writer.get_statistics();
+    EXPECT_EQ(11u, stats.files);
+    const std::vector<std::string> files = dir.files();
+    ASSERT_EQ(3u, files.size());
+    EXPECT_EQ(0u, files[0].find("ring_00009_"));
+    EXPECT_EQ(0u, files[1].find("ring_00010_"));
+    EXPECT_EQ(0u, files[2].find("ring_00011_"));
+    EXPECT_EQ(std::string("ring_00011_20240101120000.pcap").size(), files[2].size());
+
+    std::vector<uint8_t> fills;
+    for (const std::string& file : files) {
+        struct stat status;
+        ASSERT_EQ(0, stat((dir.name + "/" + file).c_str(), &status));
+        EXPECT_LE(status.st_size, 20000);
+        const Read read = read_file(dir.name + "/" + file);
+        ASSERT_TRUE(read.ok) << file;
+        for (const Bytes& data : read.data)
+            fills.push_back(data[0]);
+    }
+    ASSERT_EQ(200u - 8 * 19, fills.size());
+    for (size_t i = 0; i < fills.size(); ++i)
+        EXPECT_EQ(static_cast<uint8_t>(8 * 19 + i), fills[i]);
+}
+
+TEST(CaptureWriterTest, RotatesByPacketTime) {
+    TempDir dir;
+    CaptureWriter::Config config;
+    config.path = dir.name + "/timed.pcapng";
+    config.format = CaptureWriter::Format::PcapNg;
+    config.rotate_seconds = 2;
+    CaptureWriter writer;
+    ASSERT_TRUE(writer.open(config)) << writer.last_error();
+    const Bytes bytes = frame(1, 60);
+    // Every half second for five seconds: files start at 0, 2 and 4 s.
+    for (uint64_t i = 0; i < 10; ++i)
+        ASSERT_TRUE(writer.write(1700000000000000000ull + i * 500000000ull, 60, 0, bytes.data(), 60));
+    writer.close();
+
+    const std::vector<std::string> files = dir.files();
+    ASSERT_EQ(3u, files.size());
+    const size_t expected[] = {4, 4, 2};
+    for (size_t i = 0; i < files.size(); ++i) {
+        const Read read = read_file(dir.name + "/" + files[i]);
+        ASSERT_TRUE(read.ok);
+        EXPECT_EQ(expected[i], read.frames.size()) << files[i];
+    }
+}
+
+TEST(CaptureWriterTest, DropsInsteadOfBlockingWhenTheOutputFallsBehind) {
+    TempDir dir;
+    const std::string path = dir.name + "/fifo";
+    ASSERT_EQ(0, mkfifo(path.c_str(), 0600));
+    const int reader = open(path.c_str(), O_RDONLY | O_NONBLOCK);
+    ASSERT_GE(reader, 0);
+
+    CaptureWriter::Config config;
+    config.path = path;
+    config.snaplen = 1500;
+    config.buffer_size = 8192;
+    config.buffer_count = 2;
+    CaptureWriter writer;
+    ASSERT_TRUE(writer.open(config)) << writer.last_error();
+    EXPECT_EQ(CaptureWriter::Backend::Writev, writer.backend());
+
+    // Nobody reads the pipe, so once it and both buffers are full every
+    // packet is dropped.
+    const Bytes bytes = frame(7, 1500);
+    size_t taken = 0;
+    for (size_t i = 0; i < 2000; ++i)
+        taken += writer.write(i, 1500, 0, bytes.data(), 1500);
+    CaptureWriter::Statistics stats = writer.get_statistics();
+    EXPECT_EQ(taken, stats.packets);
+    EXPECT_EQ(2000u, stats.packets + stats.dropped_packets);
+    EXPECT_GT(stats.dropped_packets, 1000u);
+    EXPECT_EQ(stats.dropped_packets * 1500, stats.dropped_bytes);
+    EXPECT_EQ(2u, stats.buffers_high_water);
+
+    // Draining the pipe lets close() finish; what was taken arrives whole.
+    const int flags = fcntl(reader, F_GETFL);
+    fcntl(reader, F_SETFL, flags & ~O_NONBLOCK);
+    uint64_t drained = 0;
+    std::thread drain([&] {
+        char chunk[65536];
+        ssize_t count;
+        while ((count = read(reader, chunk, sizeof(chunk))) > 0)
+            drained += count;
+    });
+    writer.close();
+    drain.join();
+    close(reader);
+    stats = writer.get_statistics();
+    EXPECT_EQ(24 + taken * (16 + 1500), drained);
+    EXPECT_EQ(drained, stats.bytes);
+}
+
+TEST(CaptureWriterTest, ThreadsWriteWholeRecords) {
+    for (bool io_uring : {false, true}) {
+        TempDir dir;
+        CaptureWriter::Config config;
+        config.path = dir.name + "/threads.pcapng";
+        config.format = CaptureWriter::Format::PcapNg;
+        config.snaplen = 1500;
+        config.interfaces.resize(4);
+        config.buffer_size = 16384;
+        config.buffer_count = 3;
+        config.use_io_uring = io_uring;
+        config.drop_when_full = false;
+        CaptureWriter writer;
+        ASSERT_TRUE(writer.open(config)) << writer.last_error();
+
+        std::vector<std::thread> threads;
+        for (uint32_t thread = 0; thread < 4; ++thread) {
+            threads.emplace_back([&writer, thread] {
+                for (uint32_t i = 0; i < 3000; ++i) {
+                    const Bytes bytes = frame(static_cast<uint8_t>(thread), 60 + thread);
+                    writer.write(i, 100, thread, bytes.data(), static_cast<uint32_t>(bytes.size()));
+                }
+            });
+        }
+        for (std::thread& thread : threads)
+            thread.join();
+        writer.close();
+
+        const Read read = read_file(config.path);
+        ASSERT_TRUE(read.ok);
+        ASSERT_EQ(12000u, read.frames.size());
+        std::vector<uint32_t> next(4, 0);
+        for (size_t i = 0; i < read.frames.size(); ++i) {
+            const uint32_t thread = read.frames[i].interface;
+            ASSERT_LT(thread, 4u);
+            EXPECT_EQ(60 + thread, read.data[i].size());
+            EXPECT_EQ(thread, read.data[i][0]);
+            EXPECT_EQ(next[thread]++, read.frames[i].timestamp_ns);
+        }
+    }
+}
@@ -0,0 +1,157 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/checksum.h"
+#include <cstring>
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+constexpr size_t IP = 14;           // untagged Ethernet
+constexpr size_t L4 = IP + 20;
+
+// RFC 1071 reference: big-endian 16-bit words, end-around carry.
+uint16_t reference_sum(const uint8_t* data, size_t length, uint32_t sum = 0)
+{
+    for (size_t i = 0; i < length; i += 2) {
+        sum += static_cast<uint32_t>(data[i] << 8) | (i + 1 < length ? data[i + 1] : 0);
+        sum = (sum & 0xffff) + (sum >> 16);
+    }
+    return static_cast<uint16_t>(sum);
+}
+
+void store_be16(uint8_t* p, uint16_t value)
+{
+    p[0] = static_cast<uint8_t>(value >> 8);
+    p[1] = static_cast<uint8_t>(value);
+}
+
+Bytes ipv4_frame(uint8_t protocol, size_t payload)
+{
+    const size_t l4_header = protocol == 6 ? 20 : (protocol == 17 ? 8 : 4);
+    const size_t total = 20 + l4_header + payload;
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                   0x45, 0, static_cast<uint8_t>(total >> 8), static_cast<uint8_t>(total),
+                   0x12, 0x34, 0x40, 0, 64, protocol, 0, 0, 10, 0, 0, 1, 192, 168, 7, 9};
+    if (protocol == 6)
+        frame.insert(frame.end(), {0x04, 0xd2, 0x00, 0x50, 0, 0, 0, 1, 0, 0, 0, 0, 0x50, 0x18, 0xff, 0xff, 0, 0, 0, 0});
+    else if (protocol == 17)
+        frame.insert(frame.end(), {0x04, 0xd2, 0x00, 0x35, static_cast<uint8_t>((8 + payload) >> 8),
+                                   static_cast<uint8_t>(8 + payload), 0, 0});
+    else
+        frame.insert(frame.end(), {8, 0, 0, 0});
+    for (size_t i = 0; i < payload; ++i)
+        frame.push_back(static_cast<uint8_t>(i * 7 + 3));
+
+    store_be16(&frame[IP + 10], static_cast<uint16_t>(~reference_sum(&frame[IP], 20)));
+    const size_t length = total - 20;
+    uint32_t pseudo = 0;
+    if (protocol != 1) {
+        pseudo = reference_sum(&frame[IP + 12], 8);
+        pseudo += protocol + static_cast<uint32_t>(length);
+    }
+    const size_t field = protocol == 6 ? 16 : (protocol == 17 ? 6 : 2);
+    store_be16(&frame[L4 + field], static_cast<uint16_t>(~reference_sum(&frame[L4], length, pseudo)));
+    return frame;
+}
+
+uint32_t verify(Bytes& frame, ChecksumCounters* counters = nullptr, size_t caplen = 0)
+{
+    const uint32_t captured = static_cast<uint32_t>(caplen ? caplen : frame.size());
+    DecodedPacket packet;
+    PacketDecoder::decode(frame.data(), captured, static_cast<uint32_t>(frame.size()), packet);
+    ChecksumVerifier::verify(frame.data(), captured, packet, counters);
+    return packet.flags;
+}
+
+constexpr uint32_t RESULT_FLAGS = DecodedPacket::CHECKSUM_VERIFIED | DecodedPacket::BAD_IP_CHECKSUM
+                                | DecodedPacket::BAD_L4_CHECKSUM | DecodedPacket::CHECKSUM_OFFLOAD;
+
+} // namespace
+
+TEST(ChecksumTest, EveryPathMatchesReference) {
+    Bytes data(1500);
+    for (size_t i = 0; i < data.size(); ++i)
+        data[i] = static_cast<uint8_t>(i * 131 + (i >> 3));
+
+    const ChecksumVerifier::Path paths[] = {ChecksumVerifier::Path::Best, ChecksumVerifier::Path::Scalar,
+                                            ChecksumVerifier::Path::Sse2, ChecksumVerifier::Path::Avx2};
+    for (ChecksumVerifier::Path path : paths) {
+        if (!ChecksumVerifier::has_path(path))
+            continue;
+        for (size_t length : {0, 1, 2, 3, 15, 16, 17, 31, 63, 64, 65, 127, 200, 1499, 1500}) {
+            uint8_t expected[2];
+            store_be16(expected, static_cast<uint16_t>(~reference_sum(data.data(), length)));
+            const uint16_t checksum = static_cast<uint16_t>(~ChecksumVerifier::fold(
+                ChecksumVerifier::add(data.data(), length, 0, path)));
+            EXPECT_EQ(0, std::memcmp(expected, &checksum, 2)) << "length " << length;
+        }
+    }
+}
+
+TEST(ChecksumTest, AcceptsValidPackets) {
+    ChecksumCounters counters;
+    for (uint8_t protocol : {6, 17, 1}) {
+        Bytes frame = ipv4_frame(protocol, 333);
+        EXPECT_EQ(static_cast<uint32_t>(DecodedPacket::CHECKSUM_VERIFIED), verify(frame, &counters) & RESULT_FLAGS)
+            << "protocol " << int(protocol);
+    }
+    EXPECT_EQ(3u, counters.verified.load());
+    EXPECT_EQ(0u, counters.bad_ip.load() + counters.bad_l4.load() + counters.offloaded.load());
+}
+
+TEST(ChecksumTest, FlagsCorruption) {
+    ChecksumCounters counters;
+    Bytes frame = ipv4_frame(6, 100);
+    frame[L4 + 20 + 50] ^= 0x40;
+    uint32_t flags = verify(frame, &counters);
+    EXPECT_TRUE(flags & DecodedPacket::BAD_L4_CHECKSUM);
+    EXPECT_FALSE(flags & DecodedPacket::BAD_IP_CHECKSUM);
+
+    frame = ipv4_frame(17, 101);
+    frame[IP + 8] = 63;             // TTL
+    flags = verify(frame, &counters);
+    EXPECT_TRUE(flags & DecodedPacket::BAD_IP_CHECKSUM);
+    EXPECT_FALSE(flags & DecodedPacket::BAD_L4_CHECKSUM);
+    EXPECT_EQ(1u, counters.bad_ip.load());
+    EXPECT_EQ(1u, counters.bad_l4.load());
+}
+
+TEST(ChecksumTest, RecognisesOffloadedTransportChecksum) {
+    Bytes frame = ipv4_frame(6, 64);
+    const size_t length = 20 + 64;
+    // What the kernel leaves for the NIC: the pseudo-header sum, not inverted.
+    store_be16(&frame[L4 + 16], reference_sum(&frame[IP + 12], 8, 6 + static_cast<uint32_t>(length)));
+    const uint32_t flags = verify(frame);
+    EXPECT_TRUE(flags & DecodedPacket::CHECKSUM_OFFLOAD);
+    EXPECT_FALSE(flags & DecodedPacket::BAD_L4_CHECKSUM);
+}
+
+TEST(ChecksumTest, UdpZeroChecksumAndIpv6) {
+    Bytes frame = ipv4_frame(17, 20);
+    frame[L4 + 6] = frame[L4 + 7] = 0;
+    EXPECT_EQ(static_cast<uint32_t>(DecodedPacket::CHECKSUM_VERIFIED), verify(frame) & RESULT_FLAGS);
+
+    Bytes v6 = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x86, 0xdd, 0x60, 0, 0, 0, 0, 12, 17, 64};
+    v6.resize(v6.size() + 32, 0);
+    v6[22 + 15] = 1;
+    v6[38 + 15] = 2;
+    v6.insert(v6.end(), {0x13, 0x88, 0x00, 0x35, 0, 12, 0, 0, 'p', 'i', 'n', 'g'});
+    const size_t udp = 54;
+    uint32_t pseudo = reference_sum(&v6[22], 32, 12 + 17);
+    store_be16(&v6[udp + 6], static_cast<uint16_t>(~reference_sum(&v6[udp], 12, pseudo)));
+    EXPECT_EQ(static_cast<uint32_t>(DecodedPacket::CHECKSUM_VERIFIED), verify(v6) & RESULT_FLAGS);
+
+    v6[udp + 6] = v6[udp + 7] = 0;
+    EXPECT_TRUE(verify(v6) & DecodedPacket::BAD_L4_CHECKSUM);
+}
+
+TEST(ChecksumTest, SkipsWhatWasNotCaptured) {
+    ChecksumCounters counters;
+    Bytes frame = ipv4_frame(6, 400);
+    const uint32_t flags = verify(frame, &counters, 96);
+    EXPECT_FALSE(flags & DecodedPacket::CHECKSUM_VERIFIED);
+    EXPECT_FALSE(flags & DecodedPacket::BAD_L4_CHECKSUM);
+    EXPECT_EQ(1u, counters.unverifiable.load());
+    EXPECT_EQ(1u, counters.verified.load());       // the IPv4 header was captured
+}
@@ -0,0 +1,159 @@
+#include <gtest/gtest.h>
+#include "netlyzer/core/display_filter.h"
+#include <arpa/inet.h>
+#include <cstring>
+#include <functional>
+#include <random>
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+constexpr uint64_t SECOND = 1000000000ull;
+constexpr uint64_t START = 1700000000 * SECOND;
+
+Bytes ipv4_frame(uint8_t source, uint8_t dest, uint16_t source_port, uint16_t dest_port, bool udp)
+{
+    const size_t transport = udp ? 8 : 20;
+    const size_t total = 20 + transport;
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                   0x45, 0, static_cast<uint8_t>(total >> 8), static_cast<uint8_t>(total), 0, 1, 0x40, 0,
+                   64, static_cast<uint8_t>(udp ? 17 : 6), 0, 0, 10, 0, 0, source, 10, 0, 0, dest,
+                   static_cast<uint8_t>(source_port >> 8), static_cast<uint8_t>(source_port),
+                   static_cast<uint8_t>(dest_port >> 8), static_cast<uint8_t>(dest_port)};
+    if (udp)
+        frame.insert(frame.end(), {0, 8, 0, 0});
+    else
+        frame.insert(frame.end(), {0, 0, 0, 1, 0, 0, 0, 0, 0x50, 0x10, 0xff, 0xff, 0, 0, 0, 0});
+    return frame;
+}
+
+Bytes arp_frame()
+{
+    return {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0, 1, 2, 3, 4, 5, 0x08, 0x06,
+            0, 1, 0x08, 0x00, 6, 4, 0, 1, 0, 1, 2, 3, 4, 5, 10, 0, 0, 1,
+            0, 0, 0, 0, 0, 0, 10, 0, 0, 2};
+}
+
+// A store of mixed traffic between 10.0.0.1-8, with its index.
+class DisplayFilterTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        std::mt19937 random(3);
+        for (uint32_t i = 0; i < 150000; ++i) {
+            const uint32_t kind = random() % 10;
+            const Bytes frame = kind == 0 ? arp_frame()
+                : ipv4_frame(static_cast<uint8_t>(1 + random() % 8), static_cast<uint8_t>(1 + random() % 8),
+                             static_cast<uint16_t>(kind < 4 ? 53 : 1024 + random() % 64),
+                             static_cast<uint16_t>(kind < 4 ? 40000 + random() % 8 : (kind < 7 ? 443 : 80)),
+                             kind < 4);
+            DecodedPacket packet;
+            PacketDecoder::decode(frame.data(), static_cast<uint32_t>(frame.size()),
+                                  static_cast<uint32_t>(frame.size()), packet);
+            // A millisecond apart, with some out of order.
+            const uint64_t timestamp = START + i * 1000000ull - (i % 7 == 3 ? 5000000ull : 0);
+            store.append(timestamp, static_cast<uint32_t>(frame.size()), 0, frame.data(),
+                         static_cast<uint32_t>(frame.size()), packet);
+            index.add(store.contents(), i);
+        }
+    }
+
+    // What the filter gives, against a scan of every row.
+    void expect_matches(const std::string& text, const std::function<bool(const PacketStore::Row&)>& match)
+    {
+        DisplayFilter filter;
+        ASSERT_TRUE(filter.parse(text)) << text << ": " << filter.last_error();
+        std::vector<uint32_t> expected;
+        for (size_t i = 0; i < store.size(); ++i) {
+            if (match(store[i]))
+                expected.push_back(static_cast<uint32_t>(i));
+        }
+        EXPECT_FALSE(expected.empty()) << text;
+        EXPECT_EQ(expected, filter.evaluate(index, store.contents()).to_vector()) << text;
+        // And row by row, as rows added after the evaluate are decided.
+        std::vector<uint32_t> scanned;
+        for (size_t i = 0; i < store.size(); ++i) {
+            if (filter.matches(store.contents(), i))
+                scanned.push_back(static_cast<uint32_t>(i));
+        }
+        EXPECT_EQ(expected, scanned) << text;
+    }
+
+    static bool is_address(const uint8_t* address, uint8_t last)
+    {
+        const uint8_t ipv4[16] = {10, 0, 0, last};
+        return std::memcmp(address, ipv4, 16) == 0;
+    }
+
+    PacketStore store;
+    PacketIndex index;
+};
+
+} // namespace
+
+TEST_F(DisplayFilterTest, LayersMatchEveryPacketCarryingThem) {
+    expect_matches("tcp", [](const PacketStore::Row& row) { return row.has(DecodedPacket::TCP); });
+    expect_matches("ARP", [](const PacketStore::Row& row) { return row.has(DecodedPacket::ARP); });
+    expect_matches("ip and not udp", [](const PacketStore::Row& row) {
+        return row.has(DecodedPacket::IPV4) && !row.has(DecodedPacket::UDP);
+    });
+    expect_matches("protocol == \"udp\"", [](const PacketStore::Row& row) {
+        return std::strcmp(row.protocol_name(), "UDP") == 0;
+    });
+}
+
+TEST_F(DisplayFilterTest, AddressesAndPorts) {
+    expect_matches("ip.addr == 10.0.0.3", [](const PacketStore::Row& row) {
+        return row.has(DecodedPacket::IPV4)
+            && (is_address(row.source_address(), 3) || is_address(row.dest_address(), 3));
+    });
+    expect_matches("ip.src == 10.0.0.1 && ip.dst != 10.0.0.2", [](const PacketStore::Row& row) {
+        return row.has(DecodedPacket::IPV4) && is_address(row.source_address(), 1)
+            && !(row.has(DecodedPacket::IPV4) && is_address(row.dest_address(), 2));
+    });
+    expect_matches("tcp.port == 443 or udp.srcport eq 53", [](const PacketStore::Row& row) {
+        return (row.has(DecodedPacket::TCP) && (row.source_port() == 443 || row.dest_port() == 443))
+            || (row.has(DecodedPacket::UDP) && row.source_port() == 53);
+    });
+    expect_matches("udp.dstport >= 40004 && !(tcp.dstport < 100)", [](const PacketStore::Row& row) {
+        return row.has(DecodedPacket::UDP) && row.dest_port() >= 40004;
+    });
+}
+
+TEST_F(DisplayFilterTest, FrameNumbersAndTimes) {
+    expect_matches("frame.number <= 10 || frame.number > 149990", [](const PacketStore::Row& row) {
+        return row.number() <= 10 || row.number() > 149990;
+    });
+    // Across a block boundary, with timestamps a little out of order.
+    expect_matches("frame.time_relative >= 65.5 and frame.time_relative < 66", [](const PacketStore::Row& row) {
+        return row.timestamp_ns() >= START + 65500000000ull && row.timestamp_ns() < START + 66 * SECOND;
+    });
+    expect_matches("frame.time_epoch > 1700000100", [](const PacketStore::Row& row) {
+        return row.timestamp_ns() > START + 100 * SECOND;
+    });
+}
+
+TEST_F(DisplayFilterTest, UnknownValuesMatchNothing) {
+    DisplayFilter filter;
+    ASSERT_TRUE(filter.parse("ip.addr == 192.168.0.1 or protocol == DNS or ipv6"));
+    EXPECT_TRUE(filter.evaluate(index, store.contents()).empty());
+    for (size_t i = 0; i < store.size(); ++i)
+        ASSERT_FALSE(filter.matches(store.contents(), i)) << i;
+}
+
+TEST(DisplayFilterParseTest, RejectsWhatTheIndexCannotAnswer) {
+    DisplayFilter filter;
+    ASSERT_TRUE(filter.parse("tcp"));
+    for (const char* text : {"", "http.host == x", "tcp.port == 70000", "ip.addr == 10.0.0", "ip.addr > 10.0.0.1",
+                             "(tcp", "tcp udp", "frame.time_relative == -1", "protocol == \"TCP",
+                             "ipv6.src == 10.0.0.1", "tcp.flags"}) {
+        EXPECT_FALSE(filter.parse(text)) << text;
+        EXPECT_FALSE(filter.last_error().empty()) << text;
+    }
+    // The last good filter is kept.
+    EXPECT_FALSE(filter.empty());
+    EXPECT_TRUE(filter.parse("ipv6.addr == ::1 || ( tcp.srcport==1 )"));
+    EXPECT_TRUE(filter.last_error().empty());
+}
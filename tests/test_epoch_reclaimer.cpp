@@ -0,0 +1,66 @@
+#include <gtest/gtest.h>
+#include "netlyzer/core/epoch_reclaimer.h"
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+TEST(EpochReclaimerTest, WaitsForReadersPinnedBeforeRetirement) {
+    EpochReclaimer epochs;
+    int freed = 0;
+
+    EpochReclaimer::Guard early = epochs.pin();
+    epochs.retire([&freed] { ++freed; });
+    EpochReclaimer::Guard late = epochs.pin();
+
+    EXPECT_EQ(0u, epochs.reclaim());
+    early = EpochReclaimer::Guard();
+    // Pinned after the retirement, so it cannot have seen the object.
+    EXPECT_EQ(1u, epochs.reclaim());
+    EXPECT_EQ(1, freed);
+    EXPECT_EQ(0u, epochs.pending());
+}
+
+TEST(EpochReclaimerTest, DestructorFreesWhatIsLeft) {
+    int freed = 0;
+    {
+        EpochReclaimer epochs;
+        {
+            EpochReclaimer::Guard guard = epochs.pin();
+            epochs.retire([&freed] { ++freed; });
+            epochs.reclaim();
+        }
+        EXPECT_EQ(0, freed);
+    }
+    EXPECT_EQ(1, freed);
+}
+
+TEST(EpochReclaimerTest, ReadersNeverSeeFreedMemory) {
+    EpochReclaimer epochs;
+    std::atomic<int*> shared{new int(0)};
+    std::atomic<bool> done{false};
+    std::atomic<size_t> bad{0};
+
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 4; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                EpochReclaimer::Guard guard = epochs.pin();
+                // Freed values are poisoned to -1 before the delete.
+                if (*shared.load() < 0)
+                    ++bad;
+            }
+        });
+    }
+
+    for (int i = 1; i <= 20000; ++i) {
+        int* old = shared.exchange(new int(i));
+        epochs.retire([old] { *old = -1; delete old; });
+        epochs.reclaim();
+    }
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+    delete shared.load();
+    EXPECT_EQ(0u, bad.load());
+}
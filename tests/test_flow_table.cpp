@@ -0,0 +1,253 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/flow_table.h"
+#include <map>
+#include <memory>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+constexpr uint64_t SECOND = 1000000000ull;
+constexpr uint8_t FIN = 0x01;
+constexpr uint8_t SYN = 0x02;
+constexpr uint8_t RST = 0x04;
+constexpr uint8_t ACK = 0x10;
+
+// Ethernet/IPv4/TCP (or UDP) frame from 10.0.a.b:sport to 10.0.c.d:dport.
+Bytes ipv4_frame(uint16_t source, uint16_t dest, uint16_t source_port, uint16_t dest_port,
+                 uint8_t flags, bool udp = false, size_t payload = 0)
+{
+    const size_t transport = udp ? 8 : 20;
+    const size_t total = 20 + transport + payload;
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                   0x45, 0, static_cast<uint8_t>(total >> 8), static_cast<uint8_t>(total), 0, 1, 0x40, 0,
+                   64, static_cast<uint8_t>(udp ? 17 : 6), 0, 0,
+                   10, 0, static_cast<uint8_t>(source >> 8), static_cast<uint8_t>(source),
+                   10, 0, static_cast<uint8_t>(dest >> 8), static_cast<uint8_t>(dest),
+                   static_cast<uint8_t>(source_port >> 8), static_cast<uint8_t>(source_port),
+                   static_cast<uint8_t>(dest_port >> 8), static_cast<uint8_t>(dest_port)};
+    if (udp)
+        frame.insert(frame.end(), {static_cast<uint8_t>((8 + payload) >> 8), static_cast<uint8_t>(8 + payload), 0, 0});
+    else
+        frame.insert(frame.end(), {0, 0, 0, 1, 0, 0, 0, 0, 0x50, flags, 0xff, 0xff, 0, 0, 0, 0});
+    frame.resize(frame.size() + payload, 0x5a);
+    return frame;
+}
+
+DecodedPacket decode(const Bytes& frame)
+{
+    DecodedPacket packet;
+    PacketDecoder::decode(frame.data(), static_cast<uint32_t>(frame.size()), static_cast<uint32_t>(frame.size()),
+                          packet);
+    return packet;
+}
+
+void feed(FlowTable& table, const Bytes& frame, uint64_t timestamp_ns)
+{
+    table.update(decode(frame), timestamp_ns);
+}
+
+struct Expired {
+    std::vector<std::pair<FlowTable::Flow, FlowTable::Expiry>> flows;
+
+    FlowTable::ExpiryCallback callback()
+    {
+        return [this](const FlowTable::Flow& flow, FlowTable::Expiry why) { flows.emplace_back(flow, why); };
+    }
+};
+
+} // namespace
+
+TEST(FlowTableTest, CountsBothDirectionsOfOneFlow) {
+    FlowTable table;
+    feed(table, ipv4_frame(2, 1, 80, 40000, SYN | ACK), SECOND);         // SYN-ACK seen first
+    feed(table, ipv4_frame(1, 2, 40000, 80, ACK, false, 100), 2 * SECOND);
+    feed(table, ipv4_frame(2, 1, 80, 40000, ACK, false, 1000), 3 * SECOND);
+    EXPECT_EQ(1u, table.size());
+
+    const FlowTable::Flow* flow = table.find(decode(ipv4_frame(1, 2, 40000, 80, ACK)));
+    ASSERT_NE(nullptr, flow);
+    EXPECT_EQ(flow, table.find(decode(ipv4_frame(2, 1, 80, 40000, ACK))));
+    EXPECT_EQ(nullptr, table.find(decode(ipv4_frame(1, 2, 40001, 80, ACK))));
+
+    // Endpoint 0 is 10.0.0.1:40000, which was called back by the SYN-ACK.
+    EXPECT_EQ(40000, flow->key.port[0]);
+    EXPECT_EQ(0, flow->initiator);
+    EXPECT_EQ(1u, flow->packets[0]);
+    EXPECT_EQ(2u, flow->packets[1]);
+    EXPECT_EQ(14u + 40u + 100u, flow->bytes[0]);
+    EXPECT_EQ(SECOND, flow->first_seen_ns);
+    EXPECT_EQ(3 * SECOND, flow->last_seen_ns);
+    EXPECT_EQ(FlowTable::TcpState::Established, flow->tcp_state);
+    EXPECT_EQ(SYN | ACK, flow->tcp_flags[1]);
+}
+
+TEST(FlowTableTest, TracksTcpState) {
+    FlowTable table;
+    const Bytes probe = ipv4_frame(1, 2, 40000, 80, ACK);
+    auto state = [&]() { return table.find(decode(probe))->tcp_state; };
+
+    feed(table, ipv4_frame(1, 2, 40000, 80, SYN), SECOND);
+    EXPECT_EQ(FlowTable::TcpState::SynSent, state());
+    feed(table, ipv4_frame(2, 1, 80, 40000, SYN | ACK), SECOND);
+    EXPECT_EQ(FlowTable::TcpState::SynReceived, state());
+    feed(table, ipv4_frame(1, 2, 40000, 80, ACK), SECOND);
+    EXPECT_EQ(FlowTable::TcpState::Established, state());
+    feed(table, ipv4_frame(2, 1, 80, 40000, FIN | ACK), SECOND);
+    EXPECT_EQ(FlowTable::TcpState::Closing, state());
+    feed(table, ipv4_frame(1, 2, 40000, 80, FIN | ACK), SECOND);
+    EXPECT_EQ(FlowTable::TcpState::Closed, state());
+
+    feed(table, ipv4_frame(5, 6, 1, 2, 0, true), SECOND);
+    EXPECT_EQ(FlowTable::TcpState::None, table.find(decode(ipv4_frame(6, 5, 2, 1, 0, true)))->tcp_state);
+}
+
+TEST(FlowTableTest, ExpiresIdleAndClosedFlowsOnTheWheel) {
+    Expired expired;
+    FlowTable::Config config;
+    config.idle_timeout_ns = 60 * SECOND;
+    config.closed_timeout_ns = 5 * SECOND;
+    FlowTable table(config);
+    table.set_expiry_callback(expired.callback());
+
+    feed(table, ipv4_frame(1, 2, 1000, 53, 0, true), 0);
+    feed(table, ipv4_frame(1, 3, 40000, 80, SYN), 0);
+    feed(table, ipv4_frame(1, 3, 40000, 80, RST), 10 * SECOND);
+    feed(table, ipv4_frame(1, 4, 1000, 53, 0, true), 12 * SECOND);
+    EXPECT_EQ(3u, table.size());
+
+    table.advance(14 * SECOND);
+    EXPECT_TRUE(expired.flows.empty());
+    table.advance(15 * SECOND + SECOND / 2);
+    ASSERT_EQ(1u, expired.flows.size());
+    EXPECT_EQ(FlowTable::Expiry::Closed, expired.flows[0].second);
+    EXPECT_EQ(80, expired.flows[0].first.key.port[1]);
+
+    // Packets keep a flow alive without rescheduling it; the first timer
+    // finds it still busy and moves it on.
+    feed(table, ipv4_frame(2, 1, 53, 1000, 0, true), 50 * SECOND);
+    table.advance(61 * SECOND);
+    EXPECT_EQ(1u, expired.flows.size());
+    table.advance(73 * SECOND);
+    ASSERT_EQ(2u, expired.flows.size());
+    EXPECT_EQ(FlowTable::Expiry::Idle, expired.flows[1].second);
+    EXPECT_EQ(4, expired.flows[1].first.key.address[1][3]);
+    table.advance(111 * SECOND);
+    ASSERT_EQ(3u, expired.flows.size());
+    EXPECT_EQ(2u, expired.flows[2].first.packets[0] + expired.flows[2].first.packets[1]);
+    EXPECT_EQ(0u, table.size());
+
+    const FlowTable::Statistics stats = table.get_statistics();
+    EXPECT_EQ(2u, stats.idle_expired);
+    EXPECT_EQ(1u, stats.closed_expired);
+    EXPECT_EQ(0u, stats.active);
+}
+
+TEST(FlowTableTest, ReportsLongFlowsEveryActiveTimeout) {
+    Expired expired;
+    FlowTable::Config config;
+    config.active_timeout_ns = 100 * SECOND;
+    FlowTable table(config);
+    table.set_expiry_callback(expired.callback());
+
+    // Far past the wheel's first level, so the timer has to cascade down.
+    for (uint64_t t = 0; t <= 250; t += 10)
+        feed(table, ipv4_frame(1, 2, 5000, 5001, 0, true), t * SECOND);
+    ASSERT_EQ(2u, expired.flows.size());
+    EXPECT_EQ(FlowTable::Expiry::Active, expired.flows[0].second);
+    EXPECT_EQ(11u, expired.flows[0].first.packets[0]);         // 0 s to 100 s
+    EXPECT_EQ(FlowTable::Expiry::Active, expired.flows[1].second);
+    EXPECT_EQ(10u, expired.flows[1].first.packets[0]);
+    EXPECT_EQ(1u, table.size());
+    EXPECT_EQ(2u, table.get_statistics().active_reports);
+}
+
+TEST(FlowTableTest, EvictsTheOldestFlowWhenFull) {
+    Expired expired;
+    FlowTable::Config config;
+    config.capacity = 16;
+    FlowTable table(config);
+    table.set_expiry_callback(expired.callback());
+
+    for (uint16_t i = 0; i < 14; ++i)
+        feed(table, ipv4_frame(1, 2, static_cast<uint16_t>(1000 + i), 53, 0, true), (i + 1) * SECOND);
+    EXPECT_EQ(14u, table.size());
+    EXPECT_TRUE(expired.flows.empty());
+
+    feed(table, ipv4_frame(1, 2, 999, 53, 0, true), 20 * SECOND);
+    EXPECT_EQ(14u, table.size());
+    ASSERT_EQ(1u, expired.flows.size());
+    EXPECT_EQ(FlowTable::Expiry::Evicted, expired.flows[0].second);
+    EXPECT_NE(nullptr, table.find(decode(ipv4_frame(1, 2, 999, 53, 0, true))));
+    EXPECT_EQ(1u, table.get_statistics().evicted);
+}
+
+TEST(FlowTableTest, MatchesAReferenceMapUnderChurn) {
+    // Removal shifts entries back; every flow must stay reachable.
+    FlowTable::Config config;
+    config.capacity = 1024;
+    config.idle_timeout_ns = 3 * SECOND;
+    FlowTable table(config);
+    std::map<uint16_t, uint64_t> last_seen;
+    table.set_expiry_callback([&](const FlowTable::Flow& flow, FlowTable::Expiry why) {
+        EXPECT_EQ(FlowTable::Expiry::Idle, why);
+        EXPECT_EQ(1u, last_seen.erase(flow.key.port[0] == 53 ? flow.key.port[1] : flow.key.port[0]));
+    });
+
+    std::mt19937 random(7);
+    for (uint64_t step = 0; step < 20000; ++step) {
+        const uint64_t now = step * (SECOND / 100);
+        const uint16_t port = static_cast<uint16_t>(1024 + random() % 800);
+        feed(table, ipv4_frame(1, 2, port, 53, 0, true), now);
+        last_seen[port] = now;
+    }
+    EXPECT_EQ(last_seen.size(), table.size());
+    for (const auto& entry : last_seen) {
+        const FlowTable::Flow* flow = table.find(decode(ipv4_frame(1, 2, entry.first, 53, 0, true)));
+        ASSERT_NE(nullptr, flow);
+        EXPECT_EQ(entry.second, flow->last_seen_ns);
+    }
+}
+
+TEST(FlowTableTest, BatchUpdateMatchesPerPacketUpdate) {
+    std::vector<Bytes> frames;
+    for (uint16_t i = 0; i < 200; ++i) {
+        frames.push_back(ipv4_frame(static_cast<uint16_t>(i % 7), 9, static_cast<uint16_t>(2000 + i % 13), 443, ACK));
+        frames.push_back(ipv4_frame(9, static_cast<uint16_t>(i % 7), 443, static_cast<uint16_t>(2000 + i % 13), ACK,
+                                    false, i));
+    }
+
+    std::vector<TupleExtractor::Frame> views;
+    for (size_t i = 0; i < frames.size(); ++i) {
+        TupleExtractor::Frame view;
+        view.data = frames[i].data();
+        view.caplen = view.len = static_cast<uint32_t>(frames[i].size());
+        view.ts_sec = 1;
+        view.ts_nsec = static_cast<uint32_t>(i);
+        views.push_back(view);
+    }
+
+    FlowTable by_packet;
+    FlowTable by_batch;
+    auto batch = std::make_unique<TupleBatch>();
+    for (size_t done = 0; done < views.size();) {
+        batch->clear();
+        done += TupleExtractor::extract(views.data() + done, views.size() - done, *batch);
+        by_batch.update(*batch);
+    }
+    for (size_t i = 0; i < frames.size(); ++i)
+        feed(by_packet, frames[i], SECOND + i);
+
+    ASSERT_EQ(by_packet.size(), by_batch.size());
+    for (const Bytes& frame : frames) {
+        const FlowTable::Flow* expected = by_packet.find(decode(frame));
+        const FlowTable::Flow* actual = by_batch.find(decode(frame));
+        ASSERT_NE(nullptr, actual);
+        EXPECT_EQ(expected->packets[0], actual->packets[0]);
+        EXPECT_EQ(expected->bytes[1], actual->bytes[1]);
+        EXPECT_EQ(expected->last_seen_ns, actual->last_seen_ns);
+    }
+}
@@ -0,0 +1,82 @@
+#include <gtest/gtest.h>
+#include "netlyzer/utils/format.h"
+#include <arpa/inet.h>
+#include <string>
+#include <vector>
+
+using namespace netlyzer;
+
+namespace {
+
+std::string ipv6(const char* text)
+{
+    uint8_t address[16];
+    EXPECT_EQ(inet_pton(AF_INET6, text, address), 1) << text;
+    return ipv6_to_string(address);
+}
+
+} // namespace
+
+TEST(FormatTest, Hex) {
+    std::vector<uint8_t> bytes(40);
+    for (size_t i = 0; i < bytes.size(); ++i)
+        bytes[i] = static_cast<uint8_t>(i * 37);
+
+    // Long enough to take the 16-byte path and the scalar tail.
+    std::string expected;
+    static const char digits[] = "0123456789abcdef";
+    for (uint8_t b : bytes) {
+        expected += digits[b >> 4];
+        expected += digits[b & 0x0f];
+    }
+    std::vector<char> out(bytes.size() * 2);
+    ASSERT_EQ(format_hex(bytes.data(), bytes.size(), out.data()), out.size());
+    EXPECT_EQ(std::string(out.begin(), out.end()), expected);
+
+    format_hex(bytes.data(), bytes.size(), out.data(), true);
+    for (char& c : expected)
+        c = static_cast<char>(toupper(c));
+    EXPECT_EQ(std::string(out.begin(), out.end()), expected);
+
+    const uint8_t dead[] = {0xde, 0xad, 0xbe, 0xef};
+    char text[16];
+    EXPECT_EQ(std::string(text, format_hex_separated(dead, 4, '-', text)), "de-ad-be-ef");
+}
+
+TEST(FormatTest, Addresses) {
+    const uint8_t mac[] = {0x00, 0x1b, 0x21, 0xaa, 0xff, 0x09};
+    EXPECT_EQ(mac_to_string(mac), "00:1b:21:aa:ff:09");
+
+    EXPECT_EQ(ipv4_to_string(0), "0.0.0.0");
+    EXPECT_EQ(ipv4_to_string(0xc0a80001u), "192.168.0.1");
+    EXPECT_EQ(ipv4_to_string(0xffffffffu), "255.255.255.255");
+    EXPECT_EQ(ipv4_to_string(0x0a630a09u), "10.99.10.9");
+}
+
+TEST(FormatTest, IPv6FollowsRfc5952) {
+    EXPECT_EQ(ipv6("::"), "::");
+    EXPECT_EQ(ipv6("::1"), "::1");
+    EXPECT_EQ(ipv6("2001:0db8:0000:0000:0000:0000:0000:0001"), "2001:db8::1");
+    // A single zero group is not compressed.
+    EXPECT_EQ(ipv6("2001:db8:0:1:1:1:1:1"), "2001:db8:0:1:1:1:1:1");
+    // The longest run wins; the first on a tie.
+    EXPECT_EQ(ipv6("2001:0:0:1:0:0:0:1"), "2001:0:0:1::1");
+    EXPECT_EQ(ipv6("2001:db8:0:0:1:0:0:1"), "2001:db8::1:0:0:1");
+    EXPECT_EQ(ipv6("fe80::ABCD:EF01"), "fe80::abcd:ef01");
+    EXPECT_EQ(ipv6("1:2:3:4:5:6:7:0"), "1:2:3:4:5:6:7:0");
+    EXPECT_EQ(ipv6("1:0:0:0:0:0:0:0"), "1::");
+    EXPECT_EQ(ipv6("::ffff:192.0.2.1"), "::ffff:192.0.2.1");
+    EXPECT_EQ(ipv6("ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff"), "ffff:ffff:ffff:ffff:ffff:ffff:ffff:ffff");
+}
+
+TEST(FormatTest, HexDumpLine) {
+    const uint8_t full[] = {0x45, 0x00, 0x00, 0x3c, 0x1c, 0x46, 0x40, 0x00,
+                            0x40, 0x06, 0xb1, 0xe6, 0xac, 0x10, 0x0a, 0x63};
+    char line[HEX_DUMP_LINE_MAX];
+    EXPECT_EQ(std::string(line, format_hex_dump_line(full, sizeof(full), 0x10, line)),
+              "0010  45 00 00 3C 1C 46 40 00  40 06 B1 E6 AC 10 0A 63  |E..<.F@.@......c|\n");
+
+    const std::string short_line(line, format_hex_dump_line(full, 3, 0x12340, line, false));
+    EXPECT_EQ(short_line,
+              "12340  45 00 00                                          |E..             |\n");
+}
@@ -0,0 +1,199 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/fragment_reassembler.h"
+#include "netlyzer/network/checksum.h"
+#include <algorithm>
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+constexpr uint64_t SECOND = 1000000000ull;
+
+// UDP datagram with `payload` bytes after the 8-byte header.
+Bytes udp_datagram(size_t payload)
+{
+    const size_t length = 8 + payload;
+    Bytes datagram = {0x13, 0x88, 0x00, 0x35, static_cast<uint8_t>(length >> 8), static_cast<uint8_t>(length), 0, 0};
+    for (size_t i = 0; i < payload; ++i)
+        datagram.push_back(static_cast<uint8_t>(i * 7 + 1));
+    return datagram;
+}
+
+Bytes ipv4_fragment(const Bytes& datagram, size_t offset, size_t length, uint16_t id = 0x4242)
+{
+    const size_t total = 20 + length;
+    const bool more = offset + length < datagram.size();
+    const uint16_t field = static_cast<uint16_t>((more ? 0x2000 : 0) | (offset / 8));
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                   0x45, 0, static_cast<uint8_t>(total >> 8), static_cast<uint8_t>(total),
+                   static_cast<uint8_t>(id >> 8), static_cast<uint8_t>(id),
+                   static_cast<uint8_t>(field >> 8), static_cast<uint8_t>(field),
+                   64, 17, 0, 0, 10, 0, 0, 1, 10, 0, 0, 2};
+    frame.insert(frame.end(), datagram.begin() + offset, datagram.begin() + offset + length);
+    return frame;
+}
+
+Bytes ipv6_fragment(const Bytes& datagram, size_t offset, size_t length, uint32_t id = 7)
+{
+    const size_t payload = 8 + 8 + length;      // destination options + fragment header
+    const bool more = offset + length < datagram.size();
+    const uint16_t field = static_cast<uint16_t>(offset | (more ? 1 : 0));
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x86, 0xdd,
+                   0x60, 0, 0, 0, static_cast<uint8_t>(payload >> 8), static_cast<uint8_t>(payload), 60, 64};
+    frame.resize(frame.size() + 32, 0);
+    frame[22 + 15] = 1;
+    frame[38 + 15] = 2;
+    frame.insert(frame.end(), {44, 0, 1, 4, 0, 0, 0, 0});
+    frame.insert(frame.end(), {17, 0, static_cast<uint8_t>(field >> 8), static_cast<uint8_t>(field),
+                               static_cast<uint8_t>(id >> 24), static_cast<uint8_t>(id >> 16),
+                               static_cast<uint8_t>(id >> 8), static_cast<uint8_t>(id)});
+    frame.insert(frame.end(), datagram.begin() + offset, datagram.begin() + offset + length);
+    return frame;
+}
+
+PacketBuffer feed(FragmentReassembler& reassembler, const Bytes& frame, uint64_t timestamp_ns = SECOND)
+{
+    DecodedPacket packet;
+    PacketDecoder::decode(frame.data(), static_cast<uint32_t>(frame.size()), static_cast<uint32_t>(frame.size()), packet);
+    EXPECT_TRUE(packet.has(DecodedPacket::FRAGMENT));
+    return reassembler.add(frame.data(), static_cast<uint32_t>(frame.size()), packet, timestamp_ns);
+}
+
+DecodedPacket decode(const PacketBuffer& frame)
+{
+    DecodedPacket packet;
+    PacketDecoder::decode(frame.data(), frame.size(), frame.size(), packet);
+    return packet;
+}
+
+void expect_datagram(const PacketBuffer& frame, size_t ip_headers, const Bytes& datagram)
+{
+    ASSERT_TRUE(frame);
+    ASSERT_EQ(14 + ip_headers + datagram.size(), frame.size());
+    EXPECT_TRUE(std::equal(datagram.begin(), datagram.end(), frame.data() + 14 + ip_headers));
+}
+
+} // namespace
+
+TEST(FragmentReassemblerTest, ReassemblesInOrderIpv4) {
+    FragmentReassembler reassembler;
+    const Bytes datagram = udp_datagram(4000);
+    PacketBuffer frame;
+    for (size_t offset = 0; offset < datagram.size(); offset += 1480) {
+        EXPECT_FALSE(frame);
+        frame = feed(reassembler, ipv4_fragment(datagram, offset, std::min<size_t>(1480, datagram.size() - offset)));
+    }
+    expect_datagram(frame, 20, datagram);
+
+    const DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::UDP));
+    EXPECT_FALSE(packet.has(DecodedPacket::FRAGMENT));
+    EXPECT_EQ(5000, packet.source_port);
+    EXPECT_EQ(53, packet.dest_port);
+    EXPECT_EQ(4000, packet.payload_length);
+
+    // The patched header has a valid checksum.
+    EXPECT_EQ(0xffff, ChecksumVerifier::fold(ChecksumVerifier::add(frame.data() + 14, 20)));
+
+    const FragmentReassembler::Statistics stats = reassembler.get_statistics();
+    EXPECT_EQ(3u, stats.fragments);
+    EXPECT_EQ(1u, stats.reassembled);
+    EXPECT_EQ(0u, stats.pending);
+    EXPECT_EQ(0u, stats.pending_bytes);
+}
+
+TEST(FragmentReassemblerTest, ReassemblesOutOfOrderAndGrows) {
+    FragmentReassembler reassembler;
+    const Bytes datagram = udp_datagram(20000);
+    std::vector<Bytes> fragments;
+    for (size_t offset = 0; offset < datagram.size(); offset += 1480)
+        fragments.push_back(ipv4_fragment(datagram, offset, std::min<size_t>(1480, datagram.size() - offset)));
+    std::reverse(fragments.begin() + 1, fragments.end());
+    std::swap(fragments.front(), fragments[fragments.size() / 2]);
+
+    PacketBuffer frame;
+    for (const Bytes& fragment : fragments) {
+        EXPECT_FALSE(frame);
+        frame = feed(reassembler, fragment);
+    }
+    expect_datagram(frame, 20, datagram);
+    EXPECT_EQ(5000, decode(frame).source_port);
+}
+
+TEST(FragmentReassemblerTest, FirstDataWinsOnIpv4Overlap) {
+    FragmentReassembler reassembler;
+    const Bytes datagram = udp_datagram(2992);
+    Bytes forged = datagram;
+    std::fill(forged.begin() + 1000, forged.end(), 0xee);
+
+    EXPECT_FALSE(feed(reassembler, ipv4_fragment(datagram, 0, 1480)));
+    EXPECT_FALSE(feed(reassembler, ipv4_fragment(forged, 1000, 1480)));
+    PacketBuffer frame = feed(reassembler, ipv4_fragment(datagram, 1480, datagram.size() - 1480));
+    ASSERT_TRUE(frame);
+    EXPECT_TRUE(std::equal(datagram.begin(), datagram.begin() + 1480, frame.data() + 34));
+    EXPECT_TRUE(std::equal(forged.begin() + 1480, forged.begin() + 2480, frame.data() + 34 + 1480));
+    EXPECT_EQ(2u, reassembler.get_statistics().overlaps);
+}
+
+TEST(FragmentReassemblerTest, ReassemblesIpv6AndDropsOverlaps) {
+    FragmentReassembler reassembler;
+    const Bytes datagram = udp_datagram(2500);
+    EXPECT_FALSE(feed(reassembler, ipv6_fragment(datagram, 1232, datagram.size() - 1232)));
+    PacketBuffer frame = feed(reassembler, ipv6_fragment(datagram, 0, 1232));
+    expect_datagram(frame, 40 + 8, datagram);
+
+    const DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::IPV6));
+    EXPECT_TRUE(packet.has(DecodedPacket::UDP));
+    EXPECT_FALSE(packet.has(DecodedPacket::FRAGMENT));
+    EXPECT_EQ(2500, packet.payload_length);
+
+    // RFC 5722: overlapping IPv6 fragments discard the datagram.
+    EXPECT_FALSE(feed(reassembler, ipv6_fragment(datagram, 0, 1232, 8)));
+    EXPECT_FALSE(feed(reassembler, ipv6_fragment(datagram, 1224, 8, 8)));
+    EXPECT_FALSE(feed(reassembler, ipv6_fragment(datagram, 1232, datagram.size() - 1232, 8)));
+    const FragmentReassembler::Statistics stats = reassembler.get_statistics();
+    EXPECT_EQ(1u, stats.overlaps);
+    EXPECT_EQ(1u, stats.reassembled);
+}
+
+TEST(FragmentReassemblerTest, EvictsOldestToStayUnderMemoryCap) {
+    FragmentReassembler::Config config;
+    config.max_bytes = 40 * 1024;      // ten 4 KiB buffers
+    FragmentReassembler reassembler(config);
+
+    const Bytes datagram = udp_datagram(4000);
+    for (uint16_t id = 0; id < 16; ++id)
+        feed(reassembler, ipv4_fragment(datagram, 0, 1480, id));
+    FragmentReassembler::Statistics stats = reassembler.get_statistics();
+    EXPECT_LE(stats.pending_bytes, config.max_bytes);
+    EXPECT_GT(stats.evictions, 0u);
+    EXPECT_EQ(16u, stats.pending + stats.evictions);
+
+    // The newest datagram is still there and completes.
+    feed(reassembler, ipv4_fragment(datagram, 1480, 1480, 15));
+    expect_datagram(feed(reassembler, ipv4_fragment(datagram, 2960, datagram.size() - 2960, 15)), 20, datagram);
+}
+
+TEST(FragmentReassemblerTest, ExpiresIncompleteDatagrams) {
+    FragmentReassembler::Config config;
+    config.timeout_ns = 5 * SECOND;
+    FragmentReassembler reassembler(config);
+
+    const Bytes datagram = udp_datagram(4000);
+    feed(reassembler, ipv4_fragment(datagram, 0, 1480, 1), SECOND);
+    feed(reassembler, ipv4_fragment(datagram, 0, 1480, 2), 3 * SECOND);
+    reassembler.expire(7 * SECOND);
+    FragmentReassembler::Statistics stats = reassembler.get_statistics();
+    EXPECT_EQ(1u, stats.timeouts);
+    EXPECT_EQ(1u, stats.pending);
+
+    // Late fragments of the expired datagram start over.
+    EXPECT_FALSE(feed(reassembler, ipv4_fragment(datagram, 1480, 1480, 1), 7 * SECOND));
+    EXPECT_FALSE(feed(reassembler, ipv4_fragment(datagram, 2960, datagram.size() - 2960, 1), 7 * SECOND));
+    reassembler.expire(20 * SECOND);
+    stats = reassembler.get_statistics();
+    EXPECT_EQ(0u, stats.pending);
+    EXPECT_EQ(0u, stats.pending_bytes);
+}
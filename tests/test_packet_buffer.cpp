@@ -0,0 +1,88 @@
+#include <gtest/gtest.h>
+#include "netlyzer/core/packet_buffer.h"
+#include <thread>
+#include <vector>
+
+TEST(PacketBufferTest, CopiesShareOneBuffer) {
+    PacketBufferPool pool;
+    const uint8_t bytes[] = {1, 2, 3, 4, 5};
+
+    PacketBuffer a = pool.copy(bytes, sizeof(bytes));
+    ASSERT_TRUE(a);
+    EXPECT_EQ(a.size(), sizeof(bytes));
+    EXPECT_GE(a.capacity(), a.size());
+    EXPECT_EQ(a.use_count(), 1u);
+
+    PacketBuffer b = a;
+    EXPECT_EQ(b.data(), a.data());
+    EXPECT_EQ(a.use_count(), 2u);
+
+    PacketBuffer c = std::move(b);
+    EXPECT_FALSE(b);
+    EXPECT_EQ(a.use_count(), 2u);
+    EXPECT_EQ(c.data()[4], 5);
+
+    c = PacketBuffer();
+    EXPECT_EQ(a.use_count(), 1u);
+    EXPECT_EQ(pool.get_statistics().live_buffers, 1u);
+
+    a = PacketBuffer();
+    EXPECT_EQ(pool.get_statistics().live_buffers, 0u);
+    EXPECT_EQ(pool.get_statistics().live_bytes, 0u);
+}
+
+TEST(PacketBufferTest, SteadyStateDoesNotGrow) {
+    PacketBufferPool pool;
+    std::vector<uint8_t> frame(1500, 0xab);
+
+    {
+        std::vector<PacketBuffer> held;
+        for (int i = 0; i < 1000; ++i)
+            held.push_back(pool.copy(frame.data(), static_cast<uint32_t>(frame.size())));
+    }
+    const auto warm = pool.get_statistics();
+    EXPECT_GT(warm.pool_misses, 0u);
+
+    // The same working set again is served entirely from the free list.
+    {
+        std::vector<PacketBuffer> held;
+        for (int i = 0; i < 1000; ++i)
+            held.push_back(pool.copy(frame.data(), static_cast<uint32_t>(frame.size())));
+    }
+    const auto stats = pool.get_statistics();
+    EXPECT_EQ(stats.pool_misses, warm.pool_misses);
+    EXPECT_EQ(stats.reserved_bytes, warm.reserved_bytes);
+    EXPECT_EQ(stats.allocations, 2000u);
+}
+
+TEST(PacketBufferTest, OversizeAndLimit) {
+    PacketBufferPool pool(2u << 20);
+
+    PacketBuffer big = pool.allocate(1u << 20);
+    ASSERT_TRUE(big);
+    EXPECT_EQ(pool.get_statistics().oversize, 1u);
+    big = PacketBuffer();
+
+    // Two 1 MiB slabs fit the limit, a third does not.
+    std::vector<PacketBuffer> held;
+    for (int i = 0; i < 4096; ++i) {
+        PacketBuffer buffer = pool.allocate(1024);
+        if (!buffer)
+            break;
+        held.push_back(std::move(buffer));
+    }
+    EXPECT_LE(pool.get_statistics().reserved_bytes, 2u << 20);
+    EXPECT_EQ(pool.get_statistics().failures, 1u);
+}
+
+TEST(PacketBufferTest, ReleaseFromAnotherThread) {
+    PacketBufferPool pool;
+    const uint8_t bytes[64] = {};
+    std::vector<PacketBuffer> buffers;
+    for (int i = 0; i < 10000; ++i)
+        buffers.push_back(pool.copy(bytes, sizeof(bytes)));
+
+    std::thread consumer([moved = std::move(buffers)]() mutable { moved.clear(); });
+    consumer.join();
+    EXPECT_EQ(pool.get_statistics().live_buffers, 0u);
+}
@@ -0,0 +1,235 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/packet_decoder.h"
+#include <string>
+#include <vector>
+
+namespace {
+
+std::vector<uint8_t> ethernet(uint16_t ethertype)
+{
+    return {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55,
+        0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0x0f,
+        static_cast<uint8_t>(ethertype >> 8), static_cast<uint8_t>(ethertype)
+    };
+}
+
+void append(std::vector<uint8_t>& frame, std::initializer_list<uint8_t> bytes)
+{
+    frame.insert(frame.end(), bytes);
+}
+
+DecodedPacket decode(const std::vector<uint8_t>& frame)
+{
+    DecodedPacket packet;
+    PacketDecoder::decode(frame.data(), static_cast<uint32_t>(frame.size()),
+                          static_cast<uint32_t>(frame.size()), packet);
+    return packet;
+}
+
+// IPv4 header with the given protocol and payload length, no options.
+void append_ipv4(std::vector<uint8_t>& frame, uint8_t protocol, uint16_t payload, uint8_t last_octet)
+{
+    const uint16_t total = static_cast<uint16_t>(20 + payload);
+    append(frame, {0x45, 0x00, static_cast<uint8_t>(total >> 8), static_cast<uint8_t>(total),
+                   0, 0, 0x40, 0, 64, protocol, 0, 0,
+                   10, 0, 0, last_octet, 10, 0, 0, 100});
+}
+
+void append_tcp(std::vector<uint8_t>& frame, uint16_t source_port)
+{
+    append(frame, {static_cast<uint8_t>(source_port >> 8), static_cast<uint8_t>(source_port), 0x01, 0xbb,
+                   0, 0, 0, 1, 0, 0, 0, 0, 0x50, 0x02, 0xff, 0xff, 0, 0, 0, 0});
+}
+
+std::string source(const DecodedPacket& packet)
+{
+    char text[PacketDecoder::ADDRESS_STRING_MAX];
+    return std::string(text, PacketDecoder::format_source(packet, text));
+}
+
+} // namespace
+
+TEST(PacketDecoderTest, VlanTaggedIPv4Tcp) {
+    std::vector<uint8_t> frame = ethernet(0x8100);
+    append(frame, {0x20, 0x64, 0x08, 0x00});                     // VLAN 100
+    append(frame, {0x45, 0x00, 0x00, 0x2c, 0x00, 0x01, 0x40, 0x00, 0x40, 0x06, 0x00, 0x00,
+                   192, 168, 1, 10, 10, 0, 0, 1});
+    append(frame, {0x30, 0x39, 0x00, 0x50, 0, 0, 0, 7, 0, 0, 0, 9,
+                   0x50, 0x18, 0x10, 0x00, 0, 0, 0, 0});
+    append(frame, {'a', 'b', 'c', 'd'});
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::VLAN));
+    EXPECT_TRUE(packet.has(DecodedPacket::IPV4));
+    EXPECT_TRUE(packet.has(DecodedPacket::TCP));
+    EXPECT_FALSE(packet.has(DecodedPacket::TRUNCATED));
+    EXPECT_EQ(packet.vlan_id, 100);
+    EXPECT_EQ(packet.ethertype, 0x0800);
+    EXPECT_EQ(packet.network_offset, 18);
+    EXPECT_EQ(packet.transport_offset, 38);
+    EXPECT_EQ(packet.payload_offset, 58);
+    EXPECT_EQ(packet.payload_length, 4);
+    EXPECT_EQ(packet.ipv4_source(), 0xc0a8010au);
+    EXPECT_EQ(packet.source_port, 12345);
+    EXPECT_EQ(packet.dest_port, 80);
+    EXPECT_EQ(packet.tcp_sequence, 7u);
+    EXPECT_EQ(packet.tcp_flags, 0x18);
+    EXPECT_STREQ(PacketDecoder::protocol_name(packet), "TCP");
+    EXPECT_EQ(source(packet), "192.168.1.10");
+}
+
+TEST(PacketDecoderTest, IPv6Udp) {
+    std::vector<uint8_t> frame = ethernet(0x86dd);
+    append(frame, {0x60, 0, 0, 0, 0x00, 0x0c, 17, 64});
+    append(frame, {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 1});
+    append(frame, {0x20, 0x01, 0x0d, 0xb8, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 2});
+    append(frame, {0x00, 0x35, 0xd4, 0x31, 0x00, 0x0c, 0, 0, 1, 2, 3, 4});
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::IPV6));
+    EXPECT_TRUE(packet.has(DecodedPacket::UDP));
+    EXPECT_EQ(packet.ttl, 64);
+    EXPECT_EQ(packet.source_port, 53);
+    EXPECT_EQ(packet.payload_offset, 62);
+    EXPECT_EQ(packet.payload_length, 4);
+    EXPECT_EQ(source(packet), "2001:db8::1");
+}
+
+TEST(PacketDecoderTest, ArpRequest) {
+    std::vector<uint8_t> frame = ethernet(0x0806);
+    append(frame, {0, 1, 0x08, 0x00, 6, 4, 0, 1,
+                   0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0x0f, 10, 0, 0, 1,
+                   0, 0, 0, 0, 0, 0, 10, 0, 0, 2});
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::ARP));
+    EXPECT_EQ(packet.arp_operation, 1);
+    EXPECT_EQ(packet.ipv4_dest(), 0x0a000002u);
+    EXPECT_STREQ(PacketDecoder::protocol_name(packet), "ARP");
+}
+
+TEST(PacketDecoderTest, TruncatedAndFragmentedFrames) {
+    std::vector<uint8_t> frame = ethernet(0x0800);
+    append(frame, {0x45, 0x00, 0x00, 0x40, 0x00, 0x01, 0x20, 0x00, 0x40, 0x06, 0x00, 0x00,
+                   1, 2, 3, 4, 5, 6, 7, 8});
+    append(frame, {0x30, 0x39});                                  // TCP cut short
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::IPV4));
+    EXPECT_TRUE(packet.has(DecodedPacket::FRAGMENT));
+    EXPECT_TRUE(packet.has(DecodedPacket::TRUNCATED));
+    EXPECT_FALSE(packet.has(DecodedPacket::TCP));
+    EXPECT_EQ(packet.transport_offset, 34);
+
+    frame[14] = 0x43;                                             // header length 12
+    packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::MALFORMED));
+    EXPECT_FALSE(packet.has(DecodedPacket::IPV4));
+
+    packet = decode(std::vector<uint8_t>(frame.begin(), frame.begin() + 10));
+    EXPECT_TRUE(packet.has(DecodedPacket::TRUNCATED));
+    EXPECT_STREQ(PacketDecoder::protocol_name(packet), "Ethernet");
+    EXPECT_EQ(source(packet), "");
+}
+
+TEST(PacketDecoderTest, QinQ) {
+    std::vector<uint8_t> frame = ethernet(0x88a8);
+    append(frame, {0x00, 0x0a, 0x81, 0x00});                     // service tag 10
+    append(frame, {0x00, 0x14, 0x08, 0x00});                     // customer tag 20
+    append_ipv4(frame, 6, 20, 1);
+    append_tcp(frame, 1000);
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::TCP));
+    EXPECT_EQ(packet.vlan_id, 10);
+    EXPECT_EQ(packet.vlan_count, 2);
+    EXPECT_EQ(packet.network_offset, 22);
+    EXPECT_EQ(packet.source_port, 1000);
+}
+
+TEST(PacketDecoderTest, IPv6ExtensionHeaders) {
+    std::vector<uint8_t> frame = ethernet(0x86dd);
+    append(frame, {0x60, 0, 0, 0, 0x00, 0x28, 0, 64});           // next: hop-by-hop
+    frame.resize(frame.size() + 32, 0);
+    frame[14 + 8 + 15] = 1;
+    frame[14 + 24 + 15] = 2;
+    append(frame, {60, 0, 1, 4, 0, 0, 0, 0});                    // hop-by-hop, next: dest options
+    append(frame, {44, 0, 1, 4, 0, 0, 0, 0});                    // dest options, next: fragment
+    append(frame, {6, 0, 0x00, 0x01, 0, 0, 0, 1});               // first fragment, more follow
+    append_tcp(frame, 2000);
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::IPV6));
+    EXPECT_TRUE(packet.has(DecodedPacket::FRAGMENT));
+    EXPECT_TRUE(packet.has(DecodedPacket::TCP));
+    EXPECT_EQ(packet.ip_protocol, 6);
+    EXPECT_EQ(packet.transport_offset, 14 + 40 + 24);
+    EXPECT_EQ(packet.source_port, 2000);
+    EXPECT_EQ(source(packet), "::1");
+}
+
+TEST(PacketDecoderTest, GreDecapsulation) {
+    std::vector<uint8_t> frame = ethernet(0x0800);
+    append_ipv4(frame, 47, 8 + 40, 1);
+    append(frame, {0x20, 0x00, 0x08, 0x00, 0, 0, 0x30, 0x39});   // key 12345, carrying IPv4
+    append_ipv4(frame, 6, 20, 2);
+    append_tcp(frame, 3000);
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::GRE));
+    EXPECT_TRUE(packet.has(DecodedPacket::TCP));
+    EXPECT_EQ(packet.tunnel_depth, 1);
+    EXPECT_EQ(packet.tunnel_id, 12345u);
+    EXPECT_EQ(packet.outer_network_offset, 14);
+    EXPECT_EQ(packet.network_offset, 14 + 20 + 8);
+    EXPECT_EQ(packet.ipv4_source(), 0x0a000002u);
+    EXPECT_EQ(packet.source_port, 3000);
+}
+
+TEST(PacketDecoderTest, GreWithUnknownProtocolKeepsTheOuterDecode) {
+    std::vector<uint8_t> frame = ethernet(0x0800);
+    append_ipv4(frame, 47, 4 + 12, 1);
+    append(frame, {0x00, 0x00, 0x88, 0xbe});                     // ERSPAN type II
+    frame.resize(frame.size() + 12, 0xee);
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_FALSE(packet.has(DecodedPacket::GRE));
+    EXPECT_TRUE(packet.has(DecodedPacket::IPV4));
+    EXPECT_EQ(packet.tunnel_depth, 0);
+    EXPECT_EQ(packet.ip_protocol, 47);
+    EXPECT_EQ(packet.network_offset, 14);
+    EXPECT_EQ(packet.ipv4_source(), 0x0a000001u);
+    EXPECT_EQ(packet.payload_offset, 14 + 20 + 4);
+    EXPECT_EQ(packet.payload_length, 12);
+}
+
+TEST(PacketDecoderTest, VxlanDecapsulation) {
+    std::vector<uint8_t> frame = ethernet(0x0800);
+    append_ipv4(frame, 17, 8 + 8 + 14 + 40, 1);
+    append(frame, {0xc0, 0x00, 0x12, 0xb5, 0x00, 0x5e, 0, 0});  // to port 4789
+    append(frame, {0x08, 0, 0, 0, 0x00, 0x01, 0x00, 0});          // VNI 256
+    const std::vector<uint8_t> inner = ethernet(0x0800);
+    frame.insert(frame.end(), inner.begin(), inner.end());
+    append_ipv4(frame, 6, 20, 3);
+    append_tcp(frame, 4000);
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::VXLAN));
+    EXPECT_TRUE(packet.has(DecodedPacket::TCP));
+    EXPECT_FALSE(packet.has(DecodedPacket::UDP));
+    EXPECT_EQ(packet.tunnel_id, 256u);
+    EXPECT_EQ(packet.ipv4_source(), 0x0a000003u);
+    EXPECT_EQ(packet.source_port, 4000);
+    EXPECT_EQ(packet.payload_offset, frame.size());
+}
+
+TEST(PacketDecoderTest, EndlessTagChainIsMalformed) {
+    std::vector<uint8_t> frame = ethernet(0x8100);
+    for (int i = 0; i < 32; ++i)
+        append(frame, {0x00, 0x01, 0x81, 0x00});
+
+    DecodedPacket packet = decode(frame);
+    EXPECT_TRUE(packet.has(DecodedPacket::MALFORMED));
+    EXPECT_FALSE(packet.is_ip());
+}
@@ -0,0 +1,131 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/packet_parser.h"
+#include <vector>
+
+namespace {
+
+// Ethernet + IPv4 (no options) + TCP with 4 bytes of options.
+std::vector<uint8_t> tcp_frame()
+{
+    return {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55,     // dest MAC
+        0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0x0f,     // source MAC
+        0x08, 0x00,                             // IPv4
+        0x45, 0x10, 0x00, 0x2c, 0x12, 0x34, 0x40, 0x00,
+        0x40, 0x06, 0xbe, 0xef,
+        192, 168, 1, 10,
+        10, 0, 0, 255,
+        0x30, 0x39, 0x01, 0xbb,                 // 12345 -> 443
+        0x00, 0x00, 0x00, 0x01,
+        0x00, 0x00, 0x00, 0x02,
+        0x60, 0x12, 0xff, 0xff,                 // 24-byte header, SYN+ACK
+        0xab, 0xcd, 0x00, 0x00,
+        0x02, 0x04, 0x05, 0xb4                  // MSS option
+    };
+}
+
+} // namespace
+
+TEST(PacketParserTest, ViewsDecodeHeaders) {
+    const std::vector<uint8_t> frame = tcp_frame();
+
+    PacketParser::EthernetView ethernet;
+    ASSERT_TRUE(PacketParser::view_ethernet(frame.data(), frame.size(), ethernet));
+    EXPECT_EQ(ethernet.ethertype, 0x0800);
+    EXPECT_EQ(ethernet.payload_offset, 14);
+    EXPECT_EQ(PacketParser::mac_to_string(ethernet.source), "aa:bb:cc:dd:ee:0f");
+    EXPECT_EQ(PacketParser::mac_to_string(ethernet.dest), "00:11:22:33:44:55");
+
+    PacketParser::IPv4View ip;
+    ASSERT_TRUE(PacketParser::view_ipv4(frame.data(), frame.size(), ethernet.payload_offset, ip));
+    EXPECT_EQ(ip.version, 4);
+    EXPECT_EQ(ip.header_length, 20);
+    EXPECT_EQ(ip.total_length, 44);
+    EXPECT_EQ(ip.flags, 2);
+    EXPECT_EQ(ip.fragment_offset, 0);
+    EXPECT_EQ(ip.protocol, IPPROTO_TCP);
+    EXPECT_EQ(ip.source, 0xc0a8010au);
+    EXPECT_EQ(ip.payload_offset, 34);
+    EXPECT_EQ(PacketParser::ipv4_to_string(ip.dest), "10.0.0.255");
+
+    PacketParser::TCPView tcp;
+    ASSERT_TRUE(PacketParser::view_tcp(frame.data(), frame.size(), ip.payload_offset, tcp));
+    EXPECT_EQ(tcp.source_port, 12345);
+    EXPECT_EQ(tcp.dest_port, 443);
+    EXPECT_EQ(tcp.sequence_number, 1u);
+    EXPECT_EQ(tcp.acknowledgment_number, 2u);
+    EXPECT_EQ(tcp.header_length, 24);
+    EXPECT_EQ(tcp.flags, 0x12);
+    EXPECT_EQ(tcp.payload_offset, frame.size());
+}
+
+TEST(PacketParserTest, ViewsRejectTruncatedHeaders) {
+    const std::vector<uint8_t> frame = tcp_frame();
+    PacketParser::EthernetView ethernet;
+    PacketParser::IPv4View ip;
+    PacketParser::TCPView tcp;
+    PacketParser::UDPView udp;
+
+    EXPECT_FALSE(PacketParser::view_ethernet(frame.data(), 13, ethernet));
+    EXPECT_FALSE(PacketParser::view_ipv4(frame.data(), 33, 14, ip));
+    // TCP options run past the captured length.
+    EXPECT_FALSE(PacketParser::view_tcp(frame.data(), frame.size() - 1, 34, tcp));
+    EXPECT_FALSE(PacketParser::view_udp(frame.data(), 41, 34, udp));
+
+    std::vector<uint8_t> bad_ihl = frame;
+    bad_ihl[14] = 0x44;
+    EXPECT_FALSE(PacketParser::view_ipv4(bad_ihl.data(), bad_ihl.size(), 14, ip));
+}
+
+TEST(PacketParserTest, FormatsAddressesWithoutAllocating) {
+    char text[PacketParser::IPV4_STRING_MAX];
+    EXPECT_EQ(std::string(text, PacketParser::format_ipv4(0, text)), "0.0.0.0");
+    EXPECT_EQ(std::string(text, PacketParser::format_ipv4(0xffffffffu, text)), "255.255.255.255");
+    EXPECT_EQ(std::string(text, PacketParser::format_ipv4(0x0a630009u, text)), "10.99.0.9");
+}
+
+TEST(PacketParserTest, LegacyApiMatchesViews) {
+    const std::vector<uint8_t> frame = tcp_frame();
+
+    PacketParser::EthernetHeader ethernet = PacketParser::parse_ethernet(frame.data());
+    EXPECT_EQ(ethernet.source_mac, "aa:bb:cc:dd:ee:0f");
+    EXPECT_EQ(ethernet.ethertype, 0x0800);
+
+    PacketParser::IPHeader ip = PacketParser::parse_ip(frame.data() + 14);
+    EXPECT_EQ(ip.source_ip, "192.168.1.10");
+    EXPECT_EQ(ip.dest_ip, "10.0.0.255");
+    EXPECT_EQ(ip.ttl, 64);
+    EXPECT_EQ(ip.checksum, 0xbeef);
+
+    PacketParser::TCPHeader tcp = PacketParser::parse_tcp(frame.data() + 34);
+    EXPECT_EQ(tcp.dest_port, 443);
+    EXPECT_EQ(tcp.window_size, 0xffff);
+    EXPECT_EQ(tcp.checksum, 0xabcd);
+    EXPECT_FALSE(ip.malformed);
+    EXPECT_FALSE(tcp.malformed);
+
+    EXPECT_EQ(PacketParser::protocol_to_string(IPPROTO_UDP), "UDP");
+}
+
+TEST(PacketParserTest, LegacyApiKeepsFieldsOfShortHeaders) {
+    std::vector<uint8_t> frame = tcp_frame();
+    frame[14] = 0x44;                           // IHL 4
+    frame[46] = 0x40;                           // data offset 4
+
+    PacketParser::IPHeader ip = PacketParser::parse_ip(frame.data() + 14);
+    EXPECT_TRUE(ip.malformed);
+    EXPECT_EQ(ip.header_length, 16);
+    EXPECT_EQ(ip.source_ip, "192.168.1.10");
+    EXPECT_EQ(ip.protocol, IPPROTO_TCP);
+    EXPECT_EQ(ip.total_length, 0x2c);
+
+    PacketParser::TCPHeader tcp = PacketParser::parse_tcp(frame.data() + 34);
+    EXPECT_TRUE(tcp.malformed);
+    EXPECT_EQ(tcp.header_length, 16);
+    EXPECT_EQ(tcp.source_port, 12345);
+    EXPECT_EQ(tcp.acknowledgment_number, 2u);
+    EXPECT_EQ(tcp.flags, 0x12);
+
+    PacketParser::IPv4View view;
+    EXPECT_FALSE(PacketParser::view_ipv4(frame.data(), frame.size(), 14, view));
+}
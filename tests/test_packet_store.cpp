@@ -0,0 +1,456 @@
+#include <gtest/gtest.h>
+#include "netlyzer/core/packet_store.h"
+#include <atomic>
+#include <cstring>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+// Ethernet/IPv4/UDP frame from 10.0.0.<source> to 10.0.0.<dest>.
+Bytes udp_frame(uint8_t source, uint8_t dest, uint16_t source_port, uint16_t dest_port, size_t payload = 0)
+{
+    const size_t total = 28 + payload;
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                   0x45, 0, static_cast<uint8_t>(total >> 8), static_cast<uint8_t>(total), 0, 1, 0x40, 0,
+                   64, 17, 0, 0, 10, 0, 0, source, 10, 0, 0, dest,
+                   static_cast<uint8_t>(source_port >> 8), static_cast<uint8_t>(source_port),
+                   static_cast<uint8_t>(dest_port >> 8), static_cast<uint8_t>(dest_port),
+                   static_cast<uint8_t>((8 + payload) >> 8), static_cast<uint8_t>(8 + payload), 0, 0};
+    frame.resize(frame.size() + payload, 0x5a);
+    return frame;
+}
+
+Bytes arp_frame()
+{
+    return {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0, 1, 2, 3, 4, 5, 0x08, 0x06,
+            0, 1, 0x08, 0x00, 6, 4, 0, 1, 0, 1, 2, 3, 4, 5, 192, 168, 1, 1,
+            0, 0, 0, 0, 0, 0, 192, 168, 1, 2};
+}
+
+size_t add(PacketStore& store, const Bytes& frame, uint64_t timestamp_ns, uint32_t length = 0,
+           uint32_t extra_flags = 0)
+{
+    DecodedPacket packet;
+    const uint32_t size = static_cast<uint32_t>(frame.size());
+    PacketDecoder::decode(frame.data(), size, length ? length : size, packet);
+    packet.flags |= extra_flags;
+    return store.append(timestamp_ns, length ? length : size, 1, frame.data(), size, packet);
+}
+
+} // namespace
+
+TEST(PacketStoreTest, RowsReadBackWhatWasAppended) {
+    PacketStore store;
+    const Bytes first = udp_frame(1, 2, 5353, 53, 10);
+    const Bytes second = arp_frame();
+    EXPECT_EQ(0u, add(store, first, 1000, 1500));
+    EXPECT_EQ(1u, add(store, second, 2000));
+    ASSERT_EQ(2u, store.size());
+
+    const PacketStore::Row udp = store[0];
+    EXPECT_EQ(1u, udp.number());
+    EXPECT_EQ(1000u, udp.timestamp_ns());
+    EXPECT_EQ(1500u, udp.length());
+    EXPECT_EQ(first.size(), udp.captured_length());
+    EXPECT_EQ(1, udp.interface_id());
+    EXPECT_TRUE(udp.has(DecodedPacket::UDP));
+    EXPECT_EQ(17, udp.ip_protocol());
+    EXPECT_EQ(5353, udp.source_port());
+    EXPECT_EQ(53, udp.dest_port());
+    EXPECT_STREQ("UDP", udp.protocol_name());
+    EXPECT_EQ(0, std::memcmp(udp.data(), first.data(), first.size()));
+    const uint8_t source[4] = {10, 0, 0, 1};
+    EXPECT_EQ(0, std::memcmp(udp.source_address(), source, 4));
+
+    const PacketStore::Row arp = store[1];
+    EXPECT_STREQ("ARP", arp.protocol_name());
+    EXPECT_EQ(0, std::memcmp(arp.data(), second.data(), second.size()));
+
+    DecodedPacket expected;
+    PacketDecoder::decode(first.data(), static_cast<uint32_t>(first.size()), 1500, expected);
+    DecodedPacket decoded;
+    udp.decode(decoded);
+    EXPECT_EQ(0, std::memcmp(&expected, &decoded, sizeof(decoded)));
+}
+
+TEST(PacketStoreTest, DecodeKeepsFlagsSetAfterDecoding) {
+    PacketStore store;
+    add(store, udp_frame(1, 2, 1, 2), 0, 0, DecodedPacket::CHECKSUM_VERIFIED | DecodedPacket::REASSEMBLED);
+
+    DecodedPacket decoded;
+    store[0].decode(decoded);
+    EXPECT_TRUE(decoded.has(DecodedPacket::UDP));
+    EXPECT_TRUE(decoded.has(DecodedPacket::CHECKSUM_VERIFIED));
+    EXPECT_TRUE(decoded.has(DecodedPacket::REASSEMBLED));
+}
+
+TEST(PacketStoreTest, DictionariesHoldEachValueOnce) {
+    PacketStore store;
+    for (int i = 0; i < 1000; ++i)
+        add(store, udp_frame(static_cast<uint8_t>(i % 10), static_cast<uint8_t>(100 + i % 3), 1, 2), i);
+
+    const PacketStore::Contents& contents = store.contents();
+    EXPECT_EQ(13u, contents.address_count());
+    EXPECT_EQ(1u, contents.protocol_count());
+    const uint8_t address[16] = {10, 0, 0, 101};
+    const uint32_t id = contents.find_address(address);
+    ASSERT_NE(PacketStore::NO_ADDRESS, id);
+    EXPECT_EQ(id, contents.dest_addresses()[1]);
+    const uint8_t unseen[16] = {10, 0, 0, 200};
+    EXPECT_EQ(PacketStore::NO_ADDRESS, contents.find_address(unseen));
+}
+
+TEST(PacketStoreTest, ColumnsScanBlockByBlock) {
+    PacketStore store;
+    const Bytes frame = udp_frame(1, 2, 1, 2);
+    const size_t count = PacketStore::BLOCK_ROWS * 2 + 100;
+    for (size_t i = 0; i < count; ++i)
+        add(store, frame, i, static_cast<uint32_t>(frame.size() + i % 7));
+
+    const PacketStore::Contents& contents = store.contents();
+    const auto& lengths = contents.lengths();
+    ASSERT_EQ(3u, PacketStore::block_count(count));
+    EXPECT_EQ(100u, PacketStore::block_size(2, count));
+    uint64_t scanned = 0;
+    for (size_t block = 0; block < PacketStore::block_count(count); ++block) {
+        const uint32_t* values = lengths.block(block);
+        for (size_t i = 0; i < PacketStore::block_size(block, count); ++i)
+            scanned += values[i];
+    }
+    uint64_t expected = 0;
+    for (size_t i = 0; i < count; ++i)
+        expected += frame.size() + i % 7;
+    EXPECT_EQ(expected, scanned);
+    EXPECT_EQ(count - 1, store[count - 1].timestamp_ns());
+
+    // Blocks are allocated whole; counted that way, a row stays under 64 bytes.
+    EXPECT_LT(contents.metadata_bytes(), PacketStore::block_count(count) * PacketStore::BLOCK_ROWS * 64);
+    EXPECT_EQ(count * frame.size(), contents.data_bytes());
+}
+
+TEST(PacketStoreTest, LargePacketsGetTheirOwnChunk) {
+    PacketStore store;
+    const Bytes small = udp_frame(1, 2, 1, 2, 100);
+    const Bytes large = udp_frame(3, 4, 1, 2, PacketStore::ARENA_CHUNK_SIZE);
+    add(store, small, 1);
+    add(store, large, 2);
+    add(store, small, 3);
+
+    EXPECT_EQ(0, std::memcmp(store[0].data(), small.data(), small.size()));
+    EXPECT_EQ(0, std::memcmp(store[1].data(), large.data(), large.size()));
+    EXPECT_EQ(0, std::memcmp(store[2].data(), small.data(), small.size()));
+
+    store.clear();
+    EXPECT_TRUE(store.empty());
+    EXPECT_EQ(0u, store.contents().data_bytes());
+    EXPECT_EQ(0u, store.contents().address_count());
+}
+
+TEST(PacketStoreTest, SnapshotOutlivesClear) {
+    PacketStore store;
+    const Bytes frame = udp_frame(1, 2, 1, 2, 20);
+    add(store, frame, 7);
+
+    PacketStore::Snapshot snapshot = store.snapshot();
+    store.clear();
+    add(store, udp_frame(3, 4, 1, 2), 8);
+
+    ASSERT_EQ(1u, snapshot->size());
+    EXPECT_EQ(7u, (*snapshot)[0].timestamp_ns());
+    EXPECT_EQ(0, std::memcmp((*snapshot)[0].data(), frame.data(), frame.size()));
+    EXPECT_EQ(8u, store[0].timestamp_ns());
+}
+
+TEST(PacketStoreTest, ReadersScanWhileTheWriterAppends) {
+    PacketStore store;
+    const size_t count = PacketStore::BLOCK_ROWS * 3;
+    std::vector<Bytes> frames;
+    for (uint8_t i = 0; i < 16; ++i)
+        frames.push_back(udp_frame(i, 100, 1000 + i, 53, i));
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> bad{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                PacketStore::Snapshot snapshot = store.snapshot();
+                // Every published row is complete: its port, length and
+                // bytes all belong to the same frame.
+                const size_t rows = snapshot->size();
+                for (size_t i = rows > 4096 ? rows - 4096 : 0; i < rows; ++i) {
+                    const PacketStore::Row row = (*snapshot)[i];
+                    const size_t frame = row.source_port() - 1000;
+                    if (frame >= frames.size() || row.timestamp_ns() != i
+                        || row.captured_length() != frames[frame].size()
+                        || std::memcmp(row.data(), frames[frame].data(), frames[frame].size()) != 0
+                        || std::strcmp(row.protocol_name(), "UDP") != 0
+                        || row.source_address()[3] != frame)
+                        ++bad;
+                }
+            }
+        });
+    }
+
+    for (size_t i = 0; i < count; ++i) {
+        add(store, frames[i % frames.size()], i);
+        if (i == count / 2) {
+            store.clear();
+            for (size_t j = 0; j <= i; ++j)
+                add(store, frames[j % frames.size()], j);
+        }
+    }
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+    EXPECT_EQ(0u, bad.load());
+    EXPECT_EQ(count, store.size());
+}
+
+namespace {
+
+// A 1000-byte frame whose payload starts with its row index.
+Bytes numbered_frame(uint32_t index)
+{
+    Bytes frame = udp_frame(1, 2, 1, 2, 958);
+    std::memcpy(frame.data() + 42, &index, sizeof(index));
+    return frame;
+}
+
+bool holds_frame(const PacketStore::Row& row)
+{
+    const uint8_t* data = row.data();
+    const Bytes expected = numbered_frame(static_cast<uint32_t>(row.index()));
+    return data && row.captured_length() == expected.size()
+        && std::memcmp(data, expected.data(), expected.size()) == 0;
+}
+
+struct SpillDirectory {
+    SpillDirectory()
+    {
+        char path[] = "/tmp/netlyzer-test-XXXXXX";
+        name = mkdtemp(path);
+    }
+    ~SpillDirectory() { rmdir(name.c_str()); }
+
+    std::string name;
+};
+
+} // namespace
+
+TEST(PacketStoreTest, SpillsSealedSegmentsToStayWithinBudget) {
+    SpillDirectory directory;
+    PacketStore::Config config;
+    config.spill_directory = directory.name;
+    config.memory_budget = 3 * PacketStore::ARENA_CHUNK_SIZE;
+    PacketStore store(config);
+
+    const uint32_t count = 40000;          // about ten segments
+    for (uint32_t i = 0; i < count; ++i)
+        add(store, numbered_frame(i), i);
+
+    PacketStore::Statistics stats = store.get_statistics();
+    EXPECT_LE(stats.resident_bytes, config.memory_budget);
+    EXPECT_GE(stats.spilled_segments, 6u);
+    EXPECT_EQ(0u, stats.page_ins);
+    EXPECT_EQ(0u, stats.spill_errors);
+
+    // Everything reads back, paging spilled segments in as it goes.
+    PacketStore::Snapshot snapshot = store.snapshot();
+    size_t bad = 0;
+    for (uint32_t i = 0; i < count; ++i)
+        bad += holds_frame((*snapshot)[i]) ? 0 : 1;
+    EXPECT_EQ(0u, bad);
+
+    stats = store.get_statistics();
+    EXPECT_GE(stats.page_ins, 6u);
+    EXPECT_GE(stats.page_in_ns, stats.max_page_in_ns);
+    EXPECT_LE(stats.resident_bytes, config.memory_budget);
+
+    // The spill file was unlinked as soon as it was created.
+    EXPECT_EQ(0, rmdir(directory.name.c_str()));
+    mkdir(directory.name.c_str(), 0700);
+}
+
+TEST(PacketStoreTest, KeepsSegmentsInMemoryWhenSpillingFails) {
+    PacketStore::Config config;
+    config.spill_directory = "/nonexistent/netlyzer";
+    config.memory_budget = PacketStore::ARENA_CHUNK_SIZE;
+    PacketStore store(config);
+
+    for (uint32_t i = 0; i < 10000; ++i)
+        add(store, numbered_frame(i), i);
+
+    const PacketStore::Statistics stats = store.get_statistics();
+    EXPECT_GT(stats.spill_errors, 0u);
+    EXPECT_EQ(0u, stats.spilled_segments);
+    EXPECT_TRUE(holds_frame(store[0]));
+    EXPECT_TRUE(holds_frame(store[9999]));
+}
+
+TEST(PacketStoreTest, ReadersPageInWhileTheWriterSpills) {
+    SpillDirectory directory;
+    PacketStore::Config config;
+    config.spill_directory = directory.name;
+    config.memory_budget = 2 * PacketStore::ARENA_CHUNK_SIZE;
+    PacketStore store(config);
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> bad{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&, r] {
+            std::mt19937 random(r);
+            while (!done.load()) {
+                PacketStore::Snapshot snapshot = store.snapshot();
+                const size_t rows = snapshot->size();
+                for (int i = 0; i < 64 && rows > 0; ++i) {
+                    if (!holds_frame((*snapshot)[random() % rows]))
+                        ++bad;
+                }
+            }
+        });
+    }
+
+    for (uint32_t i = 0; i < 30000; ++i)
+        add(store, numbered_frame(i), i);
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+    EXPECT_EQ(0u, bad.load());
+    EXPECT_EQ(0u, store.get_statistics().spill_errors);
+}
+
+TEST(PacketStoreTest, ParsesCodecNames) {
+    PacketStore::Codec codec = PacketStore::Codec::None;
+    EXPECT_TRUE(PacketStore::parse_codec("zlib", codec));
+    EXPECT_EQ(PacketStore::Codec::Zlib, codec);
+    EXPECT_TRUE(PacketStore::parse_codec("lz4", codec));
+    EXPECT_EQ(PacketStore::Codec::Lz4, codec);
+    EXPECT_TRUE(PacketStore::parse_codec("none", codec));
+    EXPECT_EQ(PacketStore::Codec::None, codec);
+    EXPECT_FALSE(PacketStore::parse_codec("gzip", codec));
+}
+
+TEST(PacketStoreTest, CompressesSealedSegments) {
+    PacketStore::Config config;
+    config.codec = PacketStore::Codec::Zlib;
+    config.block_cache_bytes = 4 * PacketStore::COMPRESSION_BLOCK;
+    PacketStore store(config);
+
+    const uint32_t count = 20000;          // five segments
+    for (uint32_t i = 0; i < count; ++i)
+        add(store, numbered_frame(i), i);
+
+    PacketStore::Statistics stats = store.get_statistics();
+    EXPECT_EQ(4u, stats.compressed_segments);
+    // 4194 frames to a segment, 65 to a block.
+    EXPECT_EQ(4 * 4194000u, stats.uncompressed_bytes);
+    EXPECT_LT(stats.compressed_bytes * 5, stats.uncompressed_bytes);
+    // Only the segment being filled is kept whole.
+    EXPECT_EQ(PacketStore::ARENA_CHUNK_SIZE + stats.compressed_bytes, stats.resident_bytes);
+
+    size_t bad = 0;
+    for (uint32_t i = 0; i < count; ++i)
+        bad += holds_frame(store[i]) ? 0 : 1;
+    EXPECT_EQ(0u, bad);
+
+    stats = store.get_statistics();
+    EXPECT_EQ(4 * ((4194 + 64) / 65u), stats.block_decodes);
+    EXPECT_GE(stats.decode_ns, stats.max_decode_ns);
+    EXPECT_LE(stats.cached_bytes, config.block_cache_bytes);
+    EXPECT_GT(stats.cached_blocks, 0u);
+}
+
+TEST(PacketStoreTest, KeepsIncompressibleBlocksAsTheyAre) {
+    PacketStore::Config config;
+    config.codec = PacketStore::Codec::Lz4;
+    PacketStore store(config);
+
+    std::mt19937 random(7);
+    std::vector<Bytes> frames;
+    for (int i = 0; i < 4000; ++i) {
+        Bytes frame = udp_frame(1, 2, 1, 2, 1400);
+        for (size_t j = 42; j < frame.size(); ++j)
+            frame[j] = static_cast<uint8_t>(random());
+        add(store, frame, i);
+        frames.push_back(frame);
+    }
+
+    const PacketStore::Statistics stats = store.get_statistics();
+    ASSERT_EQ(1u, stats.compressed_segments);
+    EXPECT_LE(stats.compressed_bytes, stats.uncompressed_bytes);
+    for (size_t i = 0; i < frames.size(); ++i)
+        ASSERT_EQ(0, std::memcmp(frames[i].data(), store[i].data(), frames[i].size())) << i;
+}
+
+TEST(PacketStoreTest, SpillsCompressedSegments) {
+    SpillDirectory directory;
+    PacketStore::Config config;
+    config.spill_directory = directory.name;
+    config.memory_budget = PacketStore::ARENA_CHUNK_SIZE + (256u << 10);
+    config.codec = PacketStore::Codec::Zlib;
+    config.block_cache_bytes = PacketStore::COMPRESSION_BLOCK;
+    PacketStore store(config);
+
+    const uint32_t count = 40000;
+    for (uint32_t i = 0; i < count; ++i)
+        add(store, numbered_frame(i), i);
+
+    PacketStore::Statistics stats = store.get_statistics();
+    EXPECT_GT(stats.spilled_segments, 0u);
+    EXPECT_LE(stats.resident_bytes, config.memory_budget);
+    EXPECT_EQ(stats.compressed_bytes, stats.spilled_bytes + stats.resident_bytes - PacketStore::ARENA_CHUNK_SIZE);
+
+    PacketStore::Snapshot snapshot = store.snapshot();
+    size_t bad = 0;
+    for (uint32_t i = count; i-- > 0;)
+        bad += holds_frame((*snapshot)[i]) ? 0 : 1;
+    EXPECT_EQ(0u, bad);
+    stats = store.get_statistics();
+    EXPECT_GT(stats.page_ins, 0u);
+    EXPECT_EQ(0u, stats.spill_errors);
+    EXPECT_LE(stats.cached_bytes, config.block_cache_bytes);
+}
+
+TEST(PacketStoreTest, ReadersDecompressWhileTheWriterSeals) {
+    SpillDirectory directory;
+    PacketStore::Config config;
+    config.spill_directory = directory.name;
+    config.memory_budget = PacketStore::ARENA_CHUNK_SIZE + (128u << 10);
+    config.codec = PacketStore::Codec::Zlib;
+    config.block_cache_bytes = 2 * PacketStore::COMPRESSION_BLOCK;
+    PacketStore store(config);
+
+    std::atomic<bool> done{false};
+    std::atomic<size_t> bad{0};
+    std::vector<std::thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&, r] {
+            std::mt19937 random(r);
+            while (!done.load()) {
+                PacketStore::Snapshot snapshot = store.snapshot();
+                const size_t rows = snapshot->size();
+                for (int i = 0; i < 64 && rows > 0; ++i) {
+                    if (!holds_frame((*snapshot)[random() % rows]))
+                        ++bad;
+                }
+            }
+        });
+    }
+
+    for (uint32_t i = 0; i < 30000; ++i)
+        add(store, numbered_frame(i), i);
+    done = true;
+    for (auto& reader : readers)
+        reader.join();
+    EXPECT_EQ(0u, bad.load());
+    EXPECT_EQ(0u, store.get_statistics().spill_errors);
+}
@@ -0,0 +1,132 @@
+#include <gtest/gtest.h>
+#include "netlyzer/core/spsc_ring.h"
+#include "netlyzer/core/reorder_buffer.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+#include <vector>
+
+TEST(SpscRingTest, PushPopInOrder) {
+    SpscRing<int> ring(4);
+    EXPECT_EQ(ring.capacity(), 4u);
+    for (int i = 0; i < 4; ++i)
+        EXPECT_TRUE(ring.try_push(i));
+    EXPECT_FALSE(ring.try_push(99));
+
+    int value = -1;
+    for (int i = 0; i < 4; ++i) {
+        ASSERT_TRUE(ring.try_pop(value));
+        EXPECT_EQ(value, i);
+    }
+    EXPECT_FALSE(ring.try_pop(value));
+    EXPECT_TRUE(ring.empty());
+}
+
+TEST(SpscRingTest, TransfersAcrossThreads) {
+    SpscRing<uint64_t> ring(64);
+    const uint64_t count = 20000;
+
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < count; ++i) {
+            while (!ring.try_push(i))
+                std::this_thread::yield();
+        }
+    });
+
+    uint64_t expected = 0;
+    uint64_t value;
+    while (expected < count) {
+        if (ring.try_pop(value)) {
+            ASSERT_EQ(value, expected);
+            ++expected;
+        } else {
+            std::this_thread::yield();
+        }
+    }
+    producer.join();
+}
+
+TEST(ReorderBufferTest, MergesSourcesByTimestamp) {
+    ReorderBuffer<int> buffer(2, 16, 1000000);
+    buffer.push(0, 10, 10);
+    buffer.push(0, 30, 30);
+    buffer.push(1, 20, 20);
+    buffer.push(1, 40, 40);
+
+    std::vector<int> out;
+    auto sink = [&](uint64_t, int&& value) { out.push_back(value); };
+
+    // Source 1 may still produce something before 40, so 40 stays queued.
+    EXPECT_EQ(buffer.drain(sink), 3u);
+    EXPECT_EQ(out, (std::vector<int>{10, 20, 30}));
+
+    buffer.advance(0, 50);
+    EXPECT_EQ(buffer.drain(sink), 1u);
+    EXPECT_EQ(out.back(), 40);
+}
+
+TEST(ReorderBufferTest, WaitsForSilentSourceUntilDelay) {
+    ReorderBuffer<int> buffer(2, 16, 100);
+    std::vector<int> out;
+    auto sink = [&](uint64_t, int&& value) { out.push_back(value); };
+
+    buffer.push(0, 1000, 1);
+    EXPECT_EQ(buffer.drain(sink), 0u);
+
+    buffer.push(0, 1100, 2);
+    EXPECT_EQ(buffer.drain(sink), 1u);
+    EXPECT_EQ(buffer.get_statistics().forced, 1u);
+
+    // Nothing newer arrives, but the clock moves on.
+    EXPECT_EQ(buffer.drain(sink, 1200), 1u);
+    EXPECT_EQ(out, (std::vector<int>{1, 2}));
+}
+
+TEST(ReorderBufferTest, FullSourceDropsOnlyItsOwnPackets) {
+    ReorderBuffer<int> buffer(2, 2, 1000);
+    EXPECT_TRUE(buffer.push(0, 1, 1));
+    EXPECT_TRUE(buffer.push(0, 2, 2));
+    EXPECT_FALSE(buffer.push(0, 3, 3));
+    EXPECT_TRUE(buffer.push(1, 1, 4));
+
+    EXPECT_EQ(buffer.dropped(0), 1u);
+    EXPECT_EQ(buffer.dropped(1), 0u);
+
+    std::vector<int> out;
+    buffer.drain([&](uint64_t, int&& value) { out.push_back(value); }, 0, true);
+    EXPECT_EQ(out.size(), 3u);
+}
+
+TEST(ReorderBufferTest, StaysOrderedWhileSourcesPushConcurrently) {
+    constexpr size_t SOURCES = 4;
+    constexpr uint64_t PER_SOURCE = 20000;
+    ReorderBuffer<int> buffer(SOURCES, 64, UINT64_MAX / 2);
+
+    std::atomic<size_t> finished{0};
+    std::vector<std::thread> producers;
+    for (size_t source = 0; source < SOURCES; ++source) {
+        producers.emplace_back([&, source] {
+            for (uint64_t i = 0; i < PER_SOURCE; ++i) {
+                const uint64_t timestamp = i * SOURCES + source + 1;
+                while (!buffer.push(source, timestamp, 0))
+                    std::this_thread::yield();
+            }
+            buffer.advance(source, UINT64_MAX / 4);
+            finished.fetch_add(1);
+        });
+    }
+
+    std::vector<uint64_t> out;
+    auto sink = [&](uint64_t timestamp, int&&) { out.push_back(timestamp); };
+    while (finished.load() < SOURCES) {
+        if (buffer.drain(sink) == 0)
+            std::this_thread::yield();
+    }
+    for (auto& producer : producers)
+        producer.join();
+    buffer.drain(sink, 0, true);
+
+    ASSERT_EQ(out.size(), SOURCES * PER_SOURCE);
+    EXPECT_TRUE(std::is_sorted(out.begin(), out.end()));
+    EXPECT_EQ(buffer.get_statistics().late, 0u);
+}
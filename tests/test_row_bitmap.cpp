@@ -0,0 +1,117 @@
+#include <gtest/gtest.h>
+#include "netlyzer/core/row_bitmap.h"
+#include <random>
+#include <set>
+#include <vector>
+
+namespace {
+
+RowBitmap from_set(const std::set<uint32_t>& rows)
+{
+    RowBitmap bitmap;
+    for (uint32_t row : rows)
+        bitmap.add(row);
+    return bitmap;
+}
+
+std::vector<uint32_t> to_vector(const std::set<uint32_t>& rows)
+{
+    return std::vector<uint32_t>(rows.begin(), rows.end());
+}
+
+// Some chunks sparse, some dense, some absent.
+std::set<uint32_t> random_rows(std::mt19937& random)
+{
+    std::set<uint32_t> rows;
+    for (uint32_t chunk = 0; chunk < 8; ++chunk) {
+        const uint32_t kind = random() % 3;
+        const size_t count = kind == 0 ? 0 : kind == 1 ? random() % 200 : 3000 + random() % 20000;
+        for (size_t i = 0; i < count; ++i)
+            rows.insert((chunk << 16) | (random() & 0xffff));
+    }
+    return rows;
+}
+
+} // namespace
+
+TEST(RowBitmapTest, AddsAndFindsRows) {
+    RowBitmap bitmap;
+    EXPECT_TRUE(bitmap.empty());
+    for (uint32_t row : {5u, 70000u, 3u, 70000u, 0xffffffffu})
+        bitmap.add(row);
+    EXPECT_EQ(4u, bitmap.cardinality());
+    EXPECT_TRUE(bitmap.contains(3));
+    EXPECT_TRUE(bitmap.contains(70000));
+    EXPECT_TRUE(bitmap.contains(0xffffffffu));
+    EXPECT_FALSE(bitmap.contains(4));
+    EXPECT_EQ((std::vector<uint32_t>{3, 5, 70000, 0xffffffffu}), bitmap.to_vector());
+}
+
+TEST(RowBitmapTest, DenseChunksSwitchToBitsAndBack) {
+    RowBitmap bitmap;
+    for (uint32_t row = 0; row < 65536; row += 2)
+        bitmap.add(row);
+    EXPECT_EQ(32768u, bitmap.cardinality());
+    // A dense chunk costs 8 KiB instead of two bytes a row.
+    EXPECT_LT(bitmap.memory_bytes(), 9000u);
+
+    const RowBitmap sparse = bitmap & RowBitmap::range(0, 100);
+    EXPECT_EQ(50u, sparse.cardinality());
+    EXPECT_LT(sparse.memory_bytes(), 1000u);
+    EXPECT_EQ(sparse, RowBitmap::range(0, 100).and_not(RowBitmap::range(0, 100).and_not(bitmap)));
+}
+
+TEST(RowBitmapTest, RangesCoverExactlyTheirRows) {
+    const RowBitmap range = RowBitmap::range(65530, 200000);
+    EXPECT_EQ(200000u - 65530u, range.cardinality());
+    EXPECT_FALSE(range.contains(65529));
+    EXPECT_TRUE(range.contains(65530));
+    EXPECT_TRUE(range.contains(131072));
+    EXPECT_TRUE(range.contains(199999));
+    EXPECT_FALSE(range.contains(200000));
+    EXPECT_TRUE(RowBitmap::range(7, 7).empty());
+
+    // Both ends inside one dense chunk.
+    const RowBitmap inner = RowBitmap::range(100, 10001);
+    std::vector<uint32_t> expected;
+    for (uint32_t row = 100; row < 10001; ++row)
+        expected.push_back(row);
+    EXPECT_EQ(expected, inner.to_vector());
+}
+
+TEST(RowBitmapTest, SetOperationsMatchStdSet) {
+    std::mt19937 random(11);
+    for (int round = 0; round < 20; ++round) {
+        const std::set<uint32_t> a = random_rows(random);
+        const std::set<uint32_t> b = random_rows(random);
+        std::set<uint32_t> both;
+        std::set<uint32_t> either = a;
+        std::set<uint32_t> only_a;
+        for (uint32_t row : a)
+            (b.count(row) ? both : only_a).insert(row);
+        either.insert(b.begin(), b.end());
+
+        const RowBitmap x = from_set(a);
+        const RowBitmap y = from_set(b);
+        EXPECT_EQ(to_vector(both), (x & y).to_vector());
+        EXPECT_EQ(to_vector(either), (x | y).to_vector());
+        EXPECT_EQ(to_vector(only_a), x.and_not(y).to_vector());
+        EXPECT_EQ(both.size(), (x & y).cardinality());
+        EXPECT_EQ(either.size(), (x | y).cardinality());
+        EXPECT_EQ(x | y, y | x);
+    }
+}
+
+TEST(RowBitmapTest, UnionOfManySetsMatchesRepeatedOr) {
+    std::mt19937 random(5);
+    std::vector<RowBitmap> sets;
+    for (int i = 0; i < 12; ++i)
+        sets.push_back(from_set(random_rows(random)));
+    std::vector<const RowBitmap*> pointers;
+    RowBitmap expected;
+    for (const RowBitmap& set : sets) {
+        pointers.push_back(&set);
+        expected |= set;
+    }
+    EXPECT_EQ(expected.to_vector(), RowBitmap::union_of(pointers).to_vector());
+}
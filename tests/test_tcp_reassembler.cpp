@@ -0,0 +1,273 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/tcp_reassembler.h"
+#include <algorithm>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Bytes = std::vector<uint8_t>;
+
+constexpr uint64_t SECOND = 1000000000ull;
+constexpr uint8_t FIN = 0x01;
+constexpr uint8_t SYN = 0x02;
+constexpr uint8_t RST = 0x04;
+constexpr uint8_t ACK = 0x10;
+
+constexpr uint32_t CLIENT_ISN = 1000;
+constexpr uint32_t SERVER_ISN = 0xfffffff0;     // wraps after 15 bytes
+
+// Ethernet/IPv4/TCP frame; `reply` swaps 10.0.0.1:40000 and 10.0.0.2:80.
+PacketBuffer segment(bool reply, uint32_t sequence, uint8_t flags, const std::string& payload = std::string())
+{
+    const size_t total = 20 + 20 + payload.size();
+    const uint8_t client = reply ? 2 : 1;
+    const uint8_t server = reply ? 1 : 2;
+    const uint16_t source_port = reply ? 80 : 40000;
+    const uint16_t dest_port = reply ? 40000 : 80;
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x08, 0x00,
+                   0x45, 0, static_cast<uint8_t>(total >> 8), static_cast<uint8_t>(total), 0, 1, 0x40, 0,
+                   64, 6, 0, 0, 10, 0, 0, client, 10, 0, 0, server,
+                   static_cast<uint8_t>(source_port >> 8), static_cast<uint8_t>(source_port),
+                   static_cast<uint8_t>(dest_port >> 8), static_cast<uint8_t>(dest_port),
+                   static_cast<uint8_t>(sequence >> 24), static_cast<uint8_t>(sequence >> 16),
+                   static_cast<uint8_t>(sequence >> 8), static_cast<uint8_t>(sequence),
+                   0, 0, 0, 0, 0x50, flags, 0xff, 0xff, 0, 0, 0, 0};
+    frame.insert(frame.end(), payload.begin(), payload.end());
+    return PacketBuffer::copy_of(frame.data(), static_cast<uint32_t>(frame.size()));
+}
+
+struct Collector {
+    std::string text[2];
+    std::vector<TcpReassembler::Chunk> chunks;
+    TcpStreamIndex index;
+
+    TcpReassembler::ChunkCallback callback()
+    {
+        return [this](const TcpReassembler::Chunk& chunk) {
+            if (chunk.gap)
+                text[chunk.direction] += '|';
+            text[chunk.direction].append(reinterpret_cast<const char*>(chunk.data), chunk.length);
+            chunks.push_back(chunk);
+            index.append(chunk);
+        };
+    }
+};
+
+uint64_t feed(TcpReassembler& reassembler, const PacketBuffer& frame, uint64_t packet_id = 0,
+              uint64_t timestamp_ns = SECOND)
+{
+    DecodedPacket packet;
+    PacketDecoder::decode(frame.data(), frame.size(), frame.size(), packet);
+    EXPECT_TRUE(packet.has(DecodedPacket::TCP));
+    return reassembler.add(frame, packet, packet_id, timestamp_ns);
+}
+
+void handshake(TcpReassembler& reassembler)
+{
+    feed(reassembler, segment(false, CLIENT_ISN, SYN));
+    feed(reassembler, segment(true, SERVER_ISN, SYN | ACK));
+}
+
+} // namespace
+
+TEST(TcpReassemblerTest, DeliversBothDirectionsInOrder) {
+    Collector collector;
+    TcpReassembler reassembler(collector.callback());
+
+    // The SYN-ACK arrives first; the client is still direction 0.
+    feed(reassembler, segment(true, SERVER_ISN, SYN | ACK));
+    feed(reassembler, segment(false, CLIENT_ISN, SYN));
+    feed(reassembler, segment(false, CLIENT_ISN + 1, ACK, "GET / HTTP/1.1\r\n"));
+    feed(reassembler, segment(true, SERVER_ISN + 1, ACK, "HTTP/1.1 200 OK\r\n"));
+    feed(reassembler, segment(true, SERVER_ISN + 18, ACK | FIN, "done"));
+
+    EXPECT_EQ("GET / HTTP/1.1\r\n", collector.text[0]);
+    EXPECT_EQ("HTTP/1.1 200 OK\r\ndone", collector.text[1]);
+    ASSERT_EQ(3u, collector.chunks.size());
+    EXPECT_EQ(17u, collector.chunks[2].offset);
+
+    const TcpReassembler::Statistics stats = reassembler.get_statistics();
+    EXPECT_EQ(1u, stats.streams);
+    EXPECT_EQ(37u, stats.delivered_bytes);
+    EXPECT_EQ(0u, stats.held_bytes);
+}
+
+TEST(TcpReassemblerTest, BuffersOutOfOrderAcrossWraparound) {
+    Collector collector;
+    TcpReassembler reassembler(collector.callback());
+    handshake(reassembler);
+
+    feed(reassembler, segment(true, SERVER_ISN + 21, ACK, "three"));
+    feed(reassembler, segment(true, SERVER_ISN + 11, ACK, "two-wraps!"));
+    EXPECT_EQ("", collector.text[1]);
+    EXPECT_GT(reassembler.get_statistics().held_bytes, 0u);
+
+    feed(reassembler, segment(true, SERVER_ISN + 1, ACK, "one-------"));
+    EXPECT_EQ("one-------two-wraps!three", collector.text[1]);
+    EXPECT_EQ(2u, reassembler.get_statistics().out_of_order);
+    EXPECT_EQ(0u, reassembler.get_statistics().held_bytes);
+}
+
+TEST(TcpReassemblerTest, TrimsRetransmissionsAndOverlaps) {
+    Collector collector;
+    TcpReassembler reassembler(collector.callback());
+    handshake(reassembler);
+
+    feed(reassembler, segment(false, CLIENT_ISN + 1, ACK, "abcdef"));
+    feed(reassembler, segment(false, CLIENT_ISN + 1, ACK, "abcdef"));        // retransmission
+    feed(reassembler, segment(false, CLIENT_ISN + 4, ACK, "defghi"));        // overlaps by 3
+    feed(reassembler, segment(false, CLIENT_ISN + 13, ACK, "mn"));
+    feed(reassembler, segment(false, CLIENT_ISN + 13, ACK, "mn"));           // waiting copy
+    feed(reassembler, segment(false, CLIENT_ISN + 10, ACK, "jklm"));         // fills and overlaps
+
+    EXPECT_EQ("abcdefghijklmn", collector.text[0]);
+    EXPECT_EQ(6u + 3u + 2u + 1u, reassembler.get_statistics().retransmitted_bytes);
+}
+
+TEST(TcpReassemblerTest, SpillsWhenTheFlowBudgetRunsOut) {
+    Collector collector;
+    TcpReassembler::Config config;
+    config.max_flow_bytes = 2 * segment(false, 0, ACK, "B").capacity();
+    TcpReassembler reassembler(config, collector.callback());
+    handshake(reassembler);
+
+    feed(reassembler, segment(false, CLIENT_ISN + 11, ACK, "B"));
+    feed(reassembler, segment(false, CLIENT_ISN + 21, ACK, "C"));
+    feed(reassembler, segment(false, CLIENT_ISN + 31, ACK, "D"));
+    EXPECT_EQ("|B|C|D", collector.text[0]);
+    EXPECT_EQ(3u, reassembler.get_statistics().gaps);
+    EXPECT_EQ(0u, reassembler.get_statistics().held_bytes);
+
+    // The hole has been given up on; late data for it is a retransmission.
+    feed(reassembler, segment(false, CLIENT_ISN + 1, ACK, "A"));
+    feed(reassembler, segment(false, CLIENT_ISN + 32, ACK, "E"));
+    EXPECT_EQ("|B|C|DE", collector.text[0]);
+    EXPECT_EQ(31u, collector.chunks.back().offset);
+}
+
+TEST(TcpReassemblerTest, OverflowingSegmentKeepsItsPlaceAmongTheWaiting) {
+    Collector collector;
+    TcpReassembler::Config config;
+    config.max_flow_bytes = 2 * segment(false, 0, ACK, "B").capacity();
+    TcpReassembler reassembler(config, collector.callback());
+    handshake(reassembler);
+
+    feed(reassembler, segment(false, CLIENT_ISN + 21, ACK, "B"));
+    feed(reassembler, segment(false, CLIENT_ISN + 31, ACK, "C"));
+    // Over the budget, and ahead of both waiting segments.
+    feed(reassembler, segment(false, CLIENT_ISN + 11, ACK, "A"));
+    EXPECT_EQ("|A|B|C", collector.text[0]);
+
+    const TcpReassembler::Statistics stats = reassembler.get_statistics();
+    EXPECT_EQ(0u, stats.retransmitted_bytes);
+    EXPECT_EQ(3u, stats.delivered_bytes);
+    EXPECT_EQ(0u, stats.held_bytes);
+}
+
+TEST(TcpReassemblerTest, DropsWhenTheGlobalBudgetRunsOut) {
+    Collector collector;
+    TcpReassembler::Config config;
+    config.max_bytes = segment(false, 0, ACK, "B").capacity();
+    config.policy = TcpReassembler::Policy::Drop;
+    TcpReassembler reassembler(config, collector.callback());
+    handshake(reassembler);
+
+    feed(reassembler, segment(false, CLIENT_ISN + 1, ACK, "A"));
+    feed(reassembler, segment(false, CLIENT_ISN + 11, ACK, "B"));
+    feed(reassembler, segment(true, SERVER_ISN + 11, ACK, "Y"));
+    EXPECT_EQ("A", collector.text[0]);
+    EXPECT_EQ("", collector.text[1]);
+
+    const TcpReassembler::Statistics stats = reassembler.get_statistics();
+    EXPECT_EQ(2u, stats.dropped_bytes);
+    EXPECT_EQ(0u, stats.held_bytes);
+
+    // Both directions moved past what was dropped.
+    feed(reassembler, segment(false, CLIENT_ISN + 12, ACK, "C"));
+    feed(reassembler, segment(true, SERVER_ISN + 12, ACK, "Z"));
+    EXPECT_EQ("A|C", collector.text[0]);
+    EXPECT_EQ("|Z", collector.text[1]);
+}
+
+TEST(TcpReassemblerTest, SeparatesStreamsAndExpiresIdleOnes) {
+    Collector collector;
+    TcpReassembler reassembler(collector.callback());
+
+    EXPECT_EQ(0u, feed(reassembler, segment(false, CLIENT_ISN, SYN)));
+    feed(reassembler, segment(false, CLIENT_ISN + 5, ACK, "late"));
+    feed(reassembler, segment(true, SERVER_ISN, RST | ACK));
+    EXPECT_EQ("|late", collector.text[0]);
+
+    // The same ports again after the reset are a new connection.
+    EXPECT_EQ(1u, feed(reassembler, segment(false, 5000, SYN, "")));
+    feed(reassembler, segment(false, 5011, ACK, "held"), 0, 2 * SECOND);
+    EXPECT_EQ(1u, reassembler.get_statistics().active_streams);
+
+    reassembler.expire(2 * SECOND + 121 * SECOND);
+    EXPECT_EQ("|late|held", collector.text[0]);
+    EXPECT_EQ(0u, reassembler.get_statistics().active_streams);
+    EXPECT_EQ(2u, reassembler.get_statistics().streams);
+}
+
+TEST(TcpReassemblerTest, CopiesPlainBytesOnlyWhenTheyWait) {
+    Collector collector;
+    TcpReassembler reassembler(collector.callback());
+    handshake(reassembler);
+
+    // Fed from one scratch buffer that is overwritten after each call, as a
+    // caller reading frames out of a store would.
+    Bytes scratch;
+    auto feed_bytes = [&](const PacketBuffer& frame) {
+        scratch.assign(frame.data(), frame.data() + frame.size());
+        DecodedPacket packet;
+        PacketDecoder::decode(scratch.data(), scratch.size(), scratch.size(), packet);
+        reassembler.add(scratch.data(), static_cast<uint32_t>(scratch.size()), packet, 0, SECOND);
+        std::fill(scratch.begin(), scratch.end(), 'x');
+    };
+    feed_bytes(segment(false, CLIENT_ISN + 4, ACK, "def"));
+    EXPECT_EQ(1u, reassembler.get_statistics().out_of_order);
+    feed_bytes(segment(false, CLIENT_ISN + 1, ACK, "abc"));
+    EXPECT_EQ("abcdef", collector.text[0]);
+
+    ASSERT_EQ(2u, collector.chunks.size());
+    EXPECT_EQ(nullptr, collector.chunks[0].frame);      // delivered during the call
+}
+
+TEST(TcpStreamIndexTest, ReadsAcrossEntriesWithoutHoldingTheFrames) {
+    Collector collector;
+    TcpReassembler reassembler(collector.callback());
+    handshake(reassembler);
+
+    // Stands in for the packet store the GUI reads frames back from.
+    std::vector<PacketBuffer> frames = {segment(false, CLIENT_ISN + 1, ACK, "hello "),
+                                        segment(true, SERVER_ISN + 1, ACK, "HI"),
+                                        segment(false, CLIENT_ISN + 7, ACK, "world")};
+    for (size_t i = 0; i < frames.size(); ++i)
+        feed(reassembler, frames[i], i + 1);
+    for (const PacketBuffer& frame : frames)
+        EXPECT_EQ(1u, frame.use_count());
+    const TcpStreamIndex::FrameSource source = [&frames](uint64_t packet_id) -> const uint8_t* {
+        return packet_id >= 1 && packet_id <= frames.size() ? frames[packet_id - 1].data() : nullptr;
+    };
+
+    const TcpStreamIndex& index = collector.index;
+    ASSERT_EQ(13u, index.size());
+    EXPECT_EQ(11u, index.bytes(0));
+    EXPECT_EQ(2u, index.bytes(1));
+    EXPECT_EQ(3u, index.entries().size());
+    EXPECT_EQ(1u, index.find(7));
+    EXPECT_EQ(2u, index.find(8));
+    EXPECT_EQ(3u, index.find(13));
+
+    char text[32] = {};
+    EXPECT_EQ(6u, index.read(4, reinterpret_cast<uint8_t*>(text), 6, source));
+    EXPECT_EQ(std::string("o HIwo"), std::string(text));
+    EXPECT_EQ(3u, index.read(10, reinterpret_cast<uint8_t*>(text), sizeof(text), source));
+    EXPECT_EQ(0u, index.read(13, reinterpret_cast<uint8_t*>(text), sizeof(text), source));
+    EXPECT_EQ(3u, index.entries()[2].packet_id);
+
+    // A frame that is gone ends the read there.
+    frames[1] = PacketBuffer();
+    EXPECT_EQ(2u, index.read(4, reinterpret_cast<uint8_t*>(text), 6, source));
+}
@@ -0,0 +1,56 @@
+#include <gtest/gtest.h>
+#include "netlyzer/core/timestamp_formatter.h"
+#include <cstdlib>
+#include <ctime>
+
+namespace {
+
+// 2024-01-02 03:04:05 UTC
+constexpr uint64_t BASE_NS = 1704164645ULL * 1000000000ULL;
+
+class TimestampFormatterTest : public ::testing::Test {
+protected:
+    void SetUp() override
+    {
+        setenv("TZ", "UTC", 1);
+        tzset();
+    }
+};
+
+} // namespace
+
+TEST_F(TimestampFormatterTest, AbsoluteKeepsNanoseconds) {
+    TimestampFormatter formatter;
+    EXPECT_EQ(formatter.format(BASE_NS + 123456789), "03:04:05.123456789");
+    EXPECT_EQ(formatter.format(BASE_NS + 7), "03:04:05.000000007");
+    // Crossing into the next second refreshes the cached prefix.
+    EXPECT_EQ(formatter.format(BASE_NS + 1000000000), "03:04:06.000000000");
+    EXPECT_EQ(formatter.format(BASE_NS + 999999999), "03:04:05.999999999");
+
+    formatter.set_digits(6);
+    EXPECT_EQ(formatter.format(BASE_NS + 123456789), "03:04:05.123456");
+    formatter.set_digits(0);
+    EXPECT_EQ(formatter.format(BASE_NS + 123456789), "03:04:05");
+}
+
+TEST_F(TimestampFormatterTest, RelativeToReference) {
+    TimestampFormatter formatter(TimestampFormatter::Mode::Relative, 6);
+    formatter.set_reference(BASE_NS);
+    EXPECT_EQ(formatter.format(BASE_NS), "0.000000");
+    EXPECT_EQ(formatter.format(BASE_NS + 1500000), "0.001500");
+    EXPECT_EQ(formatter.format(BASE_NS + 3600ULL * 1000000000 + 42), "3600.000000");
+    EXPECT_EQ(formatter.format(BASE_NS - 250000000), "-0.250000");
+}
+
+TEST_F(TimestampFormatterTest, DeltaToPrevious) {
+    TimestampFormatter formatter(TimestampFormatter::Mode::Delta);
+    EXPECT_EQ(formatter.format(BASE_NS + 20, BASE_NS), "0.000000020");
+    EXPECT_EQ(formatter.format(BASE_NS, 0), "0.000000000");
+    EXPECT_EQ(formatter.format(BASE_NS, BASE_NS + 5), "0.000000000");
+    EXPECT_EQ(formatter.format(BASE_NS + 12000000000ULL, BASE_NS), "12.000000000");
+}
+
+TEST_F(TimestampFormatterTest, ConvertsTimeval) {
+    EXPECT_EQ(TimestampFormatter::from_timeval(10, 5, false), 10000005000ULL);
+    EXPECT_EQ(TimestampFormatter::from_timeval(10, 5, true), 10000000005ULL);
+}
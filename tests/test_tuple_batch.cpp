@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+#include "netlyzer/network/tuple_batch.h"
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace {
+
+using Frame = TupleExtractor::Frame;
+using Bytes = std::vector<uint8_t>;
+
+void append(Bytes& frame, std::initializer_list<uint8_t> bytes)
+{
+    frame.insert(frame.end(), bytes);
+}
+
+Bytes ipv4_frame(uint8_t protocol, uint8_t host, bool tagged = false)
+{
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11};
+    if (tagged)
+        append(frame, {0x81, 0x00, 0x00, 0x07});
+    append(frame, {0x08, 0x00});
+    append(frame, {0x45, 0, 0, 48, 0, 0, 0x40, 0, 64, protocol, 0, 0, 10, 0, 0, host, 192, 168, 0, 1});
+    if (protocol == 6)
+        append(frame, {0x04, 0xd2, 0x00, 0x50, 0, 0, 0, 1, 0, 0, 0, 0, 0x50, 0x12, 0xff, 0xff, 0, 0, 0, 0});
+    else
+        append(frame, {0x04, 0xd2, 0x00, 0x35, 0, 28, 0, 0});
+    frame.resize(frame.size() + 8, 0);
+    return frame;
+}
+
+Bytes ipv6_udp_frame()
+{
+    Bytes frame = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 0x86, 0xdd};
+    append(frame, {0x60, 0, 0, 0, 0, 8, 17, 64});
+    frame.resize(frame.size() + 32, 0);
+    frame[14 + 8 + 15] = 1;
+    frame[14 + 24 + 15] = 2;
+    append(frame, {0x13, 0x88, 0x13, 0x89, 0, 8, 0, 0});
+    return frame;
+}
+
+std::vector<Frame> frames_of(const std::vector<Bytes>& packets)
+{
+    std::vector<Frame> frames;
+    uint32_t second = 100;
+    for (const Bytes& bytes : packets) {
+        Frame frame;
+        frame.data = bytes.data();
+        frame.caplen = static_cast<uint32_t>(bytes.size());
+        frame.len = frame.caplen + 4;
+        frame.ts_sec = second++;
+        frame.ts_nsec = 5;
+        frames.push_back(frame);
+    }
+    return frames;
+}
+
+} // namespace
+
+TEST(TupleBatchTest, ExtractsColumns) {
+    std::vector<Bytes> packets = {ipv4_frame(6, 1), ipv4_frame(17, 2, true), ipv6_udp_frame(), Bytes(10, 0)};
+    std::vector<Frame> frames = frames_of(packets);
+    auto batch = std::make_unique<TupleBatch>();
+
+    ASSERT_EQ(TupleExtractor::extract(frames.data(), frames.size(), *batch), 4u);
+    ASSERT_EQ(batch->count, 4u);
+
+    EXPECT_EQ(batch->family[0], TupleBatch::IPV4);
+    EXPECT_EQ(batch->protocol[0], 6);
+    EXPECT_EQ(batch->source_ipv4[0], 0x0a000001u);
+    EXPECT_EQ(batch->dest_ipv4[0], 0xc0a80001u);
+    EXPECT_EQ(batch->source_port[0], 1234);
+    EXPECT_EQ(batch->dest_port[0], 80);
+    EXPECT_EQ(batch->tcp_flags[0], 0x12);
+    EXPECT_EQ(batch->ip_length[0], 48);
+    EXPECT_EQ(batch->timestamp_ns[0], 100000000005u);
+    EXPECT_EQ(batch->wire_length[0], frames[0].len);
+
+    EXPECT_EQ(batch->protocol[1], 17);
+    EXPECT_EQ(batch->dest_port[1], 53);
+    EXPECT_EQ(batch->tcp_flags[1], 0);
+
+    EXPECT_EQ(batch->family[2], TupleBatch::IPV6);
+    EXPECT_EQ(batch->source_ipv6[2][15], 1);
+    EXPECT_EQ(batch->dest_port[2], 5001);
+    EXPECT_EQ(batch->ip_length[2], 48);
+
+    EXPECT_EQ(batch->family[3], TupleBatch::OTHER);
+}
+
+TEST(TupleBatchTest, VectorPathMatchesScalar) {
+    // Every kind of frame in every lane position, plus captures cut short at
+    // each length, so the gather masks see all their edge cases.
+    std::vector<Bytes> packets;
+    for (int i = 0; i < 8; ++i) {
+        packets.push_back(ipv4_frame(6, static_cast<uint8_t>(i), i & 1));
+        packets.push_back(ipv4_frame(17, static_cast<uint8_t>(i), i & 2));
+        packets.push_back(ipv4_frame(1, static_cast<uint8_t>(i)));
+        packets.push_back(ipv6_udp_frame());
+    }
+    const Bytes full = ipv4_frame(6, 9, true);
+    for (size_t length = 0; length <= full.size(); ++length)
+        packets.emplace_back(full.begin(), full.begin() + static_cast<long>(length));
+    Bytes fragment = ipv4_frame(6, 10);
+    fragment[20] = 0x20;
+    packets.push_back(fragment);
+    Bytes options = ipv4_frame(17, 11);
+    options[14] = 0x46;
+    packets.push_back(options);
+
+    std::vector<Frame> frames = frames_of(packets);
+    auto best = std::make_unique<TupleBatch>();
+    auto scalar = std::make_unique<TupleBatch>();
+    size_t offset = 0;
+    while (offset < frames.size()) {
+        best->clear();
+        scalar->clear();
+        size_t taken = TupleExtractor::extract(frames.data() + offset, frames.size() - offset, *best);
+        ASSERT_EQ(TupleExtractor::extract(frames.data() + offset, frames.size() - offset, *scalar,
+                                          TupleExtractor::Path::Scalar), taken);
+        for (size_t i = 0; i < taken; ++i) {
+            SCOPED_TRACE(offset + i);
+            EXPECT_EQ(best->family[i], scalar->family[i]);
+            EXPECT_EQ(best->protocol[i], scalar->protocol[i]);
+            EXPECT_EQ(best->source_port[i], scalar->source_port[i]);
+            EXPECT_EQ(best->dest_port[i], scalar->dest_port[i]);
+            EXPECT_EQ(best->tcp_flags[i], scalar->tcp_flags[i]);
+            EXPECT_EQ(best->ip_length[i], scalar->ip_length[i]);
+            EXPECT_EQ(best->timestamp_ns[i], scalar->timestamp_ns[i]);
+            if (scalar->family[i] == TupleBatch::IPV4) {
+                EXPECT_EQ(best->source_ipv4[i], scalar->source_ipv4[i]);
+                EXPECT_EQ(best->dest_ipv4[i], scalar->dest_ipv4[i]);
+            }
+        }
+        offset += taken;
+    }
+}
+
+TEST(TupleBatchTest, StopsWhenFull) {
+    std::vector<Bytes> packets(TupleBatch::CAPACITY + 10, ipv4_frame(6, 1));
+    std::vector<Frame> frames = frames_of(packets);
+    auto batch = std::make_unique<TupleBatch>();
+    batch->count = 5;
+
+    EXPECT_EQ(TupleExtractor::extract(frames.data(), frames.size(), *batch), TupleBatch::CAPACITY - 5);
+    EXPECT_TRUE(batch->full());
+    EXPECT_EQ(TupleExtractor::extract(frames.data(), frames.size(), *batch), 0u);
+}